@@ -27,6 +27,7 @@
 #ifdef CFF_APPLICATION_IMPLEMENTATION
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
+#include "mipmap.h"
 #endif
 
 // Platform stuff
@@ -238,13 +239,26 @@ enum Texture_Format {
     TF_R8G8B8A8_UINT_SRGB,
     TF_DEPTH_STENCIL,
 
+    // block compressed, see texture_compression.h
+    TF_BC1_UNORM,
+    TF_BC1_UNORM_SRGB,
+    TF_BC3_UNORM,
+    TF_BC3_UNORM_SRGB,
+    TF_BC4_UNORM,
+    TF_BC5_UNORM,
+    TF_BC7_UNORM,
+    TF_BC7_UNORM_SRGB,
+
     TF_COUNT,
 };
 
+// Block compressed formats have no pixel size, they store 4x4 blocks of block_size_in_bytes each.
+// Use texture_row_pitch() and texture_level_size() instead of multiplying things out.
 struct Texture_Format_Info {
     int pixel_size_in_bytes;
     int num_channels;
     bool is_depth_format;
+    int block_size_in_bytes;
 };
 
 enum Texture_Type {
@@ -279,7 +293,7 @@ struct Texture_Description {
     Texture_Format format;
     Texture_Type type;
     Texture_Wrap_Mode wrap_mode;
-    byte *color_data;
+    byte *color_data; // for 2D textures mipmap_count levels back to back, largest first, see mipmap.h
 };
 
 struct Texture {
@@ -302,6 +316,9 @@ enum Vertex_Field_Type {
     VFT_FLOAT2,
     VFT_FLOAT3,
     VFT_FLOAT4,
+    VFT_HALF2,           // two 16 bit floats, read as float2
+    VFT_SNORM16_2,       // two 16 bit snorms, read as float2 in [-1, 1]
+    VFT_UNORM10_10_10_2, // read as float4 in [0, 1]
 
     VFT_COUNT,
 };
@@ -331,6 +348,23 @@ enum Buffer_Type {
     BT_COUNT,
 };
 
+// how map_buffer() hands out a dynamic buffer's memory
+enum Buffer_Map_Mode {
+    BMM_WRITE_DISCARD,      // fresh memory, whatever queued draws still read from stays untouched
+    BMM_WRITE_NO_OVERWRITE, // the same memory, the caller promises to only write where no queued draw reads
+
+    BMM_COUNT,
+};
+
+enum Index_Type {
+    IT_U32, // first so zero-initialized meshes get it
+    IT_U16,
+
+    IT_COUNT,
+};
+
+static inline int index_type_size(Index_Type type) { return type == IT_U16 ? 2 : 4; }
+
 enum Primitive_Topology {
     PT_TRIANGLE_LIST,
     PT_TRIANGLE_STRIP,
@@ -370,6 +404,8 @@ byte *load_texture_data_from_file(char *filename, int *width, int *height);
 void delete_texture_data(byte *data);
 
 Texture_Format_Info get_texture_format_info(Texture_Format format);
+u32 texture_row_pitch(Texture_Format format, int width);
+u32 texture_level_size(Texture_Format format, int width, int height);
 
 
 
@@ -391,9 +427,12 @@ void          bind_vertex_format(Vertex_Format format);
 
 Buffer create_buffer(Buffer_Type type, void *data, int len);
 void   update_buffer(Buffer buffer, void *data, int len);
+Buffer create_dynamic_buffer(Buffer_Type type, int len); // CPU written through map_buffer() instead of update_buffer()
+void  *map_buffer(Buffer buffer, Buffer_Map_Mode mode);
+void   unmap_buffer(Buffer buffer);
 void   destroy_buffer(Buffer buffer);
 void   bind_vertex_buffers(Buffer *buffers, int num_buffers, u32 start_slot, u32 *strides, u32 *offsets);
-void   bind_index_buffer(Buffer buffer, u32 slot);
+void   bind_index_buffer(Buffer buffer, u32 offset, Index_Type type = IT_U32);
 void   bind_constant_buffers(Buffer *buffers, int num_buffers, u32 start_slot);
 
 Vertex_Shader  compile_vertex_shader_from_file(wchar_t *filename);
@@ -401,6 +440,7 @@ void           destroy_vertex_shader(Vertex_Shader shader);
 Pixel_Shader   compile_pixel_shader_from_file(wchar_t *filename);
 void           destroy_pixel_shader(Pixel_Shader shader);
 void           bind_shaders(Vertex_Shader vertex, Pixel_Shader pixel);
+void           bind_vertex_shader(Vertex_Shader vertex); // leaves the pixel shader alone
 Compute_Shader compile_compute_shader_from_file(wchar_t *filename);
 void           bind_compute_shader(Compute_Shader shader);
 void           destroy_compute_shader(Compute_Shader shader);
@@ -440,7 +480,9 @@ void set_render_targets(Render_Target_Bindings bindings);
 void unset_render_targets();
 // void clear_bound_render_targets(Vector4 color);
 
-void issue_draw_call(int vertex_count, int index_count, int instance_count = 0);
+// start_index is where in the bound index buffer to start reading. base_vertex is added to every index
+// before the vertex is fetched, or for unindexed draws is the first vertex.
+void issue_draw_call(int vertex_count, int index_count, int instance_count = 0, int start_index = 0, int base_vertex = 0);
 void present(bool vsync);
 
 
@@ -856,10 +898,18 @@ void init_render_backend(Window *window) {
     texture_format_infos[TF_R8G8B8A8_UINT]      = {4,  4, false};
     texture_format_infos[TF_R8G8B8A8_UINT_SRGB] = {4,  4, false};
     texture_format_infos[TF_DEPTH_STENCIL]      = {4,  2, true};
+    texture_format_infos[TF_BC1_UNORM]          = {0,  4, false, 8};
+    texture_format_infos[TF_BC1_UNORM_SRGB]     = {0,  4, false, 8};
+    texture_format_infos[TF_BC3_UNORM]          = {0,  4, false, 16};
+    texture_format_infos[TF_BC3_UNORM_SRGB]     = {0,  4, false, 16};
+    texture_format_infos[TF_BC4_UNORM]          = {0,  1, false, 8};
+    texture_format_infos[TF_BC5_UNORM]          = {0,  2, false, 16};
+    texture_format_infos[TF_BC7_UNORM]          = {0,  4, false, 16};
+    texture_format_infos[TF_BC7_UNORM_SRGB]     = {0,  4, false, 16};
 
     // make sure all texture format infos are supplied
     for (int i = 0; i < ARRAYSIZE(texture_format_infos); i++) {
-        if (texture_format_infos[i].pixel_size_in_bytes == 0) {
+        if (texture_format_infos[i].pixel_size_in_bytes == 0 && texture_format_infos[i].block_size_in_bytes == 0) {
             if ((Texture_Format)i != TF_INVALID && (Texture_Format)i != TF_COUNT) {
                 printf("Missing texture_format_info for %d\n", i);
                 assert(false);
@@ -874,6 +924,23 @@ Texture_Format_Info get_texture_format_info(Texture_Format format) {
     return texture_format_infos[format];
 }
 
+// note(josh): a row of a block compressed texture is a row of blocks, 4 pixels tall. levels smaller
+// than a block still take up a whole one.
+u32 texture_row_pitch(Texture_Format format, int width) {
+    Texture_Format_Info info = texture_format_infos[format];
+    if (info.block_size_in_bytes != 0) {
+        return (u32)((width + 3) / 4) * (u32)info.block_size_in_bytes;
+    }
+    return (u32)width * (u32)info.pixel_size_in_bytes;
+}
+
+u32 texture_level_size(Texture_Format format, int width, int height) {
+    if (texture_format_infos[format].block_size_in_bytes != 0) {
+        return texture_row_pitch(format, width) * (u32)((height + 3) / 4);
+    }
+    return texture_row_pitch(format, width) * (u32)height;
+}
+
 void create_color_and_depth_buffers(Texture_Description description, Texture *out_color_buffer, Texture *out_depth_buffer) {
     assert(out_color_buffer != nullptr);
     assert(out_depth_buffer != nullptr);
@@ -910,10 +977,19 @@ Texture create_texture_from_file(char *filename, Texture_Format format, Texture_
     }
     defer(delete_texture_data(color_data));
 
+    Mipmap_Settings mipmap_settings = {};
+    mipmap_settings.filter = MIPMAP_FILTER_BOX;
+    mipmap_settings.srgb = format == TF_R8G8B8A8_UINT_SRGB;
+    int num_levels = mipmap_count(width, height);
+    byte *mipmaps = (byte *)alloc(default_allocator(), (int)mipmap_chain_size(IMAGE_FORMAT_RGBA8, width, height, num_levels));
+    defer(free(default_allocator(), mipmaps));
+    generate_mipmaps(color_data, width, height, mipmap_settings, num_levels, mipmaps, default_allocator());
+
     Texture_Description texture_description = {};
     texture_description.width = width;
     texture_description.height = height;
-    texture_description.color_data = color_data;
+    texture_description.color_data = mipmaps;
+    texture_description.mipmap_count = num_levels;
     texture_description.format = format;
     texture_description.wrap_mode = wrap_mode;
     texture_description.type = TT_2D;
@@ -1030,6 +1106,14 @@ void init_graphics_driver(Window *window) {
     dx_texture_format_mapping[TF_R8G8B8A8_UINT]      = DXGI_FORMAT_R8G8B8A8_UNORM;
     dx_texture_format_mapping[TF_R8G8B8A8_UINT_SRGB] = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
     dx_texture_format_mapping[TF_DEPTH_STENCIL]      = DXGI_FORMAT_D24_UNORM_S8_UINT;
+    dx_texture_format_mapping[TF_BC1_UNORM]          = DXGI_FORMAT_BC1_UNORM;
+    dx_texture_format_mapping[TF_BC1_UNORM_SRGB]     = DXGI_FORMAT_BC1_UNORM_SRGB;
+    dx_texture_format_mapping[TF_BC3_UNORM]          = DXGI_FORMAT_BC3_UNORM;
+    dx_texture_format_mapping[TF_BC3_UNORM_SRGB]     = DXGI_FORMAT_BC3_UNORM_SRGB;
+    dx_texture_format_mapping[TF_BC4_UNORM]          = DXGI_FORMAT_BC4_UNORM;
+    dx_texture_format_mapping[TF_BC5_UNORM]          = DXGI_FORMAT_BC5_UNORM;
+    dx_texture_format_mapping[TF_BC7_UNORM]          = DXGI_FORMAT_BC7_UNORM;
+    dx_texture_format_mapping[TF_BC7_UNORM_SRGB]     = DXGI_FORMAT_BC7_UNORM_SRGB;
 
     // make sure all texture formats have a mapping
     for (int i = 0; i < ARRAYSIZE(dx_texture_format_mapping); i++) {
@@ -1306,6 +1390,9 @@ DXGI_FORMAT dx_vertex_field_type(Vertex_Field_Type vft) {
         case VFT_FLOAT2: return DXGI_FORMAT_R32G32_FLOAT;
         case VFT_FLOAT3: return DXGI_FORMAT_R32G32B32_FLOAT;
         case VFT_FLOAT4: return DXGI_FORMAT_R32G32B32A32_FLOAT;
+        case VFT_HALF2:           return DXGI_FORMAT_R16G16_FLOAT;
+        case VFT_SNORM16_2:       return DXGI_FORMAT_R16G16_SNORM;
+        case VFT_UNORM10_10_10_2: return DXGI_FORMAT_R10G10B10A2_UNORM;
         default: {
             ASSERTF(false, "Unknown vertex format type: %d", vft);
             return DXGI_FORMAT_UNKNOWN;
@@ -1376,13 +1463,45 @@ void update_buffer(Buffer buffer, void *data, int len) {
     directx.device_context->UpdateSubresource((ID3D11Resource *)buffer, 0, nullptr, data, (u32)len, 0);
 }
 
+Buffer create_dynamic_buffer(Buffer_Type type, int len) {
+    D3D11_BUFFER_DESC buffer_desc = {};
+    buffer_desc.Usage = D3D11_USAGE_DYNAMIC;
+    buffer_desc.ByteWidth = len;
+    buffer_desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+    switch (type) {
+        case BT_VERTEX:   { buffer_desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;   break; }
+        case BT_INDEX:    { buffer_desc.BindFlags = D3D11_BIND_INDEX_BUFFER;    break; }
+        case BT_CONSTANT: { buffer_desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER; break; }
+        default: {
+            ASSERTF(false, "Unknown buffer type: %d", type);
+        }
+    }
+
+    Buffer buffer = {};
+    auto result = directx.device->CreateBuffer(&buffer_desc, nullptr, &buffer);
+    ASSERT(result == S_OK);
+    return buffer;
+}
+
+void *map_buffer(Buffer buffer, Buffer_Map_Mode mode) {
+    // note(josh): D3D11_MAP_WRITE_NO_OVERWRITE on constant buffers needs 11.1, only use it on vertex and index buffers
+    D3D11_MAP map_type = mode == BMM_WRITE_NO_OVERWRITE ? D3D11_MAP_WRITE_NO_OVERWRITE : D3D11_MAP_WRITE_DISCARD;
+    D3D11_MAPPED_SUBRESOURCE mapped = {};
+    auto result = directx.device_context->Map((ID3D11Resource *)buffer, 0, map_type, 0, &mapped);
+    ASSERT(result == S_OK);
+    return mapped.pData;
+}
+
+void unmap_buffer(Buffer buffer) {
+    directx.device_context->Unmap((ID3D11Resource *)buffer, 0);
+}
+
 void bind_vertex_buffers(Buffer *buffers, int num_buffers, u32 start_slot, u32 *strides, u32 *offsets) {
     directx.device_context->IASetVertexBuffers(start_slot, num_buffers, buffers, strides, offsets);
 }
 
-void bind_index_buffer(Buffer buffer, u32 slot) {
-    // todo(josh): parameterize index type
-    directx.device_context->IASetIndexBuffer(buffer, DXGI_FORMAT_R32_UINT, slot);
+void bind_index_buffer(Buffer buffer, u32 offset, Index_Type type) {
+    directx.device_context->IASetIndexBuffer(buffer, type == IT_U16 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT, offset);
 }
 
 void bind_constant_buffers(Buffer *buffers, int num_buffers, u32 start_slot) {
@@ -1441,6 +1560,10 @@ void bind_shaders(Vertex_Shader vertex, Pixel_Shader pixel) {
     directx.device_context->PSSetShader(pixel, 0, 0);
 }
 
+void bind_vertex_shader(Vertex_Shader vertex) {
+    directx.device_context->VSSetShader(vertex.handle, 0, 0);
+}
+
 Compute_Shader compile_compute_shader_from_file(wchar_t *filename) {
     ID3D10Blob *errors = {};
     ID3D10Blob *compute_blob = {};
@@ -1533,21 +1656,21 @@ void destroy_compute_shader(Compute_Shader shader) {
     shader->Release();
 }
 
-void issue_draw_call(int vertex_count, int index_count, int instance_count) {
+void issue_draw_call(int vertex_count, int index_count, int instance_count, int start_index, int base_vertex) {
     if (instance_count == 0) {
         if (index_count > 0) {
-            directx.device_context->DrawIndexed((u32)index_count, 0, 0);
+            directx.device_context->DrawIndexed((u32)index_count, (u32)start_index, base_vertex);
         }
         else {
-            directx.device_context->Draw((u32)vertex_count, 0);
+            directx.device_context->Draw((u32)vertex_count, (u32)base_vertex);
         }
     }
     else {
         if (index_count > 0) {
-            directx.device_context->DrawIndexedInstanced((u32)index_count, (u32)instance_count, 0, 0, 0);
+            directx.device_context->DrawIndexedInstanced((u32)index_count, (u32)instance_count, (u32)start_index, base_vertex, 0);
         }
         else {
-            directx.device_context->DrawInstanced((u32)vertex_count, (u32)instance_count, 0, 0);
+            directx.device_context->DrawInstanced((u32)vertex_count, (u32)instance_count, (u32)base_vertex, 0);
         }
     }
 }
@@ -1565,6 +1688,11 @@ Texture create_texture(Texture_Description desc) {
         desc.format = TF_R8G8B8A8_UINT;
     }
 
+    if (texture_format_infos[desc.format].block_size_in_bytes != 0) {
+        ASSERT(desc.width % 4 == 0 && desc.height % 4 == 0 && "block compressed textures have to be a multiple of 4 in size");
+        ASSERT(!desc.render_target && !desc.uav);
+    }
+
     if (desc.wrap_mode == TWM_INVALID) {
         desc.wrap_mode = TWM_POINT_CLAMP;
     }
@@ -1577,7 +1705,8 @@ Texture create_texture(Texture_Description desc) {
         desc.mipmap_count = 1;
     }
 
-    ASSERT(desc.mipmap_count <= 1 && "mipmaps are not supported yet");
+    ASSERT(desc.mipmap_count <= D3D11_REQ_MIP_LEVELS);
+    ASSERT((desc.mipmap_count == 1 || desc.type == TT_2D || desc.color_data == nullptr) && "only 2D textures take data for more than one mip level");
 
     DXGI_FORMAT texture_format = dx_texture_format_mapping[desc.format];
 
@@ -1619,15 +1748,15 @@ Texture create_texture(Texture_Description desc) {
                 }
             }
 
-            u32 pixel_size = (u32)texture_format_infos[desc.format].pixel_size_in_bytes;
-            D3D11_SUBRESOURCE_DATA subresource_data[6] = {
-                {desc.color_data, pixel_size * (u32)desc.width,    0},
-                {desc.color_data, pixel_size * (u32)desc.width/2,  0},
-                {desc.color_data, pixel_size * (u32)desc.width/4,  0},
-                {desc.color_data, pixel_size * (u32)desc.width/8,  0},
-                {desc.color_data, pixel_size * (u32)desc.width/16, 0},
-                {desc.color_data, pixel_size * (u32)desc.width/32, 0},
-            };
+            D3D11_SUBRESOURCE_DATA subresource_data[D3D11_REQ_MIP_LEVELS] = {};
+            byte *level_data = desc.color_data;
+            for (int i = 0; i < desc.mipmap_count; i++) {
+                int level_width  = desc.width  >> i > 0 ? desc.width  >> i : 1;
+                int level_height = desc.height >> i > 0 ? desc.height >> i : 1;
+                subresource_data[i].pSysMem     = level_data;
+                subresource_data[i].SysMemPitch = texture_row_pitch(desc.format, level_width);
+                level_data += texture_level_size(desc.format, level_width, level_height);
+            }
 
             auto result = directx.device->CreateTexture2D(&texture_desc, desc.color_data == nullptr ? nullptr : &subresource_data[0], &texture_handle_2d);
             ASSERT(result == S_OK);
@@ -1667,14 +1796,13 @@ Texture create_texture(Texture_Description desc) {
                 }
             }
 
-            u32 pixel_size = (u32)texture_format_infos[desc.format].pixel_size_in_bytes;
             D3D11_SUBRESOURCE_DATA subresource_data[6] = {
-                {desc.color_data, pixel_size * (u32)desc.width,    pixel_size * ((u32)desc.width)    * ((u32)desc.height)   },
-                {desc.color_data, pixel_size * (u32)desc.width/2,  pixel_size * ((u32)desc.width/2)  * ((u32)desc.height/2) },
-                {desc.color_data, pixel_size * (u32)desc.width/4,  pixel_size * ((u32)desc.width/4)  * ((u32)desc.height/4) },
-                {desc.color_data, pixel_size * (u32)desc.width/8,  pixel_size * ((u32)desc.width/8)  * ((u32)desc.height/8) },
-                {desc.color_data, pixel_size * (u32)desc.width/16, pixel_size * ((u32)desc.width/16) * ((u32)desc.height/16)},
-                {desc.color_data, pixel_size * (u32)desc.width/32, pixel_size * ((u32)desc.width/32) * ((u32)desc.height/32)},
+                {desc.color_data, texture_row_pitch(desc.format, desc.width),    texture_level_size(desc.format, desc.width,    desc.height)   },
+                {desc.color_data, texture_row_pitch(desc.format, desc.width/2),  texture_level_size(desc.format, desc.width/2,  desc.height/2) },
+                {desc.color_data, texture_row_pitch(desc.format, desc.width/4),  texture_level_size(desc.format, desc.width/4,  desc.height/4) },
+                {desc.color_data, texture_row_pitch(desc.format, desc.width/8),  texture_level_size(desc.format, desc.width/8,  desc.height/8) },
+                {desc.color_data, texture_row_pitch(desc.format, desc.width/16), texture_level_size(desc.format, desc.width/16, desc.height/16)},
+                {desc.color_data, texture_row_pitch(desc.format, desc.width/32), texture_level_size(desc.format, desc.width/32, desc.height/32)},
             };
 
             auto result = directx.device->CreateTexture3D(&texture_desc, desc.color_data == nullptr ? nullptr : &subresource_data[0], &texture_handle_3d);
@@ -1707,14 +1835,13 @@ Texture create_texture(Texture_Description desc) {
                 }
             }
 
-            u32 pixel_size = (u32)texture_format_infos[desc.format].pixel_size_in_bytes;
             D3D11_SUBRESOURCE_DATA subresource_data[6] = {
-                {desc.color_data, pixel_size * (u32)desc.width,    0},
-                {desc.color_data, pixel_size * (u32)desc.width/2,  0},
-                {desc.color_data, pixel_size * (u32)desc.width/4,  0},
-                {desc.color_data, pixel_size * (u32)desc.width/8,  0},
-                {desc.color_data, pixel_size * (u32)desc.width/16, 0},
-                {desc.color_data, pixel_size * (u32)desc.width/32, 0},
+                {desc.color_data, texture_row_pitch(desc.format, desc.width),    0},
+                {desc.color_data, texture_row_pitch(desc.format, desc.width/2),  0},
+                {desc.color_data, texture_row_pitch(desc.format, desc.width/4),  0},
+                {desc.color_data, texture_row_pitch(desc.format, desc.width/8),  0},
+                {desc.color_data, texture_row_pitch(desc.format, desc.width/16), 0},
+                {desc.color_data, texture_row_pitch(desc.format, desc.width/32), 0},
             };
 
             auto result = directx.device->CreateTexture2D(&texture_desc, desc.color_data == nullptr ? nullptr : &subresource_data[0], &texture_handle_2d);
@@ -2,232 +2,192 @@
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+// note(josh): only built with ASSIMP_IMPORT on, see main.cpp, so the library isn't on build.bat's link line
+#ifdef _MSC_VER
+#pragma comment(lib, "assimp-vc141-mtd.lib")
+#endif
+
 #include "application.h"
 #include "renderer.h"
 
-void calculate_tangents_and_bitangents(Vertex *vert0, Vertex *vert1, Vertex *vert2) {
-    Vector3 delta_pos1 = vert1->position - vert0->position;
-    Vector3 delta_pos2 = vert2->position - vert0->position;
-
-    Vector3 delta_uv1 = vert1->tex_coord - vert0->tex_coord;
-    Vector3 delta_uv2 = vert2->tex_coord - vert0->tex_coord;
+// the CPU side of an assimp mesh, in the layout the renderer uses
+void import_mesh(aiMesh *mesh, Array<Vertex> *out_vertices, Array<u32> *out_indices) {
+    Array<Vertex> &vertices = *out_vertices;
+    Array<u32> &indices = *out_indices;
+    vertices.clear();
+    indices.clear();
 
-    float r = 1.0f / (delta_uv1.x * delta_uv2.y - delta_uv1.y * delta_uv2.x);
-    Vector3 tangent   = (delta_pos1 * delta_uv2.y - delta_pos2 * delta_uv1.y) * r;
-    Vector3 bitangent = (delta_pos2 * delta_uv1.x - delta_pos1 * delta_uv2.x) * r;
+    for (int i = 0; i < mesh->mNumVertices; i++) {
+        Vertex vertex = {};
+        vertex.position.x = mesh->mVertices[i].x;
+        vertex.position.y = mesh->mVertices[i].y;
+        vertex.position.z = mesh->mVertices[i].z;
 
-    // note(josh): we += here instead of = because in the case of indexing we could hit
-    // the same vertex more than once, so we want an "average" of all the tangents/bitangents
-    // for that vertex. explained here under the "Indexing" heading
-    // http://www.opengl-tutorial.org/intermediate-tutorials/tutorial-13-normal-mapping/#indexing
+        if (mesh->HasVertexColors(0)) {
+            vertex.color.x = (float)mesh->mColors[0][i].r;
+            vertex.color.y = (float)mesh->mColors[0][i].g;
+            vertex.color.z = (float)mesh->mColors[0][i].b;
+            vertex.color.w = (float)mesh->mColors[0][i].a;
+        }
+        else {
+            vertex.color.x = 1;
+            vertex.color.y = 1;
+            vertex.color.z = 1;
+            vertex.color.w = 1;
+        }
 
-    vert0->tangent += tangent;
-    vert1->tangent += tangent;
-    vert2->tangent += tangent;
+        // todo(josh): vertex colors
 
-    vert0->bitangent += bitangent;
-    vert1->bitangent += bitangent;
-    vert2->bitangent += bitangent;
-}
+        if (mesh->HasTextureCoords(0)) {
+            vertex.tex_coord.x = (float)mesh->mTextureCoords[0][i].x;
+            vertex.tex_coord.y = (float)mesh->mTextureCoords[0][i].y;
+        }
 
-void process_node(const aiScene *scene, aiNode *node, char *directory, Allocator allocator, Model *out_model) {
-    Array<Vertex> vertices = make_array<Vertex>(allocator, 1024);
-    defer(vertices.destroy());
+        if (mesh->HasNormals()) {
+            vertex.normal.x = (float)mesh->mNormals[i].x;
+            vertex.normal.y = (float)mesh->mNormals[i].y;
+            vertex.normal.z = (float)mesh->mNormals[i].z;
+        }
 
-    Array<u32> indices = make_array<u32>(allocator, 1024);
-    defer(indices.destroy());
+        if (mesh->HasTangentsAndBitangents()) {
+            vertex.tangent.x = (float)mesh->mTangents[i].x;
+            vertex.tangent.y = (float)mesh->mTangents[i].y;
+            vertex.tangent.z = (float)mesh->mTangents[i].z;
 
-    for (int i = 0; i < node->mNumMeshes; i++) {
-        vertices.clear();
-        indices.clear();
-
-        aiMesh *mesh = scene->mMeshes[node->mMeshes[i]];
-
-        for (int i = 0; i < mesh->mNumVertices; i++) {
-            Vertex vertex = {};
-            vertex.position.x = mesh->mVertices[i].x;
-            vertex.position.y = mesh->mVertices[i].y;
-            vertex.position.z = mesh->mVertices[i].z;
-
-            if (mesh->HasVertexColors(0)) {
-                vertex.color.x = (float)mesh->mColors[0][i].r;
-                vertex.color.y = (float)mesh->mColors[0][i].g;
-                vertex.color.z = (float)mesh->mColors[0][i].b;
-                vertex.color.w = (float)mesh->mColors[0][i].a;
-            }
-            else {
-                vertex.color.x = 1;
-                vertex.color.y = 1;
-                vertex.color.z = 1;
-                vertex.color.w = 1;
-            }
+            vertex.bitangent.x = (float)mesh->mBitangents[i].x;
+            vertex.bitangent.y = (float)mesh->mBitangents[i].y;
+            vertex.bitangent.z = (float)mesh->mBitangents[i].z;
+        }
 
-            // todo(josh): vertex colors
+        vertices.append(vertex);
+    }
 
-            if (mesh->HasTextureCoords(0)) {
-                vertex.tex_coord.x = (float)mesh->mTextureCoords[0][i].x;
-                vertex.tex_coord.y = (float)mesh->mTextureCoords[0][i].y;
-            }
+    for (int i = 0; i < mesh->mNumFaces; i++) {
+        aiFace face = mesh->mFaces[i];
+        for (int j = 0; j < face.mNumIndices; j++) {
+            indices.append(face.mIndices[j]);
+        }
+    }
 
-            if (mesh->HasNormals()) {
-                vertex.normal.x = (float)mesh->mNormals[i].x;
-                vertex.normal.y = (float)mesh->mNormals[i].y;
-                vertex.normal.z = (float)mesh->mNormals[i].z;
-            }
+    // note(josh): exporters and PreTransformVertices leave exact duplicates around, merging them is what
+    // makes the index buffer worth anything to the vertex cache. this happens before the tangents get
+    // generated so split copies of a vertex end up with the same tangent.
+    weld_vertices(out_vertices, out_indices);
+}
 
-            if (mesh->HasTangentsAndBitangents()) {
-                vertex.tangent.x = (float)mesh->mTangents[i].x;
-                vertex.tangent.y = (float)mesh->mTangents[i].y;
-                vertex.tangent.z = (float)mesh->mTangents[i].z;
+static int count_scene_vertices(const aiScene *scene) {
+    int count = 0;
+    for (int i = 0; i < scene->mNumMeshes; i++) {
+        count += scene->mMeshes[i]->mNumVertices;
+    }
+    return count;
+}
 
-                vertex.bitangent.x = (float)mesh->mBitangents[i].x;
-                vertex.bitangent.y = (float)mesh->mBitangents[i].y;
-                vertex.bitangent.z = (float)mesh->mBitangents[i].z;
+// note(josh): the paths point into the aiMaterial so they only live as long as the aiScene
+void import_material(aiMaterial *assimp_material, Imported_Material *out_material) {
+    *out_material = {};
+    for (int prop_index = 0; prop_index < assimp_material->mNumProperties; prop_index++) {
+        aiMaterialProperty *property = assimp_material->mProperties[prop_index];
+        if (strcmp(property->mKey.data, "$tex.file") == 0) {
+            assert(property->mType == aiPTI_String);
+            char *cstr = ((aiString *)property->mData)->data;
+            switch (property->mSemantic) {
+                // todo(josh): there is probably a material parameter for the wrap mode ???
+                case aiTextureType_DIFFUSE:           { set_imported_texture(out_material, MM_ALBEDO,    cstr, true);  break; }
+                case aiTextureType_NORMALS:           { set_imported_texture(out_material, MM_NORMAL,    cstr, false); break; }
+                case aiTextureType_BASE_COLOR:        { set_imported_texture(out_material, MM_ALBEDO,    cstr, false); break; }
+                case aiTextureType_NORMAL_CAMERA:     { set_imported_texture(out_material, MM_NORMAL,    cstr, false); break; }
+                case aiTextureType_EMISSION_COLOR:    { set_imported_texture(out_material, MM_EMISSION,  cstr, false); break; }
+                case aiTextureType_METALNESS:         { set_imported_texture(out_material, MM_METALLIC,  cstr, false); break; }
+                case aiTextureType_DIFFUSE_ROUGHNESS: { set_imported_texture(out_material, MM_ROUGHNESS, cstr, false); break; }
+                case aiTextureType_AMBIENT_OCCLUSION: { set_imported_texture(out_material, MM_AO,        cstr, false); break; }
+                case aiTextureType_LIGHTMAP:          { set_imported_texture(out_material, MM_AO,        cstr, false); break; }
+                case aiTextureType_EMISSIVE:          { set_imported_texture(out_material, MM_EMISSION,  cstr, false); break; }
+                case aiTextureType_SPECULAR:          { printf("Unhandled: aiTextureType_SPECULAR: %s\n",     cstr); break; }
+                case aiTextureType_AMBIENT:           { printf("Unhandled: aiTextureType_AMBIENT: %s\n",      cstr); break; }
+                case aiTextureType_HEIGHT:            { printf("Unhandled: aiTextureType_HEIGHT: %s\n",       cstr); break; }
+                case aiTextureType_SHININESS:         { printf("Unhandled: aiTextureType_SHININESS: %s\n",    cstr); break; }
+                case aiTextureType_OPACITY:           { printf("Unhandled: aiTextureType_OPACITY: %s\n",      cstr); break; }
+                case aiTextureType_DISPLACEMENT:      { printf("Unhandled: aiTextureType_DISPLACEMENT: %s\n", cstr); break; }
+                case aiTextureType_REFLECTION:        { printf("Unhandled: aiTextureType_REFLECTION: %s\n",   cstr); break; }
+                case aiTextureType_NONE:              { assert(false); }
+                case aiTextureType_UNKNOWN: {
+                    printf("Unknown texture type: %s\n", cstr);
+                    break;
+                }
             }
-
-            vertices.append(vertex);
         }
-
-        for (int i = 0; i < mesh->mNumFaces; i++) {
-            aiFace face = mesh->mFaces[i];
-            for (int j = 0; j < face.mNumIndices; j++) {
-                indices.append(face.mIndices[j]);
-            }
+        // todo(josh): apparently property->mData can be an array (of floats, for example).
+        //             we should use property->mDataLength to pull the right values out.
+        //             the only one I've seen be an array is for ambient but all the values
+        //             are the same and our current Material system only does scalar ambient.
+        else if (strcmp(property->mKey.data, "$mat.gltf.pbrMetallicRoughness.baseColorFactor") == 0) {
+            assert(property->mType == aiPTI_Float);
+            out_material->ambient = *(float *)property->mData;
         }
-
-        if (!mesh->HasTangentsAndBitangents()) {
-            if (indices.count) {
-                for (int i = 0; i < indices.count; i += 3) {
-                    int index0 = indices[i+0];
-                    int index1 = indices[i+1];
-                    int index2 = indices[i+2];
-
-                    Vertex *vert0 = &vertices[index0];
-                    Vertex *vert1 = &vertices[index1];
-                    Vertex *vert2 = &vertices[index2];
-                    calculate_tangents_and_bitangents(vert0, vert1, vert2);
-                }
+        else if (strcmp(property->mKey.data, "$mat.gltf.pbrMetallicRoughness.metallicFactor") == 0) {
+            assert(property->mType == aiPTI_Float);
+            out_material->metallic = *(float *)property->mData;
+        }
+        else if (strcmp(property->mKey.data, "$mat.gltf.pbrMetallicRoughness.roughnessFactor") == 0) {
+            assert(property->mType == aiPTI_Float);
+            out_material->roughness = *(float *)property->mData;
+        }
+        else if (strcmp(property->mKey.data, "$mat.gltf.alphaMode") == 0) {
+            assert(property->mType == aiPTI_String);
+            char *cstr = ((aiString *)property->mData)->data;
+            if (strcmp(cstr, "MASK") == 0) {
+                out_material->has_transparency = true;
             }
             else {
-                for (int i = 0; i < vertices.count; i += 3) {
-                    Vertex *vert0 = &vertices[i+0];
-                    Vertex *vert1 = &vertices[i+1];
-                    Vertex *vert2 = &vertices[i+2];
-                    calculate_tangents_and_bitangents(vert0, vert1, vert2);
+                if (strcmp(cstr, "OPAQUE") != 0) {
+                    printf("%s\n", cstr);
+                    assert(false);
                 }
             }
         }
-
-        PBR_Material material = {};
-        bool has_material = false;
-        if (scene->mNumMaterials > 0) {
-            has_material = true;
-            assert(material.cbuffer_handle == nullptr);
-            material.cbuffer_handle = create_pbr_material_cbuffer();
-            aiMaterial *assimp_material = scene->mMaterials[mesh->mMaterialIndex];
-            assert(assimp_material != nullptr);
-            for (int prop_index = 0; prop_index < assimp_material->mNumProperties; prop_index++) {
-                aiMaterialProperty *property = assimp_material->mProperties[prop_index];
-                if (strcmp(property->mKey.data, "$tex.file") == 0) {
-                    assert(property->mType == aiPTI_String);
-                    char *cstr = ((aiString *)property->mData)->data;
-                    String_Builder path_sb = make_string_builder(allocator);
-                    defer(path_sb.destroy());
-                    if (directory) {
-                        path_sb.printf("%s/", directory);
-                    }
-                    path_sb.print(cstr);
-                    switch (property->mSemantic) {
-                        // todo(josh): there is probably a material parameter for the wrap mode ???
-                        // todo(josh): there is probably a material parameter for the wrap mode ???
-                        // todo(josh): there is probably a material parameter for the wrap mode ???
-                        // todo(josh): there is probably a material parameter for the wrap mode ???
-                        // todo(josh): there is probably a material parameter for the wrap mode ???
-                        // todo(josh): there is probably a material parameter for the wrap mode ???
-                        case aiTextureType_DIFFUSE:           { if (!material.albedo_map.valid)    {  material.albedo_map    = create_texture_from_file(path_sb.string(), TF_R8G8B8A8_UINT_SRGB, TWM_LINEAR_WRAP); } break; }
-                        case aiTextureType_NORMALS:           { if (!material.normal_map.valid)    {  material.normal_map    = create_texture_from_file(path_sb.string(), TF_R8G8B8A8_UINT,      TWM_LINEAR_WRAP); } break; }
-                        case aiTextureType_BASE_COLOR:        { if (!material.albedo_map.valid)    {  material.albedo_map    = create_texture_from_file(path_sb.string(), TF_R8G8B8A8_UINT,      TWM_LINEAR_WRAP); } break; }
-                        case aiTextureType_NORMAL_CAMERA:     { if (!material.normal_map.valid)    {  material.normal_map    = create_texture_from_file(path_sb.string(), TF_R8G8B8A8_UINT,      TWM_LINEAR_WRAP); } break; }
-                        case aiTextureType_EMISSION_COLOR:    { if (!material.emission_map.valid)  {  material.emission_map  = create_texture_from_file(path_sb.string(), TF_R8G8B8A8_UINT,      TWM_LINEAR_WRAP); } break; }
-                        case aiTextureType_METALNESS:         { if (!material.metallic_map.valid)  {  material.metallic_map  = create_texture_from_file(path_sb.string(), TF_R8G8B8A8_UINT,      TWM_LINEAR_WRAP); } break; }
-                        case aiTextureType_DIFFUSE_ROUGHNESS: { if (!material.roughness_map.valid) {  material.roughness_map = create_texture_from_file(path_sb.string(), TF_R8G8B8A8_UINT,      TWM_LINEAR_WRAP); } break; }
-                        case aiTextureType_AMBIENT_OCCLUSION: { if (!material.ao_map.valid)        {  material.ao_map        = create_texture_from_file(path_sb.string(), TF_R8G8B8A8_UINT,      TWM_LINEAR_WRAP); } break; }
-                        case aiTextureType_LIGHTMAP:          { if (!material.ao_map.valid)        {  material.ao_map        = create_texture_from_file(path_sb.string(), TF_R8G8B8A8_UINT,      TWM_LINEAR_WRAP); } break; }
-                        case aiTextureType_EMISSIVE:          { if (!material.emission_map.valid)  {  material.emission_map  = create_texture_from_file(path_sb.string(), TF_R8G8B8A8_UINT,      TWM_LINEAR_WRAP); } break; }
-                        case aiTextureType_SPECULAR:          { printf("Unhandled: aiTextureType_SPECULAR: %s\n",     path_sb.string()); break; }
-                        case aiTextureType_AMBIENT:           { printf("Unhandled: aiTextureType_AMBIENT: %s\n",      path_sb.string()); break; }
-                        case aiTextureType_HEIGHT:            { printf("Unhandled: aiTextureType_HEIGHT: %s\n",       path_sb.string()); break; }
-                        case aiTextureType_SHININESS:         { printf("Unhandled: aiTextureType_SHININESS: %s\n",    path_sb.string()); break; }
-                        case aiTextureType_OPACITY:           { printf("Unhandled: aiTextureType_OPACITY: %s\n",      path_sb.string()); break; }
-                        case aiTextureType_DISPLACEMENT:      { printf("Unhandled: aiTextureType_DISPLACEMENT: %s\n", path_sb.string()); break; }
-                        case aiTextureType_REFLECTION:        { printf("Unhandled: aiTextureType_REFLECTION: %s\n",   path_sb.string()); break; }
-                        case aiTextureType_NONE:              { assert(false); }
-                        case aiTextureType_UNKNOWN: {
-                            printf("Unknown texture type: %s\n", path_sb.string());
-                            break;
-                        }
-                    }
-                }
-                // todo(josh): apparently property->mData can be an array (of floats, for example).
-                //             we should use property->mDataLength to pull the right values out.
-                //             the only one I've seen be an array is for ambient but all the values
-                //             are the same and our current Material system only does scalar ambient.
-                else if (strcmp(property->mKey.data, "$mat.gltf.pbrMetallicRoughness.baseColorFactor") == 0) {
-                    assert(property->mType == aiPTI_Float);
-                    material.ambient = *(float *)property->mData;
-                }
-                else if (strcmp(property->mKey.data, "$mat.gltf.pbrMetallicRoughness.metallicFactor") == 0) {
-                    assert(property->mType == aiPTI_Float);
-                    material.metallic = *(float *)property->mData;
-                }
-                else if (strcmp(property->mKey.data, "$mat.gltf.pbrMetallicRoughness.roughnessFactor") == 0) {
-                    assert(property->mType == aiPTI_Float);
-                    material.roughness = *(float *)property->mData;
-                }
-                else if (strcmp(property->mKey.data, "$mat.gltf.alphaMode") == 0) {
-                    assert(property->mType == aiPTI_String);
-                    char *cstr = ((aiString *)property->mData)->data;
-                    if (strcmp(cstr, "MASK") == 0) {
-                        material.has_transparency = true;
-                    }
-                    else {
-                        if (strcmp(cstr, "OPAQUE") != 0) {
-                            printf("%s\n", cstr);
-                            assert(false);
-                        }
-                    }
-                }
-                else {
-                    // switch (property->mType) {
-                    //     case aiPTI_Float:   printf("%s -> %f\n", property->mKey.data, *(float *)property->mData);           break;
-                    //     case aiPTI_Double:  printf("%s -> %f\n", property->mKey.data, *(double *)property->mData);          break;
-                    //     case aiPTI_Integer: printf("%s -> %d\n", property->mKey.data, *(int *)property->mData);             break;
-                    //     case aiPTI_Buffer:  printf("%s -> %p\n", property->mKey.data, property->mData);                     break;
-                    //     case aiPTI_String:  printf("%s -> %s\n", property->mKey.data, ((aiString *)property->mData)->data); break;
-                    // }
-                }
-            }
+        else {
+            // switch (property->mType) {
+            //     case aiPTI_Float:   printf("%s -> %f\n", property->mKey.data, *(float *)property->mData);           break;
+            //     case aiPTI_Double:  printf("%s -> %f\n", property->mKey.data, *(double *)property->mData);          break;
+            //     case aiPTI_Integer: printf("%s -> %d\n", property->mKey.data, *(int *)property->mData);             break;
+            //     case aiPTI_Buffer:  printf("%s -> %p\n", property->mKey.data, property->mData);                     break;
+            //     case aiPTI_String:  printf("%s -> %s\n", property->mKey.data, ((aiString *)property->mData)->data); break;
+            // }
         }
+    }
+}
 
-        Buffer vertex_buffer = create_buffer(BT_VERTEX, vertices.data, vertices.count * sizeof(vertices[0]));
-        Buffer index_buffer  = create_buffer(BT_INDEX,  indices.data,  indices.count  * sizeof(indices[0]));
-        Loaded_Mesh loaded_mesh = {
-            vertex_buffer,
-            vertices.count,
-            index_buffer,
-            indices.count,
-            material,
-            has_material,
-        };
-        out_model->meshes.append(loaded_mesh);
+// Every mesh in the scene, indexed like scene->mMeshes, with tangents and optimization done.
+Array<Imported_Mesh> import_scene_meshes(const aiScene *scene, Allocator allocator, Mesh_Optimization_Report *report) {
+    Array<Imported_Mesh> meshes = make_array<Imported_Mesh>(allocator, scene->mNumMeshes > 0 ? scene->mNumMeshes : 1);
+    for (int i = 0; i < scene->mNumMeshes; i++) {
+        aiMesh *mesh = scene->mMeshes[i];
+        Imported_Mesh imported = make_imported_mesh(allocator, mesh->mNumVertices, mesh->mNumFaces * 3);
+        import_mesh(mesh, &imported.vertices, &imported.indices);
+        imported.has_tangents = mesh->HasTangentsAndBitangents();
+        imported.has_vertex_colors = mesh->HasVertexColors(0);
+        imported.material = scene->mNumMaterials > 0 ? mesh->mMaterialIndex : -1;
+        imported.name = (char *)mesh->mName.C_Str();
+        meshes.append(imported);
+    }
+    finish_imported_meshes(&meshes, allocator, report);
+    return meshes;
+}
+
+// materials is indexed by mMaterialIndex
+void process_node(const aiScene *scene, aiNode *node, Array<Imported_Mesh> *imported_meshes, Array<PBR_Material> *materials, Vertex_Layout layout, Allocator allocator, Mesh_Import_Scratch *scratch, Mesh_Lod_Report *lod_report, Model *out_model) {
+    for (int i = 0; i < node->mNumMeshes; i++) {
+        Imported_Mesh *mesh = &(*imported_meshes)[node->mMeshes[i]];
+        add_imported_mesh(mesh, mesh->material != -1 ? &(*materials)[mesh->material] : nullptr, layout, allocator, scratch, lod_report, out_model);
     }
 
     for (int i = 0; i < node->mNumChildren; i++) {
-        process_node(scene, node->mChildren[i], directory, allocator, out_model);
+        process_node(scene, node->mChildren[i], imported_meshes, materials, layout, allocator, scratch, lod_report, out_model);
     }
 }
 
-Model load_model_from_file(char *filename, Allocator allocator) {
+Model load_model_from_file(char *filename, Allocator allocator, Texture_Cache *texture_cache, Vertex_Layout layout = VL_FULL) {
     Assimp::Importer importer;
 
     const aiScene *scene = importer.ReadFile(filename,
@@ -244,7 +204,92 @@ Model load_model_from_file(char *filename, Allocator allocator) {
     char *directory = path_directory(filename, allocator);
     defer(if (directory) free(allocator, directory));
 
+    Mesh_Optimization_Report report = {};
+    Mesh_Lod_Report lod_report = {};
+    Array<Imported_Mesh> imported_meshes = import_scene_meshes(scene, allocator, &report);
+    defer(destroy_imported_meshes(imported_meshes));
+
+    Array<Imported_Material> imported_materials = make_array<Imported_Material>(allocator, scene->mNumMaterials > 0 ? scene->mNumMaterials : 1);
+    defer(imported_materials.destroy());
+    Array<bool> material_imported = make_array<bool>(allocator, scene->mNumMaterials > 0 ? scene->mNumMaterials : 1);
+    defer(material_imported.destroy());
+    for (int i = 0; i < scene->mNumMaterials; i++) {
+        imported_materials.append({});
+        material_imported.append(false);
+    }
+    // note(josh): only the materials something uses, import_material() asserts on things we don't handle
+    Foreach (mesh, imported_meshes) {
+        if (mesh->material != -1 && !material_imported[mesh->material]) {
+            import_material(scene->mMaterials[mesh->material], &imported_materials[mesh->material]);
+            material_imported[mesh->material] = true;
+        }
+    }
+    Array<PBR_Material> materials = create_imported_materials(imported_materials, imported_meshes, directory, texture_cache, allocator);
+    defer(materials.destroy());
+
     Model model = create_model(allocator);
-    process_node(scene, scene->mRootNode, directory, allocator, &model);
+    Mesh_Import_Scratch scratch = make_mesh_import_scratch(allocator, layout);
+    defer(destroy_mesh_import_scratch(&scratch));
+    process_node(scene, scene->mRootNode, &imported_meshes, &materials, layout, allocator, &scratch, &lod_report, &model);
+
+    print_model_import_report(filename, count_scene_vertices(scene), &model, &report, &lod_report, layout);
     return model;
 }
+
+
+
+static void cook_node(const aiScene *scene, aiNode *node, Array<Imported_Mesh> *imported_meshes, Array<int> *material_remap, Mesh_Import_Scratch *scratch, Mesh_Lod_Report *lod_report, Model_Cooker *cooker) {
+    for (int i = 0; i < node->mNumMeshes; i++) {
+        Imported_Mesh *mesh = &(*imported_meshes)[node->mMeshes[i]];
+        int material_index = -1;
+        if (mesh->material != -1) {
+            int *remapped = &(*material_remap)[mesh->material];
+            if (*remapped == -1) {
+                Imported_Material imported;
+                import_material(scene->mMaterials[mesh->material], &imported);
+                *remapped = model_cooker_add_material(cooker, cook_imported_material(&imported, cooker));
+            }
+            material_index = *remapped;
+        }
+        cook_imported_mesh(mesh, material_index, scratch, lod_report, cooker);
+    }
+
+    for (int i = 0; i < node->mNumChildren; i++) {
+        cook_node(scene, node->mChildren[i], imported_meshes, material_remap, scratch, lod_report, cooker);
+    }
+}
+
+// Imports source_filename with the same post-processing as load_model_from_file() and writes it out
+// as a .cffmodel. The cooked file has to be in the same directory as the source for the texture paths to work.
+bool cook_model(char *source_filename, char *cooked_filename, Allocator allocator, Vertex_Layout layout = VL_FULL) {
+    Assimp::Importer importer;
+    const aiScene *scene = importer.ReadFile(source_filename,
+        aiProcess_PreTransformVertices |
+        aiProcess_Triangulate |
+        aiProcess_GenSmoothNormals |
+        aiProcess_FlipUVs);
+
+    if (scene == nullptr) {
+        printf("Error cooking mesh: %s\n", importer.GetErrorString());
+        return false;
+    }
+
+    Array<int> material_remap = make_array<int>(allocator, scene->mNumMaterials > 0 ? scene->mNumMaterials : 1);
+    defer(material_remap.destroy());
+    for (int i = 0; i < scene->mNumMaterials; i++) {
+        material_remap.append(-1);
+    }
+
+    Model_Cooker cooker = make_model_cooker(vertex_layout_size(layout), allocator);
+    defer(destroy_model_cooker(&cooker));
+    Mesh_Optimization_Report report = {};
+    Mesh_Lod_Report lod_report = {};
+    Array<Imported_Mesh> imported_meshes = import_scene_meshes(scene, allocator, &report);
+    defer(destroy_imported_meshes(imported_meshes));
+    Mesh_Import_Scratch scratch = make_mesh_import_scratch(allocator, layout);
+    defer(destroy_mesh_import_scratch(&scratch));
+    cook_node(scene, scene->mRootNode, &imported_meshes, &material_remap, &scratch, &lod_report, &cooker);
+
+    print_cooked_import_report(source_filename, count_scene_vertices(scene), &cooker, &report, &lod_report, layout);
+    return write_cooked_model(&cooker, cooked_filename);
+}
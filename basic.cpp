@@ -1,3 +1,13 @@
+#ifdef CFF_PLATFORM_WINDOWS
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 #include "basic.h"
 
 #include <stdio.h>
@@ -111,6 +121,8 @@ void null_allocator_free(void *allocator, void *ptr) {
 
 Allocator null_allocator() {
     Allocator a = {};
+    a.alloc_proc = null_allocator_alloc;
+    a.free_proc = null_allocator_free;
     return a;
 }
 
@@ -240,6 +252,86 @@ char *read_entire_file(char *filename, int *len) {
     return str;
 }
 
+#ifdef CFF_PLATFORM_WINDOWS
+bool map_entire_file(char *filename, Mapped_File *out_file) {
+    *out_file = {};
+    HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    defer(CloseHandle(file));
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+        return false;
+    }
+    // note(josh): the view keeps the mapping and the file open, we don't need the handles after this
+    defer(CloseHandle(mapping));
+    void *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (data == nullptr) {
+        return false;
+    }
+    out_file->data = (byte *)data;
+    out_file->size = size.QuadPart;
+    return true;
+}
+
+void unmap_file(Mapped_File *file) {
+    if (file->data) {
+        UnmapViewOfFile(file->data);
+    }
+    *file = {};
+}
+
+bool get_file_write_time(char *filename, u64 *out_time) {
+    WIN32_FILE_ATTRIBUTE_DATA attributes;
+    if (!GetFileAttributesExA(filename, GetFileExInfoStandard, &attributes)) {
+        return false;
+    }
+    *out_time = ((u64)attributes.ftLastWriteTime.dwHighDateTime << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+    return true;
+}
+#else
+bool map_entire_file(char *filename, Mapped_File *out_file) {
+    *out_file = {};
+    int fd = open(filename, O_RDONLY);
+    if (fd == -1) {
+        return false;
+    }
+    defer(close(fd));
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        return false;
+    }
+    void *data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+    out_file->data = (byte *)data;
+    out_file->size = info.st_size;
+    return true;
+}
+
+void unmap_file(Mapped_File *file) {
+    if (file->data) {
+        munmap(file->data, file->size);
+    }
+    *file = {};
+}
+
+bool get_file_write_time(char *filename, u64 *out_time) {
+    struct stat info;
+    if (stat(filename, &info) != 0) {
+        return false;
+    }
+    *out_time = (u64)info.st_mtime;
+    return true;
+}
+#endif
+
 
 
 String_Builder make_string_builder(Allocator allocator, int capacity) {
@@ -2,6 +2,8 @@
 
 #include <assert.h>
 #include <stdio.h>
+#include <stdint.h>
+#include <string.h>
 #include <math.h>
 #include <float.h>
 
@@ -27,6 +29,11 @@ static_assert(sizeof(float) == 4, "float size was not 4");
 
 static_assert(sizeof(void *) == 8, "void * size was not 8");
 
+// note(josh): so the platform independent code builds with gcc and clang, e.g. the benchmarks
+#if !defined(_MSC_VER) && !defined(__debugbreak)
+#define __debugbreak() __builtin_trap()
+#endif
+
 #ifndef ASSERT
 #define ASSERT(cond) { if (!(cond)) { printf("<%s:%d> Assertion failed: " #cond "\n", __FILE__, __LINE__); __debugbreak(); } }
 #endif
@@ -41,7 +48,7 @@ static_assert(sizeof(void *) == 8, "void * size was not 8");
     static_cast<size_t>(!(sizeof(a) % sizeof(*(a)))))
 #endif
 
-static void bounds__check(int index, int min, int max_plus_one, char *file, int line) {
+static void bounds__check(int index, int min, int max_plus_one, const char *file, int line) {
     if ((index < min) || (index >= max_plus_one)) {
         printf("<%s:%d> Index %d is out of range %d..<%d\n", file, line, index, min, max_plus_one);
         assert(false);
@@ -119,6 +126,19 @@ void destroy_pool(Pool_Allocator pool);
 // todo(josh): read_entire_file should be in a different file I think
 char *read_entire_file(char *filename, int *len);
 
+// Read-only memory mapping of a whole file. Pages are loaded by the OS as they are touched so this
+// is close to free for big files you only need parts of.
+struct Mapped_File {
+    byte *data;
+    i64 size;
+};
+
+bool map_entire_file(char *filename, Mapped_File *out_file);
+void unmap_file(Mapped_File *file);
+
+// Last modification time in an OS specific unit, only good for comparing two files on the same machine.
+bool get_file_write_time(char *filename, u64 *out_time);
+
 // note(josh): defer implementation stolen from gb.h
 #if !defined(GB_NO_DEFER) && defined(__cplusplus) && ((defined(_MSC_VER) && _MSC_VER >= 1400) || (__cplusplus >= 201103L))
 extern "C++" {
@@ -396,6 +416,9 @@ static i64 next_power_of_2(i64 n) {
     return n;
 }
 
+template<typename Key>
+u64 hash_key(Key key);
+
 template<typename Key, typename Value>
 void Hashtable<Key, Value>::insert(Key key, Value value) {
     if ((f64)count >= ((f64)capacity*0.75)) {
@@ -0,0 +1,2328 @@
+//
+// Microbenchmarks for the platform independent modules (math, basic, half, packing, quaternion
+// streams, fastmath, intersection, bvh, spherical harmonics, random, json, gltf, texture compression, mipmaps). This is
+// its own program so it builds with gcc/clang outside of Windows, see build_benchmark.sh.
+//
+//     ./benchmark                      run everything
+//     ./benchmark matrix4 half         run the benchmarks whose name contains any of the filters
+//     ./benchmark --json out.json      also write the results as JSON, for comparing between builds
+//     ./benchmark --list               print the names and exit
+//     --repetitions N                  timed repetitions per benchmark, default 7
+//     --min-time MS                    minimum length of one repetition, default 20
+//     --texture-report FILE...         compress the images with every format and print PSNR and Mpix/s
+//     --texture-quality fast|normal|best   quality for --texture-report, default normal
+//     --check                          print the max error of the SIMD kernels against their scalar versions
+//
+// Each benchmark is warmed up while we figure out how many iterations fill --min-time, and then
+// timed for --repetitions runs of that many iterations. The median is the headline number, min and
+// max are in the JSON so noisy runs are easy to spot.
+//
+
+#include "basic.h"
+#include "math.h"
+#include "half.h"
+#include "packing.h"
+#include "quaternion_stream.h"
+#include "fastmath.h"
+#include "intersection.h"
+#include "bvh.h"
+#include "threading.h"
+#include "spherical_harmonics.h"
+#include "random.h"
+#include "model_format.h"
+#include "mesh_optimizer.h"
+#include "tangent_space.h"
+#include "json.h"
+#include "gltf.h"
+#include "texture_compression.h"
+#include "cooked_texture.h"
+#include "mipmap.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <algorithm>
+
+static double benchmark_seconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// keeps the compiler from deleting work whose result is never used
+template<typename T>
+static inline void do_not_optimize(T const &value) {
+#if defined(__GNUC__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const void *sink;
+    sink = &value;
+#endif
+}
+
+
+
+// a proc does `iterations` iterations of the thing being measured. ops_per_iteration is how many
+// operations one iteration counts as for ns/op, e.g. a batch kernel over 4096 elements is 4096 ops.
+typedef void (*Benchmark_Proc)(i64 iterations);
+
+struct Benchmark {
+    const char *name;
+    Benchmark_Proc proc;
+    i64 ops_per_iteration;
+    i64 bytes_per_iteration; // 0 if bandwidth isn't interesting
+};
+
+struct Benchmark_Result {
+    const char *name;
+    i64 iterations; // per repetition
+    int repetitions;
+    double ns_per_op_median;
+    double ns_per_op_min;
+    double ns_per_op_max;
+    double ops_per_second;
+    double bytes_per_second;
+};
+
+static double time_proc(Benchmark_Proc proc, i64 iterations) {
+    double start = benchmark_seconds();
+    proc(iterations);
+    return benchmark_seconds() - start;
+}
+
+static Benchmark_Result run_benchmark(Benchmark *benchmark, double min_seconds, int repetitions) {
+    // note(josh): the calibration runs double as the warmup, so caches, branch predictors and the
+    // clock speed have settled by the time the timed repetitions start
+    i64 iterations = 1;
+    double elapsed = time_proc(benchmark->proc, iterations);
+    while (elapsed < min_seconds) {
+        double scale = elapsed > 0 ? (min_seconds * 1.2) / elapsed : 100;
+        if (scale < 2)   scale = 2;
+        if (scale > 100) scale = 100;
+        iterations = (i64)(iterations * scale);
+        elapsed = time_proc(benchmark->proc, iterations);
+    }
+
+    double ns_per_op[64];
+    if (repetitions > (int)ARRAYSIZE(ns_per_op)) repetitions = (int)ARRAYSIZE(ns_per_op);
+    for (int i = 0; i < repetitions; i++) {
+        double seconds = time_proc(benchmark->proc, iterations);
+        ns_per_op[i] = seconds * 1e9 / ((double)iterations * benchmark->ops_per_iteration);
+    }
+    std::sort(ns_per_op, ns_per_op + repetitions);
+
+    Benchmark_Result result = {};
+    result.name = benchmark->name;
+    result.iterations = iterations;
+    result.repetitions = repetitions;
+    result.ns_per_op_median = ns_per_op[repetitions / 2];
+    result.ns_per_op_min = ns_per_op[0];
+    result.ns_per_op_max = ns_per_op[repetitions - 1];
+    result.ops_per_second = 1e9 / result.ns_per_op_median;
+    if (benchmark->bytes_per_iteration > 0) {
+        result.bytes_per_second = result.ops_per_second * ((double)benchmark->bytes_per_iteration / benchmark->ops_per_iteration);
+    }
+    return result;
+}
+
+
+
+//
+// Inputs. Everything gets generated up front from a fixed seed so runs are comparable.
+//
+
+#define DATA_COUNT 1024 // power of two, small enough that the scalar math benchmarks stay in L1/L2
+#define DATA_MASK (DATA_COUNT - 1)
+#define BATCH_COUNT 4096
+
+static Matrix4    data_matrices[DATA_COUNT];
+static Matrix4    data_transforms[DATA_COUNT]; // invertible, well conditioned
+static Quaternion data_quaternions[DATA_COUNT];
+static Vector3    data_positions[DATA_COUNT];
+static Vector3    data_scales[DATA_COUNT];
+static Vector3    data_normals[DATA_COUNT];
+static float      data_floats[DATA_COUNT];
+
+static float      batch_floats[BATCH_COUNT];
+static float      batch_angles[BATCH_COUNT];
+static float      batch_out[BATCH_COUNT];
+static u16        batch_halves[BATCH_COUNT];
+static Vector3    batch_normals[BATCH_COUNT];
+static Vector2    batch_uvs[BATCH_COUNT];
+static u32        batch_packed[BATCH_COUNT];
+static float      batch_transform_floats[10][BATCH_COUNT]; // what batch_transforms points into
+static Transform_Stream batch_transforms;
+static Matrix4    batch_matrices[BATCH_COUNT];
+static int        batch_keys[BATCH_COUNT];
+
+static Quaternion_Stream stream_a;
+static Quaternion_Stream stream_b;
+static Quaternion_Stream stream_out;
+
+static Ray              data_rays[DATA_COUNT];
+static Vector3          data_triangles[DATA_COUNT][3];
+static Triangle_Packet4 data_packets4[DATA_COUNT / 4];
+static Triangle_Packet8 data_packets8[DATA_COUNT / 8];
+static AABB             data_boxes[DATA_COUNT];
+
+#define TERRAIN_SIZE 320 // cells per side, 2 triangles each, ~205k triangles
+static Array<Vector3> terrain_positions;
+static Array<u32>     terrain_indices;
+static Triangle_BVH   terrain_bvh;
+static Ray            terrain_rays[DATA_COUNT];
+static Array<Vector3> terrain_soup; // terrain_positions expanded per triangle, for welding
+static u32           *terrain_remap;
+static u32           *terrain_shuffled_indices; // triangles in random order, what the index optimizers start from
+static u32           *terrain_cache_optimized_indices;
+static u32           *terrain_optimizer_out;
+static Meshlet       *terrain_meshlets;
+static u32           *terrain_meshlet_vertices;
+static u8            *terrain_meshlet_triangles;
+static int            terrain_num_meshlets;
+static Meshlet_Bounds *terrain_meshlet_bounds;
+static u32           *terrain_cluster_indices; // each meshlet's triangles back as mesh indices, what culling compacts
+#define MESHLET_VIEWS 64
+static Meshlet_Culler terrain_meshlet_cullers[MESHLET_VIEWS];
+
+// same size and position offset as renderer.h's Vertex, which this can't include
+struct Interleaved_Vertex {
+    Vector3 position;
+    Vector3 tex_coord;
+    Vector4 color;
+    Vector3 normal;
+    Vector3 tangent;
+    Vector3 bitangent;
+};
+static_assert(sizeof(Interleaved_Vertex) == 76, "should match renderer.h's Vertex");
+static Array<Interleaved_Vertex> terrain_interleaved;
+
+// the terrain again, cut into TANGENT_CHUNKS_PER_SIDE^2 meshes with their own vertices like a scene
+// made of lots of small meshes
+#define TANGENT_CHUNKS_PER_SIDE 8
+#define TANGENT_CHUNKS (TANGENT_CHUNKS_PER_SIDE * TANGENT_CHUNKS_PER_SIDE)
+static Array<Interleaved_Vertex> tangent_chunk_vertices[TANGENT_CHUNKS];
+static Array<u32>                tangent_chunk_indices[TANGENT_CHUNKS];
+static Vector4                  *tangent_corners; // one per terrain index
+
+#define CUBEMAP_FACE_SIZE 256
+static byte *cubemap_faces[6];
+
+static char cooked_terrain_filename[] = "benchmark_terrain.cffmodel";
+
+// note(josh): the gltf benchmarks use the helmet main.cpp loads, run from the repo root for them to
+// find it. they do nothing if it isn't there.
+#define HELMET_TRIANGLES 15452
+static char helmet_filename[] = "sponza/DamagedHelmet.gltf";
+static bool helmet_found;
+static Mapped_File helmet_file;
+static Array<Interleaved_Vertex> helmet_vertices;
+static Array<u32> helmet_indices;
+static Vector4 *helmet_corners;
+
+// note(josh): the texture benchmarks compress a crop of the helmet's textures, same deal as above
+#define TEXTURE_SIZE 256
+static char texture_albedo_filename[] = "sponza/Default_albedo.jpg";
+static char texture_normal_filename[] = "sponza/Default_normal.jpg";
+static bool textures_found;
+static byte *texture_albedo;
+static byte *texture_normal;
+static byte *texture_blocks;
+static byte *texture_mipmaps;
+
+static Xoshiro128_x8 batch_rng;
+
+static Vector3 random_unit_vector(PCG32 *rng) {
+    return sample_unit_sphere(random_float(rng), random_float(rng));
+}
+
+static Quaternion random_rotation(PCG32 *rng) {
+    return axis_angle(random_unit_vector(rng), random_range(rng, -PI, PI));
+}
+
+static float terrain_height(float x, float z) {
+    return sinf(x * 0.05f) * 10.0f + cosf(z * 0.073f) * 7.0f + sinf((x + z) * 0.31f);
+}
+
+// every primitive of the first mesh as one Interleaved_Vertex mesh, what gltf_loader.cpp does minus
+// the transform and welding
+static void read_helmet(Gltf_File *gltf, Array<Interleaved_Vertex> *vertices, Array<u32> *indices) {
+    vertices->clear();
+    indices->clear();
+    Gltf_Mesh *mesh = &gltf->meshes[0];
+    for (int p = 0; p < mesh->num_primitives; p++) {
+        Gltf_Primitive *primitive = &gltf->primitives[mesh->first_primitive + p];
+        Gltf_Accessor *positions = &gltf->accessors[primitive->attributes[GLTF_POSITION]];
+        Gltf_Accessor *index_accessor = &gltf->accessors[primitive->indices];
+        int first_vertex = vertices->count;
+        vertices->reserve(first_vertex + positions->count);
+        vertices->count = first_vertex + positions->count;
+        Interleaved_Vertex *first = &(*vertices)[first_vertex];
+        gltf_read_floats(positions, &first->position, 3, sizeof(Interleaved_Vertex));
+        gltf_read_floats(&gltf->accessors[primitive->attributes[GLTF_NORMAL]], &first->normal, 3, sizeof(Interleaved_Vertex));
+        gltf_read_floats(&gltf->accessors[primitive->attributes[GLTF_TEXCOORD_0]], &first->tex_coord, 2, sizeof(Interleaved_Vertex));
+        int first_index = indices->count;
+        indices->reserve(first_index + index_accessor->count);
+        gltf_read_indices(index_accessor, &indices->data[first_index]);
+        indices->count = first_index + index_accessor->count;
+        for (int i = first_index; i < indices->count; i++) {
+            (*indices)[i] += first_vertex;
+        }
+    }
+}
+
+// default_allocator() that keeps track of the most it ever had out at once
+struct Peak_Allocator {
+    i64 current;
+    i64 peak;
+};
+
+static void *peak_allocator_alloc(void *allocator, int size, int alignment) {
+    Peak_Allocator *peak = (Peak_Allocator *)allocator;
+    assert(alignment <= 16);
+    byte *memory = (byte *)malloc(size + 16);
+    memset(memory + 16, 0, size);
+    *(i64 *)memory = size;
+    peak->current += size;
+    if (peak->current > peak->peak) peak->peak = peak->current;
+    return memory + 16;
+}
+
+static void peak_allocator_free(void *allocator, void *ptr) {
+    if (ptr == nullptr) return;
+    Peak_Allocator *peak = (Peak_Allocator *)allocator;
+    byte *memory = (byte *)ptr - 16;
+    peak->current -= *(i64 *)memory;
+    free(memory);
+}
+
+static void setup_helmet_data() {
+    if (!map_entire_file(helmet_filename, &helmet_file)) {
+        printf("%s not found, the gltf benchmarks won't do anything\n", helmet_filename);
+        return;
+    }
+    helmet_found = true;
+
+    // note(josh): the file and buffers are mapped so the allocations are all open_gltf() adds. assimp
+    // can't be built here, main.cpp's COMPARE_MODEL_LOAD_TIMES has it on windows.
+    Peak_Allocator peak = {};
+    Allocator allocator = {&peak, peak_allocator_alloc, peak_allocator_free};
+    Gltf_File gltf;
+    bool opened = open_gltf(helmet_filename, allocator, &gltf);
+    assert(opened);
+    i64 buffer_bytes = 0;
+    Foreach (size, gltf.buffer_sizes) {
+        buffer_bytes += *size;
+    }
+    printf("%s: %lld byte file, %lld bytes of buffers, open_gltf() peaks at %lld bytes allocated for %d tokens\n",
+           helmet_filename, (long long)gltf.file.size, (long long)buffer_bytes, (long long)peak.peak, gltf.json.tokens.count);
+
+    helmet_vertices = make_array<Interleaved_Vertex>(default_allocator(), 1024);
+    helmet_indices = make_array<u32>(default_allocator(), 1024);
+    read_helmet(&gltf, &helmet_vertices, &helmet_indices);
+    assert(helmet_indices.count == HELMET_TRIANGLES * 3);
+    helmet_corners = (Vector4 *)alloc(default_allocator(), sizeof(Vector4) * helmet_indices.count);
+    close_gltf(&gltf);
+}
+
+// the TEXTURE_SIZE square in the middle of filename as tightly packed RGBA8
+static byte *load_texture_crop(char *filename) {
+    int width;
+    int height;
+    int channels;
+    byte *pixels = stbi_load(filename, &width, &height, &channels, 4);
+    if (pixels == nullptr) {
+        return nullptr;
+    }
+    defer(stbi_image_free(pixels));
+    if (width < TEXTURE_SIZE || height < TEXTURE_SIZE) {
+        return nullptr;
+    }
+    byte *crop = (byte *)alloc(default_allocator(), TEXTURE_SIZE * TEXTURE_SIZE * 4);
+    int x0 = (width - TEXTURE_SIZE) / 2;
+    int y0 = (height - TEXTURE_SIZE) / 2;
+    for (int y = 0; y < TEXTURE_SIZE; y++) {
+        memcpy(crop + y * TEXTURE_SIZE * 4, pixels + ((i64)(y0 + y) * width + x0) * 4, TEXTURE_SIZE * 4);
+    }
+    return crop;
+}
+
+static void setup_texture_data() {
+    texture_albedo = load_texture_crop(texture_albedo_filename);
+    texture_normal = load_texture_crop(texture_normal_filename);
+    if (texture_albedo == nullptr || texture_normal == nullptr) {
+        printf("%s or %s not found, the texture benchmarks won't do anything\n", texture_albedo_filename, texture_normal_filename);
+        return;
+    }
+    textures_found = true;
+    texture_blocks = (byte *)alloc(default_allocator(), (int)image_level_size(IMAGE_FORMAT_RGBA8, TEXTURE_SIZE, TEXTURE_SIZE));
+    texture_mipmaps = (byte *)alloc(default_allocator(), (int)mipmap_chain_size(IMAGE_FORMAT_RGBA8, TEXTURE_SIZE, TEXTURE_SIZE, mipmap_count(TEXTURE_SIZE, TEXTURE_SIZE)));
+}
+
+static void setup_benchmark_data() {
+    PCG32 rng = make_pcg32(12345);
+    for (int i = 0; i < DATA_COUNT; i++) {
+        for (int e = 0; e < 16; e++) {
+            data_matrices[i].elements[e / 4][e % 4] = random_range(&rng, -1, 1);
+        }
+        data_quaternions[i] = random_rotation(&rng);
+        data_positions[i] = v3(random_range(&rng, -100, 100), random_range(&rng, -100, 100), random_range(&rng, -100, 100));
+        data_scales[i] = v3(random_range(&rng, 0.5f, 2), random_range(&rng, 0.5f, 2), random_range(&rng, 0.5f, 2));
+        data_normals[i] = random_unit_vector(&rng);
+        data_floats[i] = random_range(&rng, -1000, 1000);
+        data_transforms[i] = construct_trs_matrix(data_positions[i], data_quaternions[i], data_scales[i]);
+    }
+
+    for (int i = 0; i < BATCH_COUNT; i++) {
+        batch_floats[i] = random_range(&rng, -60000, 60000);
+        batch_angles[i] = random_range(&rng, -100, 100);
+        u32 bits;
+        memcpy(&bits, &batch_floats[i], sizeof(bits));
+        batch_halves[i] = half_from_float(bits);
+        batch_normals[i] = random_unit_vector(&rng);
+        batch_uvs[i] = v2(random_range(&rng, -4, 4), random_range(&rng, -4, 4));
+        Vector3 position = data_positions[i & DATA_MASK];
+        Vector3 scale = data_scales[i & DATA_MASK];
+        Quaternion orientation = random_rotation(&rng);
+        batch_transform_floats[0][i] = position.x;
+        batch_transform_floats[1][i] = position.y;
+        batch_transform_floats[2][i] = position.z;
+        batch_transform_floats[3][i] = scale.x;
+        batch_transform_floats[4][i] = scale.y;
+        batch_transform_floats[5][i] = scale.z;
+        batch_transform_floats[6][i] = orientation.x;
+        batch_transform_floats[7][i] = orientation.y;
+        batch_transform_floats[8][i] = orientation.z;
+        batch_transform_floats[9][i] = orientation.w;
+        batch_keys[i] = (int)next_u32(&rng);
+    }
+
+    batch_transforms.px = batch_transform_floats[0];
+    batch_transforms.py = batch_transform_floats[1];
+    batch_transforms.pz = batch_transform_floats[2];
+    batch_transforms.sx = batch_transform_floats[3];
+    batch_transforms.sy = batch_transform_floats[4];
+    batch_transforms.sz = batch_transform_floats[5];
+    batch_transforms.qx = batch_transform_floats[6];
+    batch_transforms.qy = batch_transform_floats[7];
+    batch_transforms.qz = batch_transform_floats[8];
+    batch_transforms.qw = batch_transform_floats[9];
+    batch_transforms.count = BATCH_COUNT;
+
+    stream_a = make_quaternion_stream(BATCH_COUNT);
+    stream_b = make_quaternion_stream(BATCH_COUNT);
+    stream_out = make_quaternion_stream(BATCH_COUNT);
+    for (int i = 0; i < BATCH_COUNT; i++) {
+        quaternion_stream_set(&stream_a, i, random_rotation(&rng));
+        quaternion_stream_set(&stream_b, i, random_rotation(&rng));
+    }
+
+    // rays from around the origin towards triangles scattered around them, about half hit
+    for (int i = 0; i < DATA_COUNT; i++) {
+        Vector3 center = random_unit_vector(&rng) * 10.0f;
+        for (int v = 0; v < 3; v++) {
+            data_triangles[i][v] = center + random_unit_vector(&rng) * 2.0f;
+        }
+        set_triangle(&data_packets4[i / 4], i % 4, data_triangles[i][0], data_triangles[i][1], data_triangles[i][2]);
+        set_triangle(&data_packets8[i / 8], i % 8, data_triangles[i][0], data_triangles[i][1], data_triangles[i][2]);
+        Ray ray = {};
+        ray.origin = random_unit_vector(&rng) * 0.5f;
+        ray.direction = normalize(center + random_unit_vector(&rng) * 2.0f - ray.origin);
+        data_rays[i] = ray;
+        Vector3 extent = v3(random_range(&rng, 0.5f, 3), random_range(&rng, 0.5f, 3), random_range(&rng, 0.5f, 3));
+        data_boxes[i] = {center - extent, center + extent};
+    }
+
+    int verts_per_side = TERRAIN_SIZE + 1;
+    terrain_positions = make_array<Vector3>(default_allocator(), verts_per_side * verts_per_side);
+    terrain_indices = make_array<u32>(default_allocator(), TERRAIN_SIZE * TERRAIN_SIZE * 6);
+    for (int z = 0; z < verts_per_side; z++) {
+        for (int x = 0; x < verts_per_side; x++) {
+            terrain_positions.append(v3((float)x, terrain_height((float)x, (float)z), (float)z));
+        }
+    }
+    for (int z = 0; z < TERRAIN_SIZE; z++) {
+        for (int x = 0; x < TERRAIN_SIZE; x++) {
+            u32 i = z * verts_per_side + x;
+            u32 quad[6] = {i, i + verts_per_side, i + 1, i + 1, i + verts_per_side, i + verts_per_side + 1};
+            for (int k = 0; k < 6; k++) terrain_indices.append(quad[k]);
+        }
+    }
+    terrain_bvh = build_triangle_bvh(terrain_positions.data, terrain_indices.data, terrain_indices.count / 3, default_allocator());
+    for (int i = 0; i < DATA_COUNT; i++) {
+        Ray ray = {};
+        ray.origin = v3(random_range(&rng, 0, TERRAIN_SIZE), 40, random_range(&rng, 0, TERRAIN_SIZE));
+        ray.direction = normalize(v3(random_range(&rng, -1, 1), -1, random_range(&rng, -1, 1)));
+        terrain_rays[i] = ray;
+    }
+
+    // smooth gradients with a bright spot, the contents don't change the cost but keep it plausible
+    for (int face = 0; face < 6; face++) {
+        cubemap_faces[face] = (byte *)malloc(CUBEMAP_FACE_SIZE * CUBEMAP_FACE_SIZE * 4);
+        u32 *texels = (u32 *)cubemap_faces[face];
+        for (int y = 0; y < CUBEMAP_FACE_SIZE; y++) {
+            for (int x = 0; x < CUBEMAP_FACE_SIZE; x++) {
+                u32 r = (x * 255) / CUBEMAP_FACE_SIZE;
+                u32 g = (y * 255) / CUBEMAP_FACE_SIZE;
+                u32 b = face * 40;
+                texels[y * CUBEMAP_FACE_SIZE + x] = r | (g << 8) | (b << 16) | 0xff000000;
+            }
+        }
+    }
+
+    batch_rng = make_xoshiro128_x8(777);
+
+    terrain_soup = make_array<Vector3>(default_allocator(), terrain_indices.count);
+    Foreach (index, terrain_indices) {
+        terrain_soup.append(terrain_positions[*index]);
+    }
+    terrain_remap = (u32 *)alloc(default_allocator(), sizeof(u32) * terrain_soup.count);
+
+    terrain_shuffled_indices = (u32 *)alloc(default_allocator(), sizeof(u32) * terrain_indices.count);
+    terrain_cache_optimized_indices = (u32 *)alloc(default_allocator(), sizeof(u32) * terrain_indices.count);
+    terrain_optimizer_out = (u32 *)alloc(default_allocator(), sizeof(u32) * terrain_indices.count);
+    memcpy(terrain_shuffled_indices, terrain_indices.data, sizeof(u32) * terrain_indices.count);
+    for (int i = terrain_indices.count / 3 - 1; i > 0; i--) {
+        int j = next_u32(&rng) % (i + 1);
+        for (int k = 0; k < 3; k++) {
+            u32 temp = terrain_shuffled_indices[i * 3 + k];
+            terrain_shuffled_indices[i * 3 + k] = terrain_shuffled_indices[j * 3 + k];
+            terrain_shuffled_indices[j * 3 + k] = temp;
+        }
+    }
+    optimize_vertex_cache(terrain_cache_optimized_indices, terrain_shuffled_indices, terrain_indices.count, terrain_positions.count);
+
+    terrain_interleaved = make_array<Interleaved_Vertex>(default_allocator(), terrain_positions.count);
+    Foreach (position, terrain_positions) {
+        Interleaved_Vertex vertex = {};
+        vertex.position = *position;
+        vertex.tex_coord = v3(position->x * 0.125f, position->z * 0.125f, 0);
+        vertex.color = v4(1, 1, 1, 1);
+        float x = position->x;
+        float z = position->z;
+        vertex.normal = normalize(v3(terrain_height(x - 1, z) - terrain_height(x + 1, z), 2, terrain_height(x, z - 1) - terrain_height(x, z + 1)));
+        vertex.tangent = v3(1, 0, 0);
+        vertex.bitangent = v3(0, 0, 1);
+        terrain_interleaved.append(vertex);
+    }
+
+    int chunk_size = TERRAIN_SIZE / TANGENT_CHUNKS_PER_SIDE;
+    for (int chunk = 0; chunk < TANGENT_CHUNKS; chunk++) {
+        int chunk_x = (chunk % TANGENT_CHUNKS_PER_SIDE) * chunk_size;
+        int chunk_z = (chunk / TANGENT_CHUNKS_PER_SIDE) * chunk_size;
+        tangent_chunk_vertices[chunk] = make_array<Interleaved_Vertex>(default_allocator(), (chunk_size + 1) * (chunk_size + 1));
+        tangent_chunk_indices[chunk] = make_array<u32>(default_allocator(), chunk_size * chunk_size * 6);
+        for (int z = 0; z <= chunk_size; z++) {
+            for (int x = 0; x <= chunk_size; x++) {
+                tangent_chunk_vertices[chunk].append(terrain_interleaved[(chunk_z + z) * verts_per_side + chunk_x + x]);
+            }
+        }
+        for (int z = 0; z < chunk_size; z++) {
+            for (int x = 0; x < chunk_size; x++) {
+                u32 i = z * (chunk_size + 1) + x;
+                u32 quad[6] = {i, i + chunk_size + 1, i + 1, i + 1, i + chunk_size + 1, i + chunk_size + 2};
+                for (int k = 0; k < 6; k++) tangent_chunk_indices[chunk].append(quad[k]);
+            }
+        }
+    }
+    tangent_corners = (Vector4 *)alloc(default_allocator(), sizeof(Vector4) * terrain_indices.count);
+
+    int meshlet_count = meshlet_bound(terrain_indices.count);
+    terrain_meshlets = (Meshlet *)alloc(default_allocator(), sizeof(Meshlet) * meshlet_count);
+    terrain_meshlet_vertices = (u32 *)alloc(default_allocator(), sizeof(u32) * meshlet_count * MESHLET_MAX_VERTICES);
+    terrain_meshlet_triangles = (u8 *)alloc(default_allocator(), sizeof(u8) * meshlet_count * MESHLET_MAX_TRIANGLES * 3);
+    terrain_num_meshlets = build_meshlets(terrain_meshlets, terrain_meshlet_vertices, terrain_meshlet_triangles, terrain_cache_optimized_indices, terrain_indices.count, terrain_positions.data, terrain_positions.count, sizeof(Vector3));
+    terrain_meshlet_bounds = (Meshlet_Bounds *)alloc(default_allocator(), sizeof(Meshlet_Bounds) * terrain_num_meshlets);
+    terrain_cluster_indices = (u32 *)alloc(default_allocator(), sizeof(u32) * terrain_indices.count);
+    int cluster_index = 0;
+    for (int i = 0; i < terrain_num_meshlets; i++) {
+        Meshlet *meshlet = &terrain_meshlets[i];
+        terrain_meshlet_bounds[i] = compute_meshlet_bounds(meshlet, terrain_meshlet_vertices, terrain_meshlet_triangles, terrain_positions.data, sizeof(Vector3));
+        for (u32 corner = 0; corner < meshlet->triangle_count * 3; corner++) {
+            terrain_cluster_indices[cluster_index++] = terrain_meshlet_vertices[meshlet->vertex_offset + terrain_meshlet_triangles[meshlet->triangle_offset + corner]];
+        }
+    }
+    // cameras scattered above the terrain looking every which way
+    Matrix4 projection = construct_perspective_matrix(to_radians(60), 16.0f / 9.0f, 0.1f, 1000);
+    for (int i = 0; i < MESHLET_VIEWS; i++) {
+        Vector3 camera_position = v3(random_range(&rng, 0, TERRAIN_SIZE), random_range(&rng, 20, 60), random_range(&rng, 0, TERRAIN_SIZE));
+        Quaternion camera_orientation = random_rotation(&rng);
+        Matrix4 view_projection = projection * construct_view_matrix(camera_position, camera_orientation);
+        terrain_meshlet_cullers[i] = make_meshlet_culler(view_projection, camera_position, quaternion_forward(camera_orientation), false);
+    }
+
+    // the terrain positions stand in for the vertices, the format doesn't care what's in them
+    Model_Cooker cooker = make_model_cooker(sizeof(Vector3), default_allocator());
+    model_cooker_add_mesh(&cooker, terrain_positions.data, terrain_positions.data, terrain_positions.count, terrain_indices.data, terrain_indices.count, -1);
+    bool written = write_cooked_model(&cooker, cooked_terrain_filename);
+    assert(written);
+    destroy_model_cooker(&cooker);
+
+    setup_helmet_data();
+    setup_texture_data();
+}
+
+
+
+//
+// math.h
+//
+
+static void bench_matrix4_multiply(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        Matrix4 m = data_matrices[i & DATA_MASK] * data_matrices[(i + 1) & DATA_MASK];
+        do_not_optimize(m);
+    }
+}
+
+static void bench_matrix4_inverse(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        Matrix4 m = inverse(data_transforms[i & DATA_MASK]);
+        do_not_optimize(m);
+    }
+}
+
+static void bench_matrix4_transform_point(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        Vector4 p = data_transforms[i & DATA_MASK] * v4(data_positions[(i + 7) & DATA_MASK]);
+        do_not_optimize(p);
+    }
+}
+
+static void bench_quaternion_multiply(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        Quaternion q = data_quaternions[i & DATA_MASK] * data_quaternions[(i + 1) & DATA_MASK];
+        do_not_optimize(q);
+    }
+}
+
+static void bench_quaternion_rotate_vector(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        Vector3 v = data_quaternions[i & DATA_MASK] * data_normals[(i + 3) & DATA_MASK];
+        do_not_optimize(v);
+    }
+}
+
+static void bench_quaternion_slerp(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        Quaternion q = slerp(data_quaternions[i & DATA_MASK], data_quaternions[(i + 1) & DATA_MASK], 0.3f);
+        do_not_optimize(q);
+    }
+}
+
+static void bench_quaternion_nlerp(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        Quaternion q = nlerp(data_quaternions[i & DATA_MASK], data_quaternions[(i + 1) & DATA_MASK], 0.3f);
+        do_not_optimize(q);
+    }
+}
+
+static void bench_quaternion_to_matrix4(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        Matrix4 m = quaternion_to_matrix4(data_quaternions[i & DATA_MASK]);
+        do_not_optimize(m);
+    }
+}
+
+static void bench_axis_angle(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        Quaternion q = axis_angle(data_normals[i & DATA_MASK], data_floats[i & DATA_MASK]);
+        do_not_optimize(q);
+    }
+}
+
+static void bench_construct_model_matrix(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        int k = i & DATA_MASK;
+        Matrix4 m = construct_model_matrix(data_positions[k], data_scales[k], data_quaternions[k]);
+        do_not_optimize(m);
+    }
+}
+
+static void bench_construct_trs_matrix(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        int k = i & DATA_MASK;
+        Matrix4 m = construct_trs_matrix(data_positions[k], data_quaternions[k], data_scales[k]);
+        do_not_optimize(m);
+    }
+}
+
+// the old way, for comparison with the two above
+static void bench_translation_rotation_scale_multiply(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        int k = i & DATA_MASK;
+        Matrix4 m = construct_translation_matrix(data_positions[k]) * (quaternion_to_matrix4(data_quaternions[k]) * construct_scale_matrix(data_scales[k]));
+        do_not_optimize(m);
+    }
+}
+
+static void bench_construct_model_matrices(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        construct_model_matrices(batch_matrices, &batch_transforms);
+        do_not_optimize(batch_matrices[0]);
+    }
+}
+
+static void bench_normalize_vector3(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        Vector3 v = normalize(data_positions[i & DATA_MASK]);
+        do_not_optimize(v);
+    }
+}
+
+
+
+//
+// fastmath.h, against libm over a batch
+//
+
+static void bench_sinf(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        for (int k = 0; k < BATCH_COUNT; k++) {
+            batch_out[k] = sinf(batch_angles[k]);
+        }
+        do_not_optimize(batch_out[0]);
+    }
+}
+
+static void bench_sin_fast_wide(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        for (int k = 0; k < BATCH_COUNT; k += SIMD_WIDTH) {
+            f32xN_store(batch_out + k, sin_fast(f32xN_load(batch_angles + k)));
+        }
+        do_not_optimize(batch_out[0]);
+    }
+}
+
+static void bench_cosf(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        for (int k = 0; k < BATCH_COUNT; k++) {
+            batch_out[k] = cosf(batch_angles[k]);
+        }
+        do_not_optimize(batch_out[0]);
+    }
+}
+
+static void bench_cos_fast_wide(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        for (int k = 0; k < BATCH_COUNT; k += SIMD_WIDTH) {
+            f32xN_store(batch_out + k, cos_fast(f32xN_load(batch_angles + k)));
+        }
+        do_not_optimize(batch_out[0]);
+    }
+}
+
+// y and x from two unrelated batches so every octant comes up
+static void bench_atan2f(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        for (int k = 0; k < BATCH_COUNT; k++) {
+            batch_out[k] = atan2f(batch_angles[k], batch_floats[k]);
+        }
+        do_not_optimize(batch_out[0]);
+    }
+}
+
+static void bench_atan2_fast_wide(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        for (int k = 0; k < BATCH_COUNT; k += SIMD_WIDTH) {
+            f32xN_store(batch_out + k, atan2_fast(f32xN_load(batch_angles + k), f32xN_load(batch_floats + k)));
+        }
+        do_not_optimize(batch_out[0]);
+    }
+}
+
+// halved so it stays inside the range exp_fast() clamps to
+static void bench_expf(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        for (int k = 0; k < BATCH_COUNT; k++) {
+            batch_out[k] = expf(batch_angles[k] * 0.5f);
+        }
+        do_not_optimize(batch_out[0]);
+    }
+}
+
+static void bench_exp_fast_wide(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        for (int k = 0; k < BATCH_COUNT; k += SIMD_WIDTH) {
+            f32xN_store(batch_out + k, exp_fast(f32xN_mul(f32xN_load(batch_angles + k), f32xN_set1(0.5f))));
+        }
+        do_not_optimize(batch_out[0]);
+    }
+}
+
+static void bench_logf(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        for (int k = 0; k < BATCH_COUNT; k++) {
+            batch_out[k] = logf(fabsf(batch_floats[k]) + 1.0f);
+        }
+        do_not_optimize(batch_out[0]);
+    }
+}
+
+static void bench_log_fast_wide(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        for (int k = 0; k < BATCH_COUNT; k += SIMD_WIDTH) {
+            f32xN x = f32xN_add(f32xN_abs(f32xN_load(batch_floats + k)), f32xN_set1(1.0f));
+            f32xN_store(batch_out + k, log_fast(x));
+        }
+        do_not_optimize(batch_out[0]);
+    }
+}
+
+static void bench_sqrt_divide(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        for (int k = 0; k < BATCH_COUNT; k++) {
+            batch_out[k] = 1.0f / sqrtf(fabsf(batch_angles[k]) + 1.0f);
+        }
+        do_not_optimize(batch_out[0]);
+    }
+}
+
+static void bench_rsqrt_fast_wide(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        for (int k = 0; k < BATCH_COUNT; k += SIMD_WIDTH) {
+            f32xN x = f32xN_add(f32xN_abs(f32xN_load(batch_angles + k)), f32xN_set1(1.0f));
+            f32xN_store(batch_out + k, rsqrt_fast(x));
+        }
+        do_not_optimize(batch_out[0]);
+    }
+}
+
+
+
+//
+// half.h and packing.h
+//
+
+static void bench_half_from_float(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        u32 bits;
+        memcpy(&bits, &data_floats[i & DATA_MASK], sizeof(bits));
+        u16 h = half_from_float(bits);
+        do_not_optimize(h);
+    }
+}
+
+static void bench_half_to_float(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        u32 f = half_to_float(batch_halves[i & DATA_MASK]);
+        do_not_optimize(f);
+    }
+}
+
+static void bench_halves_from_floats(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        halves_from_floats(batch_halves, batch_floats, BATCH_COUNT);
+        do_not_optimize(batch_halves[0]);
+    }
+}
+
+static void bench_floats_from_halves(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        floats_from_halves(batch_out, batch_halves, BATCH_COUNT);
+        do_not_optimize(batch_out[0]);
+    }
+}
+
+static void bench_pack_oct32(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        u32 packed = pack_oct32(data_normals[i & DATA_MASK]);
+        do_not_optimize(packed);
+    }
+}
+
+static void bench_pack_oct32_batch(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        pack_oct32_batch(batch_packed, batch_normals, BATCH_COUNT);
+        do_not_optimize(batch_packed[0]);
+    }
+}
+
+static void bench_pack_half2_batch(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        pack_half2_batch(batch_packed, batch_uvs, BATCH_COUNT);
+        do_not_optimize(batch_packed[0]);
+    }
+}
+
+
+
+//
+// quaternion_stream.h
+//
+
+static void bench_stream_nlerp(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        quaternion_stream_nlerp(&stream_out, &stream_a, &stream_b, 0.3f);
+        do_not_optimize(stream_out.x[0]);
+    }
+}
+
+static void bench_stream_slerp_approx(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        quaternion_stream_slerp_approx(&stream_out, &stream_a, &stream_b, 0.3f);
+        do_not_optimize(stream_out.x[0]);
+    }
+}
+
+static void bench_stream_multiply(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        quaternion_stream_multiply(&stream_out, &stream_a, &stream_b);
+        do_not_optimize(stream_out.x[0]);
+    }
+}
+
+
+
+//
+// basic.h containers and allocators
+//
+
+static void bench_array_append(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        Array<int> array = make_array<int>(default_allocator());
+        for (int k = 0; k < BATCH_COUNT; k++) {
+            array.append(k);
+        }
+        do_not_optimize(array.data[BATCH_COUNT - 1]);
+        array.destroy();
+    }
+}
+
+static void bench_hashtable_insert(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        Hashtable<int, int> table = make_hashtable<int, int>(default_allocator());
+        for (int k = 0; k < BATCH_COUNT; k++) {
+            table.insert(batch_keys[k], k);
+        }
+        do_not_optimize(table.count);
+        table.destroy();
+    }
+}
+
+static Hashtable<int, int> lookup_table;
+
+static void bench_hashtable_get(i64 iterations) {
+    if (lookup_table.capacity == 0) {
+        lookup_table = make_hashtable<int, int>(default_allocator());
+        for (int k = 0; k < BATCH_COUNT; k++) {
+            lookup_table.insert(batch_keys[k], k);
+        }
+    }
+    for (i64 i = 0; i < iterations; i++) {
+        int *value = lookup_table.get(batch_keys[(i * 7) & (BATCH_COUNT - 1)]);
+        do_not_optimize(value);
+    }
+}
+
+static void bench_default_allocator(i64 iterations) {
+    Allocator allocator = default_allocator();
+    for (i64 i = 0; i < iterations; i++) {
+        void *ptr = alloc(allocator, 64 + (int)(i & 255));
+        do_not_optimize(ptr);
+        free(allocator, ptr);
+    }
+}
+
+static byte arena_memory[1024 * 1024];
+
+static void bench_arena_allocator(i64 iterations) {
+    Arena arena = {};
+    init_arena(&arena, arena_memory, sizeof(arena_memory));
+    Allocator allocator = arena_allocator(&arena);
+    for (i64 i = 0; i < iterations; i++) {
+        // 1024 allocations of at most 512 bytes always fit
+        if ((i & 1023) == 0) {
+            arena_clear(&arena);
+        }
+        void *ptr = alloc(allocator, 64 + (int)(i & 255));
+        do_not_optimize(ptr);
+    }
+}
+
+static Pool_Allocator benchmark_pool;
+
+static void bench_pool_allocator(i64 iterations) {
+    if (benchmark_pool.memory == nullptr) {
+        init_pool_allocator(&benchmark_pool, default_allocator(), 64, 1024);
+    }
+    Allocator allocator = pool_allocator(&benchmark_pool);
+    for (i64 i = 0; i < iterations; i++) {
+        void *ptr = alloc(allocator, 64);
+        do_not_optimize(ptr);
+        free(allocator, ptr);
+    }
+}
+
+
+
+//
+// intersection.h and bvh.h
+//
+
+static void bench_ray_triangle(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        int k = i & DATA_MASK;
+        Triangle_Hit hit;
+        bool result = ray_triangle(data_rays[k], data_triangles[k][0], data_triangles[k][1], data_triangles[k][2], FLT_MAX, &hit);
+        do_not_optimize(result);
+    }
+}
+
+static void bench_ray_triangle_packet4(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        Triangle_Hit hit;
+        int lane = ray_triangle_packet(data_rays[i & DATA_MASK], &data_packets4[i & (DATA_COUNT / 4 - 1)], FLT_MAX, &hit);
+        do_not_optimize(lane);
+    }
+}
+
+static void bench_ray_triangle_packet8(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        Triangle_Hit hit;
+        int lane = ray_triangle_packet(data_rays[i & DATA_MASK], &data_packets8[i & (DATA_COUNT / 8 - 1)], FLT_MAX, &hit);
+        do_not_optimize(lane);
+    }
+}
+
+static void bench_ray_aabb(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        bool result = ray_aabb(data_rays[i & DATA_MASK], data_boxes[(i + 5) & DATA_MASK], FLT_MAX);
+        do_not_optimize(result);
+    }
+}
+
+static void bench_aabb_transform(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        AABB box = aabb_transform(data_boxes[i & DATA_MASK], data_transforms[(i + 1) & DATA_MASK]);
+        do_not_optimize(box);
+    }
+}
+
+static void bench_bvh_build_terrain(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        Triangle_BVH bvh = build_triangle_bvh(terrain_positions.data, terrain_indices.data, terrain_indices.count / 3, default_allocator());
+        do_not_optimize(bvh.bvh.nodes.count);
+        destroy_triangle_bvh(&bvh);
+    }
+}
+
+static void bench_bvh_raycast_terrain(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        BVH_Ray_Hit hit;
+        bool result = bvh_raycast(&terrain_bvh, terrain_rays[i & DATA_MASK], FLT_MAX, &hit);
+        do_not_optimize(result);
+    }
+}
+
+static void bench_bvh_nearest_point_terrain(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        Vector3 point;
+        int triangle;
+        bool result = bvh_nearest_point(&terrain_bvh, terrain_rays[i & DATA_MASK].origin, 50, &point, &triangle);
+        do_not_optimize(result);
+    }
+}
+
+static Array<int> overlap_results;
+
+static void bench_bvh_overlap_terrain(i64 iterations) {
+    if (overlap_results.allocator.alloc_proc == nullptr) {
+        overlap_results = make_array<int>(default_allocator(), 1024);
+    }
+    for (i64 i = 0; i < iterations; i++) {
+        Vector3 center = terrain_rays[i & DATA_MASK].origin;
+        center.y = terrain_height(center.x, center.z);
+        AABB box = {center - v3(2, 2, 2), center + v3(2, 2, 2)};
+        overlap_results.clear();
+        bvh_overlap(&terrain_bvh, box, &overlap_results);
+        do_not_optimize(overlap_results.count);
+    }
+}
+
+
+
+//
+// spherical_harmonics.h and random.h
+//
+
+static void bench_sh9_project_cubemap(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        SH9_Color sh = sh9_project_cubemap(cubemap_faces, CUBEMAP_FACE_SIZE);
+        do_not_optimize(sh);
+    }
+}
+
+static void bench_pcg32(i64 iterations) {
+    PCG32 rng = make_pcg32(1);
+    u32 sum = 0;
+    for (i64 i = 0; i < iterations; i++) {
+        sum += next_u32(&rng);
+    }
+    do_not_optimize(sum);
+}
+
+static void bench_xoshiro128(i64 iterations) {
+    Xoshiro128 rng = make_xoshiro128(1);
+    u32 sum = 0;
+    for (i64 i = 0; i < iterations; i++) {
+        sum += next_u32(&rng);
+    }
+    do_not_optimize(sum);
+}
+
+static void bench_xoshiro256(i64 iterations) {
+    Xoshiro256 rng = make_xoshiro256(1);
+    u64 sum = 0;
+    for (i64 i = 0; i < iterations; i++) {
+        sum += next_u64(&rng);
+    }
+    do_not_optimize(sum);
+}
+
+static void bench_random_float_batch(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        random_float_batch(&batch_rng, batch_out, BATCH_COUNT);
+        do_not_optimize(batch_out[0]);
+    }
+}
+
+static void bench_sample_unit_sphere(i64 iterations) {
+    Xoshiro128 rng = make_xoshiro128(1);
+    for (i64 i = 0; i < iterations; i++) {
+        Vector3 v = sample_unit_sphere(random_float(&rng), random_float(&rng));
+        do_not_optimize(v);
+    }
+}
+
+static float sphere_x[BATCH_COUNT], sphere_y[BATCH_COUNT], sphere_z[BATCH_COUNT];
+
+static void bench_sample_unit_sphere_batch(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        sample_unit_sphere_batch(&batch_rng, sphere_x, sphere_y, sphere_z, BATCH_COUNT);
+        do_not_optimize(sphere_x[0]);
+    }
+}
+
+static void bench_sobol(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        float x = sobol((u32)i, 3);
+        do_not_optimize(x);
+    }
+}
+
+
+
+#define TERRAIN_TRIANGLES (TERRAIN_SIZE * TERRAIN_SIZE * 2)
+#define CUBEMAP_TEXELS (CUBEMAP_FACE_SIZE * CUBEMAP_FACE_SIZE * 6)
+
+//
+// mesh_optimizer.h
+//
+
+static void bench_vertex_remap_terrain(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        int num_unique = generate_vertex_remap(terrain_remap, nullptr, terrain_soup.count, terrain_soup.data, terrain_soup.count, sizeof(Vector3));
+        do_not_optimize(num_unique);
+    }
+}
+
+static void bench_optimize_vertex_cache_terrain(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        optimize_vertex_cache(terrain_optimizer_out, terrain_shuffled_indices, terrain_indices.count, terrain_positions.count);
+        do_not_optimize(terrain_optimizer_out[0]);
+    }
+}
+
+static void bench_optimize_overdraw_terrain(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        optimize_overdraw(terrain_optimizer_out, terrain_cache_optimized_indices, terrain_indices.count, terrain_positions.data, terrain_positions.count, sizeof(Vector3));
+        do_not_optimize(terrain_optimizer_out[0]);
+    }
+}
+
+static void bench_optimize_vertex_fetch_remap_terrain(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        int num_used = optimize_vertex_fetch_remap(terrain_remap, terrain_cache_optimized_indices, terrain_indices.count, terrain_positions.count);
+        do_not_optimize(num_used);
+    }
+}
+
+// half the triangles, the first LOD generate_mesh_lods() would make
+static void bench_simplify_terrain(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        int count = simplify_mesh(terrain_optimizer_out, terrain_cache_optimized_indices, terrain_indices.count, terrain_positions.data, terrain_positions.count, sizeof(Vector3), terrain_indices.count / 6 * 3, 0.05f);
+        do_not_optimize(count);
+    }
+}
+
+static void bench_build_meshlets_terrain(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        int count = build_meshlets(terrain_meshlets, terrain_meshlet_vertices, terrain_meshlet_triangles, terrain_cache_optimized_indices, terrain_indices.count, terrain_positions.data, terrain_positions.count, sizeof(Vector3));
+        do_not_optimize(count);
+    }
+}
+
+// what cull_mesh_clusters() in renderer.cpp does for one view, frustum and cone test every meshlet and
+// compact the indices of the survivors
+static void bench_cull_meshlets_terrain(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        Meshlet_Culler *culler = &terrain_meshlet_cullers[i % MESHLET_VIEWS];
+        int count = 0;
+        int cluster_index = 0;
+        for (int m = 0; m < terrain_num_meshlets; m++) {
+            int num_indices = terrain_meshlets[m].triangle_count * 3;
+            if (meshlet_visible(culler, &terrain_meshlet_bounds[m])) {
+                memcpy(&terrain_optimizer_out[count], &terrain_cluster_indices[cluster_index], sizeof(u32) * num_indices);
+                count += num_indices;
+            }
+            cluster_index += num_indices;
+        }
+        do_not_optimize(count);
+    }
+}
+
+static void bench_analyze_vertex_cache_terrain(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        Vertex_Cache_Stats stats = analyze_vertex_cache(terrain_shuffled_indices, terrain_indices.count, terrain_positions.count);
+        do_not_optimize(stats.vertices_transformed);
+    }
+}
+
+static void bench_analyze_vertex_fetch_terrain(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        Vertex_Fetch_Stats stats = analyze_vertex_fetch(terrain_shuffled_indices, terrain_indices.count, terrain_positions.count, sizeof(Vector3));
+        do_not_optimize(stats.bytes_fetched);
+    }
+}
+
+static void bench_analyze_overdraw_terrain(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        Overdraw_Stats stats = analyze_overdraw(terrain_indices.data, terrain_indices.count, terrain_positions.data, terrain_positions.count, sizeof(Vector3));
+        do_not_optimize(stats.pixels_shaded);
+    }
+}
+
+
+
+//
+// tangent_space.h
+//
+
+// what the assimp loader did before generate_vertex_tangents(): one triangle at a time, adding the
+// unnormalized tangent and bitangent into its vertices
+static void accumulate_tangents(Interleaved_Vertex *vert0, Interleaved_Vertex *vert1, Interleaved_Vertex *vert2) {
+    Vector3 delta_pos1 = vert1->position - vert0->position;
+    Vector3 delta_pos2 = vert2->position - vert0->position;
+    Vector3 delta_uv1 = vert1->tex_coord - vert0->tex_coord;
+    Vector3 delta_uv2 = vert2->tex_coord - vert0->tex_coord;
+
+    float r = 1.0f / (delta_uv1.x * delta_uv2.y - delta_uv1.y * delta_uv2.x);
+    Vector3 tangent   = (delta_pos1 * delta_uv2.y - delta_pos2 * delta_uv1.y) * r;
+    Vector3 bitangent = (delta_pos2 * delta_uv1.x - delta_pos1 * delta_uv2.x) * r;
+    vert0->tangent += tangent;
+    vert1->tangent += tangent;
+    vert2->tangent += tangent;
+    vert0->bitangent += bitangent;
+    vert1->bitangent += bitangent;
+    vert2->bitangent += bitangent;
+}
+
+static void bench_accumulate_tangents_terrain(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        for (int t = 0; t < terrain_indices.count; t += 3) {
+            accumulate_tangents(&terrain_interleaved[terrain_indices[t+0]], &terrain_interleaved[terrain_indices[t+1]], &terrain_interleaved[terrain_indices[t+2]]);
+        }
+        do_not_optimize(terrain_interleaved[0].tangent.x);
+    }
+}
+
+static Tangent_Mesh make_tangent_mesh(Array<Interleaved_Vertex> *vertices, Array<u32> *indices, Vector4 *out_tangents) {
+    Tangent_Mesh mesh = {};
+    mesh.indices = indices->data;
+    mesh.num_indices = indices->count;
+    mesh.positions = &vertices->data[0].position;
+    mesh.normals = &vertices->data[0].normal;
+    mesh.tex_coords = &vertices->data[0].tex_coord;
+    mesh.num_vertices = vertices->count;
+    mesh.vertex_stride = sizeof(Interleaved_Vertex);
+    mesh.out_tangents = out_tangents;
+    return mesh;
+}
+
+static void bench_generate_tangents_terrain(i64 iterations) {
+    Tangent_Mesh mesh = make_tangent_mesh(&terrain_interleaved, &terrain_indices, tangent_corners);
+    for (i64 i = 0; i < iterations; i++) {
+        generate_tangents(&mesh, 1);
+        do_not_optimize(tangent_corners[0].x);
+    }
+}
+
+// every chunk in one call, which is what the loader does with a scene's meshes
+static void bench_generate_tangents_chunks_batched(i64 iterations) {
+    Tangent_Mesh meshes[TANGENT_CHUNKS];
+    Vector4 *out = tangent_corners;
+    for (int chunk = 0; chunk < TANGENT_CHUNKS; chunk++) {
+        meshes[chunk] = make_tangent_mesh(&tangent_chunk_vertices[chunk], &tangent_chunk_indices[chunk], out);
+        out += tangent_chunk_indices[chunk].count;
+    }
+    for (i64 i = 0; i < iterations; i++) {
+        generate_tangents(meshes, TANGENT_CHUNKS);
+        do_not_optimize(tangent_corners[0].x);
+    }
+}
+
+static void bench_generate_tangents_chunks_one_by_one(i64 iterations) {
+    Tangent_Mesh meshes[TANGENT_CHUNKS];
+    Vector4 *out = tangent_corners;
+    for (int chunk = 0; chunk < TANGENT_CHUNKS; chunk++) {
+        meshes[chunk] = make_tangent_mesh(&tangent_chunk_vertices[chunk], &tangent_chunk_indices[chunk], out);
+        out += tangent_chunk_indices[chunk].count;
+    }
+    for (i64 i = 0; i < iterations; i++) {
+        for (int chunk = 0; chunk < TANGENT_CHUNKS; chunk++) {
+            generate_tangents(&meshes[chunk], 1);
+        }
+        do_not_optimize(tangent_corners[0].x);
+    }
+}
+
+
+static void bench_generate_tangents_helmet(i64 iterations) {
+    if (!helmet_found) return;
+    Tangent_Mesh mesh = make_tangent_mesh(&helmet_vertices, &helmet_indices, helmet_corners);
+    for (i64 i = 0; i < iterations; i++) {
+        generate_tangents(&mesh, 1);
+        do_not_optimize(helmet_corners[0].x);
+    }
+}
+
+
+//
+// shadow passes, renderer.cpp's render_scene() modelled on the CPU
+//
+// One iteration is a frame's worth of shadow maps over the terrain: NUM_SHADOW_MAPS cascades, each
+// binding a vertex buffer and the index buffer and running every index through a vertex shader
+// that only reads the position. The terrain's indices are in grid order so this is the friendly
+// case, the difference grows with less coherent meshes. bytes_per_iteration is what gets bound per frame:
+//   full Vertex: 4 * (103041 * 76 + 614400 * 4) bytes = 41.2 MB
+//   positions:   4 * (103041 * 12 + 614400 * 4) bytes = 14.8 MB
+//
+
+#define SHADOW_CASCADES 4 // NUM_SHADOW_MAPS
+#define TERRAIN_VERTICES ((TERRAIN_SIZE + 1) * (TERRAIN_SIZE + 1))
+
+static float shadow_pass_fetch(byte *vertices, int stride, u32 *indices, int num_indices) {
+    float depth_sum = 0;
+    for (int cascade = 0; cascade < SHADOW_CASCADES; cascade++) {
+        // only the depth row of the light's matrix, a shadow pass doesn't do much more than this per vertex
+        Vector4 depth_row = v4(data_normals[cascade].x, data_normals[cascade].y, data_normals[cascade].z, 0.5f);
+        for (int i = 0; i < num_indices; i++) {
+            Vector3 position = *(Vector3 *)(vertices + (u64)indices[i] * stride);
+            depth_sum += position.x * depth_row.x + position.y * depth_row.y + position.z * depth_row.z + depth_row.w;
+        }
+    }
+    return depth_sum;
+}
+
+static void bench_shadow_pass_interleaved_terrain(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        float depth_sum = shadow_pass_fetch((byte *)terrain_interleaved.data, sizeof(Interleaved_Vertex), terrain_indices.data, terrain_indices.count);
+        do_not_optimize(depth_sum);
+    }
+}
+
+static void bench_shadow_pass_positions_terrain(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        float depth_sum = shadow_pass_fetch((byte *)terrain_positions.data, sizeof(Vector3), terrain_indices.data, terrain_indices.count);
+        do_not_optimize(depth_sum);
+    }
+}
+
+
+
+//
+// model_format.h
+//
+
+static void bench_open_cooked_terrain(i64 iterations) {
+    for (i64 i = 0; i < iterations; i++) {
+        Cooked_Model_File model;
+        bool ok = open_cooked_model(cooked_terrain_filename, sizeof(Vector3), &model);
+        assert(ok);
+        do_not_optimize(model.meshes[0].num_indices);
+        close_cooked_model(&model);
+    }
+}
+
+
+
+//
+// json.h, gltf.h
+//
+
+static void bench_parse_json_helmet(i64 iterations) {
+    if (!helmet_found) return;
+    for (i64 i = 0; i < iterations; i++) {
+        Json json;
+        bool ok = parse_json((char *)helmet_file.data, helmet_file.size, default_allocator(), &json);
+        assert(ok);
+        do_not_optimize(json.tokens.count);
+        destroy_json(&json);
+    }
+}
+
+static void bench_open_gltf_helmet(i64 iterations) {
+    if (!helmet_found) return;
+    for (i64 i = 0; i < iterations; i++) {
+        Gltf_File gltf;
+        bool ok = open_gltf(helmet_filename, default_allocator(), &gltf);
+        assert(ok);
+        do_not_optimize(gltf.accessors.count);
+        close_gltf(&gltf);
+    }
+}
+
+// open_gltf() and copying the vertices out, the part of loading the helmet assimp's ReadFile() does
+static void bench_read_gltf_helmet(i64 iterations) {
+    if (!helmet_found) return;
+    Array<Interleaved_Vertex> vertices = make_array<Interleaved_Vertex>(default_allocator(), helmet_vertices.count);
+    Array<u32> indices = make_array<u32>(default_allocator(), helmet_indices.count);
+    for (i64 i = 0; i < iterations; i++) {
+        Gltf_File gltf;
+        bool ok = open_gltf(helmet_filename, default_allocator(), &gltf);
+        assert(ok);
+        read_helmet(&gltf, &vertices, &indices);
+        do_not_optimize(vertices[0].position.x);
+        close_gltf(&gltf);
+    }
+    vertices.destroy();
+    indices.destroy();
+}
+
+
+
+//
+// texture_compression.h
+//
+
+static void compress_texture(byte *pixels, Image_Format format, Compression_Quality quality, i64 iterations) {
+    if (!textures_found) return;
+    for (i64 i = 0; i < iterations; i++) {
+        compress_image(format, quality, pixels, TEXTURE_SIZE, TEXTURE_SIZE, TEXTURE_SIZE * 4, texture_blocks);
+        do_not_optimize(texture_blocks[0]);
+    }
+}
+
+static void bench_compress_bc1(i64 iterations)        { compress_texture(texture_albedo, IMAGE_FORMAT_BC1, COMPRESSION_QUALITY_NORMAL, iterations); }
+static void bench_compress_bc3(i64 iterations)        { compress_texture(texture_albedo, IMAGE_FORMAT_BC3, COMPRESSION_QUALITY_NORMAL, iterations); }
+static void bench_compress_bc4(i64 iterations)        { compress_texture(texture_albedo, IMAGE_FORMAT_BC4, COMPRESSION_QUALITY_NORMAL, iterations); }
+static void bench_compress_bc5_normal(i64 iterations) { compress_texture(texture_normal, IMAGE_FORMAT_BC5, COMPRESSION_QUALITY_NORMAL, iterations); }
+static void bench_compress_bc7_fast(i64 iterations)   { compress_texture(texture_albedo, IMAGE_FORMAT_BC7, COMPRESSION_QUALITY_FAST,   iterations); }
+static void bench_compress_bc7(i64 iterations)        { compress_texture(texture_albedo, IMAGE_FORMAT_BC7, COMPRESSION_QUALITY_NORMAL, iterations); }
+static void bench_compress_bc7_best(i64 iterations)   { compress_texture(texture_albedo, IMAGE_FORMAT_BC7, COMPRESSION_QUALITY_BEST,   iterations); }
+
+static void generate_texture_mipmaps(byte *pixels, Mipmap_Filter filter, bool srgb, bool normal_map, float alpha_cutoff, i64 iterations) {
+    if (!textures_found) return;
+    Mipmap_Settings settings = {};
+    settings.filter = filter;
+    settings.srgb = srgb;
+    settings.normal_map = normal_map;
+    settings.alpha_cutoff = alpha_cutoff;
+    for (i64 i = 0; i < iterations; i++) {
+        generate_mipmaps(pixels, TEXTURE_SIZE, TEXTURE_SIZE, settings, mipmap_count(TEXTURE_SIZE, TEXTURE_SIZE), texture_mipmaps, default_allocator());
+        do_not_optimize(texture_mipmaps[0]);
+    }
+}
+
+static void bench_mipmaps_box(i64 iterations)             { generate_texture_mipmaps(texture_albedo, MIPMAP_FILTER_BOX,    false, false, 0,    iterations); }
+static void bench_mipmaps_box_srgb(i64 iterations)        { generate_texture_mipmaps(texture_albedo, MIPMAP_FILTER_BOX,    true,  false, 0,    iterations); }
+static void bench_mipmaps_kaiser_srgb(i64 iterations)     { generate_texture_mipmaps(texture_albedo, MIPMAP_FILTER_KAISER, true,  false, 0,    iterations); }
+static void bench_mipmaps_kaiser_coverage(i64 iterations) { generate_texture_mipmaps(texture_albedo, MIPMAP_FILTER_KAISER, true,  false, 0.5f, iterations); }
+static void bench_mipmaps_kaiser_normal(i64 iterations)   { generate_texture_mipmaps(texture_normal, MIPMAP_FILTER_KAISER, false, true,  0,    iterations); }
+
+// --texture-report: every format over whole images, for judging quality changes on real textures
+// rather than the crop. PSNR is over the channels the format keeps.
+static void print_texture_report(char **filenames, int num_filenames, Compression_Quality quality) {
+    Image_Format formats[] = {IMAGE_FORMAT_BC1, IMAGE_FORMAT_BC3, IMAGE_FORMAT_BC4, IMAGE_FORMAT_BC5, IMAGE_FORMAT_BC7};
+    u32 channel_masks[]    = {0x7,              0xf,              0x1,              0x3,              0xf};
+    double total_psnr[ARRAYSIZE(formats)] = {};
+    double total_seconds[ARRAYSIZE(formats)] = {};
+    i64 total_pixels = 0;
+    int num_images = 0;
+
+    printf("%-48s", "image");
+    for (int f = 0; f < (int)ARRAYSIZE(formats); f++) {
+        printf(" %16s", image_format_name(formats[f]));
+    }
+    printf("\n");
+    for (int i = 0; i < num_filenames; i++) {
+        int width;
+        int height;
+        int channels;
+        byte *pixels = stbi_load(filenames[i], &width, &height, &channels, 4);
+        if (pixels == nullptr) {
+            printf("%-48s couldn't load: %s\n", filenames[i], stbi_failure_reason());
+            continue;
+        }
+        // BC7 rounds up to whole blocks so it's the biggest for sizes that aren't a multiple of 4
+        i64 blocks_size = image_level_size(IMAGE_FORMAT_BC7, width, height);
+        if (blocks_size < image_level_size(IMAGE_FORMAT_RGBA8, width, height)) blocks_size = image_level_size(IMAGE_FORMAT_RGBA8, width, height);
+        byte *blocks = (byte *)alloc(default_allocator(), (int)blocks_size);
+        byte *decoded = (byte *)alloc(default_allocator(), width * height * 4);
+        printf("%-48s", filenames[i]);
+        for (int f = 0; f < (int)ARRAYSIZE(formats); f++) {
+            double start = benchmark_seconds();
+            compress_image(formats[f], quality, pixels, width, height, width * 4, blocks);
+            double seconds = benchmark_seconds() - start;
+            decompress_image(formats[f], blocks, width, height, decoded);
+            float psnr = image_psnr(pixels, decoded, width, height, channel_masks[f]);
+            // a lossless channel is 999, don't let e.g. a flat BC4 image swamp the average
+            if (psnr > 99) psnr = 99;
+            total_psnr[f] += psnr;
+            total_seconds[f] += seconds;
+            printf(" %6.2fdB %5.1fMp/s", psnr, width * height / seconds / 1e6);
+        }
+        printf("\n");
+        total_pixels += (i64)width * height;
+        num_images += 1;
+        free(default_allocator(), blocks);
+        free(default_allocator(), decoded);
+        stbi_image_free(pixels);
+    }
+    if (num_images == 0) {
+        return;
+    }
+    printf("%-48s", "average");
+    for (int f = 0; f < (int)ARRAYSIZE(formats); f++) {
+        printf(" %6.2fdB %5.1fMp/s", total_psnr[f] / num_images, total_pixels / total_seconds[f] / 1e6);
+    }
+    printf("\n");
+}
+
+
+
+static Benchmark BENCHMARKS[] = {
+    {"math/matrix4_multiply",                   bench_matrix4_multiply,                   1, 0},
+    {"math/matrix4_inverse",                    bench_matrix4_inverse,                    1, 0},
+    {"math/matrix4_transform_point",            bench_matrix4_transform_point,            1, 0},
+    {"math/quaternion_multiply",                bench_quaternion_multiply,                1, 0},
+    {"math/quaternion_rotate_vector",           bench_quaternion_rotate_vector,           1, 0},
+    {"math/quaternion_slerp",                   bench_quaternion_slerp,                   1, 0},
+    {"math/quaternion_nlerp",                   bench_quaternion_nlerp,                   1, 0},
+    {"math/quaternion_to_matrix4",              bench_quaternion_to_matrix4,              1, 0},
+    {"math/axis_angle",                         bench_axis_angle,                         1, 0},
+    {"math/construct_model_matrix",             bench_construct_model_matrix,             1, 0},
+    {"math/construct_trs_matrix",               bench_construct_trs_matrix,               1, 0},
+    {"math/translation_rotation_scale_multiply",bench_translation_rotation_scale_multiply,1, 0},
+    {"math/construct_model_matrices",           bench_construct_model_matrices,           BATCH_COUNT, BATCH_COUNT * sizeof(Matrix4)},
+    {"math/normalize_vector3",                  bench_normalize_vector3,                  1, 0},
+
+    {"fastmath/sinf",                           bench_sinf,                               BATCH_COUNT, 0},
+    {"fastmath/sin_fast_wide",                  bench_sin_fast_wide,                      BATCH_COUNT, 0},
+    {"fastmath/cosf",                           bench_cosf,                               BATCH_COUNT, 0},
+    {"fastmath/cos_fast_wide",                  bench_cos_fast_wide,                      BATCH_COUNT, 0},
+    {"fastmath/atan2f",                         bench_atan2f,                             BATCH_COUNT, 0},
+    {"fastmath/atan2_fast_wide",                bench_atan2_fast_wide,                    BATCH_COUNT, 0},
+    {"fastmath/expf",                           bench_expf,                               BATCH_COUNT, 0},
+    {"fastmath/exp_fast_wide",                  bench_exp_fast_wide,                      BATCH_COUNT, 0},
+    {"fastmath/logf",                           bench_logf,                               BATCH_COUNT, 0},
+    {"fastmath/log_fast_wide",                  bench_log_fast_wide,                      BATCH_COUNT, 0},
+    {"fastmath/sqrt_divide",                    bench_sqrt_divide,                        BATCH_COUNT, 0},
+    {"fastmath/rsqrt_fast_wide",                bench_rsqrt_fast_wide,                    BATCH_COUNT, 0},
+
+    {"half/half_from_float",                    bench_half_from_float,                    1, 0},
+    {"half/half_to_float",                      bench_half_to_float,                      1, 0},
+    {"half/halves_from_floats",                 bench_halves_from_floats,                 BATCH_COUNT, BATCH_COUNT * sizeof(float)},
+    {"half/floats_from_halves",                 bench_floats_from_halves,                 BATCH_COUNT, BATCH_COUNT * sizeof(u16)},
+    {"packing/pack_oct32",                      bench_pack_oct32,                         1, 0},
+    {"packing/pack_oct32_batch",                bench_pack_oct32_batch,                   BATCH_COUNT, BATCH_COUNT * sizeof(Vector3)},
+    {"packing/pack_half2_batch",                bench_pack_half2_batch,                   BATCH_COUNT, BATCH_COUNT * sizeof(Vector2)},
+
+    {"quaternion_stream/nlerp",                 bench_stream_nlerp,                       BATCH_COUNT, 0},
+    {"quaternion_stream/slerp_approx",          bench_stream_slerp_approx,                BATCH_COUNT, 0},
+    {"quaternion_stream/multiply",              bench_stream_multiply,                    BATCH_COUNT, 0},
+
+    {"basic/array_append",                      bench_array_append,                       BATCH_COUNT, 0},
+    {"basic/hashtable_insert",                  bench_hashtable_insert,                   BATCH_COUNT, 0},
+    {"basic/hashtable_get",                     bench_hashtable_get,                      1, 0},
+    {"basic/default_allocator",                 bench_default_allocator,                  1, 0},
+    {"basic/arena_allocator",                   bench_arena_allocator,                    1, 0},
+    {"basic/pool_allocator",                    bench_pool_allocator,                     1, 0},
+
+    {"intersection/ray_triangle",               bench_ray_triangle,                       1, 0},
+    {"intersection/ray_triangle_packet4",       bench_ray_triangle_packet4,               4, 0},
+    {"intersection/ray_triangle_packet8",       bench_ray_triangle_packet8,               8, 0},
+    {"intersection/ray_aabb",                   bench_ray_aabb,                           1, 0},
+    {"intersection/aabb_transform",             bench_aabb_transform,                     1, 0},
+    {"bvh/build_terrain",                       bench_bvh_build_terrain,                  TERRAIN_TRIANGLES, 0},
+    {"bvh/raycast_terrain",                     bench_bvh_raycast_terrain,                1, 0},
+    {"bvh/nearest_point_terrain",               bench_bvh_nearest_point_terrain,          1, 0},
+    {"bvh/overlap_terrain",                     bench_bvh_overlap_terrain,                1, 0},
+
+    {"spherical_harmonics/project_cubemap",     bench_sh9_project_cubemap,                CUBEMAP_TEXELS, CUBEMAP_TEXELS * 4},
+
+    {"random/pcg32",                            bench_pcg32,                              1, 0},
+    {"random/xoshiro128",                       bench_xoshiro128,                         1, 0},
+    {"random/xoshiro256",                       bench_xoshiro256,                         1, 0},
+    {"random/random_float_batch",               bench_random_float_batch,                 BATCH_COUNT, BATCH_COUNT * sizeof(float)},
+    {"random/sample_unit_sphere",               bench_sample_unit_sphere,                 1, 0},
+    {"random/sample_unit_sphere_batch",         bench_sample_unit_sphere_batch,           BATCH_COUNT, 0},
+    {"random/sobol",                            bench_sobol,                              1, 0},
+
+    {"mesh_optimizer/vertex_remap_terrain",     bench_vertex_remap_terrain,               TERRAIN_TRIANGLES * 3, TERRAIN_TRIANGLES * 3 * sizeof(Vector3)},
+    {"mesh_optimizer/optimize_vertex_cache_terrain", bench_optimize_vertex_cache_terrain,     TERRAIN_TRIANGLES, 0},
+    {"mesh_optimizer/optimize_overdraw_terrain", bench_optimize_overdraw_terrain,             TERRAIN_TRIANGLES, 0},
+    {"mesh_optimizer/vertex_fetch_remap_terrain", bench_optimize_vertex_fetch_remap_terrain,  TERRAIN_TRIANGLES * 3, 0},
+    {"mesh_optimizer/simplify_terrain",         bench_simplify_terrain,                   TERRAIN_TRIANGLES, 0},
+    {"mesh_optimizer/build_meshlets_terrain",   bench_build_meshlets_terrain,             TERRAIN_TRIANGLES, 0},
+    {"mesh_optimizer/cull_meshlets_terrain",    bench_cull_meshlets_terrain,              TERRAIN_TRIANGLES, 0},
+    {"mesh_optimizer/analyze_vertex_cache_terrain", bench_analyze_vertex_cache_terrain,       TERRAIN_TRIANGLES * 3, 0},
+    {"mesh_optimizer/analyze_vertex_fetch_terrain", bench_analyze_vertex_fetch_terrain,       TERRAIN_TRIANGLES * 3, 0},
+    {"mesh_optimizer/analyze_overdraw_terrain", bench_analyze_overdraw_terrain,               TERRAIN_TRIANGLES, 0},
+
+    {"tangent_space/accumulate_terrain",        bench_accumulate_tangents_terrain,        TERRAIN_TRIANGLES, 0},
+    {"tangent_space/generate_terrain",          bench_generate_tangents_terrain,          TERRAIN_TRIANGLES, 0},
+    {"tangent_space/generate_chunks_batched",   bench_generate_tangents_chunks_batched,   TERRAIN_TRIANGLES, 0},
+    {"tangent_space/generate_chunks_one_by_one",bench_generate_tangents_chunks_one_by_one,TERRAIN_TRIANGLES, 0},
+    {"tangent_space/generate_helmet",           bench_generate_tangents_helmet,           HELMET_TRIANGLES, 0},
+
+    {"shadow_pass/interleaved_vertices_terrain", bench_shadow_pass_interleaved_terrain,     1, SHADOW_CASCADES * ((i64)TERRAIN_VERTICES * sizeof(Interleaved_Vertex) + TERRAIN_TRIANGLES * 3 * sizeof(u32))},
+    {"shadow_pass/position_stream_terrain",     bench_shadow_pass_positions_terrain,       1, SHADOW_CASCADES * ((i64)TERRAIN_VERTICES * sizeof(Vector3) + TERRAIN_TRIANGLES * 3 * sizeof(u32))},
+    {"model_format/open_cooked_terrain",        bench_open_cooked_terrain,                1, 0},
+    {"gltf/parse_json_helmet",                  bench_parse_json_helmet,                  1, 0},
+    {"gltf/open_helmet",                        bench_open_gltf_helmet,                   1, 0},
+    {"gltf/read_helmet",                        bench_read_gltf_helmet,                   1, 0},
+
+    {"texture/bc1_albedo",                      bench_compress_bc1,                       TEXTURE_SIZE * TEXTURE_SIZE, TEXTURE_SIZE * TEXTURE_SIZE * 4},
+    {"texture/bc3_albedo",                      bench_compress_bc3,                       TEXTURE_SIZE * TEXTURE_SIZE, TEXTURE_SIZE * TEXTURE_SIZE * 4},
+    {"texture/bc4_albedo",                      bench_compress_bc4,                       TEXTURE_SIZE * TEXTURE_SIZE, TEXTURE_SIZE * TEXTURE_SIZE * 4},
+    {"texture/bc5_normal",                      bench_compress_bc5_normal,                TEXTURE_SIZE * TEXTURE_SIZE, TEXTURE_SIZE * TEXTURE_SIZE * 4},
+    {"texture/bc7_fast_albedo",                 bench_compress_bc7_fast,                  TEXTURE_SIZE * TEXTURE_SIZE, TEXTURE_SIZE * TEXTURE_SIZE * 4},
+    {"texture/bc7_albedo",                      bench_compress_bc7,                       TEXTURE_SIZE * TEXTURE_SIZE, TEXTURE_SIZE * TEXTURE_SIZE * 4},
+    {"texture/bc7_best_albedo",                 bench_compress_bc7_best,                  TEXTURE_SIZE * TEXTURE_SIZE, TEXTURE_SIZE * TEXTURE_SIZE * 4},
+    {"mipmap/box_albedo",                       bench_mipmaps_box,                        TEXTURE_SIZE * TEXTURE_SIZE, TEXTURE_SIZE * TEXTURE_SIZE * 4},
+    {"mipmap/box_srgb_albedo",                  bench_mipmaps_box_srgb,                   TEXTURE_SIZE * TEXTURE_SIZE, TEXTURE_SIZE * TEXTURE_SIZE * 4},
+    {"mipmap/kaiser_srgb_albedo",               bench_mipmaps_kaiser_srgb,                TEXTURE_SIZE * TEXTURE_SIZE, TEXTURE_SIZE * TEXTURE_SIZE * 4},
+    {"mipmap/kaiser_alpha_coverage_albedo",     bench_mipmaps_kaiser_coverage,            TEXTURE_SIZE * TEXTURE_SIZE, TEXTURE_SIZE * TEXTURE_SIZE * 4},
+    {"mipmap/kaiser_normal",                    bench_mipmaps_kaiser_normal,              TEXTURE_SIZE * TEXTURE_SIZE, TEXTURE_SIZE * TEXTURE_SIZE * 4},
+};
+
+
+
+static bool matches_filters(const char *name, char **filters, int num_filters) {
+    if (num_filters == 0) {
+        return true;
+    }
+    for (int i = 0; i < num_filters; i++) {
+        if (strstr(name, filters[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void write_json(FILE *file, Benchmark_Result *results, int num_results, double min_seconds) {
+#if defined(__clang__)
+    const char *compiler = "clang " __clang_version__;
+#elif defined(__GNUC__)
+    const char *compiler = "gcc " __VERSION__;
+#elif defined(_MSC_VER)
+    const char *compiler = "msvc";
+#else
+    const char *compiler = "unknown";
+#endif
+    fprintf(file, "{\n");
+    fprintf(file, "  \"compiler\": \"%s\",\n", compiler);
+    fprintf(file, "  \"simd_width\": %d,\n", SIMD_WIDTH);
+    fprintf(file, "  \"hardware_threads\": %d,\n", num_hardware_threads());
+    fprintf(file, "  \"min_time_ms\": %g,\n", min_seconds * 1000);
+    fprintf(file, "  \"benchmarks\": [\n");
+    for (int i = 0; i < num_results; i++) {
+        Benchmark_Result *r = &results[i];
+        fprintf(file, "    {\"name\": \"%s\", \"iterations\": %lld, \"repetitions\": %d, "
+                      "\"ns_per_op\": %.4f, \"ns_per_op_min\": %.4f, \"ns_per_op_max\": %.4f, "
+                      "\"ops_per_second\": %.1f, \"bytes_per_second\": %.1f}%s\n",
+                r->name, (long long)r->iterations, r->repetitions,
+                r->ns_per_op_median, r->ns_per_op_min, r->ns_per_op_max,
+                r->ops_per_second, r->bytes_per_second, i + 1 < num_results ? "," : "");
+    }
+    fprintf(file, "  ]\n");
+    fprintf(file, "}\n");
+}
+
+// --check: the SIMD kernels against the scalar code they stand in for, over the benchmark data. the
+// timings say nothing about whether a kernel still gives the right answer. checks of kernels that
+// have to match exactly count the results that differ as their error, with a tolerance of 0.
+
+struct Accuracy_Check {
+    const char *name;
+    void (*proc)(Accuracy_Check *check);
+    double tolerance;
+    double max_error;
+};
+
+// angle of the rotation between a and b in radians, in double and with atan2() because acos() of a
+// dot product near 1 can't resolve anything under ~0.0003 radians in float
+static double rotation_error(Quaternion a, Quaternion b) {
+    double sign = dot(a, b) < 0 ? -1 : 1;
+    double difference = 0;
+    double sum = 0;
+    for (int i = 0; i < 4; i++) {
+        double d = a.elements[i] - sign * b.elements[i];
+        double s = a.elements[i] + sign * b.elements[i];
+        difference += d * d;
+        sum += s * s;
+    }
+    return 2 * atan2(sqrt(difference), sqrt(sum));
+}
+
+// t of 0, 0.1, ... 1 for every pair in stream_a/stream_b, then one t per element for the _weights versions
+static void check_quaternion_stream(Accuracy_Check *check, bool slerp_kernel) {
+    static float weights[BATCH_COUNT];
+    for (int i = 0; i < BATCH_COUNT; i++) weights[i] = (float)(i % 101) / 100.0f;
+
+    for (int step = 0; step <= 11; step++) {
+        float t = step / 10.0f;
+        if (step == 11) {
+            if (slerp_kernel) quaternion_stream_slerp_approx_weights(&stream_out, &stream_a, &stream_b, weights);
+            else              quaternion_stream_nlerp_weights(&stream_out, &stream_a, &stream_b, weights);
+        }
+        else {
+            if (slerp_kernel) quaternion_stream_slerp_approx(&stream_out, &stream_a, &stream_b, t);
+            else              quaternion_stream_nlerp(&stream_out, &stream_a, &stream_b, t);
+        }
+        for (int i = 0; i < BATCH_COUNT; i++) {
+            Quaternion a = quaternion_stream_get(&stream_a, i);
+            Quaternion b = quaternion_stream_get(&stream_b, i);
+            float element_t = step == 11 ? weights[i] : t;
+            Quaternion expected = slerp_kernel ? slerp(a, b, element_t) : nlerp(a, b, element_t);
+            double error = rotation_error(quaternion_stream_get(&stream_out, i), expected);
+            if (error > check->max_error) check->max_error = error;
+        }
+    }
+}
+
+static void check_stream_nlerp(Accuracy_Check *check)        { check_quaternion_stream(check, false); }
+static void check_stream_slerp_approx(Accuracy_Check *check) { check_quaternion_stream(check, true); }
+
+// one packet lane per ray, the lanes left over stay zeroed and never hit
+static void check_aabb_packets(Accuracy_Check *check, Ray *rays, float *t_maxes, int count, AABB box) {
+    for (int first = 0; first < count; first += 8) {
+        Ray_Packet4 packet4[2] = {};
+        Ray_Packet8 packet8 = {};
+        for (int lane = 0; lane < 8 && first + lane < count; lane++) {
+            set_ray(&packet4[lane / 4], lane % 4, rays[first + lane], t_maxes[first + lane]);
+            set_ray(&packet8, lane, rays[first + lane], t_maxes[first + lane]);
+        }
+        float t4[8], t8[8];
+        int mask4 = ray_packet_aabb(&packet4[0], box, t4) | (ray_packet_aabb(&packet4[1], box, t4 + 4) << 4);
+        int mask8 = ray_packet_aabb(&packet8, box, t8);
+        for (int lane = 0; lane < 8 && first + lane < count; lane++) {
+            float t = 0;
+            bool hit = ray_aabb(rays[first + lane], box, t_maxes[first + lane], &t);
+            bool hit4 = (mask4 >> lane) & 1;
+            bool hit8 = (mask8 >> lane) & 1;
+            if (hit4 != hit || hit8 != hit || (hit && (t4[lane] != t || t8[lane] != t))) {
+                check->max_error += 1;
+            }
+        }
+    }
+}
+
+// the closest hit among triangles [first, first + count) of data_triangles, the way the packets pick it
+static int closest_scalar_hit(Ray ray, int first, int count, float t_max, Triangle_Hit *out_hit) {
+    int best = -1;
+    for (int lane = 0; lane < count; lane++) {
+        Vector3 *triangle = data_triangles[first + lane];
+        Triangle_Hit hit;
+        if (ray_triangle(ray, triangle[0], triangle[1], triangle[2], t_max, &hit) && (best == -1 || hit.t < out_hit->t)) {
+            best = lane;
+            *out_hit = hit;
+        }
+    }
+    return best;
+}
+
+// every data_ray against every packet of data_triangles, with no t_max and with one that cuts some
+// hits off. a different lane counts as an error of 1, otherwise the error is the largest difference
+// in t, u or v relative to t. that isn't 0 when the compiler contracts the scalar version into FMAs
+// (gcc with -mfma does), the packets only use them for the dot products.
+static void check_ray_triangle_packets(Accuracy_Check *check) {
+    float t_maxes[] = {FLT_MAX, 10};
+    for (int m = 0; m < (int)ARRAYSIZE(t_maxes); m++) {
+        for (int r = 0; r < DATA_COUNT; r++) {
+            Ray ray = data_rays[r];
+            for (int p = 0; p < DATA_COUNT / 8; p++) {
+                for (int half = 0; half < 3; half++) {
+                    Triangle_Hit expected = {}, hit = {};
+                    int expected_lane, lane;
+                    if (half < 2) {
+                        expected_lane = closest_scalar_hit(ray, p * 8 + half * 4, 4, t_maxes[m], &expected);
+                        lane = ray_triangle_packet(ray, &data_packets4[p * 2 + half], t_maxes[m], &hit);
+                    }
+                    else {
+                        expected_lane = closest_scalar_hit(ray, p * 8, 8, t_maxes[m], &expected);
+                        lane = ray_triangle_packet(ray, &data_packets8[p], t_maxes[m], &hit);
+                    }
+                    double error = 0;
+                    if (lane != expected_lane) {
+                        error = 1;
+                    }
+                    else if (lane != -1) {
+                        error = fmax(fabs((double)hit.t - expected.t), fmax(fabs((double)hit.u - expected.u), fabs((double)hit.v - expected.v)) * expected.t) / expected.t;
+                    }
+                    if (error > check->max_error) check->max_error = error;
+                }
+            }
+        }
+    }
+}
+
+// every data_ray against the first 64 data_boxes, with t_maxes that cut some of the hits off
+static void check_ray_aabb_packets(Accuracy_Check *check) {
+    static float t_maxes[DATA_COUNT];
+    PCG32 rng = make_pcg32(31);
+    for (int i = 0; i < DATA_COUNT; i++) t_maxes[i] = random_range(&rng, 0, 20);
+    for (int b = 0; b < 64; b++) {
+        check_aabb_packets(check, data_rays, t_maxes, DATA_COUNT, data_boxes[b]);
+    }
+}
+
+// axis aligned rays starting on the faces, edges and corners of a box, going along every axis. the
+// ones parallel to the face they start on are the 0*inf case in the slab test.
+static void check_ray_aabb_on_faces(Accuracy_Check *check) {
+    AABB box = {v3(-1, -1, -1), v3(1, 1, 1)};
+    float offsets[] = {-1.5f, -1, 0, 1, 1.5f};
+    Vector3 directions[] = {v3(1, 0, 0), v3(-1, 0, 0), v3(0, 1, 0), v3(0, -1, 0), v3(0, 0, 1), v3(0, 0, -1)};
+    Array<Ray> rays = make_array<Ray>(default_allocator());
+    defer(rays.destroy());
+    for (int axis = 0; axis < 3; axis++) {
+        for (int side = 0; side < 2; side++) {
+            for (int u = 0; u < (int)ARRAYSIZE(offsets); u++) {
+                for (int v = 0; v < (int)ARRAYSIZE(offsets); v++) {
+                    for (int d = 0; d < (int)ARRAYSIZE(directions); d++) {
+                        Ray ray = {};
+                        ray.origin.elements[axis] = side ? box.max.elements[axis] : box.min.elements[axis];
+                        ray.origin.elements[(axis + 1) % 3] = offsets[u];
+                        ray.origin.elements[(axis + 2) % 3] = offsets[v];
+                        ray.direction = directions[d];
+                        rays.append(ray);
+                    }
+                }
+            }
+        }
+    }
+    Array<float> t_maxes = make_array<float>(default_allocator(), rays.count);
+    defer(t_maxes.destroy());
+    For (i, rays) t_maxes.append(10);
+    check_aabb_packets(check, rays.data, t_maxes.data, rays.count, box);
+}
+
+// ulps between a fast result and double precision libm, in units of the float ulp at the correctly
+// rounded answer. errors under absolute_tolerance count as 0, for the functions fastmath.h documents
+// an absolute bound for where the result is close to 0.
+static double ulp_error(float result, double expected, double absolute_tolerance) {
+    double error = fabs((double)result - expected);
+    if (error <= absolute_tolerance) {
+        return 0;
+    }
+    float rounded = fabsf((float)expected);
+    return error / ((double)nextafterf(rounded, INFINITY) - rounded);
+}
+
+#define FAST_MATH_CHECK_COUNT (1 << 20)
+static float fast_math_as[FAST_MATH_CHECK_COUNT]; // first argument
+static float fast_math_bs[FAST_MATH_CHECK_COUNT]; // second argument, for atan2
+
+// both the f32xN and scalar versions, the scalar ones run the 4 wide code so on AVX this is both widths
+static void check_fast_function(Accuracy_Check *check, f32xN (*wide)(f32xN, f32xN), float (*scalar)(float, float), double (*reference)(double, double), double absolute_tolerance) {
+    for (int i = 0; i < FAST_MATH_CHECK_COUNT; i += SIMD_WIDTH) {
+        float results[SIMD_WIDTH];
+        f32xN_store(results, wide(f32xN_load(&fast_math_as[i]), f32xN_load(&fast_math_bs[i])));
+        for (int lane = 0; lane < SIMD_WIDTH; lane++) {
+            double expected = reference(fast_math_as[i + lane], fast_math_bs[i + lane]);
+            double wide_error = ulp_error(results[lane], expected, absolute_tolerance);
+            double scalar_error = ulp_error(scalar(fast_math_as[i + lane], fast_math_bs[i + lane]), expected, absolute_tolerance);
+            if (wide_error > check->max_error) check->max_error = wide_error;
+            if (scalar_error > check->max_error) check->max_error = scalar_error;
+        }
+    }
+}
+
+// every stride'th float bit pattern from first up to last
+static void fill_float_sweep(float *out, u32 first, u32 last) {
+    u32 stride = (last - first) / FAST_MATH_CHECK_COUNT;
+    for (int i = 0; i < FAST_MATH_CHECK_COUNT; i++) {
+        u32 bits = first + (u32)i * stride;
+        memcpy(&out[i], &bits, sizeof(bits));
+    }
+}
+
+static void fill_linear_sweep(float *out, float min, float max) {
+    for (int i = 0; i < FAST_MATH_CHECK_COUNT; i++) {
+        out[i] = min + (max - min) * (float)i / (FAST_MATH_CHECK_COUNT - 1);
+    }
+}
+
+static void check_rsqrt_fast(Accuracy_Check *check) {
+    fill_float_sweep(fast_math_as, 0x00800000, 0x7f7fffff); // the normal floats
+    check_fast_function(check, [](f32xN x, f32xN) { return rsqrt_fast(x); }, [](float x, float) { return rsqrt_fast(x); }, [](double x, double) { return 1 / sqrt(x); }, 0);
+}
+
+static void check_sin_fast(Accuracy_Check *check) {
+    fill_linear_sweep(fast_math_as, -8192, 8192);
+    check_fast_function(check, [](f32xN x, f32xN) { return sin_fast(x); }, [](float x, float) { return sin_fast(x); }, [](double x, double) { return sin(x); }, 1.2e-10);
+}
+
+static void check_cos_fast(Accuracy_Check *check) {
+    fill_linear_sweep(fast_math_as, -8192, 8192);
+    check_fast_function(check, [](f32xN x, f32xN) { return cos_fast(x); }, [](float x, float) { return cos_fast(x); }, [](double x, double) { return cos(x); }, 1.2e-10);
+}
+
+// y and x with random signs and exponents from 2^-40 to 2^40, then the signed zeros which have to
+// match libm exactly
+static void check_atan2_fast(Accuracy_Check *check) {
+    PCG32 rng = make_pcg32(30);
+    for (int i = 0; i < FAST_MATH_CHECK_COUNT; i++) {
+        fast_math_as[i] = ldexpf(random_range(&rng, -1, 1), (int)(next_u32(&rng) % 81) - 40);
+        fast_math_bs[i] = ldexpf(random_range(&rng, -1, 1), (int)(next_u32(&rng) % 81) - 40);
+    }
+    check_fast_function(check, [](f32xN y, f32xN x) { return atan2_fast(y, x); }, [](float y, float x) { return atan2_fast(y, x); }, [](double y, double x) { return atan2(y, x); }, 0);
+
+    float zeros[] = {0.0f, -0.0f};
+    for (int y = 0; y < 2; y++) {
+        for (int x = 0; x < 2; x++) {
+            float result = atan2_fast(zeros[y], zeros[x]);
+            float expected = atan2f(zeros[y], zeros[x]);
+            if (result != expected || signbit(result) != signbit(expected)) check->max_error = INFINITY;
+        }
+    }
+}
+
+static void check_exp_fast(Accuracy_Check *check) {
+    fill_linear_sweep(fast_math_as, -87.3f, 88);
+    check_fast_function(check, [](f32xN x, f32xN) { return exp_fast(x); }, [](float x, float) { return exp_fast(x); }, [](double x, double) { return exp(x); }, 0);
+}
+
+// plus 0, negatives, inf and nan, which have to come out like logf()
+static void check_log_fast(Accuracy_Check *check) {
+    fill_float_sweep(fast_math_as, 0x00800000, 0x7f7fffff);
+    check_fast_function(check, [](f32xN x, f32xN) { return log_fast(x); }, [](float x, float) { return log_fast(x); }, [](double x, double) { return log(x); }, 4.3e-9);
+
+    float specials[] = {0.0f, -0.0f, -1.0f, -INFINITY, INFINITY, NAN};
+    for (int i = 0; i < (int)ARRAYSIZE(specials); i++) {
+        float result = log_fast(specials[i]);
+        float expected = logf(specials[i]);
+        bool same = isnan(expected) ? isnan(result) : result == expected;
+        if (!same) check->max_error = INFINITY;
+    }
+}
+
+// angle between two directions in degrees, in double and with atan2() for the same reason as rotation_error()
+static double angle_degrees(Vector3 a, Vector3 b) {
+    double cross_x = (double)a.y * b.z - (double)a.z * b.y;
+    double cross_y = (double)a.z * b.x - (double)a.x * b.z;
+    double cross_z = (double)a.x * b.y - (double)a.y * b.x;
+    double cos_angle = (double)a.x * b.x + (double)a.y * b.y + (double)a.z * b.z;
+    return atan2(sqrt(cross_x * cross_x + cross_y * cross_y + cross_z * cross_z), cos_angle) * 180 / PI;
+}
+
+// batch_normals plus the 26 directions to the corners, edges and faces of a cube, which all sit on
+// the folds of the octahedron where oct_encode() changes sign
+#define PACKING_CHECK_COUNT (BATCH_COUNT + 26)
+static Vector3 packing_check_normals[PACKING_CHECK_COUNT];
+
+static void fill_packing_check_normals() {
+    memcpy(packing_check_normals, batch_normals, sizeof(batch_normals));
+    int count = BATCH_COUNT;
+    for (int x = -1; x <= 1; x++) {
+        for (int y = -1; y <= 1; y++) {
+            for (int z = -1; z <= 1; z++) {
+                if (x != 0 || y != 0 || z != 0) {
+                    packing_check_normals[count++] = normalize(v3((float)x, (float)y, (float)z));
+                }
+            }
+        }
+    }
+    ASSERT(count == PACKING_CHECK_COUNT);
+}
+
+// error in steps of the format, for a sweep past both ends of the range at a few bit depths
+static void check_unorm_snorm_round_trip(Accuracy_Check *check) {
+    int depths[] = {2, 4, 8, 10, 16};
+    for (int d = 0; d < (int)ARRAYSIZE(depths); d++) {
+        int bits = depths[d];
+        double unorm_max = (double)((1u << bits) - 1);
+        double snorm_max = (double)((1 << (bits - 1)) - 1);
+        for (int i = 0; i <= 10000; i++) {
+            float v = -1.25f + 2.5f * (float)i / 10000;
+            double unorm_error = fabs(unpack_unorm(pack_unorm(v, bits), bits) - (double)clamp(v, 0.0f, 1.0f)) * unorm_max;
+            double snorm_error = fabs(unpack_snorm(pack_snorm(v, bits), bits) - (double)clamp(v, -1.0f, 1.0f)) * snorm_max;
+            if (unorm_error > check->max_error) check->max_error = unorm_error;
+            if (snorm_error > check->max_error) check->max_error = snorm_error;
+        }
+    }
+}
+
+static void check_oct_round_trip(Accuracy_Check *check, int bits) {
+    fill_packing_check_normals();
+    for (int i = 0; i < PACKING_CHECK_COUNT; i++) {
+        Vector3 n = packing_check_normals[i];
+        Vector3 decoded = bits == 16 ? unpack_oct16(pack_oct16(n)) : bits == 24 ? unpack_oct24(pack_oct24(n)) : unpack_oct32(pack_oct32(n));
+        double error = angle_degrees(n, decoded);
+        if (error > check->max_error) check->max_error = error;
+    }
+}
+
+static void check_oct16_round_trip(Accuracy_Check *check) { check_oct_round_trip(check, 16); }
+static void check_oct24_round_trip(Accuracy_Check *check) { check_oct_round_trip(check, 24); }
+static void check_oct32_round_trip(Accuracy_Check *check) { check_oct_round_trip(check, 32); }
+
+// a wrong bitangent sign counts as 180 degrees
+static void check_tangent_oct_round_trip(Accuracy_Check *check) {
+    fill_packing_check_normals();
+    for (int i = 0; i < PACKING_CHECK_COUNT; i++) {
+        float sign = i % 2 ? -1.0f : 1.0f;
+        Vector3 tangent;
+        float decoded_sign;
+        unpack_tangent_oct(pack_tangent_oct(packing_check_normals[i], sign), &tangent, &decoded_sign);
+        double error = decoded_sign == sign ? angle_degrees(packing_check_normals[i], tangent) : 180;
+        if (error > check->max_error) check->max_error = error;
+    }
+}
+
+// orthonormal frames from pairs of normals, the error is the worst of the three axes
+static void check_tangent_frame_round_trip(Accuracy_Check *check) {
+    fill_packing_check_normals();
+    for (int i = 0; i < PACKING_CHECK_COUNT; i++) {
+        Vector3 normal = packing_check_normals[i];
+        Vector3 other = packing_check_normals[(i * 7 + 1) % PACKING_CHECK_COUNT];
+        Vector3 tangent = cross(normal, other);
+        if (length(tangent) < 0.01f) {
+            continue;
+        }
+        tangent = normalize(tangent);
+        float sign = i % 2 ? -1.0f : 1.0f;
+        Vector3 decoded_normal, decoded_tangent, decoded_bitangent;
+        unpack_tangent_frame(pack_tangent_frame(normal, tangent, sign), &decoded_normal, &decoded_tangent, &decoded_bitangent);
+        double errors[3] = {
+            angle_degrees(normal, decoded_normal),
+            angle_degrees(tangent, decoded_tangent),
+            angle_degrees(cross(normal, tangent) * sign, decoded_bitangent),
+        };
+        for (int axis = 0; axis < 3; axis++) {
+            if (errors[axis] > check->max_error) check->max_error = errors[axis];
+        }
+    }
+}
+
+// error in steps of each channel, with inputs past both ends of [0, 1] to go through the clamp
+static void check_color_round_trip(Accuracy_Check *check) {
+    PCG32 rng = make_pcg32(29);
+    for (int i = 0; i < BATCH_COUNT; i++) {
+        Vector4 color = v4(random_range(&rng, -0.25f, 1.25f), random_range(&rng, -0.25f, 1.25f), random_range(&rng, -0.25f, 1.25f), random_range(&rng, -0.25f, 1.25f));
+        Vector4 rgba8 = unpack_rgba8(pack_rgba8(color));
+        Vector4 rgb10a2 = unpack_unorm_10_10_10_2(pack_unorm_10_10_10_2(color));
+        for (int c = 0; c < 4; c++) {
+            double expected = clamp(color[c], 0.0f, 1.0f);
+            double rgba8_error = fabs(rgba8[c] - expected) * 255;
+            double rgb10a2_error = fabs(rgb10a2[c] - expected) * (c < 3 ? 1023 : 3);
+            if (rgba8_error > check->max_error) check->max_error = rgba8_error;
+            if (rgb10a2_error > check->max_error) check->max_error = rgb10a2_error;
+        }
+    }
+}
+
+// relative error, over batch_uvs which are all well inside the range of normal halves
+static void check_half2_round_trip(Accuracy_Check *check) {
+    for (int i = 0; i < BATCH_COUNT; i++) {
+        Vector2 uv = batch_uvs[i];
+        Vector2 decoded = unpack_half2(pack_half2(uv));
+        for (int c = 0; c < 2; c++) {
+            float v = c ? uv.y : uv.x;
+            float back = c ? decoded.y : decoded.x;
+            if (fabsf(v) < 1.0f / 16384) {
+                continue;
+            }
+            double error = fabs((double)back - v) / fabs((double)v);
+            if (error > check->max_error) check->max_error = error;
+        }
+    }
+}
+
+// every _batch encoder against its scalar version, count is deliberately not a multiple of 4 so the
+// tails get checked too
+static void check_packing_batches(Accuracy_Check *check) {
+    fill_packing_check_normals();
+    const int count = PACKING_CHECK_COUNT;
+    static float signs[PACKING_CHECK_COUNT];
+    static Vector4 colors[PACKING_CHECK_COUNT];
+    static Vector2 uvs[PACKING_CHECK_COUNT];
+    static u32 packed[PACKING_CHECK_COUNT];
+    static u16 packed16[PACKING_CHECK_COUNT];
+    PCG32 rng = make_pcg32(29, 1);
+    for (int i = 0; i < count; i++) {
+        signs[i] = i % 3 ? 1.0f : -1.0f;
+        colors[i] = v4(random_range(&rng, -0.25f, 1.25f), random_range(&rng, -0.25f, 1.25f), random_range(&rng, -0.25f, 1.25f), random_range(&rng, -0.25f, 1.25f));
+        uvs[i] = i < BATCH_COUNT ? batch_uvs[i] : v2(random_range(&rng, -70000, 70000), random_range(&rng, -1e-6f, 1e-6f));
+    }
+    // overflow to infinity, the largest half, denormals and both zeros
+    uvs[count - 1] = v2(65504, 1e30f);
+    uvs[count - 2] = v2(-0.0f, 0.0f);
+    uvs[count - 3] = v2(3e-8f, -6e-5f);
+
+    pack_oct16_batch(packed16, packing_check_normals, count);
+    for (int i = 0; i < count; i++) if (packed16[i] != pack_oct16(packing_check_normals[i])) check->max_error += 1;
+    pack_oct32_batch(packed, packing_check_normals, count);
+    for (int i = 0; i < count; i++) if (packed[i] != pack_oct32(packing_check_normals[i])) check->max_error += 1;
+    pack_tangent_oct_batch(packed, packing_check_normals, signs, count);
+    for (int i = 0; i < count; i++) if (packed[i] != pack_tangent_oct(packing_check_normals[i], signs[i])) check->max_error += 1;
+    pack_rgba8_batch(packed, colors, count);
+    for (int i = 0; i < count; i++) if (packed[i] != pack_rgba8(colors[i])) check->max_error += 1;
+    pack_half2_batch(packed, uvs, count);
+    for (int i = 0; i < count; i++) if (packed[i] != pack_half2(uvs[i])) check->max_error += 1;
+}
+
+// meshes where the frames MikkTSpace gives are known exactly, so we don't need the library itself:
+//
+//   - an open cylinder with u around it and v along it. every corner's frame is the circumferential
+//     direction, even at the seam where the vertices only see triangles on one side, since a chord
+//     projected onto the plane of a radial normal is still circumferential.
+//   - a flat strip with u = |x|, mirrored down the middle. x > 0 is +x with a sign of 1, x < 0 is -x
+//     with a sign of -1, and the vertices on the mirror line get one of each.
+//   - two triangles that only share a vertex and whose u goes in different directions. MikkTSpace
+//     only averages triangles connected through an edge, so each keeps its own tangent there.
+//
+// the error is the largest angle between a frame and the expected one in radians, a wrong sign counts as pi.
+static void check_tangent_frames(Accuracy_Check *check) {
+    Array<Interleaved_Vertex> vertices[3];
+    Array<u32> indices[3];
+    Array<Vector4> expected = make_array<Vector4>(default_allocator());
+    defer(expected.destroy());
+    for (int i = 0; i < 3; i++) {
+        vertices[i] = make_array<Interleaved_Vertex>(default_allocator());
+        indices[i] = make_array<u32>(default_allocator());
+    }
+    defer(for (int i = 0; i < 3; i++) { vertices[i].destroy(); indices[i].destroy(); });
+
+    auto add_vertex = [](Array<Interleaved_Vertex> *mesh_vertices, Vector3 position, Vector3 normal, float u, float v) {
+        Interleaved_Vertex vertex = {};
+        vertex.position = position;
+        vertex.normal = normal;
+        vertex.tex_coord = v3(u, v, 0);
+        mesh_vertices->append(vertex);
+    };
+    // two triangles per cell of a grid of (columns+1)*(rows+1) vertices, wound so the UV area is positive where u and v increase with the grid
+    auto add_grid_triangles = [](Array<u32> *mesh_indices, int columns, int rows) {
+        for (int row = 0; row < rows; row++) {
+            for (int column = 0; column < columns; column++) {
+                u32 corner = (u32)(row * (columns + 1) + column);
+                u32 quad[6] = {corner, corner + 1, corner + columns + 1, corner + 1, corner + columns + 2, corner + columns + 1};
+                for (int k = 0; k < 6; k++) mesh_indices->append(quad[k]);
+            }
+        }
+    };
+
+    const int segments = 16;
+    const int rings = 4;
+    for (int ring = 0; ring <= rings; ring++) {
+        for (int segment = 0; segment <= segments; segment++) {
+            float u = (float)segment / segments;
+            float theta = 2 * (float)PI * u;
+            Vector3 normal = v3(cosf(theta), 0, -sinf(theta));
+            add_vertex(&vertices[0], v3(normal.x, (float)ring / rings * 2, normal.z), normal, u, (float)ring / rings);
+        }
+    }
+    add_grid_triangles(&indices[0], segments, rings);
+    For (i, indices[0]) {
+        float theta = 2 * (float)PI * vertices[0][indices[0][i]].tex_coord.x;
+        expected.append(v4(-sinf(theta), 0, -cosf(theta), 1));
+    }
+
+    const int columns = 8;
+    for (int row = 0; row <= 2; row++) {
+        for (int column = 0; column <= columns; column++) {
+            float x = (float)(column - columns / 2) / 2;
+            add_vertex(&vertices[1], v3(x, 0, (float)row), v3(0, 1, 0), fabsf(x), (float)row);
+        }
+    }
+    add_grid_triangles(&indices[1], columns, 2);
+    for (int i = 0; i < indices[1].count; i += 3) {
+        // the side of the mirror a triangle is on, from its centroid
+        float x = 0;
+        for (int k = 0; k < 3; k++) x += vertices[1][indices[1][i + k]].position.x;
+        for (int k = 0; k < 3; k++) expected.append(x > 0 ? v4(1, 0, 0, 1) : v4(-1, 0, 0, -1));
+    }
+
+    add_vertex(&vertices[2], v3(0, 0, 0),  v3(0, 1, 0), 0, 0);
+    add_vertex(&vertices[2], v3(1, 0, 0),  v3(0, 1, 0), 1, 0);
+    add_vertex(&vertices[2], v3(0, 0, 1),  v3(0, 1, 0), 0, 1);
+    add_vertex(&vertices[2], v3(0, 0, -1), v3(0, 1, 0), 1, 0);
+    add_vertex(&vertices[2], v3(-1, 0, 0), v3(0, 1, 0), 0, 1);
+    u32 bowtie[6] = {0, 1, 2, 0, 3, 4};
+    for (int k = 0; k < 6; k++) indices[2].append(bowtie[k]);
+    for (int k = 0; k < 3; k++) expected.append(v4(1, 0, 0, 1));
+    for (int k = 0; k < 3; k++) expected.append(v4(0, 0, -1, 1));
+
+    Vector4 *frames = (Vector4 *)alloc(default_allocator(), sizeof(Vector4) * expected.count);
+    defer(free(default_allocator(), frames));
+    Tangent_Mesh meshes[3];
+    Vector4 *out = frames;
+    for (int i = 0; i < 3; i++) {
+        meshes[i] = make_tangent_mesh(&vertices[i], &indices[i], out);
+        out += indices[i].count;
+    }
+    generate_tangents(meshes, 3);
+
+    For (i, expected) {
+        Vector4 frame = frames[i];
+        Vector4 reference = expected[i];
+        double error = PI;
+        if (frame.w == reference.w) {
+            double cross_x = (double)frame.y * reference.z - (double)frame.z * reference.y;
+            double cross_y = (double)frame.z * reference.x - (double)frame.x * reference.z;
+            double cross_z = (double)frame.x * reference.y - (double)frame.y * reference.x;
+            double cos_angle = (double)frame.x * reference.x + (double)frame.y * reference.y + (double)frame.z * reference.z;
+            error = atan2(sqrt(cross_x * cross_x + cross_y * cross_y + cross_z * cross_z), cos_angle);
+        }
+        if (error > check->max_error) check->max_error = error;
+    }
+}
+
+static Accuracy_Check ACCURACY_CHECKS[] = {
+    {"quaternion_stream/nlerp vs nlerp()",           check_stream_nlerp,             1e-5},
+    {"quaternion_stream/slerp_approx vs slerp()",    check_stream_slerp_approx,      0.001}, // documented as ~0.0008, see quaternion_stream.h
+    {"fastmath/rsqrt_fast vs libm (ulp)",            check_rsqrt_fast,               4},
+    {"fastmath/sin_fast vs libm (ulp)",              check_sin_fast,                 2},
+    {"fastmath/cos_fast vs libm (ulp)",              check_cos_fast,                 2},
+    {"fastmath/atan2_fast vs libm (ulp)",            check_atan2_fast,               3.1},
+    {"fastmath/exp_fast vs libm (ulp)",              check_exp_fast,                 1.3},
+    {"fastmath/log_fast vs libm (ulp)",              check_log_fast,                 0.9},
+    {"packing/unorm, snorm round trip (steps)",      check_unorm_snorm_round_trip,   0.5 + 1e-4}, // half a step, plus float rounding in the unpack
+    {"packing/oct16 round trip (degrees)",           check_oct16_round_trip,         0.95},
+    {"packing/oct24 round trip (degrees)",           check_oct24_round_trip,         0.06},
+    {"packing/oct32 round trip (degrees)",           check_oct32_round_trip,         0.004},
+    {"packing/tangent_oct round trip (degrees)",     check_tangent_oct_round_trip,   0.24},
+    {"packing/tangent_frame round trip (degrees)",   check_tangent_frame_round_trip, 0.004},
+    {"packing/rgba8, 10_10_10_2 round trip (steps)", check_color_round_trip,         0.5 + 1e-4},
+    {"packing/half2 round trip (relative)",          check_half2_round_trip,         1.0 / 2048},
+    {"packing/*_batch vs scalar",                    check_packing_batches,          0},
+    {"intersection/ray_triangle_packet vs scalar",   check_ray_triangle_packets,     1e-5},
+    {"intersection/ray_packet_aabb vs scalar",       check_ray_aabb_packets,         0},
+    {"intersection/ray_packet_aabb on box faces",    check_ray_aabb_on_faces,        0},
+    {"tangent_space vs MikkTSpace on test meshes",   check_tangent_frames,           1e-5},
+};
+
+static bool run_accuracy_checks() {
+    bool all_passed = true;
+    printf("%-44s %14s %14s\n", "check", "max error", "tolerance");
+    for (int i = 0; i < (int)ARRAYSIZE(ACCURACY_CHECKS); i++) {
+        Accuracy_Check *check = &ACCURACY_CHECKS[i];
+        check->proc(check);
+        bool passed = check->max_error <= check->tolerance;
+        all_passed = all_passed && passed;
+        printf("%-44s %14.3g %14.3g%s\n", check->name, check->max_error, check->tolerance, passed ? "" : "  FAILED");
+    }
+    return all_passed;
+}
+
+int main(int argc, char **argv) {
+    char *json_path = nullptr;
+    double min_seconds = 0.020;
+    int repetitions = 7;
+    bool list = false;
+    bool texture_report = false;
+    bool check = false;
+    Compression_Quality texture_quality = COMPRESSION_QUALITY_NORMAL;
+    char *filters[64];
+    int num_filters = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            json_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) {
+            min_seconds = atof(argv[++i]) / 1000.0;
+        }
+        else if (strcmp(argv[i], "--repetitions") == 0 && i + 1 < argc) {
+            repetitions = atoi(argv[++i]);
+            if (repetitions < 1) repetitions = 1;
+        }
+        else if (strcmp(argv[i], "--list") == 0) {
+            list = true;
+        }
+        else if (strcmp(argv[i], "--check") == 0) {
+            check = true;
+        }
+        else if (strcmp(argv[i], "--texture-report") == 0) {
+            texture_report = true;
+        }
+        else if (strcmp(argv[i], "--texture-quality") == 0 && i + 1 < argc) {
+            i += 1;
+            if      (strcmp(argv[i], "fast") == 0)   texture_quality = COMPRESSION_QUALITY_FAST;
+            else if (strcmp(argv[i], "normal") == 0) texture_quality = COMPRESSION_QUALITY_NORMAL;
+            else if (strcmp(argv[i], "best") == 0)   texture_quality = COMPRESSION_QUALITY_BEST;
+            else {
+                printf("Unknown texture quality %s\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (argv[i][0] == '-') {
+            printf("Unknown option %s\n", argv[i]);
+            return 1;
+        }
+        else if (num_filters < (int)ARRAYSIZE(filters)) {
+            filters[num_filters++] = argv[i];
+        }
+    }
+
+    if (list) {
+        for (int i = 0; i < (int)ARRAYSIZE(BENCHMARKS); i++) {
+            printf("%s\n", BENCHMARKS[i].name);
+        }
+        return 0;
+    }
+
+    if (texture_report) {
+        print_texture_report(filters, num_filters, texture_quality);
+        return 0;
+    }
+
+    setup_benchmark_data();
+
+    if (check) {
+        bool passed = run_accuracy_checks();
+        remove(cooked_terrain_filename);
+        return passed ? 0 : 1;
+    }
+
+    Benchmark_Result results[ARRAYSIZE(BENCHMARKS)];
+    int num_results = 0;
+    printf("%-44s %14s %16s %12s\n", "benchmark", "ns/op", "ops/s", "GB/s");
+    for (int i = 0; i < (int)ARRAYSIZE(BENCHMARKS); i++) {
+        Benchmark *benchmark = &BENCHMARKS[i];
+        if (!matches_filters(benchmark->name, filters, num_filters)) {
+            continue;
+        }
+        Benchmark_Result result = run_benchmark(benchmark, min_seconds, repetitions);
+        results[num_results++] = result;
+        printf("%-44s %14.3f %16.0f", result.name, result.ns_per_op_median, result.ops_per_second);
+        if (result.bytes_per_second > 0) {
+            printf(" %12.2f", result.bytes_per_second / 1e9);
+        }
+        printf("\n");
+        fflush(stdout);
+    }
+    remove(cooked_terrain_filename);
+
+    if (json_path) {
+        FILE *file = fopen(json_path, "wb");
+        if (!file) {
+            printf("Couldn't open %s for writing\n", json_path);
+            return 1;
+        }
+        write_json(file, results, num_results, min_seconds);
+        fclose(file);
+    }
+    return 0;
+}
@@ -1,2 +1,2 @@
-cl /MP /Zi /Od /Fd /Iexternal main.cpp math.cpp basic.cpp renderer.cpp external/dearimgui/imgui.cpp external/dearimgui/imgui_demo.cpp external/dearimgui/imgui_draw.cpp external/dearimgui/imgui_widgets.cpp assimp-vc141-mtd.lib user32.lib d3d11.lib d3dcompiler.lib -DCFF_PLATFORM_WINDOWS=1 -DCFF_GRAPHICS_DIRECTX11=1 /EHsc /link /DEBUG
+cl /MP /Zi /Od /Fd /arch:AVX2 /Iexternal main.cpp math.cpp basic.cpp renderer.cpp half.cpp intersection.cpp bvh.cpp threading.cpp spherical_harmonics.cpp packing.cpp quaternion_stream.cpp random.cpp model_format.cpp mesh_optimizer.cpp tangent_space.cpp json.cpp gltf.cpp texture_compression.cpp cooked_texture.cpp mipmap.cpp external/dearimgui/imgui.cpp external/dearimgui/imgui_demo.cpp external/dearimgui/imgui_draw.cpp external/dearimgui/imgui_widgets.cpp user32.lib d3d11.lib d3dcompiler.lib psapi.lib -DCFF_PLATFORM_WINDOWS=1 -DCFF_GRAPHICS_DIRECTX11=1 /EHsc /link /DEBUG
 @rm *.obj
\ No newline at end of file
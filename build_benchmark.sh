@@ -0,0 +1,4 @@
+#!/bin/sh
+# Builds the microbenchmarks in benchmark.cpp. Uses g++ unless CXX is set, e.g. CXX=clang++ ./build_benchmark.sh
+# Pass extra flags through CXXFLAGS, e.g. CXXFLAGS=-mno-avx to measure the SSE paths.
+${CXX:-g++} -O2 -std=c++17 -mavx2 -mfma -mf16c $CXXFLAGS -o benchmark benchmark.cpp math.cpp basic.cpp half.cpp packing.cpp quaternion_stream.cpp intersection.cpp bvh.cpp threading.cpp spherical_harmonics.cpp random.cpp model_format.cpp mesh_optimizer.cpp tangent_space.cpp json.cpp gltf.cpp texture_compression.cpp cooked_texture.cpp mipmap.cpp -pthread
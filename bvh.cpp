@@ -0,0 +1,749 @@
+#include "bvh.h"
+#include "threading.h"
+#include "simd.h"
+
+#include <atomic>
+#include <algorithm>
+#include <float.h>
+
+// note(josh): SAH costs are relative to the cost of one primitive test, which for triangle BVHs is
+// one 4 wide packet test no matter how many of the lanes are used.
+#define BVH_TRAVERSAL_COST 1.0f
+#define BVH_NUM_BINS 16
+// subtrees with at least this many primitives get built on their own thread
+#define BVH_PARALLEL_THRESHOLD 4096
+// the queries use a fixed size stack. past BVH_SAH_MAX_DEPTH the build switches to median splits,
+// which halve the primitive count every level, so the tree can never get deeper than the stack.
+#define BVH_STACK_SIZE 64
+#define BVH_SAH_MAX_DEPTH 32
+
+// primitive bounds padded out to 4 floats so the build can min/max them with SSE
+struct BVH_Build_Primitive {
+    float min[4];
+    float max[4];
+    float centroid[4];
+};
+
+struct BVH_Build {
+    BVH_Build_Primitive *primitives;
+    int *indices;
+    BVH_Node *nodes;
+    std::atomic<int> node_count;
+    std::atomic<int> num_threads;
+    int max_threads;
+    int max_leaf_size;
+    int primitives_per_test;
+};
+
+struct BVH_Build_Task {
+    BVH_Build *build;
+    int node;
+    int first;
+    int count;
+    int depth;
+};
+
+// distance is t_enter for ray queries and the squared distance for nearest point queries, so
+// entries that got too far away while they sat on the stack can be skipped without touching the node
+struct BVH_Stack_Entry {
+    int node;
+    float distance;
+};
+
+struct BVH_Bin {
+    f32x4 min;
+    f32x4 max;
+    int count;
+};
+
+static inline float half_area(f32x4 min, f32x4 max) {
+    float d[4];
+    f32x4_store(d, f32x4_sub(max, min));
+    return d[0] * d[1] + d[1] * d[2] + d[2] * d[0];
+}
+
+static inline int bin_index(float centroid, float axis_min, float bin_scale) {
+    int b = (int)((centroid - axis_min) * bin_scale);
+    return b < BVH_NUM_BINS-1 ? b : BVH_NUM_BINS-1;
+}
+
+static void make_leaf(BVH_Node *node, int first, int count) {
+    node->left_first = first;
+    node->count = count;
+}
+
+static void build_bvh_node(BVH_Build *build, int node_index, int first, int count, int depth);
+
+static void build_bvh_node_thread(void *userdata) {
+    BVH_Build_Task *task = (BVH_Build_Task *)userdata;
+    build_bvh_node(task->build, task->node, task->first, task->count, task->depth);
+}
+
+static void build_bvh_node(BVH_Build *build, int node_index, int first, int count, int depth) {
+    BVH_Node *node = &build->nodes[node_index];
+    BVH_Build_Primitive *primitives = build->primitives;
+    int *indices = build->indices + first;
+
+    f32x4 bounds_min = f32x4_set1(FLT_MAX);
+    f32x4 bounds_max = f32x4_set1(-FLT_MAX);
+    f32x4 centroid_min = f32x4_set1(FLT_MAX);
+    f32x4 centroid_max = f32x4_set1(-FLT_MAX);
+    for (int i = 0; i < count; i++) {
+        BVH_Build_Primitive *primitive = &primitives[indices[i]];
+        f32x4 centroid = f32x4_load(primitive->centroid);
+        bounds_min = f32x4_min(bounds_min, f32x4_load(primitive->min));
+        bounds_max = f32x4_max(bounds_max, f32x4_load(primitive->max));
+        centroid_min = f32x4_min(centroid_min, centroid);
+        centroid_max = f32x4_max(centroid_max, centroid);
+    }
+    float node_min[4], node_max[4];
+    f32x4_store(node_min, bounds_min);
+    f32x4_store(node_max, bounds_max);
+    node->min = v3(node_min[0], node_min[1], node_min[2]);
+    node->max = v3(node_max[0], node_max[1], node_max[2]);
+
+    if (count <= 1) {
+        make_leaf(node, first, count);
+        return;
+    }
+
+    float axis_min[4], extent[4];
+    f32x4_store(axis_min, centroid_min);
+    f32x4_store(extent, f32x4_sub(centroid_max, centroid_min));
+    float bin_scale[3];
+    for (int axis = 0; axis < 3; axis++) {
+        bin_scale[axis] = extent[axis] > 0 ? BVH_NUM_BINS / extent[axis] : 0;
+    }
+
+    // find the cheapest binned SAH split. all three axes are binned in the same pass over the primitives.
+    int k = build->primitives_per_test;
+    int best_axis = -1;
+    int best_bin = 0;
+    float best_cost = FLT_MAX;
+    if (depth < BVH_SAH_MAX_DEPTH) {
+        BVH_Bin bins[3][BVH_NUM_BINS];
+        for (int axis = 0; axis < 3; axis++) {
+            for (int b = 0; b < BVH_NUM_BINS; b++) {
+                bins[axis][b].min = f32x4_set1(FLT_MAX);
+                bins[axis][b].max = f32x4_set1(-FLT_MAX);
+                bins[axis][b].count = 0;
+            }
+        }
+        for (int i = 0; i < count; i++) {
+            BVH_Build_Primitive *primitive = &primitives[indices[i]];
+            f32x4 min = f32x4_load(primitive->min);
+            f32x4 max = f32x4_load(primitive->max);
+            for (int axis = 0; axis < 3; axis++) {
+                BVH_Bin *bin = &bins[axis][bin_index(primitive->centroid[axis], axis_min[axis], bin_scale[axis])];
+                bin->min = f32x4_min(bin->min, min);
+                bin->max = f32x4_max(bin->max, max);
+                bin->count += 1;
+            }
+        }
+
+        for (int axis = 0; axis < 3; axis++) {
+            if (extent[axis] <= 0) {
+                continue;
+            }
+            // sweep from the right to get the cost of everything right of each split, then from the left
+            float right_cost[BVH_NUM_BINS];
+            f32x4 right_min = f32x4_set1(FLT_MAX);
+            f32x4 right_max = f32x4_set1(-FLT_MAX);
+            int right_count = 0;
+            for (int b = BVH_NUM_BINS-1; b > 0; b--) {
+                right_min = f32x4_min(right_min, bins[axis][b].min);
+                right_max = f32x4_max(right_max, bins[axis][b].max);
+                right_count += bins[axis][b].count;
+                right_cost[b] = right_count > 0 ? half_area(right_min, right_max) * ((right_count + k - 1) / k) : FLT_MAX;
+            }
+            f32x4 left_min = f32x4_set1(FLT_MAX);
+            f32x4 left_max = f32x4_set1(-FLT_MAX);
+            int left_count = 0;
+            for (int b = 1; b < BVH_NUM_BINS; b++) {
+                left_min = f32x4_min(left_min, bins[axis][b-1].min);
+                left_max = f32x4_max(left_max, bins[axis][b-1].max);
+                left_count += bins[axis][b-1].count;
+                if (left_count == 0 || left_count == count) {
+                    continue;
+                }
+                float cost = half_area(left_min, left_max) * ((left_count + k - 1) / k) + right_cost[b];
+                if (cost < best_cost) {
+                    best_cost = cost;
+                    best_axis = axis;
+                    best_bin = b;
+                }
+            }
+        }
+    }
+
+    int left_count = 0;
+    if (best_axis != -1) {
+        float area = half_area(bounds_min, bounds_max);
+        float split_cost = BVH_TRAVERSAL_COST + (area > 0 ? best_cost / area : 0);
+        float leaf_cost = (float)((count + k - 1) / k);
+        if (count <= build->max_leaf_size && leaf_cost <= split_cost) {
+            make_leaf(node, first, count);
+            return;
+        }
+
+        int *start = indices;
+        int *end = indices + count - 1;
+        while (start <= end) {
+            if (bin_index(primitives[*start].centroid[best_axis], axis_min[best_axis], bin_scale[best_axis]) < best_bin) {
+                start += 1;
+            }
+            else {
+                int temp = *start;
+                *start = *end;
+                *end = temp;
+                end -= 1;
+            }
+        }
+        left_count = (int)(start - indices);
+    }
+    else {
+        // either all the centroids are in the same spot or the tree is getting too deep. split at the
+        // median so we are guaranteed to make progress.
+        if (count <= build->max_leaf_size) {
+            make_leaf(node, first, count);
+            return;
+        }
+        int axis = 0;
+        if (extent[1] > extent[axis]) axis = 1;
+        if (extent[2] > extent[axis]) axis = 2;
+        left_count = count / 2;
+        std::nth_element(indices, indices + left_count, indices + count, [primitives, axis](int a, int b) {
+            return primitives[a].centroid[axis] < primitives[b].centroid[axis];
+        });
+    }
+    assert(left_count > 0 && left_count < count);
+
+    int left = build->node_count.fetch_add(2);
+    node->left_first = left;
+    node->count = 0;
+
+    // note(josh): hand the left subtree to another thread if it's big enough to be worth it and we
+    // aren't already using every core, do the right one ourselves.
+    bool spawned = false;
+    Thread thread = {};
+    BVH_Build_Task task = {build, left, first, left_count, depth+1};
+    if (left_count >= BVH_PARALLEL_THRESHOLD && (count - left_count) >= BVH_PARALLEL_THRESHOLD) {
+        if (build->num_threads.fetch_add(1) < build->max_threads) {
+            thread = create_thread(build_bvh_node_thread, &task);
+            spawned = true;
+        }
+        else {
+            build->num_threads.fetch_sub(1);
+        }
+    }
+    if (!spawned) {
+        build_bvh_node(build, left, first, left_count, depth+1);
+    }
+    build_bvh_node(build, left+1, first + left_count, count - left_count, depth+1);
+    if (spawned) {
+        join_thread(thread);
+        build->num_threads.fetch_sub(1);
+    }
+}
+
+struct BVH_Primitive_Job {
+    AABB *bounds;
+    BVH_Build_Primitive *primitives;
+};
+
+static void setup_build_primitives(void *userdata, int start, int end) {
+    BVH_Primitive_Job *job = (BVH_Primitive_Job *)userdata;
+    for (int i = start; i < end; i++) {
+        AABB box = job->bounds[i];
+        Vector3 centroid = aabb_center(box);
+        BVH_Build_Primitive *primitive = &job->primitives[i];
+        primitive->min[0] = box.min.x;  primitive->min[1] = box.min.y;  primitive->min[2] = box.min.z;  primitive->min[3] = 0;
+        primitive->max[0] = box.max.x;  primitive->max[1] = box.max.y;  primitive->max[2] = box.max.z;  primitive->max[3] = 0;
+        primitive->centroid[0] = centroid.x;  primitive->centroid[1] = centroid.y;  primitive->centroid[2] = centroid.z;  primitive->centroid[3] = 0;
+    }
+}
+
+static BVH build_bvh_internal(AABB *primitive_bounds, int num_primitives, int max_leaf_size, int primitives_per_test, Allocator allocator) {
+    assert(max_leaf_size >= 1);
+    BVH bvh = {};
+    bvh.primitive_indices = make_array<int>(allocator, num_primitives > 0 ? num_primitives : 1);
+    bvh.primitive_indices.count = num_primitives;
+    for (int i = 0; i < num_primitives; i++) {
+        bvh.primitive_indices[i] = i;
+    }
+
+    // a binary tree with n leaves has 2n-1 nodes. the +1 is so an empty tree still gets a root.
+    int max_nodes = 2 * num_primitives + 1;
+    bvh.nodes = make_array<BVH_Node>(allocator, max_nodes);
+
+    BVH_Build_Primitive *primitives = (BVH_Build_Primitive *)alloc(default_allocator(), sizeof(BVH_Build_Primitive) * (num_primitives > 0 ? num_primitives : 1));
+    BVH_Primitive_Job primitive_job = {primitive_bounds, primitives};
+    parallel_for(num_primitives, 16 * 1024, setup_build_primitives, &primitive_job);
+
+    BVH_Build build;
+    build.primitives = primitives;
+    build.indices = bvh.primitive_indices.data;
+    build.nodes = bvh.nodes.data;
+    build.node_count = 1;
+    build.num_threads = 1;
+    build.max_threads = num_hardware_threads();
+    build.max_leaf_size = max_leaf_size;
+    build.primitives_per_test = primitives_per_test;
+    build_bvh_node(&build, 0, 0, num_primitives, 0);
+    bvh.nodes.count = build.node_count;
+
+    free(default_allocator(), primitives);
+    return bvh;
+}
+
+BVH build_bvh(AABB *primitive_bounds, int num_primitives, int max_leaf_size, Allocator allocator) {
+    return build_bvh_internal(primitive_bounds, num_primitives, max_leaf_size, 1, allocator);
+}
+
+void destroy_bvh(BVH *bvh) {
+    bvh->nodes.destroy();
+    bvh->primitive_indices.destroy();
+}
+
+AABB bvh_bounds(BVH *bvh) {
+    if (bvh->nodes.count == 0 || bvh->nodes[0].min.x > bvh->nodes[0].max.x) {
+        return aabb_empty();
+    }
+    AABB box = {bvh->nodes[0].min, bvh->nodes[0].max};
+    return box;
+}
+
+static inline AABB node_aabb(BVH_Node *node) {
+    AABB box = {node->min, node->max};
+    return box;
+}
+
+static inline Vector3 transform_point(Matrix4 m, Vector3 p) {
+    return v3(m * v4(p.x, p.y, p.z, 1));
+}
+
+static inline Vector3 transform_direction(Matrix4 m, Vector3 d) {
+    return v3(m * v4(d.x, d.y, d.z, 0));
+}
+
+
+
+struct Triangle_Bounds_Job {
+    Vector3 *positions;
+    u32 *indices;
+    AABB *bounds;
+};
+
+static inline void get_triangle(Vector3 *positions, u32 *indices, int triangle, Vector3 *a, Vector3 *b, Vector3 *c) {
+    if (indices) {
+        *a = positions[indices[triangle*3+0]];
+        *b = positions[indices[triangle*3+1]];
+        *c = positions[indices[triangle*3+2]];
+    }
+    else {
+        *a = positions[triangle*3+0];
+        *b = positions[triangle*3+1];
+        *c = positions[triangle*3+2];
+    }
+}
+
+static void compute_triangle_bounds(void *userdata, int start, int end) {
+    Triangle_Bounds_Job *job = (Triangle_Bounds_Job *)userdata;
+    for (int i = start; i < end; i++) {
+        Vector3 a, b, c;
+        get_triangle(job->positions, job->indices, i, &a, &b, &c);
+        job->bounds[i] = aabb_grow(aabb_grow(aabb_grow(aabb_empty(), a), b), c);
+    }
+}
+
+Triangle_BVH build_triangle_bvh(Vector3 *positions, u32 *indices, int num_triangles, Allocator allocator) {
+    AABB *bounds = (AABB *)alloc(default_allocator(), sizeof(AABB) * (num_triangles > 0 ? num_triangles : 1));
+    Triangle_Bounds_Job bounds_job = {positions, indices, bounds};
+    parallel_for(num_triangles, 16 * 1024, compute_triangle_bounds, &bounds_job);
+
+    Triangle_BVH result = {};
+    result.bvh = build_bvh_internal(bounds, num_triangles, 4, 4, allocator);
+    free(default_allocator(), bounds);
+
+    // bake each leaf into a packet so the queries never have to go back to the index buffer
+    int num_leaves = 0;
+    For (i, result.bvh.nodes) {
+        if (result.bvh.nodes[i].count > 0) num_leaves += 1;
+    }
+    result.packets = make_array<Triangle_Packet4>(allocator, num_leaves > 0 ? num_leaves : 1);
+    result.packet_triangles = make_array<int>(allocator, num_leaves > 0 ? num_leaves * 4 : 1);
+    For (i, result.bvh.nodes) {
+        BVH_Node *node = &result.bvh.nodes[i];
+        if (node->count == 0) {
+            continue;
+        }
+        Triangle_Packet4 packet = {};
+        for (int lane = 0; lane < 4; lane++) {
+            int triangle = -1;
+            if (lane < node->count) {
+                triangle = result.bvh.primitive_indices[node->left_first + lane];
+                Vector3 a, b, c;
+                get_triangle(positions, indices, triangle, &a, &b, &c);
+                set_triangle(&packet, lane, a, b, c);
+            }
+            result.packet_triangles.append(triangle);
+        }
+        node->left_first = result.packets.count;
+        result.packets.append(packet);
+    }
+    return result;
+}
+
+void destroy_triangle_bvh(Triangle_BVH *bvh) {
+    destroy_bvh(&bvh->bvh);
+    bvh->packets.destroy();
+    bvh->packet_triangles.destroy();
+}
+
+static inline void get_packet_triangle(Triangle_Packet4 *packet, int lane, Vector3 *a, Vector3 *b, Vector3 *c) {
+    *a = v3(packet->ax[lane], packet->ay[lane], packet->az[lane]);
+    *b = *a + v3(packet->e1x[lane], packet->e1y[lane], packet->e1z[lane]);
+    *c = *a + v3(packet->e2x[lane], packet->e2y[lane], packet->e2z[lane]);
+}
+
+bool bvh_raycast(Triangle_BVH *bvh, Ray ray, float t_max, BVH_Ray_Hit *out_hit) {
+    if (bvh->packets.count == 0) {
+        return false;
+    }
+    Vector3 inv_direction = ray_inv_direction(ray);
+    BVH_Node *nodes = bvh->bvh.nodes.data;
+    if (!ray_aabb(ray.origin, inv_direction, node_aabb(&nodes[0]), t_max)) {
+        return false;
+    }
+
+    bool hit_anything = false;
+    BVH_Stack_Entry stack[BVH_STACK_SIZE];
+    int stack_count = 0;
+    BVH_Node *node = &nodes[0];
+    while (true) {
+        if (node->count > 0) {
+            Triangle_Hit hit;
+            int lane = ray_triangle_packet(ray, &bvh->packets[node->left_first], t_max, &hit);
+            if (lane != -1) {
+                t_max = hit.t;
+                out_hit->t = hit.t;
+                out_hit->u = hit.u;
+                out_hit->v = hit.v;
+                out_hit->triangle = bvh->packet_triangles[node->left_first * 4 + lane];
+                out_hit->instance = -1;
+                hit_anything = true;
+            }
+        }
+        else {
+            // visit the nearer child first so t_max shrinks as fast as possible
+            BVH_Node *left = &nodes[node->left_first];
+            BVH_Node *right = left + 1;
+            float t_left, t_right;
+            bool hit_left = ray_aabb(ray.origin, inv_direction, node_aabb(left), t_max, &t_left);
+            bool hit_right = ray_aabb(ray.origin, inv_direction, node_aabb(right), t_max, &t_right);
+            if (hit_left && hit_right) {
+                if (t_right < t_left) {
+                    BVH_Node *temp = left;
+                    left = right;
+                    right = temp;
+                    float temp_t = t_left;
+                    t_left = t_right;
+                    t_right = temp_t;
+                }
+                assert(stack_count < BVH_STACK_SIZE);
+                stack[stack_count++] = {(int)(right - nodes), t_right};
+                node = left;
+                continue;
+            }
+            if (hit_left)  { node = left;  continue; }
+            if (hit_right) { node = right; continue; }
+        }
+
+        // the box was hit when it was pushed but t_max may have shrunk since
+        node = nullptr;
+        while (stack_count > 0) {
+            BVH_Stack_Entry entry = stack[--stack_count];
+            if (entry.distance < t_max) {
+                node = &nodes[entry.node];
+                break;
+            }
+        }
+        if (node == nullptr) {
+            break;
+        }
+    }
+    return hit_anything;
+}
+
+// culls with query_box but tests triangles against exact_box after moving them by transform (if there is
+// one). for the scene queries query_box is the world box pulled into the mesh's space, which is only
+// conservative, and exact_box is the world box itself.
+static void bvh_overlap_internal(Triangle_BVH *bvh, AABB query_box, Matrix4 *transform, AABB exact_box, Array<int> *out_triangles) {
+    if (bvh->packets.count == 0) {
+        return;
+    }
+    BVH_Node *nodes = bvh->bvh.nodes.data;
+    int stack[BVH_STACK_SIZE];
+    int stack_count = 0;
+    stack[stack_count++] = 0;
+    while (stack_count > 0) {
+        BVH_Node *node = &nodes[stack[--stack_count]];
+        if (!aabb_overlap(node_aabb(node), query_box)) {
+            continue;
+        }
+        if (node->count > 0) {
+            Triangle_Packet4 *packet = &bvh->packets[node->left_first];
+            for (int lane = 0; lane < node->count; lane++) {
+                Vector3 a, b, c;
+                get_packet_triangle(packet, lane, &a, &b, &c);
+                if (transform) {
+                    a = transform_point(*transform, a);
+                    b = transform_point(*transform, b);
+                    c = transform_point(*transform, c);
+                }
+                if (triangle_aabb_overlap(a, b, c, exact_box)) {
+                    out_triangles->append(bvh->packet_triangles[node->left_first * 4 + lane]);
+                }
+            }
+        }
+        else {
+            assert(stack_count + 2 <= BVH_STACK_SIZE);
+            stack[stack_count++] = node->left_first;
+            stack[stack_count++] = node->left_first + 1;
+        }
+    }
+}
+
+void bvh_overlap(Triangle_BVH *bvh, AABB box, Array<int> *out_triangles) {
+    bvh_overlap_internal(bvh, box, nullptr, box, out_triangles);
+}
+
+// best_distance_sq is in/out so callers can chain searches over several meshes
+static bool bvh_nearest_point_internal(Triangle_BVH *bvh, Vector3 point, float *best_distance_sq, Vector3 *out_point, int *out_triangle) {
+    if (bvh->packets.count == 0) {
+        return false;
+    }
+    BVH_Node *nodes = bvh->bvh.nodes.data;
+    bool found = false;
+    BVH_Stack_Entry stack[BVH_STACK_SIZE];
+    int stack_count = 0;
+    stack[stack_count++] = {0, aabb_distance_sq(node_aabb(&nodes[0]), point)};
+    while (stack_count > 0) {
+        BVH_Stack_Entry entry = stack[--stack_count];
+        if (entry.distance >= *best_distance_sq) {
+            continue;
+        }
+        BVH_Node *node = &nodes[entry.node];
+        if (node->count > 0) {
+            Triangle_Packet4 *packet = &bvh->packets[node->left_first];
+            for (int lane = 0; lane < node->count; lane++) {
+                Vector3 a, b, c;
+                get_packet_triangle(packet, lane, &a, &b, &c);
+                Vector3 closest = closest_point_on_triangle(point, a, b, c);
+                float distance_sq = sqr_length(closest - point);
+                if (distance_sq < *best_distance_sq) {
+                    *best_distance_sq = distance_sq;
+                    *out_point = closest;
+                    *out_triangle = bvh->packet_triangles[node->left_first * 4 + lane];
+                    found = true;
+                }
+            }
+        }
+        else {
+            // push the farther child first so the nearer one gets popped first
+            BVH_Stack_Entry left = {node->left_first, aabb_distance_sq(node_aabb(&nodes[node->left_first]), point)};
+            BVH_Stack_Entry right = {node->left_first + 1, aabb_distance_sq(node_aabb(&nodes[node->left_first + 1]), point)};
+            if (left.distance < right.distance) {
+                BVH_Stack_Entry temp = left;
+                left = right;
+                right = temp;
+            }
+            assert(stack_count + 2 <= BVH_STACK_SIZE);
+            if (left.distance < *best_distance_sq)  stack[stack_count++] = left;
+            if (right.distance < *best_distance_sq) stack[stack_count++] = right;
+        }
+    }
+    return found;
+}
+
+bool bvh_nearest_point(Triangle_BVH *bvh, Vector3 point, float max_distance, Vector3 *out_point, int *out_triangle) {
+    float best_distance_sq = max_distance * max_distance;
+    return bvh_nearest_point_internal(bvh, point, &best_distance_sq, out_point, out_triangle);
+}
+
+
+
+Scene_BVH build_scene_bvh(BVH_Instance *instances, int num_instances, Allocator allocator) {
+    Scene_BVH scene = {};
+    scene.instances = make_array<BVH_Instance>(allocator, num_instances > 0 ? num_instances : 1);
+    AABB *bounds = (AABB *)alloc(default_allocator(), sizeof(AABB) * (num_instances > 0 ? num_instances : 1));
+    for (int i = 0; i < num_instances; i++) {
+        BVH_Instance instance = instances[i];
+        assert(instance.mesh != nullptr);
+        instance.inverse_transform = inverse(instance.transform);
+        AABB local_bounds = bvh_bounds(&instance.mesh->bvh);
+        if (local_bounds.min.x > local_bounds.max.x) {
+            instance.world_bounds = aabb_empty();
+        }
+        else {
+            instance.world_bounds = aabb_transform(local_bounds, instance.transform);
+        }
+        scene.instances.append(instance);
+        bounds[i] = instance.world_bounds;
+    }
+    scene.bvh = build_bvh(bounds, num_instances, 4, allocator);
+    free(default_allocator(), bounds);
+    return scene;
+}
+
+void destroy_scene_bvh(Scene_BVH *scene) {
+    destroy_bvh(&scene->bvh);
+    scene->instances.destroy();
+}
+
+bool bvh_raycast(Scene_BVH *scene, Ray ray, float t_max, BVH_Ray_Hit *out_hit) {
+    if (scene->instances.count == 0) {
+        return false;
+    }
+    Vector3 inv_direction = ray_inv_direction(ray);
+    BVH_Node *nodes = scene->bvh.nodes.data;
+    bool hit_anything = false;
+    int stack[BVH_STACK_SIZE];
+    int stack_count = 0;
+    stack[stack_count++] = 0;
+    while (stack_count > 0) {
+        BVH_Node *node = &nodes[stack[--stack_count]];
+        if (!ray_aabb(ray.origin, inv_direction, node_aabb(node), t_max)) {
+            continue;
+        }
+        if (node->count > 0) {
+            for (int i = 0; i < node->count; i++) {
+                int instance_index = scene->bvh.primitive_indices[node->left_first + i];
+                BVH_Instance *instance = &scene->instances[instance_index];
+                // note(josh): the direction isn't renormalized, so t in local space is the same t
+                // in world space and t_max carries straight over.
+                Ray local_ray;
+                local_ray.origin = transform_point(instance->inverse_transform, ray.origin);
+                local_ray.direction = transform_direction(instance->inverse_transform, ray.direction);
+                if (bvh_raycast(instance->mesh, local_ray, t_max, out_hit)) {
+                    t_max = out_hit->t;
+                    out_hit->instance = instance_index;
+                    hit_anything = true;
+                }
+            }
+        }
+        else {
+            assert(stack_count + 2 <= BVH_STACK_SIZE);
+            stack[stack_count++] = node->left_first;
+            stack[stack_count++] = node->left_first + 1;
+        }
+    }
+    return hit_anything;
+}
+
+void bvh_overlap(Scene_BVH *scene, AABB box, Array<BVH_Overlap> *out_overlaps) {
+    if (scene->instances.count == 0) {
+        return;
+    }
+    Array<int> candidates = make_array<int>(default_allocator(), 64);
+    BVH_Node *nodes = scene->bvh.nodes.data;
+    int stack[BVH_STACK_SIZE];
+    int stack_count = 0;
+    stack[stack_count++] = 0;
+    while (stack_count > 0) {
+        BVH_Node *node = &nodes[stack[--stack_count]];
+        if (!aabb_overlap(node_aabb(node), box)) {
+            continue;
+        }
+        if (node->count > 0) {
+            for (int i = 0; i < node->count; i++) {
+                int instance_index = scene->bvh.primitive_indices[node->left_first + i];
+                BVH_Instance *instance = &scene->instances[instance_index];
+                if (!aabb_overlap(instance->world_bounds, box)) {
+                    continue;
+                }
+                candidates.clear();
+                bvh_overlap_internal(instance->mesh, aabb_transform(box, instance->inverse_transform), &instance->transform, box, &candidates);
+                Foreach (triangle, candidates) {
+                    BVH_Overlap overlap = {instance_index, *triangle};
+                    out_overlaps->append(overlap);
+                }
+            }
+        }
+        else {
+            assert(stack_count + 2 <= BVH_STACK_SIZE);
+            stack[stack_count++] = node->left_first;
+            stack[stack_count++] = node->left_first + 1;
+        }
+    }
+    candidates.destroy();
+}
+
+bool bvh_nearest_point(Scene_BVH *scene, Vector3 point, float max_distance, Vector3 *out_point, BVH_Overlap *out_triangle) {
+    if (scene->instances.count == 0) {
+        return false;
+    }
+    BVH_Node *nodes = scene->bvh.nodes.data;
+    float best_distance_sq = max_distance * max_distance;
+    bool found = false;
+    int stack[BVH_STACK_SIZE];
+    int stack_count = 0;
+    stack[stack_count++] = 0;
+    while (stack_count > 0) {
+        BVH_Node *node = &nodes[stack[--stack_count]];
+        if (aabb_distance_sq(node_aabb(node), point) >= best_distance_sq) {
+            continue;
+        }
+        if (node->count > 0) {
+            for (int i = 0; i < node->count; i++) {
+                int instance_index = scene->bvh.primitive_indices[node->left_first + i];
+                BVH_Instance *instance = &scene->instances[instance_index];
+                if (aabb_distance_sq(instance->world_bounds, point) >= best_distance_sq) {
+                    continue;
+                }
+
+                // note(josh): search in local space. dividing by the smallest scale makes the local
+                // search radius cover at least the world one, then we measure the result in world space.
+                float min_scale_sq = FLT_MAX;
+                for (int c = 0; c < 3; c++) {
+                    float scale_sq = sqr_length(v3(instance->transform[c]));
+                    if (scale_sq < min_scale_sq) min_scale_sq = scale_sq;
+                }
+                if (min_scale_sq <= 0) {
+                    continue;
+                }
+                float local_best_distance_sq = best_distance_sq / min_scale_sq;
+                Vector3 local_point = transform_point(instance->inverse_transform, point);
+                Vector3 local_closest;
+                int triangle;
+                if (!bvh_nearest_point_internal(instance->mesh, local_point, &local_best_distance_sq, &local_closest, &triangle)) {
+                    continue;
+                }
+                Vector3 closest = transform_point(instance->transform, local_closest);
+                float distance_sq = sqr_length(closest - point);
+                if (distance_sq < best_distance_sq) {
+                    best_distance_sq = distance_sq;
+                    *out_point = closest;
+                    out_triangle->instance = instance_index;
+                    out_triangle->triangle = triangle;
+                    found = true;
+                }
+            }
+        }
+        else {
+            int left = node->left_first;
+            int right = left + 1;
+            float d_left = aabb_distance_sq(node_aabb(&nodes[left]), point);
+            float d_right = aabb_distance_sq(node_aabb(&nodes[right]), point);
+            if (d_left < d_right) {
+                int temp = left;
+                left = right;
+                right = temp;
+            }
+            assert(stack_count + 2 <= BVH_STACK_SIZE);
+            stack[stack_count++] = left;
+            stack[stack_count++] = right;
+        }
+    }
+    return found;
+}
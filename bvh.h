@@ -0,0 +1,91 @@
+#pragma once
+
+#include "basic.h"
+#include "math.h"
+#include "intersection.h"
+
+//
+// Static bounding volume hierarchies for CPU-side spatial queries.
+//
+// BVH is the generic part: a binned SAH build over a list of primitive bounds that produces a
+// flat array of 32 byte nodes. Triangle_BVH puts one over a triangle mesh and stores the leaf
+// triangles as SIMD packets. Scene_BVH puts one over a set of transformed Triangle_BVH instances.
+//
+
+struct BVH_Node {
+    Vector3 min;
+    i32 left_first; // interior: index of the left child, the right child is left_first+1. leaf: first primitive
+    Vector3 max;
+    i32 count;      // number of primitives for leaves, 0 for interior nodes
+};
+
+static_assert(sizeof(BVH_Node) == 32, "BVH_Node should be 32 bytes, two per cache line");
+
+struct BVH {
+    Array<BVH_Node> nodes;        // nodes[0] is the root
+    Array<int> primitive_indices; // leaves index ranges of this, which index the primitives given to build_bvh()
+};
+
+// Large subtrees are built on other threads. max_leaf_size is the most primitives a leaf can hold,
+// SAH is free to make smaller leaves.
+BVH build_bvh(AABB *primitive_bounds, int num_primitives, int max_leaf_size, Allocator allocator);
+void destroy_bvh(BVH *bvh);
+AABB bvh_bounds(BVH *bvh);
+
+
+
+struct Triangle_BVH {
+    BVH bvh;
+    // one packet per leaf, leaf.left_first is the packet index and leaf.count the number of triangles in it
+    Array<Triangle_Packet4> packets;
+    Array<int> packet_triangles; // 4 per packet, the original triangle index of each lane or -1
+};
+
+// indices can be null for unindexed triangle lists
+Triangle_BVH build_triangle_bvh(Vector3 *positions, u32 *indices, int num_triangles, Allocator allocator);
+void destroy_triangle_bvh(Triangle_BVH *bvh);
+
+struct BVH_Ray_Hit {
+    float t;
+    float u; // barycentrics, see Triangle_Hit
+    float v;
+    int triangle;
+    int instance; // only set by the Scene_BVH queries
+};
+
+// closest hit with t < t_max
+bool bvh_raycast(Triangle_BVH *bvh, Ray ray, float t_max, BVH_Ray_Hit *out_hit);
+// appends the index of every triangle that touches box
+void bvh_overlap(Triangle_BVH *bvh, AABB box, Array<int> *out_triangles);
+// closest point on the mesh within max_distance of point
+bool bvh_nearest_point(Triangle_BVH *bvh, Vector3 point, float max_distance, Vector3 *out_point, int *out_triangle);
+
+
+
+struct BVH_Instance {
+    Triangle_BVH *mesh;
+    Matrix4 transform;
+    Matrix4 inverse_transform; // filled in by build_scene_bvh()
+    AABB world_bounds;         // filled in by build_scene_bvh()
+};
+
+struct Scene_BVH {
+    BVH bvh;
+    Array<BVH_Instance> instances;
+};
+
+Scene_BVH build_scene_bvh(BVH_Instance *instances, int num_instances, Allocator allocator);
+void destroy_scene_bvh(Scene_BVH *scene);
+
+bool bvh_raycast(Scene_BVH *scene, Ray ray, float t_max, BVH_Ray_Hit *out_hit);
+
+struct BVH_Overlap {
+    int instance;
+    int triangle;
+};
+void bvh_overlap(Scene_BVH *scene, AABB box, Array<BVH_Overlap> *out_overlaps);
+
+// note(josh): exact for instances that are only rotated, translated and uniformly scaled. with
+// non-uniform scale the point is still on the mesh and within max_distance but it's the closest one
+// as measured in the instance's local space, which isn't always the closest in world space.
+bool bvh_nearest_point(Scene_BVH *scene, Vector3 point, float max_distance, Vector3 *out_point, BVH_Overlap *out_triangle);
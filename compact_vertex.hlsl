@@ -0,0 +1,38 @@
+#include "types.hlsl"
+
+// must match oct_decode() in packing.cpp
+float3 oct_decode(float2 e) {
+    float3 n = float3(e.x, e.y, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0 ? -t : t;
+    n.y += n.y >= 0 ? -t : t;
+    return normalize(n);
+}
+
+PS_INPUT main(COMPACT_VS_INPUT input) {
+    matrix mvp = mul(projection_matrix, mul(view_matrix, model_matrix));
+    PS_INPUT v;
+    v.position = mul(mvp, float4(input.position, 1.0));
+    v.texcoord = float3(input.texcoord, 0);
+    v.color = float4(1, 1, 1, 1);
+    v.world_position = mul(model_matrix, float4(input.position, 1.0)).xyz;
+
+    float3 normal  = oct_decode(input.normal);
+    float3 tangent = oct_decode(input.tangent.xy * 2.0 - 1.0);
+    float bitangent_sign = input.tangent.w > 0.5 ? 1.0 : -1.0;
+    float3 bitangent = cross(normal, tangent) * bitangent_sign;
+
+    // todo(josh): fix normals for non-uniformly scaled objects
+    float3 T = normalize(mul(model_matrix, float4(tangent,   0)).xyz);
+    float3 B = normalize(mul(model_matrix, float4(bitangent, 0)).xyz);
+    float3 N = normalize(mul(model_matrix, float4(normal,    0)).xyz);
+
+    // this transpose is pretty lame
+    v.tbn = transpose(matrix<float, 3, 3>(T, B, N));
+
+    v.normal    = N;
+    v.tangent   = T;
+    v.bitangent = B;
+
+    return v;
+}
@@ -0,0 +1,247 @@
+#include "cooked_texture.h"
+
+#include "stb_image.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static u64 align_up(u64 offset, u64 alignment) {
+    return (offset + alignment - 1) & ~(alignment - 1);
+}
+
+bool write_cooked_texture(char *filename, Image_Format format, Compression_Quality quality, u32 flags, int width, int height, int num_levels, byte *chain) {
+    assert(num_levels >= 1 && num_levels <= CFFTEXTURE_MAX_LEVELS);
+    Cfftexture_Header header = {};
+    header.magic = CFFTEXTURE_MAGIC;
+    header.version = CFFTEXTURE_VERSION;
+    header.format = format;
+    header.flags = flags;
+    header.width = width;
+    header.height = height;
+    header.num_levels = num_levels;
+    header.quality = quality;
+    header.levels_offset = sizeof(Cfftexture_Header);
+
+    Cfftexture_Level level_table[CFFTEXTURE_MAX_LEVELS] = {};
+    u64 data_offset = align_up(header.levels_offset + num_levels * sizeof(Cfftexture_Level), CFFTEXTURE_DATA_ALIGNMENT);
+    for (int i = 0; i < num_levels; i++) {
+        Cfftexture_Level *level = &level_table[i];
+        level->width = mipmap_level_dimension(width, i);
+        level->height = mipmap_level_dimension(height, i);
+        level->size = (u64)image_level_size(format, level->width, level->height);
+        level->offset = data_offset + (u64)mipmap_level_offset(format, width, height, i);
+    }
+    u64 chain_size = (u64)mipmap_chain_size(format, width, height, num_levels);
+    header.file_size = data_offset + chain_size;
+
+    // write into a temporary and rename so a crash halfway through doesn't leave a file that looks valid
+    char temp_filename[1024];
+    snprintf(temp_filename, sizeof(temp_filename), "%s.tmp", filename);
+    FILE *file = fopen(temp_filename, "wb");
+    if (file == nullptr) {
+        printf("write_cooked_texture() couldn't open %s for writing\n", temp_filename);
+        return false;
+    }
+
+    byte padding[CFFTEXTURE_DATA_ALIGNMENT] = {};
+    u64 padding_size = data_offset - (header.levels_offset + num_levels * sizeof(Cfftexture_Level));
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    ok = ok && fwrite(level_table, sizeof(Cfftexture_Level), num_levels, file) == (size_t)num_levels;
+    if (padding_size) ok = ok && fwrite(padding, 1, padding_size, file) == padding_size;
+    ok = ok && fwrite(chain, 1, chain_size, file) == chain_size;
+    ok = (fclose(file) == 0) && ok;
+
+    if (!ok) {
+        printf("write_cooked_texture() failed writing %s\n", temp_filename);
+        remove(temp_filename);
+        return false;
+    }
+    remove(filename);
+    if (rename(temp_filename, filename) != 0) {
+        printf("write_cooked_texture() couldn't rename %s to %s\n", temp_filename, filename);
+        remove(temp_filename);
+        return false;
+    }
+    return true;
+}
+
+
+
+static bool range_in_file(u64 offset, u64 size, u64 file_size) {
+    return offset <= file_size && size <= file_size - offset;
+}
+
+bool open_cooked_texture(char *filename, Cooked_Texture_File *out_texture) {
+    *out_texture = {};
+    Mapped_File file;
+    if (!map_entire_file(filename, &file)) {
+        return false;
+    }
+
+    u64 size = (u64)file.size;
+    Cfftexture_Header *header = (Cfftexture_Header *)file.data;
+    bool valid = size >= sizeof(Cfftexture_Header)
+              && header->magic == CFFTEXTURE_MAGIC
+              && header->version == CFFTEXTURE_VERSION
+              && header->format < IMAGE_FORMAT_COUNT
+              && header->width > 0 && header->height > 0
+              && header->width <= 0x10000 && header->height <= 0x10000
+              && header->num_levels >= 1 && header->num_levels <= CFFTEXTURE_MAX_LEVELS
+              && header->file_size == size
+              && range_in_file(header->levels_offset, (u64)header->num_levels * sizeof(Cfftexture_Level), size)
+              && header->levels_offset % alignof(Cfftexture_Level) == 0;
+
+    if (valid) {
+        Cfftexture_Level *levels = (Cfftexture_Level *)(file.data + header->levels_offset);
+        for (u32 i = 0; i < header->num_levels && valid; i++) {
+            Cfftexture_Level *level = &levels[i];
+            valid = level->width == (u32)mipmap_level_dimension(header->width, i)
+                 && level->height == (u32)mipmap_level_dimension(header->height, i)
+                 && level->size == (u64)image_level_size((Image_Format)header->format, level->width, level->height)
+                 && level->offset == levels[0].offset + (u64)mipmap_level_offset((Image_Format)header->format, header->width, header->height, i)
+                 && range_in_file(level->offset, level->size, size);
+        }
+    }
+
+    if (!valid) {
+        printf("open_cooked_texture(): %s is out of date or corrupt\n", filename);
+        unmap_file(&file);
+        return false;
+    }
+
+    out_texture->file = file;
+    out_texture->header = header;
+    out_texture->levels = (Cfftexture_Level *)(file.data + header->levels_offset);
+    return true;
+}
+
+void close_cooked_texture(Cooked_Texture_File *texture) {
+    unmap_file(&texture->file);
+    *texture = {};
+}
+
+bool cooked_texture_path(char *source_filename, char *buffer, int buffer_size) {
+    int length = (int)strlen(source_filename);
+    char *extension = strrchr(source_filename, '.');
+    char *separator = strrchr(source_filename, '/');
+    char *backslash = strrchr(source_filename, '\\');
+    if (backslash > separator) separator = backslash;
+    if (extension && (separator == nullptr || extension > separator)) {
+        length = (int)(extension - source_filename);
+    }
+    int written = snprintf(buffer, buffer_size, "%.*s.cfftexture", length, source_filename);
+    return written > 0 && written < buffer_size;
+}
+
+bool find_cooked_texture(char *source_filename, Cooked_Texture_File *out_texture) {
+    *out_texture = {};
+    char cooked_filename[1024];
+    if (!cooked_texture_path(source_filename, cooked_filename, sizeof(cooked_filename))) {
+        return false;
+    }
+    u64 source_time = 0;
+    u64 cooked_time = 0;
+    if (!get_file_write_time(cooked_filename, &cooked_time)) {
+        return false;
+    }
+    if (get_file_write_time(source_filename, &source_time) && cooked_time < source_time) {
+        return false;
+    }
+    return open_cooked_texture(cooked_filename, out_texture);
+}
+
+
+
+Texture_Cook_Settings texture_cook_settings(Material_Map map, bool srgb, bool transparent, Compression_Quality quality) {
+    Texture_Cook_Settings settings = {};
+    settings.quality = quality;
+    settings.mipmaps.filter = MIPMAP_FILTER_KAISER;
+    settings.mipmaps.srgb = srgb;
+    switch (map) {
+        case MM_NORMAL: {
+            settings.format = IMAGE_FORMAT_BC5;
+            settings.mipmaps.normal_map = true;
+            break;
+        }
+        case MM_AO: {
+            settings.format = IMAGE_FORMAT_BC4;
+            break;
+        }
+        case MM_ALBEDO: {
+            settings.format = IMAGE_FORMAT_BC7;
+            if (transparent) settings.mipmaps.alpha_cutoff = 0.5f;
+            break;
+        }
+        default: {
+            settings.format = IMAGE_FORMAT_BC7;
+            break;
+        }
+    }
+    return settings;
+}
+
+u32 cooked_texture_flags(Texture_Cook_Settings settings) {
+    u32 flags = 0;
+    if (settings.mipmaps.srgb)                           flags |= CFFTEXTURE_SRGB;
+    if (settings.mipmaps.normal_map)                     flags |= CFFTEXTURE_NORMAL_MAP;
+    if (settings.mipmaps.alpha_cutoff > 0)               flags |= CFFTEXTURE_ALPHA_COVERAGE;
+    if (settings.mipmaps.filter == MIPMAP_FILTER_KAISER) flags |= CFFTEXTURE_KAISER_MIPMAPS;
+    return flags;
+}
+
+bool cook_texture(char *source_filename, char *cooked_filename, Texture_Cook_Settings settings, Allocator allocator) {
+    int width;
+    int height;
+    int channels;
+    byte *pixels = stbi_load(source_filename, &width, &height, &channels, 4);
+    if (pixels == nullptr) {
+        printf("cook_texture() couldn't load %s: %s\n", source_filename, stbi_failure_reason());
+        return false;
+    }
+    defer(stbi_image_free(pixels));
+
+    Image_Format format = settings.format;
+    if (format != IMAGE_FORMAT_RGBA8 && (width % 4 != 0 || height % 4 != 0)) {
+        printf("cook_texture(): %s is %dx%d, which isn't a multiple of 4, storing it uncompressed\n", source_filename, width, height);
+        format = IMAGE_FORMAT_RGBA8;
+    }
+
+    int num_levels = mipmap_count(width, height);
+    if (num_levels > CFFTEXTURE_MAX_LEVELS) num_levels = CFFTEXTURE_MAX_LEVELS;
+    byte *mipmaps = (byte *)alloc(allocator, (int)mipmap_chain_size(IMAGE_FORMAT_RGBA8, width, height, num_levels));
+    defer(free(allocator, mipmaps));
+    generate_mipmaps(pixels, width, height, settings.mipmaps, num_levels, mipmaps, allocator);
+
+    byte *blocks = (byte *)alloc(allocator, (int)mipmap_chain_size(format, width, height, num_levels));
+    defer(free(allocator, blocks));
+    for (int i = 0; i < num_levels; i++) {
+        int level_width = mipmap_level_dimension(width, i);
+        int level_height = mipmap_level_dimension(height, i);
+        byte *level_pixels = mipmaps + mipmap_level_offset(IMAGE_FORMAT_RGBA8, width, height, i);
+        byte *level_blocks = blocks + mipmap_level_offset(format, width, height, i);
+        compress_image(format, settings.quality, level_pixels, level_width, level_height, level_width * 4, level_blocks);
+    }
+    return write_cooked_texture(cooked_filename, format, settings.quality, cooked_texture_flags(settings), width, height, num_levels, blocks);
+}
+
+bool ensure_texture_cooked(char *source_filename, Texture_Cook_Settings settings, Allocator allocator) {
+    Cooked_Texture_File cooked;
+    if (find_cooked_texture(source_filename, &cooked)) {
+        Cfftexture_Header *header = cooked.header;
+        bool same_settings = (header->format == (u32)settings.format || header->format == IMAGE_FORMAT_RGBA8)
+                          && header->quality == (u32)settings.quality
+                          && header->flags == cooked_texture_flags(settings);
+        close_cooked_texture(&cooked);
+        if (same_settings) {
+            return true;
+        }
+    }
+
+    char cooked_filename[1024];
+    if (!cooked_texture_path(source_filename, cooked_filename, sizeof(cooked_filename))) {
+        printf("ensure_texture_cooked(): path too long: %s\n", source_filename);
+        return false;
+    }
+    printf("Cooking %s -> %s (%s)\n", source_filename, cooked_filename, image_format_name(settings.format));
+    return cook_texture(source_filename, cooked_filename, settings, allocator);
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "basic.h"
+#include "texture_compression.h"
+#include "mipmap.h"
+#include "model_format.h"
+
+//
+// .cfftexture, the cooked texture format.
+//
+// Material textures come as PNGs and JPGs, which have to be decoded on every load and then sit in
+// VRAM as RGBA8. Cooking decodes and block compresses them once and writes the blocks out in the
+// layout the GPU wants, so loading is mapping the file and handing the levels to create_texture().
+// A cooked texture lives next to its source with the extension swapped, see cooked_texture_path().
+// It has the full mip chain, generated from the source before compression, see mipmap.h.
+//
+// Layout, all offsets are from the start of the file:
+//
+//   Cfftexture_Header
+//   Cfftexture_Level x num_levels, largest first
+//   level data, CFFTEXTURE_DATA_ALIGNMENT aligned, levels back to back so the whole chain can be
+//   handed to create_texture() as one pointer
+//
+// Everything is little-endian and fixed size. Bump CFFTEXTURE_VERSION whenever any of it or the
+// encoders change, and old files will be rejected and re-cooked.
+//
+
+#define CFFTEXTURE_MAGIC 0x54464643 // "CFFT"
+#define CFFTEXTURE_VERSION 2
+#define CFFTEXTURE_DATA_ALIGNMENT 16
+#define CFFTEXTURE_MAX_LEVELS 16
+
+// how the texture was cooked, so a change in settings means a re-cook
+#define CFFTEXTURE_SRGB            (1 << 0) // the texture holds sRGB color, mips were filtered in linear
+#define CFFTEXTURE_NORMAL_MAP      (1 << 1) // mips were renormalized
+#define CFFTEXTURE_ALPHA_COVERAGE  (1 << 2) // mips keep the alpha coverage of level 0
+#define CFFTEXTURE_KAISER_MIPMAPS  (1 << 3) // mips were made with MIPMAP_FILTER_KAISER, box otherwise
+
+struct Cfftexture_Header {
+    u32 magic;
+    u32 version;
+    u32 format;     // Image_Format
+    u32 flags;
+    u32 width;
+    u32 height;
+    u32 num_levels;
+    u32 quality;    // Compression_Quality it was cooked at
+    u64 levels_offset;
+    u64 file_size;
+};
+
+struct Cfftexture_Level {
+    u64 offset;
+    u64 size;       // image_level_size() of the level
+    u32 width;
+    u32 height;
+};
+
+static_assert(sizeof(Cfftexture_Header) == 48, "Cfftexture_Header layout changed, bump CFFTEXTURE_VERSION");
+static_assert(sizeof(Cfftexture_Level)  == 24, "Cfftexture_Level layout changed, bump CFFTEXTURE_VERSION");
+
+
+
+// chain is num_levels levels laid out like mipmap.h says, mipmap_chain_size(format, ...) bytes.
+bool write_cooked_texture(char *filename, Image_Format format, Compression_Quality quality, u32 flags, int width, int height, int num_levels, byte *chain);
+
+// open_cooked_texture() maps the file and checks that the header and the level table agree with
+// each other and the file size, it never looks at the pixels. cooked_texture_level(texture, 0) is
+// the start of the whole chain.
+struct Cooked_Texture_File {
+    Mapped_File file;
+    Cfftexture_Header *header;
+    Cfftexture_Level *levels;
+};
+
+bool open_cooked_texture(char *filename, Cooked_Texture_File *out_texture);
+void close_cooked_texture(Cooked_Texture_File *texture);
+
+static inline byte *cooked_texture_level(Cooked_Texture_File *texture, int level) { return texture->file.data + texture->levels[level].offset; }
+
+// source_filename with its extension replaced by .cfftexture. Returns false if it doesn't fit.
+bool cooked_texture_path(char *source_filename, char *buffer, int buffer_size);
+
+// Opens the cooked version of source_filename if there is one and it isn't older than the source.
+// Quiet when there isn't one, that's the normal case for textures nobody cooked.
+bool find_cooked_texture(char *source_filename, Cooked_Texture_File *out_texture);
+
+
+
+// Cooking.
+struct Texture_Cook_Settings {
+    Image_Format format;
+    Compression_Quality quality;
+    Mipmap_Settings mipmaps;
+};
+
+// What each material map gets cooked to:
+//   albedo, emission           BC7, sRGB if the material says so
+//   normal                     BC5, the shader rebuilds z from x and y
+//   AO                         BC4, the shader only reads R
+//   metallic, roughness        BC7, glTF packs them into G and B of one texture
+// Mips are Kaiser filtered, in linear for sRGB maps. Normal map mips are renormalized and the albedo
+// of transparent materials keeps its alpha coverage at glTF's default cutoff of 0.5.
+Texture_Cook_Settings texture_cook_settings(Material_Map map, bool srgb, bool transparent, Compression_Quality quality);
+u32 cooked_texture_flags(Texture_Cook_Settings settings);
+
+// Decodes source_filename, generates its mips and writes them compressed to cooked_filename. Images
+// whose size isn't a multiple of 4 can't be BCn textures in D3D11 and are stored as RGBA8 instead.
+bool cook_texture(char *source_filename, char *cooked_filename, Texture_Cook_Settings settings, Allocator allocator);
+
+// Cooks source_filename unless its cooked version is up to date and was cooked with these settings.
+// Images that had to be stored as RGBA8 count as cooked with any format.
+// Returns false if the source can't be cooked. Safe to call from several threads for different files.
+bool ensure_texture_cooked(char *source_filename, Texture_Cook_Settings settings, Allocator allocator);
@@ -0,0 +1,8 @@
+#include "types.hlsl"
+
+DEPTH_PS_INPUT main(DEPTH_VS_INPUT input) {
+    matrix mvp = mul(projection_matrix, mul(view_matrix, model_matrix));
+    DEPTH_PS_INPUT v;
+    v.position = mul(mvp, float4(input.position, 1.0));
+    return v;
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "basic.h"
+#include "math.h"
+#include "simd.h"
+
+//
+// Approximate transcendentals and reciprocal square root, for float and for SoA f32x4/f32x8.
+// All of the widths run the same code so they give the same answers. Everything is header-only
+// so the SIMD versions inline into the calling loop.
+//
+// Max error against the correctly rounded result, measured by sweeping the float range given:
+//
+//   rsqrt_fast   normal x > 0                     4 ulp
+//   sin/cos_fast |x| <= 8192                      2 ulp, or 1.2e-10 absolute where the result is ~0
+//   atan2_fast   all finite y, x                  3.1 ulp, signed zeros give the same 0 or pi as libm
+//   exp_fast     x in [-87.3, 88]                 1.3 ulp
+//   log_fast     normal x > 0                     0.9 ulp, or 4.3e-9 absolute near x = 1
+//
+// Past |x| = 8192 the sin/cos range reduction starts to lose bits. exp_fast clamps its input to
+// the range above so it never returns inf or a denormal. log_fast treats denormal inputs as garbage
+// and handles 0, negatives, inf and nan like log() does. NaN into anything else is garbage out.
+//
+
+// note(josh): the int ops the kernels need, under names FM() can build. they're all #undef'd again
+// so none of them leak out of this header.
+#define FM_T f32x4
+#define FM_I i32x4
+#define FM(op) f32x4_##op
+#define f32x4_to_int         f32x4_to_i32x4
+#define f32x4_to_int_bits    f32x4_cast_i32x4
+#define f32x4_from_int_bits  i32x4_cast_f32x4
+#define f32x4_int_to_float   i32x4_to_f32x4
+#define f32x4_int_set1       i32x4_set1
+#define f32x4_int_add        i32x4_add
+#define f32x4_int_sub        i32x4_sub
+#define f32x4_int_and        i32x4_and
+#define f32x4_int_or         i32x4_or
+#define f32x4_int_shl        i32x4_shl
+#define f32x4_int_shr        i32x4_shr
+#include "fastmath_kernels.h"
+#undef FM_T
+#undef FM_I
+#undef FM
+#undef f32x4_to_int
+#undef f32x4_to_int_bits
+#undef f32x4_from_int_bits
+#undef f32x4_int_to_float
+#undef f32x4_int_set1
+#undef f32x4_int_add
+#undef f32x4_int_sub
+#undef f32x4_int_and
+#undef f32x4_int_or
+#undef f32x4_int_shl
+#undef f32x4_int_shr
+
+#ifdef CFF_SIMD_AVX
+#define FM_T f32x8
+#define FM_I i32x8
+#define FM(op) f32x8_##op
+#define f32x8_to_int         f32x8_to_i32x8
+#define f32x8_to_int_bits    f32x8_cast_i32x8
+#define f32x8_from_int_bits  i32x8_cast_f32x8
+#define f32x8_int_to_float   i32x8_to_f32x8
+#define f32x8_int_set1       i32x8_set1
+#define f32x8_int_add        i32x8_add
+#define f32x8_int_sub        i32x8_sub
+#define f32x8_int_and        i32x8_and
+#define f32x8_int_or         i32x8_or
+#define f32x8_int_shl        i32x8_shl
+#define f32x8_int_shr        i32x8_shr
+#include "fastmath_kernels.h"
+#undef FM_T
+#undef FM_I
+#undef FM
+#undef f32x8_to_int
+#undef f32x8_to_int_bits
+#undef f32x8_from_int_bits
+#undef f32x8_int_to_float
+#undef f32x8_int_set1
+#undef f32x8_int_add
+#undef f32x8_int_sub
+#undef f32x8_int_and
+#undef f32x8_int_or
+#undef f32x8_int_shl
+#undef f32x8_int_shr
+#endif
+
+
+
+// note(josh): the scalar versions just run the 4 wide code on one lane so they can't drift from
+// the wide versions. they are not faster than a good libm (glibc's sinf is about as fast), the
+// win is in loops that use the f32x4/f32x8 versions.
+
+static inline float rsqrt_fast(float x)            { return _mm_cvtss_f32(f32x4_rsqrt_fast(_mm_set1_ps(x))); }
+static inline float sin_fast  (float x)            { return _mm_cvtss_f32(f32x4_sin_fast(_mm_set1_ps(x))); }
+static inline float cos_fast  (float x)            { return _mm_cvtss_f32(f32x4_cos_fast(_mm_set1_ps(x))); }
+static inline float atan2_fast(float y, float x)   { return _mm_cvtss_f32(f32x4_atan2_fast(_mm_set1_ps(y), _mm_set1_ps(x))); }
+static inline float exp_fast  (float x)            { return _mm_cvtss_f32(f32x4_exp_fast(_mm_set1_ps(x))); }
+static inline float log_fast  (float x)            { return _mm_cvtss_f32(f32x4_log_fast(_mm_set1_ps(x))); }
+static inline void  sincos_fast(float x, float *out_sin, float *out_cos) {
+    f32x4 s, c;
+    f32x4_sincos_fast(_mm_set1_ps(x), &s, &c);
+    *out_sin = _mm_cvtss_f32(s);
+    *out_cos = _mm_cvtss_f32(c);
+}
+
+static inline f32x4 rsqrt_fast(f32x4 x)            { return f32x4_rsqrt_fast(x); }
+static inline f32x4 sin_fast  (f32x4 x)            { return f32x4_sin_fast(x); }
+static inline f32x4 cos_fast  (f32x4 x)            { return f32x4_cos_fast(x); }
+static inline f32x4 atan2_fast(f32x4 y, f32x4 x)   { return f32x4_atan2_fast(y, x); }
+static inline f32x4 exp_fast  (f32x4 x)            { return f32x4_exp_fast(x); }
+static inline f32x4 log_fast  (f32x4 x)            { return f32x4_log_fast(x); }
+static inline void  sincos_fast(f32x4 x, f32x4 *out_sin, f32x4 *out_cos) { f32x4_sincos_fast(x, out_sin, out_cos); }
+
+#ifdef CFF_SIMD_AVX
+static inline f32x8 rsqrt_fast(f32x8 x)            { return f32x8_rsqrt_fast(x); }
+static inline f32x8 sin_fast  (f32x8 x)            { return f32x8_sin_fast(x); }
+static inline f32x8 cos_fast  (f32x8 x)            { return f32x8_cos_fast(x); }
+static inline f32x8 atan2_fast(f32x8 y, f32x8 x)   { return f32x8_atan2_fast(y, x); }
+static inline f32x8 exp_fast  (f32x8 x)            { return f32x8_exp_fast(x); }
+static inline f32x8 log_fast  (f32x8 x)            { return f32x8_log_fast(x); }
+static inline void  sincos_fast(f32x8 x, f32x8 *out_sin, f32x8 *out_cos) { f32x8_sincos_fast(x, out_sin, out_cos); }
+#endif
+
+
+
+// Opt-in replacements for normalize() that use rsqrt_fast() instead of sqrt and a divide.
+// Zero length input gives inf/nan just like normalize() does.
+static inline Vector2    normalize_fast(Vector2 v)    { return v * rsqrt_fast(dot(v, v)); }
+static inline Vector3    normalize_fast(Vector3 v)    { return v * rsqrt_fast(dot(v, v)); }
+static inline Vector4    normalize_fast(Vector4 v)    { return v * rsqrt_fast(dot(v, v)); }
+static inline Quaternion normalize_fast(Quaternion q) { return q * rsqrt_fast(dot(q, q)); }
+static inline float      length_fast   (Vector3 v)    { float d = dot(v, v); return d > 0 ? d * rsqrt_fast(d) : 0; }
@@ -0,0 +1,137 @@
+// note(josh): no #pragma once, fastmath.h includes this once per vector width with
+// FM_T (float vector type), FM_I (matching int vector type) and FM(op) (op name for that width)
+// defined. Everything here is lane-wise so it doesn't care how wide it is.
+
+static inline FM_T FM(rsqrt_fast)(FM_T x) {
+    FM_T y = FM(rsqrt_approx)(x);
+    FM_T xyy = FM(mul)(FM(mul)(x, y), y);
+    return FM(mul)(FM(mul)(FM(set1)(0.5f), y), FM(sub)(FM(set1)(3.0f), xyy));
+}
+
+// r in [-pi/4, pi/4]
+static inline FM_T FM(sin_poly)(FM_T r, FM_T r2) {
+    FM_T p = FM(madd)(r2, FM(set1)(-1.9515295891e-4f), FM(set1)(8.3321608736e-3f));
+    p = FM(madd)(r2, p, FM(set1)(-1.6666654611e-1f));
+    return FM(madd)(FM(mul)(r2, r), p, r);
+}
+
+static inline FM_T FM(cos_poly)(FM_T r2) {
+    FM_T p = FM(madd)(r2, FM(set1)(2.443315711809948e-5f), FM(set1)(-1.388731625493765e-3f));
+    p = FM(madd)(r2, p, FM(set1)(4.166664568298827e-2f));
+    p = FM(mul)(FM(mul)(r2, r2), p);
+    return FM(add)(FM(madd)(r2, FM(set1)(-0.5f), FM(set1)(1.0f)), p);
+}
+
+static inline void FM(sincos_fast)(FM_T x, FM_T *out_sin, FM_T *out_cos) {
+    // x = j*(pi/2) + r with pi/2 split in three so j*(pi/2) is exact for the first two parts
+    FM_T j = FM(round)(FM(mul)(x, FM(set1)(0.636619772367581343f)));
+    FM_T r = FM(madd)(j, FM(set1)(-1.5703125f), x);
+    r = FM(madd)(j, FM(set1)(-4.837512969970703125e-4f), r);
+    r = FM(madd)(j, FM(set1)(-7.54978995489188216e-8f), r);
+    FM_T r2 = FM(mul)(r, r);
+    FM_T s = FM(sin_poly)(r, r2);
+    FM_T c = FM(cos_poly)(r2);
+
+    // quadrant q = j mod 4
+    FM_T q = FM(sub)(j, FM(mul)(FM(floor)(FM(mul)(j, FM(set1)(0.25f))), FM(set1)(4.0f)));
+    FM_T odd = FM(or)(FM(cmp_eq)(q, FM(set1)(1.0f)), FM(cmp_eq)(q, FM(set1)(3.0f)));
+    FM_T sin_negative = FM(cmp_ge)(q, FM(set1)(2.0f));
+    FM_T cos_negative = FM(or)(FM(cmp_eq)(q, FM(set1)(1.0f)), FM(cmp_eq)(q, FM(set1)(2.0f)));
+    FM_T sign_bit = FM(set1)(-0.0f);
+    *out_sin = FM(xor)(FM(select)(odd, s, c), FM(and)(sin_negative, sign_bit));
+    *out_cos = FM(xor)(FM(select)(odd, c, s), FM(and)(cos_negative, sign_bit));
+}
+
+static inline FM_T FM(sin_fast)(FM_T x) {
+    FM_T s, c;
+    FM(sincos_fast)(x, &s, &c);
+    return s;
+}
+
+static inline FM_T FM(cos_fast)(FM_T x) {
+    FM_T s, c;
+    FM(sincos_fast)(x, &s, &c);
+    return c;
+}
+
+static inline FM_T FM(atan2_fast)(FM_T y, FM_T x) {
+    FM_T ax = FM(abs)(x);
+    FM_T ay = FM(abs)(y);
+    FM_T hi = FM(max)(ax, ay);
+    FM_T lo = FM(min)(ax, ay);
+    FM_T t = FM(div)(lo, hi); // in [0, 1]
+
+    // atan(t) for t > tan(pi/8) is pi/4 + atan((t-1)/(t+1))
+    FM_T big = FM(cmp_gt)(t, FM(set1)(0.414213562373095f));
+    FM_T t_reduced = FM(div)(FM(sub)(t, FM(set1)(1.0f)), FM(add)(t, FM(set1)(1.0f)));
+    t = FM(select)(big, t, t_reduced);
+    FM_T offset = FM(and)(big, FM(set1)(0.785398163397448f));
+
+    FM_T z = FM(mul)(t, t);
+    FM_T p = FM(madd)(z, FM(set1)(8.05374449538e-2f), FM(set1)(-1.38776856032e-1f));
+    p = FM(madd)(z, p, FM(set1)(1.99777106478e-1f));
+    p = FM(madd)(z, p, FM(set1)(-3.33329491539e-1f));
+    FM_T a = FM(add)(offset, FM(madd)(FM(mul)(p, z), t, t));
+
+    // unfold the octant
+    a = FM(select)(FM(cmp_gt)(ay, ax), a, FM(sub)(FM(set1)(1.57079632679489662f), a));
+    a = FM(select)(FM(cmp_lt)(x, FM(zero)()), a, FM(sub)(FM(set1)(3.14159265358979324f), a));
+    // atan2(0, +0) is 0 and atan2(0, -0) is pi like libm, not 0/0. x or 1.0 is +-1 with the sign of
+    // x, which is the only way to tell -0 from 0 with a compare.
+    FM_T x_sign_negative = FM(cmp_lt)(FM(or)(x, FM(set1)(1.0f)), FM(zero)());
+    a = FM(select)(FM(cmp_eq)(hi, FM(zero)()), a, FM(and)(x_sign_negative, FM(set1)(3.14159265358979324f)));
+    return FM(or)(a, FM(sign_bits)(y));
+}
+
+static inline FM_T FM(exp_fast)(FM_T x) {
+    x = FM(clamp)(x, FM(set1)(-87.33f), FM(set1)(88.0f));
+    FM_T n = FM(round)(FM(mul)(x, FM(set1)(1.44269504088896341f)));
+    FM_T r = FM(madd)(n, FM(set1)(-0.693359375f), x);
+    r = FM(madd)(n, FM(set1)(2.12194440e-4f), r);
+
+    FM_T p = FM(madd)(r, FM(set1)(1.9875691500e-4f), FM(set1)(1.3981999507e-3f));
+    p = FM(madd)(r, p, FM(set1)(8.3334519073e-3f));
+    p = FM(madd)(r, p, FM(set1)(4.1665795894e-2f));
+    p = FM(madd)(r, p, FM(set1)(1.6666665459e-1f));
+    p = FM(madd)(r, p, FM(set1)(5.0000001201e-1f));
+    p = FM(madd)(FM(mul)(r, r), p, FM(add)(r, FM(set1)(1.0f)));
+
+    // 2^n straight into the exponent bits
+    FM_I e = FM(to_int)(n);
+    FM_T scale = FM(from_int_bits)(FM(int_shl)(FM(int_add)(e, FM(int_set1)(127)), 23));
+    return FM(mul)(p, scale);
+}
+
+static inline FM_T FM(log_fast)(FM_T x) {
+    FM_I bits = FM(to_int_bits)(x);
+    // x = m * 2^e with m in [0.5, 1)
+    FM_T e = FM(int_to_float)(FM(int_sub)(FM(int_shr)(bits, 23), FM(int_set1)(126)));
+    FM_T m = FM(from_int_bits)(FM(int_or)(FM(int_and)(bits, FM(int_set1)(0x007fffff)), FM(int_set1)(0x3f000000)));
+
+    // shift m to [sqrt(0.5), sqrt(2)) and take 1 off so the polynomial is centered on 0
+    FM_T small = FM(cmp_lt)(m, FM(set1)(0.707106781186547524f));
+    e = FM(sub)(e, FM(and)(small, FM(set1)(1.0f)));
+    m = FM(sub)(FM(add)(m, FM(and)(small, m)), FM(set1)(1.0f));
+
+    FM_T z = FM(mul)(m, m);
+    FM_T p = FM(madd)(m, FM(set1)(7.0376836292e-2f), FM(set1)(-1.1514610310e-1f));
+    p = FM(madd)(m, p, FM(set1)(1.1676998740e-1f));
+    p = FM(madd)(m, p, FM(set1)(-1.2420140846e-1f));
+    p = FM(madd)(m, p, FM(set1)(1.4249322787e-1f));
+    p = FM(madd)(m, p, FM(set1)(-1.6668057665e-1f));
+    p = FM(madd)(m, p, FM(set1)(2.0000714765e-1f));
+    p = FM(madd)(m, p, FM(set1)(-2.4999993993e-1f));
+    p = FM(madd)(m, p, FM(set1)(3.3333331174e-1f));
+    FM_T y = FM(mul)(FM(mul)(m, z), p);
+    y = FM(madd)(e, FM(set1)(-2.12194440e-4f), y);
+    y = FM(madd)(z, FM(set1)(-0.5f), y);
+    FM_T result = FM(madd)(e, FM(set1)(0.693359375f), FM(add)(m, y));
+
+    // log(0) = -inf, log(negative) = nan, log(inf) = inf
+    FM_T inf = FM(set1)(INFINITY);
+    result = FM(select)(FM(cmp_eq)(x, inf), result, inf);
+    result = FM(select)(FM(cmp_eq)(x, FM(zero)()), result, FM(neg)(inf));
+    result = FM(select)(FM(cmp_lt)(x, FM(zero)()), result, FM(set1)(NAN));
+    result = FM(select)(FM(cmp_eq)(x, x), FM(set1)(NAN), result);
+    return result;
+}
@@ -0,0 +1,499 @@
+#include "gltf.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define GLB_MAGIC      0x46546c67 // "glTF"
+#define GLB_CHUNK_JSON 0x4e4f534a
+#define GLB_CHUNK_BIN  0x004e4942
+
+struct Gltf_Buffer_View {
+    byte *data; // null if the buffer couldn't be loaded
+    i64 length;
+    int stride; // 0 for tightly packed
+};
+
+static int gltf_component_size(int component_type) {
+    switch (component_type) {
+        case GLTF_BYTE:           return 1;
+        case GLTF_UNSIGNED_BYTE:  return 1;
+        case GLTF_SHORT:          return 2;
+        case GLTF_UNSIGNED_SHORT: return 2;
+        case GLTF_UNSIGNED_INT:   return 4;
+        case GLTF_FLOAT:          return 4;
+    }
+    return 0;
+}
+
+static int gltf_type_components(Json *json, int type) {
+    if (json_equals(json, type, "SCALAR")) return 1;
+    if (json_equals(json, type, "VEC2"))   return 2;
+    if (json_equals(json, type, "VEC3"))   return 3;
+    if (json_equals(json, type, "VEC4"))   return 4;
+    if (json_equals(json, type, "MAT2"))   return 4;
+    if (json_equals(json, type, "MAT3"))   return 9;
+    if (json_equals(json, type, "MAT4"))   return 16;
+    return 0;
+}
+
+// %XX escapes, URIs in glTF are URI-encoded
+static void percent_decode(char *str) {
+    char *out = str;
+    for (char *c = str; *c; c++) {
+        if (c[0] == '%' && c[1] && c[2]) {
+            char hex[3] = {c[1], c[2], 0};
+            char *end = nullptr;
+            long value = strtol(hex, &end, 16);
+            if (end == hex + 2) {
+                *out++ = (char)value;
+                c += 2;
+                continue;
+            }
+        }
+        *out++ = *c;
+    }
+    *out = '\0';
+}
+
+static bool gltf_uri_path(Json *json, int uri, char *directory, char *buffer, int buffer_size) {
+    int directory_length = directory ? (int)strlen(directory) + 1 : 0;
+    if (directory_length >= buffer_size) {
+        return false;
+    }
+    if (directory) {
+        memcpy(buffer, directory, directory_length - 1);
+        buffer[directory_length - 1] = '/';
+    }
+    if (json_copy_string(json, uri, buffer + directory_length, buffer_size - directory_length) < 0) {
+        return false;
+    }
+    percent_decode(buffer + directory_length);
+    return true;
+}
+
+static float json_float(Json *json, int token, float fallback) {
+    return (float)json_number(json, token, fallback);
+}
+
+// offsets and lengths, -1 for anything that can't be one so the bounds checks throw it out
+static i64 json_byte_count(Json *json, int token) {
+    double number = json_number(json, token);
+    if (!(number >= 0 && number < (double)(1ll << 53))) {
+        return -1;
+    }
+    return (i64)number;
+}
+
+// the image a textureInfo object's texture uses
+static int texture_info_image(Gltf_File *gltf, int texture_info) {
+    int texture = json_int(&gltf->json, json_find(&gltf->json, texture_info, "index"), -1);
+    if (texture < 0 || texture >= gltf->texture_images.count) {
+        return -1;
+    }
+    if (json_find(&gltf->json, texture_info, "texCoord") != -1 && json_int(&gltf->json, json_find(&gltf->json, texture_info, "texCoord")) != 0) {
+        printf("open_gltf(): textures using TEXCOORD_1 and up get TEXCOORD_0\n");
+    }
+    return gltf->texture_images[texture];
+}
+
+
+
+// chunk lengths don't have to be multiples of 4 in broken files so nothing here is assumed aligned
+static u32 read_u32(byte *data) {
+    u32 result;
+    memcpy(&result, data, sizeof(result));
+    return result;
+}
+
+static bool read_glb(Mapped_File *file, char **out_json, i64 *out_json_length, byte **out_bin, i64 *out_bin_length) {
+    *out_bin = nullptr;
+    *out_bin_length = 0;
+    if (file->size < 20 || read_u32(file->data + 4) != 2 || read_u32(file->data + 8) > file->size) {
+        return false;
+    }
+    i64 length = read_u32(file->data + 8);
+    i64 offset = 12;
+    u32 json_length = read_u32(file->data + offset);
+    u32 json_type = read_u32(file->data + offset + 4);
+    if (json_type != GLB_CHUNK_JSON || offset + 8 + json_length > length) {
+        return false;
+    }
+    *out_json = (char *)file->data + offset + 8;
+    *out_json_length = json_length;
+    offset += 8 + json_length;
+    if (offset + 8 <= length) {
+        u32 bin_length = read_u32(file->data + offset);
+        u32 bin_type = read_u32(file->data + offset + 4);
+        if (bin_type == GLB_CHUNK_BIN && offset + 8 + bin_length <= length) {
+            *out_bin = file->data + offset + 8;
+            *out_bin_length = bin_length;
+        }
+    }
+    return true;
+}
+
+bool open_gltf(char *filename, Allocator allocator, Gltf_File *out_gltf) {
+    *out_gltf = {};
+    Gltf_File gltf = {};
+    if (!map_entire_file(filename, &gltf.file)) {
+        printf("open_gltf(): couldn't open %s\n", filename);
+        return false;
+    }
+
+    char *json_text = (char *)gltf.file.data;
+    i64 json_length = gltf.file.size;
+    byte *glb_bin = nullptr;
+    i64 glb_bin_length = 0;
+    if (gltf.file.size >= 4 && read_u32(gltf.file.data) == GLB_MAGIC) {
+        if (!read_glb(&gltf.file, &json_text, &json_length, &glb_bin, &glb_bin_length)) {
+            printf("open_gltf(): %s isn't a valid .glb\n", filename);
+            unmap_file(&gltf.file);
+            return false;
+        }
+    }
+    if (!parse_json(json_text, json_length, allocator, &gltf.json)) {
+        printf("open_gltf(): %s has broken JSON\n", filename);
+        unmap_file(&gltf.file);
+        return false;
+    }
+    Json *json = &gltf.json;
+    int root = 0;
+    if (json->tokens[root].type != JSON_OBJECT) {
+        printf("open_gltf(): %s isn't a glTF file\n", filename);
+        destroy_json(json);
+        unmap_file(&gltf.file);
+        return false;
+    }
+
+    char *directory = path_directory(filename, allocator);
+    defer(if (directory) free(allocator, directory));
+
+    // buffers
+    int buffers = json_find(json, root, "buffers");
+    gltf.buffer_files = make_array<Mapped_File>(allocator, 4);
+    gltf.buffers = make_array<byte *>(allocator, 4);
+    gltf.buffer_sizes = make_array<i64>(allocator, 4);
+    for (int buffer = json_first_child(json, buffers); buffer != -1; buffer = json_next_sibling(json, buffers, buffer)) {
+        i64 byte_length = json_byte_count(json, json_find(json, buffer, "byteLength"));
+        int uri = json_find(json, buffer, "uri");
+        byte *data = nullptr;
+        i64 size = 0;
+        if (uri == -1) {
+            data = glb_bin;
+            size = glb_bin_length;
+        }
+        else {
+            char path[1024] = {};
+            Mapped_File buffer_file = {};
+            if (json->tokens[uri].length >= 5 && memcmp(json->text + json->tokens[uri].start, "data:", 5) == 0) {
+                printf("open_gltf(): %s has a data: URI buffer, those aren't supported\n", filename);
+            }
+            else if (!gltf_uri_path(json, uri, directory, path, sizeof(path)) || !map_entire_file(path, &buffer_file)) {
+                printf("open_gltf(): couldn't open buffer %s\n", path);
+            }
+            else {
+                gltf.buffer_files.append(buffer_file);
+                data = buffer_file.data;
+                size = buffer_file.size;
+            }
+        }
+        if (data && size < byte_length) {
+            printf("open_gltf(): buffer %d of %s is %lld bytes, it should be %lld\n", gltf.buffers.count, filename, (long long)size, (long long)byte_length);
+            data = nullptr;
+        }
+        gltf.buffers.append(data);
+        gltf.buffer_sizes.append(data ? byte_length : 0);
+    }
+
+    // buffer views
+    int buffer_views = json_find(json, root, "bufferViews");
+    Array<Gltf_Buffer_View> views = make_array<Gltf_Buffer_View>(allocator, 16);
+    defer(views.destroy());
+    for (int view = json_first_child(json, buffer_views); view != -1; view = json_next_sibling(json, buffer_views, view)) {
+        int buffer = json_int(json, json_find(json, view, "buffer"), -1);
+        i64 offset = json_byte_count(json, json_find(json, view, "byteOffset"));
+        i64 length = json_byte_count(json, json_find(json, view, "byteLength"));
+        Gltf_Buffer_View result = {};
+        result.stride = json_int(json, json_find(json, view, "byteStride"));
+        if (buffer >= 0 && buffer < gltf.buffers.count && gltf.buffers[buffer] && offset >= 0 && length >= 0 && offset + length <= gltf.buffer_sizes[buffer]) {
+            result.data = gltf.buffers[buffer] + offset;
+            result.length = length;
+        }
+        views.append(result);
+    }
+
+    // accessors
+    int accessors = json_find(json, root, "accessors");
+    gltf.accessors = make_array<Gltf_Accessor>(allocator, 16);
+    for (int accessor = json_first_child(json, accessors); accessor != -1; accessor = json_next_sibling(json, accessors, accessor)) {
+        Gltf_Accessor result = {};
+        result.count = json_int(json, json_find(json, accessor, "count"));
+        result.component_type = json_int(json, json_find(json, accessor, "componentType"));
+        result.num_components = gltf_type_components(json, json_find(json, accessor, "type"));
+        result.normalized = json_bool(json, json_find(json, accessor, "normalized"));
+        int view = json_int(json, json_find(json, accessor, "bufferView"), -1);
+        i64 offset = json_byte_count(json, json_find(json, accessor, "byteOffset"));
+        int element_size = gltf_component_size(result.component_type) * result.num_components;
+        if (json_find(json, accessor, "sparse") != -1) {
+            printf("open_gltf(): accessor %d of %s is sparse, those aren't supported\n", gltf.accessors.count, filename);
+        }
+        else if (view >= 0 && view < views.count && views[view].data && element_size > 0 && result.count > 0) {
+            result.stride = views[view].stride ? views[view].stride : element_size;
+            if (offset >= 0 && offset + (i64)result.stride * (result.count - 1) + element_size <= views[view].length) {
+                result.data = views[view].data + offset;
+            }
+        }
+        if (result.data == nullptr && view != -1) {
+            printf("open_gltf(): accessor %d of %s can't be read\n", gltf.accessors.count, filename);
+        }
+        gltf.accessors.append(result);
+    }
+
+    // images and textures
+    int images = json_find(json, root, "images");
+    gltf.image_uris = make_array<int>(allocator, 16);
+    for (int image = json_first_child(json, images); image != -1; image = json_next_sibling(json, images, image)) {
+        int uri = json_find(json, image, "uri");
+        if (uri != -1 && json->tokens[uri].length >= 5 && memcmp(json->text + json->tokens[uri].start, "data:", 5) == 0) {
+            uri = -1;
+        }
+        gltf.image_uris.append(uri);
+    }
+    int textures = json_find(json, root, "textures");
+    gltf.texture_images = make_array<int>(allocator, 16);
+    for (int texture = json_first_child(json, textures); texture != -1; texture = json_next_sibling(json, textures, texture)) {
+        int image = json_int(json, json_find(json, texture, "source"), -1);
+        gltf.texture_images.append(image >= 0 && image < gltf.image_uris.count ? image : -1);
+    }
+
+    // materials
+    int materials = json_find(json, root, "materials");
+    gltf.materials = make_array<Gltf_Material>(allocator, 16);
+    for (int material = json_first_child(json, materials); material != -1; material = json_next_sibling(json, materials, material)) {
+        Gltf_Material result = {};
+        int pbr = json_find(json, material, "pbrMetallicRoughness");
+        int base_color_factor = json_find(json, pbr, "baseColorFactor");
+        for (int i = 0; i < 4; i++) {
+            result.base_color_factor[i] = json_float(json, json_index(json, base_color_factor, i), 1);
+        }
+        result.metallic_factor = json_float(json, json_find(json, pbr, "metallicFactor"), 1);
+        result.roughness_factor = json_float(json, json_find(json, pbr, "roughnessFactor"), 1);
+        int emissive_factor = json_find(json, material, "emissiveFactor");
+        for (int i = 0; i < 3; i++) {
+            result.emissive_factor[i] = json_float(json, json_index(json, emissive_factor, i), 0);
+        }
+        result.alpha_cutoff = json_float(json, json_find(json, material, "alphaCutoff"), 0.5f);
+        int alpha_mode = json_find(json, material, "alphaMode");
+        result.alpha_mode = json_equals(json, alpha_mode, "MASK") ? GLTF_ALPHA_MASK : (json_equals(json, alpha_mode, "BLEND") ? GLTF_ALPHA_BLEND : GLTF_ALPHA_OPAQUE);
+        result.double_sided = json_bool(json, json_find(json, material, "doubleSided"));
+        result.base_color_image = texture_info_image(&gltf, json_find(json, pbr, "baseColorTexture"));
+        result.metallic_roughness_image = texture_info_image(&gltf, json_find(json, pbr, "metallicRoughnessTexture"));
+        result.normal_image = texture_info_image(&gltf, json_find(json, material, "normalTexture"));
+        result.occlusion_image = texture_info_image(&gltf, json_find(json, material, "occlusionTexture"));
+        result.emissive_image = texture_info_image(&gltf, json_find(json, material, "emissiveTexture"));
+        gltf.materials.append(result);
+    }
+
+    // meshes
+    static const char *ATTRIBUTE_NAMES[GLTF_ATTRIBUTE_COUNT] = {"POSITION", "NORMAL", "TANGENT", "TEXCOORD_0", "COLOR_0"};
+    int meshes = json_find(json, root, "meshes");
+    gltf.meshes = make_array<Gltf_Mesh>(allocator, 16);
+    gltf.primitives = make_array<Gltf_Primitive>(allocator, 16);
+    for (int mesh = json_first_child(json, meshes); mesh != -1; mesh = json_next_sibling(json, meshes, mesh)) {
+        Gltf_Mesh result = {};
+        if (json_copy_string(json, json_find(json, mesh, "name"), result.name, sizeof(result.name)) < 0) {
+            snprintf(result.name, sizeof(result.name), "mesh %d", gltf.meshes.count);
+        }
+        result.first_primitive = gltf.primitives.count;
+        int primitives = json_find(json, mesh, "primitives");
+        for (int primitive = json_first_child(json, primitives); primitive != -1; primitive = json_next_sibling(json, primitives, primitive)) {
+            Gltf_Primitive prim = {};
+            int attributes = json_find(json, primitive, "attributes");
+            for (int i = 0; i < GLTF_ATTRIBUTE_COUNT; i++) {
+                int accessor = json_int(json, json_find(json, attributes, ATTRIBUTE_NAMES[i]), -1);
+                prim.attributes[i] = accessor >= 0 && accessor < gltf.accessors.count ? accessor : -1;
+            }
+            int indices = json_int(json, json_find(json, primitive, "indices"), -1);
+            prim.indices = indices >= 0 && indices < gltf.accessors.count ? indices : -1;
+            int material = json_int(json, json_find(json, primitive, "material"), -1);
+            prim.material = material >= 0 && material < gltf.materials.count ? material : -1;
+            prim.mode = json_int(json, json_find(json, primitive, "mode"), GLTF_MODE_TRIANGLES);
+            gltf.primitives.append(prim);
+        }
+        result.num_primitives = gltf.primitives.count - result.first_primitive;
+        gltf.meshes.append(result);
+    }
+
+    // nodes
+    int nodes = json_find(json, root, "nodes");
+    gltf.nodes = make_array<Gltf_Node>(allocator, 16);
+    gltf.node_children = make_array<int>(allocator, 16);
+    int num_nodes = nodes == -1 ? 0 : (int)json->tokens[nodes].count;
+    for (int node = json_first_child(json, nodes); node != -1; node = json_next_sibling(json, nodes, node)) {
+        Gltf_Node result = {};
+        int matrix = json_find(json, node, "matrix");
+        if (matrix != -1) {
+            // column major in both
+            int element = json_first_child(json, matrix);
+            for (int i = 0; i < 16; i++) {
+                result.local_transform.elements[i / 4][i % 4] = json_float(json, element, i % 5 == 0 ? 1 : 0);
+                if (element != -1) element = json_next_sibling(json, matrix, element);
+            }
+        }
+        else {
+            int translation = json_find(json, node, "translation");
+            int rotation = json_find(json, node, "rotation");
+            int scale = json_find(json, node, "scale");
+            Vector3 t = v3(json_float(json, json_index(json, translation, 0), 0), json_float(json, json_index(json, translation, 1), 0), json_float(json, json_index(json, translation, 2), 0));
+            Quaternion r = quaternion(json_float(json, json_index(json, rotation, 0), 0), json_float(json, json_index(json, rotation, 1), 0), json_float(json, json_index(json, rotation, 2), 0), json_float(json, json_index(json, rotation, 3), 1));
+            Vector3 s = v3(json_float(json, json_index(json, scale, 0), 1), json_float(json, json_index(json, scale, 1), 1), json_float(json, json_index(json, scale, 2), 1));
+            result.local_transform = construct_trs_matrix(t, r, s);
+        }
+        int mesh = json_int(json, json_find(json, node, "mesh"), -1);
+        result.mesh = mesh >= 0 && mesh < gltf.meshes.count ? mesh : -1;
+        result.first_child = gltf.node_children.count;
+        int children = json_find(json, node, "children");
+        for (int child = json_first_child(json, children); child != -1; child = json_next_sibling(json, children, child)) {
+            int index = json_int(json, child, -1);
+            if (index >= 0 && index < num_nodes) {
+                gltf.node_children.append(index);
+            }
+        }
+        result.num_children = gltf.node_children.count - result.first_child;
+        gltf.nodes.append(result);
+    }
+
+    // the default scene, or every node nothing else has as a child if there isn't one
+    gltf.scene_nodes = make_array<int>(allocator, 16);
+    int scenes = json_find(json, root, "scenes");
+    int scene = json_index(json, scenes, json_int(json, json_find(json, root, "scene"), 0));
+    if (scene != -1) {
+        int scene_nodes = json_find(json, scene, "nodes");
+        for (int node = json_first_child(json, scene_nodes); node != -1; node = json_next_sibling(json, scene_nodes, node)) {
+            int index = json_int(json, node, -1);
+            if (index >= 0 && index < gltf.nodes.count) {
+                gltf.scene_nodes.append(index);
+            }
+        }
+    }
+    else {
+        Array<bool> is_child = make_array<bool>(allocator, gltf.nodes.count > 0 ? gltf.nodes.count : 1);
+        defer(is_child.destroy());
+        For (i, gltf.nodes) {
+            is_child.append(false);
+        }
+        Foreach (child, gltf.node_children) {
+            is_child[*child] = true;
+        }
+        For (i, gltf.nodes) {
+            if (!is_child[i]) gltf.scene_nodes.append(i);
+        }
+    }
+
+    *out_gltf = gltf;
+    return true;
+}
+
+void close_gltf(Gltf_File *gltf) {
+    Foreach (file, gltf->buffer_files) {
+        unmap_file(file);
+    }
+    gltf->buffer_files.destroy();
+    gltf->buffers.destroy();
+    gltf->buffer_sizes.destroy();
+    gltf->accessors.destroy();
+    gltf->meshes.destroy();
+    gltf->primitives.destroy();
+    gltf->materials.destroy();
+    gltf->texture_images.destroy();
+    gltf->image_uris.destroy();
+    gltf->nodes.destroy();
+    gltf->node_children.destroy();
+    gltf->scene_nodes.destroy();
+    destroy_json(&gltf->json);
+    unmap_file(&gltf->file);
+    *gltf = {};
+}
+
+bool gltf_image_path(Gltf_File *gltf, int image, char *buffer, int buffer_size) {
+    if (image < 0 || image >= gltf->image_uris.count || gltf->image_uris[image] == -1) {
+        return false;
+    }
+    return gltf_uri_path(&gltf->json, gltf->image_uris[image], nullptr, buffer, buffer_size);
+}
+
+
+
+void gltf_read_floats(Gltf_Accessor *accessor, void *out, int num_components, int out_stride) {
+    int components = accessor->num_components < num_components ? accessor->num_components : num_components;
+    if (accessor->data == nullptr) {
+        return;
+    }
+    if (accessor->component_type == GLTF_FLOAT) {
+        for (int i = 0; i < accessor->count; i++) {
+            memcpy((byte *)out + (i64)i * out_stride, accessor->data + (i64)i * accessor->stride, sizeof(float) * components);
+        }
+        return;
+    }
+
+    // note(josh): normalized signed values clamp at -1 since the smallest value has no positive partner
+    for (int i = 0; i < accessor->count; i++) {
+        byte *element = accessor->data + (i64)i * accessor->stride;
+        float *result = (float *)((byte *)out + (i64)i * out_stride);
+        for (int c = 0; c < components; c++) {
+            float value = 0;
+            switch (accessor->component_type) {
+                case GLTF_BYTE:           { signed char v = ((signed char *)element)[c]; value = accessor->normalized ? (v / 127.0f   < -1 ? -1 : v / 127.0f)   : v; break; }
+                case GLTF_UNSIGNED_BYTE:  { u8 v = ((u8 *)element)[c];   value = accessor->normalized ? v / 255.0f   : v; break; }
+                case GLTF_SHORT:          { i16 v; memcpy(&v, element + c * 2, 2); value = accessor->normalized ? (v / 32767.0f < -1 ? -1 : v / 32767.0f) : v; break; }
+                case GLTF_UNSIGNED_SHORT: { u16 v; memcpy(&v, element + c * 2, 2); value = accessor->normalized ? v / 65535.0f : v; break; }
+                case GLTF_UNSIGNED_INT:   { u32 v; memcpy(&v, element + c * 4, 4); value = (float)v; break; }
+            }
+            result[c] = value;
+        }
+    }
+}
+
+void gltf_read_indices(Gltf_Accessor *accessor, u32 *out) {
+    if (accessor->data == nullptr) {
+        return;
+    }
+    switch (accessor->component_type) {
+        case GLTF_UNSIGNED_BYTE: {
+            for (int i = 0; i < accessor->count; i++) out[i] = accessor->data[(i64)i * accessor->stride];
+            break;
+        }
+        case GLTF_UNSIGNED_SHORT: {
+            for (int i = 0; i < accessor->count; i++) { u16 v; memcpy(&v, accessor->data + (i64)i * accessor->stride, 2); out[i] = v; }
+            break;
+        }
+        case GLTF_UNSIGNED_INT: {
+            for (int i = 0; i < accessor->count; i++) memcpy(&out[i], accessor->data + (i64)i * accessor->stride, 4);
+            break;
+        }
+    }
+}
+
+// note(josh): glTF says the node graph is a forest but nothing stops a file from having a cycle, the
+// depth limit keeps that from recursing forever
+#define GLTF_MAX_NODE_DEPTH 256
+
+static void append_node_instances(Gltf_File *gltf, int node_index, Matrix4 parent_transform, int depth, Array<Gltf_Mesh_Instance> *out_instances) {
+    if (depth >= GLTF_MAX_NODE_DEPTH) {
+        return;
+    }
+    Gltf_Node *node = &gltf->nodes[node_index];
+    Matrix4 transform = parent_transform * node->local_transform;
+    if (node->mesh != -1) {
+        out_instances->append({node->mesh, transform});
+    }
+    for (int i = 0; i < node->num_children; i++) {
+        append_node_instances(gltf, gltf->node_children[node->first_child + i], transform, depth + 1, out_instances);
+    }
+}
+
+void gltf_mesh_instances(Gltf_File *gltf, Array<Gltf_Mesh_Instance> *out_instances) {
+    Foreach (node, gltf->scene_nodes) {
+        append_node_instances(gltf, *node, m4_identity(), 0, out_instances);
+    }
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "basic.h"
+#include "math.h"
+#include "json.h"
+
+//
+// glTF 2.0 reader, both .gltf with external .bin buffers and .glb.
+//
+// The file and its buffers are mapped, not read, and accessors point straight into the mappings, so
+// opening a file is tokenizing the JSON and filling in the tables below. Vertex data is only touched
+// when gltf_read_floats()/gltf_read_indices() copy it out. Everything here only lives as long as the
+// Gltf_File.
+//
+// Not supported: sparse accessors, data: URIs, images embedded in buffers, extensions and
+// everything to do with animation and skinning. Those parts are skipped with a message and the
+// rest of the file still loads.
+//
+
+enum Gltf_Attribute {
+    GLTF_POSITION,
+    GLTF_NORMAL,
+    GLTF_TANGENT,
+    GLTF_TEXCOORD_0,
+    GLTF_COLOR_0,
+
+    GLTF_ATTRIBUTE_COUNT,
+};
+
+#define GLTF_BYTE           5120
+#define GLTF_UNSIGNED_BYTE  5121
+#define GLTF_SHORT          5122
+#define GLTF_UNSIGNED_SHORT 5123
+#define GLTF_UNSIGNED_INT   5125
+#define GLTF_FLOAT          5126
+
+#define GLTF_MODE_TRIANGLES      4
+#define GLTF_MODE_TRIANGLE_STRIP 5
+#define GLTF_MODE_TRIANGLE_FAN   6
+
+struct Gltf_Accessor {
+    byte *data;          // first element, inside one of the mappings. null if the accessor can't be read.
+    int stride;          // bytes between elements
+    int count;
+    int component_type;  // GLTF_FLOAT etc.
+    int num_components;  // 1 for SCALAR up to 16 for MAT4
+    bool normalized;
+};
+
+struct Gltf_Primitive {
+    int attributes[GLTF_ATTRIBUTE_COUNT]; // accessor indices, -1 if missing
+    int indices;                          // -1 if not indexed
+    int material;                         // -1 for the default material
+    int mode;
+};
+
+struct Gltf_Mesh {
+    int first_primitive;
+    int num_primitives;
+    char name[64];
+};
+
+enum Gltf_Alpha_Mode {
+    GLTF_ALPHA_OPAQUE,
+    GLTF_ALPHA_MASK,
+    GLTF_ALPHA_BLEND,
+};
+
+// Texture references are image indices, -1 for none.
+struct Gltf_Material {
+    float base_color_factor[4];
+    float metallic_factor;
+    float roughness_factor;
+    float emissive_factor[3];
+    float alpha_cutoff;
+    Gltf_Alpha_Mode alpha_mode;
+    bool double_sided;
+    int base_color_image;
+    int metallic_roughness_image; // roughness in G, metalness in B
+    int normal_image;
+    int occlusion_image;          // R
+    int emissive_image;
+};
+
+struct Gltf_Node {
+    Matrix4 local_transform;
+    int mesh;           // -1 if none
+    int first_child;    // into Gltf_File.node_children
+    int num_children;
+};
+
+struct Gltf_File {
+    Mapped_File file;
+    Array<Mapped_File> buffer_files; // external .bin files, unmapped by close_gltf()
+    Array<byte *> buffers;           // start of each buffer, in file or one of buffer_files
+    Array<i64> buffer_sizes;
+    Json json;
+
+    Array<Gltf_Accessor> accessors;
+    Array<Gltf_Mesh> meshes;
+    Array<Gltf_Primitive> primitives;
+    Array<Gltf_Material> materials;
+    Array<int> texture_images; // image of each texture
+    Array<int> image_uris;     // json string token of each image's uri, -1 if it's embedded
+    Array<Gltf_Node> nodes;
+    Array<int> node_children;
+    Array<int> scene_nodes;    // roots of the default scene
+};
+
+// Prints what's wrong and returns false if the file can't be used at all.
+bool open_gltf(char *filename, Allocator allocator, Gltf_File *out_gltf);
+void close_gltf(Gltf_File *gltf);
+
+// The image's path relative to the glTF's directory, with escapes and %XX decoded. Returns false for
+// embedded images.
+bool gltf_image_path(Gltf_File *gltf, int image, char *buffer, int buffer_size);
+
+// Converts accessor to num_components floats per element, out_stride bytes apart, normalizing
+// integer components the way the spec says when the accessor is normalized. Components the
+// accessor doesn't have are left alone.
+void gltf_read_floats(Gltf_Accessor *accessor, void *out, int num_components, int out_stride);
+// Any of the three index types as u32s.
+void gltf_read_indices(Gltf_Accessor *accessor, u32 *out);
+
+// Every node with a mesh in the default scene, with its transform baked down the hierarchy.
+struct Gltf_Mesh_Instance {
+    int mesh;
+    Matrix4 transform;
+};
+void gltf_mesh_instances(Gltf_File *gltf, Array<Gltf_Mesh_Instance> *out_instances);
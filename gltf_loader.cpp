@@ -0,0 +1,458 @@
+#include "application.h"
+#include "renderer.h"
+#include "gltf.h"
+#include "cooked_texture.h"
+
+//
+// glTF/GLB straight into Imported_Meshes without assimp. The output matches what assimp_loader.cpp
+// makes of the same file with PreTransformVertices | Triangulate | GenSmoothNormals | FlipUVs: one
+// mesh per primitive per node with the node's transform baked in, UVs as they are in the file (the
+// importer's flip and FlipUVs cancel out) and smooth normals where the file has none.
+//
+
+// note(josh): glTF wants flat normals for primitives without any but assimp's GenSmoothNormals makes
+// smooth ones, this matches assimp so a model looks the same either way
+static void generate_smooth_normals(Array<Vertex> *vertices, Array<u32> *indices) {
+    Foreach (vertex, *vertices) {
+        vertex->normal = v3(0, 0, 0);
+    }
+    for (int i = 0; i + 2 < indices->count; i += 3) {
+        Vertex *a = &(*vertices)[(*indices)[i]];
+        Vertex *b = &(*vertices)[(*indices)[i+1]];
+        Vertex *c = &(*vertices)[(*indices)[i+2]];
+        // not normalized, bigger triangles count for more
+        Vector3 face_normal = cross(b->position - a->position, c->position - a->position);
+        a->normal += face_normal;
+        b->normal += face_normal;
+        c->normal += face_normal;
+    }
+    Foreach (vertex, *vertices) {
+        if (sqr_length(vertex->normal) > 0) {
+            vertex->normal = normalize(vertex->normal);
+        }
+    }
+}
+
+// strips and fans as lists, anything else is skipped
+static bool triangulate_gltf_indices(int mode, Array<u32> *indices, Array<u32> *scratch) {
+    if (mode == GLTF_MODE_TRIANGLES) {
+        indices->count -= indices->count % 3;
+        return true;
+    }
+    if (mode != GLTF_MODE_TRIANGLE_STRIP && mode != GLTF_MODE_TRIANGLE_FAN) {
+        return false;
+    }
+    scratch->clear();
+    for (int i = 2; i < indices->count; i++) {
+        u32 a = (*indices)[i-2];
+        u32 b = (*indices)[i-1];
+        u32 c = (*indices)[i];
+        if (mode == GLTF_MODE_TRIANGLE_FAN) {
+            a = (*indices)[0];
+        }
+        else if (i % 2 == 1) {
+            // every other strip triangle is wound the other way
+            u32 temp = a;
+            a = b;
+            b = temp;
+        }
+        scratch->append(a);
+        scratch->append(b);
+        scratch->append(c);
+    }
+    indices->clear();
+    indices->reserve(scratch->count);
+    memcpy(indices->data, scratch->data, sizeof(u32) * scratch->count);
+    indices->count = scratch->count;
+    return true;
+}
+
+// attributes with a different count than POSITION are broken, those are dropped
+static Gltf_Accessor *get_gltf_attribute(Gltf_File *gltf, Gltf_Primitive *primitive, Gltf_Attribute attribute, int num_vertices) {
+    if (primitive->attributes[attribute] == -1) {
+        return nullptr;
+    }
+    Gltf_Accessor *accessor = &gltf->accessors[primitive->attributes[attribute]];
+    if (accessor->data == nullptr || accessor->count != num_vertices) {
+        return nullptr;
+    }
+    return accessor;
+}
+
+static bool import_gltf_primitive(Gltf_File *gltf, Gltf_Mesh *mesh, Gltf_Primitive *primitive, Matrix4 transform, Array<Vector4> *tangents, Array<u32> *scratch_indices, Imported_Mesh *out_mesh) {
+    Gltf_Accessor *positions = primitive->attributes[GLTF_POSITION] != -1 ? &gltf->accessors[primitive->attributes[GLTF_POSITION]] : nullptr;
+    if (positions == nullptr || positions->data == nullptr) {
+        printf("%s: primitive has no positions, skipping it\n", mesh->name);
+        return false;
+    }
+    int num_vertices = positions->count;
+    Gltf_Accessor *normals    = get_gltf_attribute(gltf, primitive, GLTF_NORMAL,     num_vertices);
+    Gltf_Accessor *tex_coords = get_gltf_attribute(gltf, primitive, GLTF_TEXCOORD_0, num_vertices);
+    Gltf_Accessor *colors     = get_gltf_attribute(gltf, primitive, GLTF_COLOR_0,    num_vertices);
+    Gltf_Accessor *tangent_accessor = normals ? get_gltf_attribute(gltf, primitive, GLTF_TANGENT, num_vertices) : nullptr;
+
+    Array<u32> &indices = out_mesh->indices;
+    if (primitive->indices != -1) {
+        Gltf_Accessor *index_accessor = &gltf->accessors[primitive->indices];
+        // note(josh): data is null when the accessor failed validation, drawing the vertices unindexed instead would be garbage
+        if (index_accessor->data == nullptr) {
+            printf("%s: primitive's index accessor is invalid, skipping it\n", mesh->name);
+            return false;
+        }
+        indices.reserve(index_accessor->count);
+        gltf_read_indices(index_accessor, indices.data);
+        indices.count = index_accessor->count;
+    }
+    else {
+        indices.reserve(num_vertices);
+        for (int i = 0; i < num_vertices; i++) {
+            indices.append((u32)i);
+        }
+    }
+    if (!triangulate_gltf_indices(primitive->mode, &indices, scratch_indices)) {
+        printf("%s: skipping a primitive with mode %d, only triangles are supported\n", mesh->name, primitive->mode);
+        return false;
+    }
+    Foreach (index, indices) {
+        if (*index >= (u32)num_vertices) {
+            printf("%s: primitive has an index past the end of its vertices, skipping it\n", mesh->name);
+            return false;
+        }
+    }
+
+    Array<Vertex> &vertices = out_mesh->vertices;
+    vertices.reserve(num_vertices);
+    vertices.count = num_vertices;
+    Foreach (vertex, vertices) {
+        *vertex = {};
+        vertex->color = v4(1, 1, 1, 1);
+    }
+    gltf_read_floats(positions, &vertices[0].position, 3, sizeof(Vertex));
+    if (normals)    gltf_read_floats(normals,    &vertices[0].normal,    3, sizeof(Vertex));
+    if (tex_coords) gltf_read_floats(tex_coords, &vertices[0].tex_coord, 2, sizeof(Vertex));
+    if (colors)     gltf_read_floats(colors,     &vertices[0].color,     4, sizeof(Vertex));
+    if (tangent_accessor) {
+        tangents->reserve(num_vertices);
+        tangents->count = num_vertices;
+        gltf_read_floats(tangent_accessor, tangents->data, 4, sizeof(Vector4));
+    }
+
+    Matrix4 normal_transform = matrix4_inverse_transpose(transform);
+    // a mirroring transform turns the triangles inside out and flips the handedness of the tangent frame
+    bool mirrored = matrix4_determinant(transform) < 0;
+    For (i, vertices) {
+        Vertex *vertex = &vertices[i];
+        Vector4 position = transform * v4(vertex->position.x, vertex->position.y, vertex->position.z, 1);
+        vertex->position = v3(position.x, position.y, position.z);
+        if (normals) {
+            Vector4 normal = normal_transform * v4(vertex->normal.x, vertex->normal.y, vertex->normal.z, 0);
+            vertex->normal = v3(normal.x, normal.y, normal.z);
+            if (sqr_length(vertex->normal) > 0) {
+                vertex->normal = normalize(vertex->normal);
+            }
+        }
+        if (tangent_accessor) {
+            Vector4 file_tangent = (*tangents)[i];
+            Vector4 tangent = transform * v4(file_tangent.x, file_tangent.y, file_tangent.z, 0);
+            vertex->tangent = v3(tangent.x, tangent.y, tangent.z);
+            if (sqr_length(vertex->tangent) > 0) {
+                vertex->tangent = normalize(vertex->tangent);
+            }
+            float handedness = (file_tangent.w < 0) != mirrored ? -1.0f : 1.0f;
+            vertex->bitangent = cross(vertex->normal, vertex->tangent) * handedness;
+        }
+    }
+
+    if (mirrored) {
+        for (int i = 0; i + 2 < indices.count; i += 3) {
+            u32 temp = indices[i+1];
+            indices[i+1] = indices[i+2];
+            indices[i+2] = temp;
+        }
+    }
+
+    // note(josh): same as import_mesh(), welding goes before the tangents so split copies of a vertex
+    // end up with the same tangent. it goes before the normals too so unindexed primitives get
+    // smooth ones.
+    weld_vertices(&vertices, &indices);
+    if (!normals) {
+        generate_smooth_normals(&vertices, &indices);
+    }
+
+    out_mesh->has_tangents = tangent_accessor != nullptr;
+    out_mesh->has_vertex_colors = colors != nullptr;
+    out_mesh->material = primitive->material;
+    out_mesh->name = mesh->name;
+    return true;
+}
+
+// Every primitive of every mesh instance in the default scene, with tangents and optimization done.
+Array<Imported_Mesh> import_gltf_meshes(Gltf_File *gltf, Allocator allocator, Mesh_Optimization_Report *report, int *out_num_source_vertices) {
+    Array<Gltf_Mesh_Instance> instances = make_array<Gltf_Mesh_Instance>(allocator, gltf->nodes.count > 0 ? gltf->nodes.count : 1);
+    defer(instances.destroy());
+    gltf_mesh_instances(gltf, &instances);
+
+    Array<Vector4> tangents = make_array<Vector4>(allocator, 1024);
+    defer(tangents.destroy());
+    Array<u32> scratch_indices = make_array<u32>(allocator, 1024);
+    defer(scratch_indices.destroy());
+
+    *out_num_source_vertices = 0;
+    Array<Imported_Mesh> meshes = make_array<Imported_Mesh>(allocator, gltf->primitives.count > 0 ? gltf->primitives.count : 1);
+    Foreach (instance, instances) {
+        Gltf_Mesh *mesh = &gltf->meshes[instance->mesh];
+        for (int i = 0; i < mesh->num_primitives; i++) {
+            Gltf_Primitive *primitive = &gltf->primitives[mesh->first_primitive + i];
+            int num_vertices = primitive->attributes[GLTF_POSITION] != -1 ? gltf->accessors[primitive->attributes[GLTF_POSITION]].count : 0;
+            Imported_Mesh imported = make_imported_mesh(allocator, num_vertices, num_vertices);
+            if (!import_gltf_primitive(gltf, mesh, primitive, instance->transform, &tangents, &scratch_indices, &imported)) {
+                imported.vertices.destroy();
+                imported.indices.destroy();
+                continue;
+            }
+            *out_num_source_vertices += num_vertices;
+            meshes.append(imported);
+        }
+    }
+    finish_imported_meshes(&meshes, allocator, report);
+    return meshes;
+}
+
+// note(josh): the paths are allocated, free them with free_gltf_materials()
+static void import_gltf_material(Gltf_File *gltf, Gltf_Material *material, Allocator allocator, Imported_Material *out_material) {
+    *out_material = {};
+    struct { int image; Material_Map map; bool srgb; } maps[] = {
+        {material->base_color_image, MM_ALBEDO,   true},
+        {material->normal_image,     MM_NORMAL,   false},
+        {material->emissive_image,   MM_EMISSION, false},
+        {material->occlusion_image,  MM_AO,       false},
+    };
+    // todo(josh): metallic_roughness_image has roughness in G and metalness in B, pixel.hlsl would need
+    // to read those channels out of one texture. assimp doesn't hand it to us either.
+    for (int i = 0; i < ARRAYSIZE(maps); i++) {
+        char path[1024];
+        if (maps[i].image == -1) {
+            continue;
+        }
+        if (!gltf_image_path(gltf, maps[i].image, path, sizeof(path))) {
+            printf("Unhandled: image %d is embedded in the file\n", maps[i].image);
+            continue;
+        }
+        int length = (int)strlen(path);
+        char *copy = (char *)alloc(allocator, length + 1);
+        memcpy(copy, path, length + 1);
+        set_imported_texture(out_material, maps[i].map, copy, maps[i].srgb);
+    }
+    // note(josh): assimp gives the first component of baseColorFactor as the ambient, same here
+    out_material->ambient = material->base_color_factor[0];
+    out_material->metallic = material->metallic_factor;
+    out_material->roughness = material->roughness_factor;
+    out_material->has_transparency = material->alpha_mode != GLTF_ALPHA_OPAQUE;
+}
+
+static Array<Imported_Material> import_gltf_materials(Gltf_File *gltf, Allocator allocator) {
+    Array<Imported_Material> materials = make_array<Imported_Material>(allocator, gltf->materials.count > 0 ? gltf->materials.count : 1);
+    Foreach (material, gltf->materials) {
+        Imported_Material imported;
+        import_gltf_material(gltf, material, allocator, &imported);
+        materials.append(imported);
+    }
+    return materials;
+}
+
+static void free_gltf_materials(Array<Imported_Material> materials, Allocator allocator) {
+    Foreach (material, materials) {
+        for (int map = 0; map < MM_COUNT; map++) {
+            if (material->texture_paths[map]) free(allocator, material->texture_paths[map]);
+        }
+    }
+    materials.destroy();
+}
+
+
+
+Model load_model_gltf(char *filename, Allocator allocator, Texture_Cache *texture_cache, Vertex_Layout layout = VL_FULL) {
+    Gltf_File gltf;
+    bool opened = open_gltf(filename, allocator, &gltf);
+    assert(opened);
+    defer(close_gltf(&gltf));
+
+    char *directory = path_directory(filename, allocator);
+    defer(if (directory) free(allocator, directory));
+
+    Mesh_Optimization_Report report = {};
+    Mesh_Lod_Report lod_report = {};
+    int num_source_vertices = 0;
+    Array<Imported_Mesh> imported_meshes = import_gltf_meshes(&gltf, allocator, &report, &num_source_vertices);
+    defer(destroy_imported_meshes(imported_meshes));
+    Array<Imported_Material> imported_materials = import_gltf_materials(&gltf, allocator);
+    defer(free_gltf_materials(imported_materials, allocator));
+    Array<PBR_Material> materials = create_imported_materials(imported_materials, imported_meshes, directory, texture_cache, allocator);
+    defer(materials.destroy());
+
+    Model model = create_model(allocator);
+    Mesh_Import_Scratch scratch = make_mesh_import_scratch(allocator, layout);
+    defer(destroy_mesh_import_scratch(&scratch));
+    Foreach (mesh, imported_meshes) {
+        add_imported_mesh(mesh, mesh->material != -1 ? &materials[mesh->material] : nullptr, layout, allocator, &scratch, &lod_report, &model);
+    }
+
+    print_model_import_report(filename, num_source_vertices, &model, &report, &lod_report, layout);
+    return model;
+}
+
+// The glTF version of cook_model(), same output without going through assimp.
+bool cook_model_gltf(char *source_filename, char *cooked_filename, Allocator allocator, Vertex_Layout layout = VL_FULL) {
+    Gltf_File gltf;
+    if (!open_gltf(source_filename, allocator, &gltf)) {
+        return false;
+    }
+    defer(close_gltf(&gltf));
+
+    Model_Cooker cooker = make_model_cooker(vertex_layout_size(layout), allocator);
+    defer(destroy_model_cooker(&cooker));
+    Mesh_Optimization_Report report = {};
+    Mesh_Lod_Report lod_report = {};
+    int num_source_vertices = 0;
+    Array<Imported_Mesh> imported_meshes = import_gltf_meshes(&gltf, allocator, &report, &num_source_vertices);
+    defer(destroy_imported_meshes(imported_meshes));
+    Array<Imported_Material> imported_materials = import_gltf_materials(&gltf, allocator);
+    defer(free_gltf_materials(imported_materials, allocator));
+
+    // materials go in the order meshes first use them, like cook_node()
+    Array<int> material_remap = make_array<int>(allocator, imported_materials.count > 0 ? imported_materials.count : 1);
+    defer(material_remap.destroy());
+    For (i, imported_materials) {
+        material_remap.append(-1);
+    }
+    Mesh_Import_Scratch scratch = make_mesh_import_scratch(allocator, layout);
+    defer(destroy_mesh_import_scratch(&scratch));
+    Foreach (mesh, imported_meshes) {
+        int material_index = -1;
+        if (mesh->material != -1) {
+            if (material_remap[mesh->material] == -1) {
+                material_remap[mesh->material] = model_cooker_add_material(&cooker, cook_imported_material(&imported_materials[mesh->material], &cooker));
+            }
+            material_index = material_remap[mesh->material];
+        }
+        cook_imported_mesh(mesh, material_index, &scratch, &lod_report, &cooker);
+    }
+
+    print_cooked_import_report(source_filename, num_source_vertices, &cooker, &report, &lod_report, layout);
+    return write_cooked_model(&cooker, cooked_filename);
+}
+
+static bool is_gltf_filename(char *filename) {
+    char *extension = strrchr(filename, '.');
+    return extension && (strcmp(extension, ".gltf") == 0 || strcmp(extension, ".glb") == 0);
+}
+
+
+
+struct Texture_Cook_Job {
+    char *path;
+    Texture_Cook_Settings settings;
+};
+
+// Cooks every texture a cooked model's materials use, see cooked_texture.h. A texture that's used by
+// more than one map is cooked for the first one, so e.g. glTF's shared metallic/roughness texture
+// doesn't get cooked twice. Textures are cooked one after another, the block compression inside
+// compress_image() is what's parallel.
+static void ensure_model_textures_cooked(char *cooked_filename, Allocator allocator, Vertex_Layout layout) {
+    Cooked_Model_File cooked;
+    if (!open_cooked_model(cooked_filename, vertex_layout_size(layout), &cooked)) {
+        return;
+    }
+    defer(close_cooked_model(&cooked));
+
+    char *directory = path_directory(cooked_filename, allocator);
+    defer(if (directory) free(allocator, directory));
+
+    Array<Texture_Cook_Job> jobs = make_array<Texture_Cook_Job>(allocator, cooked.header->num_materials * MM_COUNT + 1);
+    defer(jobs.destroy());
+    for (u32 i = 0; i < cooked.header->num_materials; i++) {
+        Cffmodel_Material *cooked_material = &cooked.materials[i];
+        for (int map = 0; map < MM_COUNT; map++) {
+            if (cooked_material->texture_paths[map] == 0) {
+                continue;
+            }
+            char *path = resolve_texture_path(directory, cooked.strings + cooked_material->texture_paths[map], allocator);
+            bool seen = false;
+            Foreach (job, jobs) {
+                if (strcmp(job->path, path) == 0) {
+                    seen = true;
+                    break;
+                }
+            }
+            if (seen) {
+                free(allocator, path);
+                continue;
+            }
+
+            bool srgb = (cooked_material->srgb_textures & (1 << map)) != 0;
+            bool transparent = (cooked_material->flags & CFFMODEL_MATERIAL_TRANSPARENT) != 0;
+            Texture_Cook_Job job = {};
+            job.path = path;
+            job.settings = texture_cook_settings((Material_Map)map, srgb, transparent, COMPRESSION_QUALITY_NORMAL);
+            jobs.append(job);
+        }
+    }
+
+    // note(josh): not a parallel_for over the textures, compress_image() already runs one per mip and
+    // parallel_for spawns its own threads, so nesting them would run threads*threads at once.
+    Foreach (job, jobs) {
+        ensure_texture_cooked(job->path, job->settings, allocator);
+        free(allocator, job->path);
+    }
+}
+
+// Cooks source_filename if cooked_filename doesn't exist yet, is older than the source, can't be read
+// or was cooked with a different vertex layout. glTF goes through cook_model_gltf(), everything else
+// through assimp's cook_model() if ASSIMP_IMPORT is on and is an error if it isn't. Then cooks whatever
+// textures of it aren't cooked yet.
+void ensure_model_cooked(char *source_filename, char *cooked_filename, Allocator allocator, Vertex_Layout layout = VL_FULL) {
+    u64 source_time = 0;
+    u64 cooked_time = 0;
+    bool have_source = get_file_write_time(source_filename, &source_time);
+    bool up_to_date = get_file_write_time(cooked_filename, &cooked_time) && (!have_source || cooked_time >= source_time);
+    if (up_to_date) {
+        Cooked_Model_File cooked;
+        up_to_date = open_cooked_model(cooked_filename, vertex_layout_size(layout), &cooked);
+        if (up_to_date) {
+            close_cooked_model(&cooked);
+        }
+    }
+
+    if (!up_to_date) {
+        printf("Cooking %s -> %s\n", source_filename, cooked_filename);
+        double cook_start = time_now();
+        bool cooked = false;
+        if (is_gltf_filename(source_filename)) {
+            cooked = cook_model_gltf(source_filename, cooked_filename, allocator, layout);
+        }
+        else {
+#ifdef ASSIMP_IMPORT
+            cooked = cook_model(source_filename, cooked_filename, allocator, layout);
+#else
+            ASSERTF(false, "Can't cook %s, only glTF/GLB models can be cooked without ASSIMP_IMPORT. Turn it on in main.cpp to cook other formats through assimp.\n", source_filename);
+#endif
+        }
+        assert(cooked);
+        printf("Cooked %s in %fs\n", cooked_filename, time_now() - cook_start);
+    }
+
+    double texture_cook_start = time_now();
+    ensure_model_textures_cooked(cooked_filename, allocator, layout);
+    double texture_cook_seconds = time_now() - texture_cook_start;
+    if (texture_cook_seconds > 0.1) {
+        printf("Cooked %s's textures in %fs\n", cooked_filename, texture_cook_seconds);
+    }
+}
+
+Model load_model_cooked(char *source_filename, char *cooked_filename, Allocator allocator, Texture_Cache *texture_cache, Vertex_Layout layout = VL_FULL, bool merge_meshes = false) {
+    ensure_model_cooked(source_filename, cooked_filename, allocator, layout);
+    Model model = {};
+    bool loaded = load_cooked_model(cooked_filename, allocator, texture_cache, &model, layout, merge_meshes);
+    assert(loaded);
+    return model;
+}
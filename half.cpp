@@ -41,6 +41,12 @@
 //     guaranteed for future versions.
 //
 
+#include "half.h"
+
+#include "simd.h"
+
+#include <string.h>
+
 // Load immediate
 static inline u32 _uint32_li( u32 a )
 {
@@ -715,3 +721,134 @@ half_mul( u16 x, u16 y )
 
   return (u16)(c_result);
 }
+
+
+
+// Everything below is not part of the original file.
+
+float f16_to_float(f16 h) {
+    u32 bits = half_to_float(h.bits);
+    float result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+// note(josh): the SSE2 versions are from Fabian Giesen's half conversion gists. they rely on
+// float denormals being enabled (no DAZ/FTZ), which is the default.
+static inline __m128i halves_from_floats_sse2(__m128 f) {
+    const __m128i c_f16max        = _mm_set1_epi32((127 + 16) << 23);                    // everything >= this is inf
+    const __m128i c_nanbit        = _mm_set1_epi32(0x200);
+    const __m128i c_infty_as_fp16 = _mm_set1_epi32(0x7c00);
+    const __m128i c_min_normal    = _mm_set1_epi32((127 - 14) << 23);                    // smallest float that is a normal half
+    const __m128i c_subnorm_magic = _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23);
+    const __m128i c_normal_bias   = _mm_set1_epi32(0xfff - ((127 - 15) << 23));         // rebias exponent and round
+
+    __m128  justsign    = _mm_and_ps(f32x4_sign_mask(), f);
+    __m128  absf        = _mm_xor_ps(f, justsign);
+    __m128i absf_int    = _mm_castps_si128(absf);
+    __m128  b_isnan     = _mm_cmpunord_ps(absf, absf);
+    __m128i b_isregular = _mm_cmpgt_epi32(c_f16max, absf_int);
+    __m128i nanbit      = _mm_and_si128(_mm_castps_si128(b_isnan), c_nanbit);
+    __m128i inf_or_nan  = _mm_or_si128(nanbit, c_infty_as_fp16);
+    __m128i b_issub     = _mm_cmpgt_epi32(c_min_normal, absf_int);
+
+    // result is a half denormal: let the float adder do the rounding for us
+    __m128  subnorm1    = _mm_add_ps(absf, _mm_castsi128_ps(c_subnorm_magic));
+    __m128i subnorm2    = _mm_sub_epi32(_mm_castps_si128(subnorm1), c_subnorm_magic);
+
+    // result is normal: rebias and round to nearest even by hand
+    __m128i mantoddbit  = _mm_slli_epi32(absf_int, 31 - 13);
+    __m128i mantodd     = _mm_srai_epi32(mantoddbit, 31);
+    __m128i round1      = _mm_add_epi32(absf_int, c_normal_bias);
+    __m128i round2      = _mm_sub_epi32(round1, mantodd);
+    __m128i normal      = _mm_srli_epi32(round2, 13);
+
+    __m128i nonspecial  = _mm_or_si128(_mm_and_si128(subnorm2, b_issub), _mm_andnot_si128(b_issub, normal));
+    __m128i joined      = _mm_or_si128(_mm_and_si128(nonspecial, b_isregular), _mm_andnot_si128(b_isregular, inf_or_nan));
+    __m128i sign_shift  = _mm_srai_epi32(_mm_castps_si128(justsign), 16);
+    return _mm_or_si128(joined, sign_shift);
+}
+
+static inline __m128 floats_from_halves_sse2(__m128i h) {
+    const __m128i mask_nosign = _mm_set1_epi32(0x7fff);
+    const __m128  magic       = _mm_castsi128_ps(_mm_set1_epi32((254 - 15) << 23));
+    const __m128i was_infnan  = _mm_set1_epi32(0x7bff);
+    const __m128  exp_infnan  = _mm_castsi128_ps(_mm_set1_epi32(255 << 23));
+
+    __m128i expmant     = _mm_and_si128(mask_nosign, h);
+    __m128i justsign    = _mm_xor_si128(h, expmant);
+    __m128i shifted     = _mm_slli_epi32(expmant, 13);
+    __m128  scaled      = _mm_mul_ps(_mm_castsi128_ps(shifted), magic);
+    __m128i b_wasinfnan = _mm_cmpgt_epi32(expmant, was_infnan);
+    __m128i sign        = _mm_slli_epi32(justsign, 16);
+    __m128  infnanexp   = _mm_and_ps(_mm_castsi128_ps(b_wasinfnan), exp_infnan);
+    __m128  sign_inf    = _mm_or_ps(_mm_castsi128_ps(sign), infnanexp);
+    return _mm_or_ps(scaled, sign_inf);
+}
+
+// one value through the same kernel the bulk loop uses, so every entry point rounds the same way
+static inline u16 half_from_float_single(float f) {
+#ifdef CFF_SIMD_F16C
+    return (u16)_mm_extract_epi16(_mm_cvtps_ph(_mm_set_ss(f), _MM_FROUND_TO_NEAREST_INT), 0);
+#else
+    return (u16)_mm_extract_epi16(halves_from_floats_sse2(_mm_set_ss(f)), 0);
+#endif
+}
+
+f16 f16_from_float(float f) {
+    f16 result;
+    result.bits = half_from_float_single(f);
+    return result;
+}
+
+void halves_from_floats(u16 *out, const float *in, int count) {
+    int i = 0;
+#ifdef CFF_SIMD_F16C
+    for (; i + 8 <= count; i += 8) {
+        __m256 f = _mm256_loadu_ps(in + i);
+        _mm_storeu_si128((__m128i *)(out + i), _mm256_cvtps_ph(f, _MM_FROUND_TO_NEAREST_INT));
+    }
+#else
+    for (; i + 8 <= count; i += 8) {
+        __m128i lo = halves_from_floats_sse2(_mm_loadu_ps(in + i));
+        __m128i hi = halves_from_floats_sse2(_mm_loadu_ps(in + i + 4));
+        // note(josh): results are sign extended so they all fit in an i16, signed saturation is a no-op here
+        _mm_storeu_si128((__m128i *)(out + i), _mm_packs_epi32(lo, hi));
+    }
+#endif
+    // note(josh): half_from_float() rounds ties away from zero and doesn't round tiny values up to
+    // the smallest denormal, so the leftovers go through the same kernel as the loop above. that way
+    // every element of the array gets the same rounding no matter where it lands.
+    for (; i < count; i++) {
+        out[i] = half_from_float_single(in[i]);
+    }
+}
+
+void floats_from_halves(float *out, const u16 *in, int count) {
+    int i = 0;
+#ifdef CFF_SIMD_F16C
+    for (; i + 8 <= count; i += 8) {
+        __m128i h = _mm_loadu_si128((__m128i *)(in + i));
+        _mm256_storeu_ps(out + i, _mm256_cvtph_ps(h));
+    }
+#else
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 8 <= count; i += 8) {
+        __m128i h = _mm_loadu_si128((__m128i *)(in + i));
+        _mm_storeu_ps(out + i,     floats_from_halves_sse2(_mm_unpacklo_epi16(h, zero)));
+        _mm_storeu_ps(out + i + 4, floats_from_halves_sse2(_mm_unpackhi_epi16(h, zero)));
+    }
+#endif
+    for (; i < count; i++) {
+        u32 bits = half_to_float(in[i]);
+        memcpy(&out[i], &bits, sizeof(bits));
+    }
+}
+
+void halves_from_floats(f16 *out, const float *in, int count) {
+    halves_from_floats((u16 *)out, in, count);
+}
+
+void floats_from_halves(float *out, const f16 *in, int count) {
+    floats_from_halves(out, (const u16 *)in, count);
+}
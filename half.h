@@ -0,0 +1,32 @@
+#pragma once
+
+#include "basic.h"
+
+// Scalar conversions on raw bit patterns, see half.cpp.
+// half_from_float() takes the bits of a 32 bit float, half_to_float() returns them.
+// note(josh): half_from_float() rounds ties away from zero, unlike everything below.
+u16 half_from_float(u32 f);
+u32 half_to_float  (u16 h);
+u16 half_add       (u16 x, u16 y);
+u16 half_mul       (u16 x, u16 y);
+
+// A typed 16 bit float so half data doesn't get mixed up with plain u16s (indices etc).
+// Same layout as a u16 so arrays of these can go straight into vertex/texture data.
+struct f16 {
+    u16 bits;
+};
+
+static_assert(sizeof(f16) == sizeof(u16), "f16 must be the same size as a u16");
+
+// f16_from_float() goes through the same code as halves_from_floats() so they always agree.
+f16   f16_from_float(float f);
+float f16_to_float  (f16 h);
+
+// Bulk conversions. These use F16C when the compiler is targeting it (/arch:AVX2 on MSVC,
+// -mf16c on gcc/clang), otherwise SSE2. Float to half rounds to nearest even like the hardware
+// does, NaNs stay NaNs and anything too big becomes infinity.
+void halves_from_floats(u16 *out, const float *in, int count);
+void floats_from_halves(float *out, const u16 *in, int count);
+
+void halves_from_floats(f16 *out, const float *in, int count);
+void floats_from_halves(float *out, const f16 *in, int count);
@@ -0,0 +1,403 @@
+#include "intersection.h"
+
+#include "simd.h"
+
+#include <float.h>
+#include <math.h>
+
+// note(josh): determinants smaller than this are treated as the ray being parallel to the triangle
+#define RAY_TRIANGLE_EPSILON 1e-12f
+
+// note(josh): fminf/fmaxf are real calls into the CRT on both compilers because of their NaN rules,
+// these compile down to a single minss/maxss. if either argument is NaN they return b.
+static inline float min_f(float a, float b) { return a < b ? a : b; }
+static inline float max_f(float a, float b) { return a > b ? a : b; }
+
+AABB aabb_empty() {
+    AABB result;
+    result.min = v3( FLT_MAX,  FLT_MAX,  FLT_MAX);
+    result.max = v3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    return result;
+}
+
+AABB aabb_union(AABB a, AABB b) {
+    AABB result;
+    result.min = v3(min_f(a.min.x, b.min.x), min_f(a.min.y, b.min.y), min_f(a.min.z, b.min.z));
+    result.max = v3(max_f(a.max.x, b.max.x), max_f(a.max.y, b.max.y), max_f(a.max.z, b.max.z));
+    return result;
+}
+
+AABB aabb_grow(AABB box, Vector3 point) {
+    AABB result;
+    result.min = v3(min_f(box.min.x, point.x), min_f(box.min.y, point.y), min_f(box.min.z, point.z));
+    result.max = v3(max_f(box.max.x, point.x), max_f(box.max.y, point.y), max_f(box.max.z, point.z));
+    return result;
+}
+
+Vector3 aabb_center(AABB box) {
+    return (box.min + box.max) * 0.5f;
+}
+
+float aabb_surface_area(AABB box) {
+    Vector3 d = box.max - box.min;
+    if (d.x < 0 || d.y < 0 || d.z < 0) {
+        return 0;
+    }
+    return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+
+
+bool aabb_overlap(AABB a, AABB b) {
+    return a.min.x <= b.max.x && a.max.x >= b.min.x
+        && a.min.y <= b.max.y && a.max.y >= b.min.y
+        && a.min.z <= b.max.z && a.max.z >= b.min.z;
+}
+
+float aabb_distance_sq(AABB box, Vector3 point) {
+    float dx = max_f(max_f(box.min.x - point.x, 0.0f), point.x - box.max.x);
+    float dy = max_f(max_f(box.min.y - point.y, 0.0f), point.y - box.max.y);
+    float dz = max_f(max_f(box.min.z - point.z, 0.0f), point.z - box.max.z);
+    return dx*dx + dy*dy + dz*dz;
+}
+
+AABB aabb_transform(AABB box, Matrix4 transform) {
+    // note(josh): Arvo's method, each output axis is the sum of the min/max contributions of each input axis
+    AABB result;
+    result.min = v3(transform[3].x, transform[3].y, transform[3].z);
+    result.max = result.min;
+    for (int c = 0; c < 3; c++) {
+        for (int r = 0; r < 3; r++) {
+            float e = transform.elements[c][r] * ((float *)&box.min)[c];
+            float f = transform.elements[c][r] * ((float *)&box.max)[c];
+            ((float *)&result.min)[r] += min_f(e, f);
+            ((float *)&result.max)[r] += max_f(e, f);
+        }
+    }
+    return result;
+}
+
+// projects the triangle and the box onto axis and checks whether the intervals overlap
+static bool sat_axis_overlaps(Vector3 axis, Vector3 v0, Vector3 v1, Vector3 v2, Vector3 half_size) {
+    float p0 = dot(v0, axis);
+    float p1 = dot(v1, axis);
+    float p2 = dot(v2, axis);
+    float r = half_size.x * fabsf(axis.x) + half_size.y * fabsf(axis.y) + half_size.z * fabsf(axis.z);
+    return !(min_f(p0, min_f(p1, p2)) > r || max_f(p0, max_f(p1, p2)) < -r);
+}
+
+bool triangle_aabb_overlap(Vector3 a, Vector3 b, Vector3 c, AABB box) {
+    // note(josh): Akenine-Möller. 13 axes: the box's 3 face normals, the triangle normal, and the 9
+    // cross products of box axes with triangle edges. everything is relative to the box center.
+    Vector3 center = aabb_center(box);
+    Vector3 half_size = (box.max - box.min) * 0.5f;
+    Vector3 v0 = a - center;
+    Vector3 v1 = b - center;
+    Vector3 v2 = c - center;
+
+    if (min_f(v0.x, min_f(v1.x, v2.x)) > half_size.x || max_f(v0.x, max_f(v1.x, v2.x)) < -half_size.x) return false;
+    if (min_f(v0.y, min_f(v1.y, v2.y)) > half_size.y || max_f(v0.y, max_f(v1.y, v2.y)) < -half_size.y) return false;
+    if (min_f(v0.z, min_f(v1.z, v2.z)) > half_size.z || max_f(v0.z, max_f(v1.z, v2.z)) < -half_size.z) return false;
+
+    Vector3 edges[3] = { v1 - v0, v2 - v1, v0 - v2 };
+    Vector3 box_axes[3] = { v3(1, 0, 0), v3(0, 1, 0), v3(0, 0, 1) };
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            if (!sat_axis_overlaps(cross(box_axes[i], edges[j]), v0, v1, v2, half_size)) {
+                return false;
+            }
+        }
+    }
+
+    return sat_axis_overlaps(cross(edges[0], edges[1]), v0, v1, v2, half_size);
+}
+
+Vector3 closest_point_on_triangle(Vector3 p, Vector3 a, Vector3 b, Vector3 c) {
+    // note(josh): Ericson, Real-Time Collision Detection 5.1.5. figure out which voronoi region
+    // of the triangle p is in and project onto that feature.
+    Vector3 ab = b - a;
+    Vector3 ac = c - a;
+    Vector3 ap = p - a;
+    float d1 = dot(ab, ap);
+    float d2 = dot(ac, ap);
+    if (d1 <= 0 && d2 <= 0) return a;
+
+    Vector3 bp = p - b;
+    float d3 = dot(ab, bp);
+    float d4 = dot(ac, bp);
+    if (d3 >= 0 && d4 <= d3) return b;
+
+    float vc = d1*d4 - d3*d2;
+    if (vc <= 0 && d1 >= 0 && d3 <= 0) {
+        return a + ab * (d1 / (d1 - d3));
+    }
+
+    Vector3 cp = p - c;
+    float d5 = dot(ab, cp);
+    float d6 = dot(ac, cp);
+    if (d6 >= 0 && d5 <= d6) return c;
+
+    float vb = d5*d2 - d1*d6;
+    if (vb <= 0 && d2 >= 0 && d6 <= 0) {
+        return a + ac * (d2 / (d2 - d6));
+    }
+
+    float va = d3*d6 - d5*d4;
+    if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0) {
+        return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+    }
+
+    float denom = 1.0f / (va + vb + vc);
+    return a + ab * (vb * denom) + ac * (vc * denom);
+}
+
+
+
+bool ray_triangle(Ray ray, Vector3 a, Vector3 b, Vector3 c, float t_max, Triangle_Hit *out_hit) {
+    Vector3 e1 = b - a;
+    Vector3 e2 = c - a;
+    Vector3 p = cross(ray.direction, e2);
+    float det = dot(e1, p);
+    if (fabsf(det) <= RAY_TRIANGLE_EPSILON) {
+        return false;
+    }
+    float inv_det = 1.0f / det;
+
+    Vector3 s = ray.origin - a;
+    float u = dot(s, p) * inv_det;
+    if (u < 0 || u > 1) {
+        return false;
+    }
+
+    Vector3 q = cross(s, e1);
+    float v = dot(ray.direction, q) * inv_det;
+    if (v < 0 || (u + v) > 1) {
+        return false;
+    }
+
+    float t = dot(e2, q) * inv_det;
+    if (t < 0 || t >= t_max) {
+        return false;
+    }
+
+    if (out_hit) {
+        out_hit->t = t;
+        out_hit->u = u;
+        out_hit->v = v;
+    }
+    return true;
+}
+
+Vector3 ray_inv_direction(Ray ray) {
+    // note(josh): 1/0 = inf is what we want here, the slab test handles it
+    return v3(1.0f / ray.direction.x, 1.0f / ray.direction.y, 1.0f / ray.direction.z);
+}
+
+bool ray_aabb(Vector3 origin, Vector3 inv_direction, AABB box, float t_max, float *out_t_enter) {
+    float tx1 = (box.min.x - origin.x) * inv_direction.x;
+    float tx2 = (box.max.x - origin.x) * inv_direction.x;
+    float ty1 = (box.min.y - origin.y) * inv_direction.y;
+    float ty2 = (box.max.y - origin.y) * inv_direction.y;
+    float tz1 = (box.min.z - origin.z) * inv_direction.z;
+    float tz2 = (box.max.z - origin.z) * inv_direction.z;
+
+    // an origin exactly on a slab plane of an axis the ray is parallel to gives 0*inf = NaN. the
+    // accumulator always goes in the b slot so a NaN slab is ignored rather than poisoning the result.
+    float t_enter = max_f(min_f(tx1, tx2), 0.0f);
+    float t_exit  = min_f(max_f(tx1, tx2), t_max);
+    t_enter = max_f(min_f(ty1, ty2), t_enter);
+    t_exit  = min_f(max_f(ty1, ty2), t_exit);
+    t_enter = max_f(min_f(tz1, tz2), t_enter);
+    t_exit  = min_f(max_f(tz1, tz2), t_exit);
+    if (out_t_enter) {
+        *out_t_enter = t_enter;
+    }
+    return t_enter <= t_exit && t_enter < t_max;
+}
+
+bool ray_aabb(Ray ray, AABB box, float t_max, float *out_t_enter) {
+    return ray_aabb(ray.origin, ray_inv_direction(ray), box, t_max, out_t_enter);
+}
+
+
+
+void set_triangle(Triangle_Packet4 *packet, int lane, Vector3 a, Vector3 b, Vector3 c) {
+    ASSERT(lane >= 0 && lane < 4);
+    Vector3 e1 = b - a;
+    Vector3 e2 = c - a;
+    packet->ax[lane]  = a.x;  packet->ay[lane]  = a.y;  packet->az[lane]  = a.z;
+    packet->e1x[lane] = e1.x; packet->e1y[lane] = e1.y; packet->e1z[lane] = e1.z;
+    packet->e2x[lane] = e2.x; packet->e2y[lane] = e2.y; packet->e2z[lane] = e2.z;
+}
+
+void set_triangle(Triangle_Packet8 *packet, int lane, Vector3 a, Vector3 b, Vector3 c) {
+    ASSERT(lane >= 0 && lane < 8);
+    Vector3 e1 = b - a;
+    Vector3 e2 = c - a;
+    packet->ax[lane]  = a.x;  packet->ay[lane]  = a.y;  packet->az[lane]  = a.z;
+    packet->e1x[lane] = e1.x; packet->e1y[lane] = e1.y; packet->e1z[lane] = e1.z;
+    packet->e2x[lane] = e2.x; packet->e2y[lane] = e2.y; packet->e2z[lane] = e2.z;
+}
+
+void set_ray(Ray_Packet4 *packet, int lane, Ray ray, float t_max) {
+    ASSERT(lane >= 0 && lane < 4);
+    Vector3 inv = ray_inv_direction(ray);
+    packet->ox[lane] = ray.origin.x; packet->oy[lane] = ray.origin.y; packet->oz[lane] = ray.origin.z;
+    packet->inv_dx[lane] = inv.x;    packet->inv_dy[lane] = inv.y;    packet->inv_dz[lane] = inv.z;
+    packet->t_max[lane] = t_max;
+}
+
+void set_ray(Ray_Packet8 *packet, int lane, Ray ray, float t_max) {
+    ASSERT(lane >= 0 && lane < 8);
+    Vector3 inv = ray_inv_direction(ray);
+    packet->ox[lane] = ray.origin.x; packet->oy[lane] = ray.origin.y; packet->oz[lane] = ray.origin.z;
+    packet->inv_dx[lane] = inv.x;    packet->inv_dy[lane] = inv.y;    packet->inv_dz[lane] = inv.z;
+    packet->t_max[lane] = t_max;
+}
+
+// picks the lane with the smallest t out of the lanes set in mask, lowest lane wins ties
+static int closest_lane(float *t, int mask, int lanes) {
+    int best = -1;
+    for (int lane = 0; lane < lanes; lane++) {
+        if ((mask & (1 << lane)) && (best == -1 || t[lane] < t[best])) {
+            best = lane;
+        }
+    }
+    return best;
+}
+
+
+
+// note(josh): the packet kernels are the same code at both widths, W is the vector prefix.
+#define RAY_TRIANGLE_PACKET_BODY(W, T)                                                           \
+    T dx = W##_set1(ray.direction.x), dy = W##_set1(ray.direction.y), dz = W##_set1(ray.direction.z); \
+    T e1x = W##_load(packet->e1x), e1y = W##_load(packet->e1y), e1z = W##_load(packet->e1z);     \
+    T e2x = W##_load(packet->e2x), e2y = W##_load(packet->e2y), e2z = W##_load(packet->e2z);     \
+    /* p = cross(d, e2) */                                                                       \
+    T px = W##_sub(W##_mul(dy, e2z), W##_mul(dz, e2y));                                          \
+    T py = W##_sub(W##_mul(dz, e2x), W##_mul(dx, e2z));                                          \
+    T pz = W##_sub(W##_mul(dx, e2y), W##_mul(dy, e2x));                                          \
+    T det = W##_madd(e1z, pz, W##_madd(e1y, py, W##_mul(e1x, px)));                              \
+    T inv_det = W##_div(W##_set1(1.0f), det);                                                    \
+    /* s = origin - a */                                                                         \
+    T sx = W##_sub(W##_set1(ray.origin.x), W##_load(packet->ax));                                \
+    T sy = W##_sub(W##_set1(ray.origin.y), W##_load(packet->ay));                                \
+    T sz = W##_sub(W##_set1(ray.origin.z), W##_load(packet->az));                                \
+    T u = W##_mul(W##_madd(sz, pz, W##_madd(sy, py, W##_mul(sx, px))), inv_det);                 \
+    /* q = cross(s, e1) */                                                                       \
+    T qx = W##_sub(W##_mul(sy, e1z), W##_mul(sz, e1y));                                          \
+    T qy = W##_sub(W##_mul(sz, e1x), W##_mul(sx, e1z));                                          \
+    T qz = W##_sub(W##_mul(sx, e1y), W##_mul(sy, e1x));                                          \
+    T v = W##_mul(W##_madd(dz, qz, W##_madd(dy, qy, W##_mul(dx, qx))), inv_det);                 \
+    T t = W##_mul(W##_madd(e2z, qz, W##_madd(e2y, qy, W##_mul(e2x, qx))), inv_det);              \
+    T zero = W##_zero();                                                                         \
+    T hit = W##_cmp_gt(W##_abs(det), W##_set1(RAY_TRIANGLE_EPSILON));                            \
+    hit = W##_and(hit, W##_cmp_ge(u, zero));                                                     \
+    hit = W##_and(hit, W##_cmp_le(u, W##_set1(1.0f)));                                           \
+    hit = W##_and(hit, W##_cmp_ge(v, zero));                                                     \
+    hit = W##_and(hit, W##_cmp_le(W##_add(u, v), W##_set1(1.0f)));                               \
+    hit = W##_and(hit, W##_cmp_ge(t, zero));                                                     \
+    hit = W##_and(hit, W##_cmp_lt(t, W##_set1(t_max)));                                         \
+    int mask = W##_mask(hit);                                                                    \
+    if (mask == 0) {                                                                             \
+        return -1;                                                                               \
+    }
+
+int ray_triangle_packet(Ray ray, Triangle_Packet4 *packet, float t_max, Triangle_Hit *out_hit) {
+    RAY_TRIANGLE_PACKET_BODY(f32x4, f32x4)
+    float ts[4], us[4], vs[4];
+    f32x4_store(ts, t);
+    f32x4_store(us, u);
+    f32x4_store(vs, v);
+    int lane = closest_lane(ts, mask, 4);
+    if (out_hit) {
+        out_hit->t = ts[lane];
+        out_hit->u = us[lane];
+        out_hit->v = vs[lane];
+    }
+    return lane;
+}
+
+int ray_triangle_packet(Ray ray, Triangle_Packet8 *packet, float t_max, Triangle_Hit *out_hit) {
+#ifdef CFF_SIMD_AVX
+    RAY_TRIANGLE_PACKET_BODY(f32x8, f32x8)
+    float ts[8], us[8], vs[8];
+    f32x8_store(ts, t);
+    f32x8_store(us, u);
+    f32x8_store(vs, v);
+    int lane = closest_lane(ts, mask, 8);
+    if (out_hit) {
+        out_hit->t = ts[lane];
+        out_hit->u = us[lane];
+        out_hit->v = vs[lane];
+    }
+    return lane;
+#else
+    int best = -1;
+    Triangle_Hit best_hit = {};
+    for (int lane = 0; lane < 8; lane++) {
+        Vector3 a  = v3(packet->ax[lane],  packet->ay[lane],  packet->az[lane]);
+        Vector3 e1 = v3(packet->e1x[lane], packet->e1y[lane], packet->e1z[lane]);
+        Vector3 e2 = v3(packet->e2x[lane], packet->e2y[lane], packet->e2z[lane]);
+        Triangle_Hit hit;
+        if (ray_triangle(ray, a, a + e1, a + e2, t_max, &hit) && (best == -1 || hit.t < best_hit.t)) {
+            best = lane;
+            best_hit = hit;
+        }
+    }
+    if (best != -1 && out_hit) {
+        *out_hit = best_hit;
+    }
+    return best;
+#endif
+}
+
+#undef RAY_TRIANGLE_PACKET_BODY
+
+
+
+#define RAY_PACKET_AABB_BODY(W, T)                                                               \
+    T ox = W##_load(packet->ox), oy = W##_load(packet->oy), oz = W##_load(packet->oz);           \
+    T ix = W##_load(packet->inv_dx), iy = W##_load(packet->inv_dy), iz = W##_load(packet->inv_dz); \
+    T tx1 = W##_mul(W##_sub(W##_set1(box.min.x), ox), ix);                                       \
+    T tx2 = W##_mul(W##_sub(W##_set1(box.max.x), ox), ix);                                       \
+    T ty1 = W##_mul(W##_sub(W##_set1(box.min.y), oy), iy);                                       \
+    T ty2 = W##_mul(W##_sub(W##_set1(box.max.y), oy), iy);                                       \
+    T tz1 = W##_mul(W##_sub(W##_set1(box.min.z), oz), iz);                                       \
+    T tz2 = W##_mul(W##_sub(W##_set1(box.max.z), oz), iz);                                       \
+    T t_max = W##_load(packet->t_max);                                                           \
+    /* same order as ray_aabb(), min/max return their second operand on NaN so the accumulator */ \
+    /* goes last and a 0*inf slab from an origin on a slab plane is ignored */                   \
+    T t_enter = W##_max(W##_min(tx1, tx2), W##_zero());                                          \
+    T t_exit  = W##_min(W##_max(tx1, tx2), t_max);                                               \
+    t_enter = W##_max(W##_min(ty1, ty2), t_enter);                                               \
+    t_exit  = W##_min(W##_max(ty1, ty2), t_exit);                                                \
+    t_enter = W##_max(W##_min(tz1, tz2), t_enter);                                               \
+    t_exit  = W##_min(W##_max(tz1, tz2), t_exit);                                                \
+    T hit = W##_and(W##_cmp_le(t_enter, t_exit), W##_cmp_lt(t_enter, t_max));                    \
+    if (out_t_enter) {                                                                           \
+        W##_store(out_t_enter, t_enter);                                                         \
+    }                                                                                            \
+    return W##_mask(hit);
+
+int ray_packet_aabb(Ray_Packet4 *packet, AABB box, float *out_t_enter) {
+    RAY_PACKET_AABB_BODY(f32x4, f32x4)
+}
+
+int ray_packet_aabb(Ray_Packet8 *packet, AABB box, float *out_t_enter) {
+#ifdef CFF_SIMD_AVX
+    RAY_PACKET_AABB_BODY(f32x8, f32x8)
+#else
+    int mask = 0;
+    for (int lane = 0; lane < 8; lane++) {
+        Vector3 origin = v3(packet->ox[lane], packet->oy[lane], packet->oz[lane]);
+        Vector3 inv_direction = v3(packet->inv_dx[lane], packet->inv_dy[lane], packet->inv_dz[lane]);
+        if (ray_aabb(origin, inv_direction, box, packet->t_max[lane], out_t_enter ? &out_t_enter[lane] : nullptr)) {
+            mask |= 1 << lane;
+        }
+    }
+    return mask;
+#endif
+}
+
+#undef RAY_PACKET_AABB_BODY
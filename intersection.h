@@ -0,0 +1,100 @@
+#pragma once
+
+#include "basic.h"
+#include "math.h"
+
+//
+// Ray queries against triangles and boxes.
+//
+// Ray directions don't have to be normalized, t is measured in multiples of direction. Hits are
+// only reported for 0 <= t < t_max. Triangles are two sided.
+//
+
+struct Ray {
+    Vector3 origin;
+    Vector3 direction;
+};
+
+struct AABB {
+    Vector3 min;
+    Vector3 max;
+};
+
+struct Triangle_Hit {
+    float t;
+    float u; // barycentrics, the hit point is a*(1-u-v) + b*u + c*v
+    float v;
+};
+
+AABB aabb_empty(); // min = +FLT_MAX, max = -FLT_MAX so anything grows it
+AABB aabb_union(AABB a, AABB b);
+AABB aabb_grow(AABB box, Vector3 point);
+Vector3 aabb_center(AABB box);
+float aabb_surface_area(AABB box);
+
+bool aabb_overlap(AABB a, AABB b);
+float aabb_distance_sq(AABB box, Vector3 point); // 0 if the point is inside
+AABB aabb_transform(AABB box, Matrix4 transform);
+
+// Exact separating axis test, touching counts as overlapping.
+bool triangle_aabb_overlap(Vector3 a, Vector3 b, Vector3 c, AABB box);
+
+Vector3 closest_point_on_triangle(Vector3 point, Vector3 a, Vector3 b, Vector3 c);
+
+// Möller–Trumbore
+bool ray_triangle(Ray ray, Vector3 a, Vector3 b, Vector3 c, float t_max, Triangle_Hit *out_hit);
+
+// Slab test. inv_direction is 1/ray.direction per axis, compute it once per ray with ray_inv_direction().
+Vector3 ray_inv_direction(Ray ray);
+bool ray_aabb(Vector3 origin, Vector3 inv_direction, AABB box, float t_max, float *out_t_enter = nullptr);
+bool ray_aabb(Ray ray, AABB box, float t_max, float *out_t_enter = nullptr);
+
+
+
+//
+// Packets
+//
+// One ray against 4/8 triangles, and 4/8 rays against one box. The 4 wide versions use SSE, the 8
+// wide ones use AVX when we are compiling for it and loop over the scalar versions otherwise.
+// Lanes you don't fill in should be left zeroed: a zeroed triangle is degenerate and never hit,
+// a zeroed ray has t_max = 0 and never hits anything.
+//
+
+struct Triangle_Packet4 {
+    // vertex a plus the two edges b-a and c-a
+    float ax[4],  ay[4],  az[4];
+    float e1x[4], e1y[4], e1z[4];
+    float e2x[4], e2y[4], e2z[4];
+};
+
+struct Triangle_Packet8 {
+    float ax[8],  ay[8],  az[8];
+    float e1x[8], e1y[8], e1z[8];
+    float e2x[8], e2y[8], e2z[8];
+};
+
+void set_triangle(Triangle_Packet4 *packet, int lane, Vector3 a, Vector3 b, Vector3 c);
+void set_triangle(Triangle_Packet8 *packet, int lane, Vector3 a, Vector3 b, Vector3 c);
+
+// returns the lane of the closest hit, or -1
+int ray_triangle_packet(Ray ray, Triangle_Packet4 *packet, float t_max, Triangle_Hit *out_hit);
+int ray_triangle_packet(Ray ray, Triangle_Packet8 *packet, float t_max, Triangle_Hit *out_hit);
+
+struct Ray_Packet4 {
+    float ox[4], oy[4], oz[4];
+    float inv_dx[4], inv_dy[4], inv_dz[4];
+    float t_max[4];
+};
+
+struct Ray_Packet8 {
+    float ox[8], oy[8], oz[8];
+    float inv_dx[8], inv_dy[8], inv_dz[8];
+    float t_max[8];
+};
+
+void set_ray(Ray_Packet4 *packet, int lane, Ray ray, float t_max);
+void set_ray(Ray_Packet8 *packet, int lane, Ray ray, float t_max);
+
+// returns a bitmask of the lanes that hit. out_t_enter is optional and gets one t per lane.
+int ray_packet_aabb(Ray_Packet4 *packet, AABB box, float *out_t_enter = nullptr);
+int ray_packet_aabb(Ray_Packet8 *packet, AABB box, float *out_t_enter = nullptr);
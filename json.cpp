@@ -0,0 +1,427 @@
+#include "json.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+
+enum Json_Parse_State {
+    JPS_VALUE,        // after ':' or ',' in an array, or at the very start
+    JPS_VALUE_OR_END, // right after '['
+    JPS_KEY,          // after ',' in an object
+    JPS_KEY_OR_END,   // right after '{'
+    JPS_COLON,
+    JPS_COMMA_OR_END,
+    JPS_DONE,
+};
+
+static bool json_error(char *text, i64 offset, const char *message) {
+    int line = 1;
+    for (i64 i = 0; i < offset; i++) {
+        if (text[i] == '\n') line += 1;
+    }
+    printf("parse_json(): %s on line %d\n", message, line);
+    return false;
+}
+
+static inline bool is_json_whitespace(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+static inline bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+// returns the offset just past the closing quote, or -1
+static i64 scan_json_string(char *text, i64 length, i64 start, bool *out_escaped) {
+    *out_escaped = false;
+    for (i64 i = start + 1; i < length; i++) {
+        char c = text[i];
+        if (c == '"') {
+            return i + 1;
+        }
+        if (c == '\\') {
+            *out_escaped = true;
+            i += 1;
+            if (i >= length || strchr("\"\\/bfnrtu", text[i]) == nullptr) {
+                return -1;
+            }
+        }
+        else if ((u8)c < 0x20) {
+            return -1;
+        }
+    }
+    return -1;
+}
+
+static i64 scan_json_number(char *text, i64 length, i64 start) {
+    i64 i = start;
+    if (i < length && text[i] == '-') i += 1;
+    i64 digits_start = i;
+    while (i < length && is_digit(text[i])) i += 1;
+    if (i == digits_start) {
+        return -1;
+    }
+    if (i < length && text[i] == '.') {
+        i += 1;
+        i64 fraction_start = i;
+        while (i < length && is_digit(text[i])) i += 1;
+        if (i == fraction_start) {
+            return -1;
+        }
+    }
+    if (i < length && (text[i] == 'e' || text[i] == 'E')) {
+        i += 1;
+        if (i < length && (text[i] == '+' || text[i] == '-')) i += 1;
+        i64 exponent_start = i;
+        while (i < length && is_digit(text[i])) i += 1;
+        if (i == exponent_start) {
+            return -1;
+        }
+    }
+    return i;
+}
+
+bool parse_json(char *text, i64 length, Allocator allocator, Json *out_json) {
+    *out_json = {};
+    if (length >= 0xffffffff) {
+        printf("parse_json(): %lld bytes is too big\n", (long long)length);
+        return false;
+    }
+    // note(josh): glTF and most other JSON we read averages a token every 10 bytes or so
+    Array<Json_Token> tokens = make_array<Json_Token>(allocator, (int)(length / 8) + 16);
+    Array<u32> stack = make_array<u32>(allocator, 32);
+    defer(stack.destroy());
+
+    Json_Parse_State state = JPS_VALUE;
+    i64 i = 0;
+    bool ok = true;
+    while (ok) {
+        while (i < length && is_json_whitespace(text[i])) i += 1;
+        if (i >= length) {
+            if (state != JPS_DONE) ok = json_error(text, i, "unexpected end of input");
+            break;
+        }
+        char c = text[i];
+        if (state == JPS_DONE) {
+            ok = json_error(text, i, "junk after the root value");
+            break;
+        }
+
+        // closing brackets, commas and colons
+        if ((c == '}' || c == ']') && (state == JPS_COMMA_OR_END || (c == '}' && state == JPS_KEY_OR_END) || (c == ']' && state == JPS_VALUE_OR_END))) {
+            Json_Token *container = &tokens[stack[stack.count-1]];
+            if (container->type != (c == '}' ? JSON_OBJECT : JSON_ARRAY)) {
+                ok = json_error(text, i, "mismatched brackets");
+                break;
+            }
+            container->length = (u32)(i + 1 - container->start);
+            container->next = (u32)tokens.count;
+            stack.pop();
+            i += 1;
+            state = stack.count ? JPS_COMMA_OR_END : JPS_DONE;
+            continue;
+        }
+        if (state == JPS_COMMA_OR_END) {
+            if (c != ',') {
+                ok = json_error(text, i, "expected ',' or a closing bracket");
+                break;
+            }
+            i += 1;
+            state = tokens[stack[stack.count-1]].type == JSON_OBJECT ? JPS_KEY : JPS_VALUE;
+            continue;
+        }
+        if (state == JPS_COLON) {
+            if (c != ':') {
+                ok = json_error(text, i, "expected ':'");
+                break;
+            }
+            i += 1;
+            state = JPS_VALUE;
+            continue;
+        }
+
+        Json_Token token = {};
+        token.start = (u32)i;
+        if (state == JPS_KEY || state == JPS_KEY_OR_END) {
+            if (c != '"') {
+                ok = json_error(text, i, "expected a key");
+                break;
+            }
+            i64 end = scan_json_string(text, length, i, &token.escaped);
+            if (end < 0) {
+                ok = json_error(text, i, "bad string");
+                break;
+            }
+            token.type = JSON_STRING;
+            token.start = (u32)(i + 1);
+            token.length = (u32)(end - i - 2);
+            token.next = (u32)tokens.count + 1;
+            tokens[stack[stack.count-1]].count += 1;
+            tokens.append(token);
+            i = end;
+            state = JPS_COLON;
+            continue;
+        }
+
+        // a value
+        if (stack.count && tokens[stack[stack.count-1]].type == JSON_ARRAY) {
+            tokens[stack[stack.count-1]].count += 1;
+        }
+        if (c == '{' || c == '[') {
+            token.type = c == '{' ? JSON_OBJECT : JSON_ARRAY;
+            stack.append((u32)tokens.count);
+            tokens.append(token);
+            i += 1;
+            state = c == '{' ? JPS_KEY_OR_END : JPS_VALUE_OR_END;
+            continue;
+        }
+
+        i64 end = -1;
+        if (c == '"') {
+            end = scan_json_string(text, length, i, &token.escaped);
+            token.type = JSON_STRING;
+            token.start = (u32)(i + 1);
+            token.length = (u32)(end - i - 2);
+        }
+        else if (c == '-' || is_digit(c)) {
+            end = scan_json_number(text, length, i);
+            token.type = JSON_NUMBER;
+            token.length = (u32)(end - i);
+        }
+        else if (c == 't' && length - i >= 4 && memcmp(text + i, "true", 4) == 0)  { end = i + 4; token.type = JSON_TRUE;  token.length = 4; }
+        else if (c == 'f' && length - i >= 5 && memcmp(text + i, "false", 5) == 0) { end = i + 5; token.type = JSON_FALSE; token.length = 5; }
+        else if (c == 'n' && length - i >= 4 && memcmp(text + i, "null", 4) == 0)  { end = i + 4; token.type = JSON_NULL;  token.length = 4; }
+        if (end < 0) {
+            ok = json_error(text, i, "expected a value");
+            break;
+        }
+        token.next = (u32)tokens.count + 1;
+        tokens.append(token);
+        i = end;
+        state = stack.count ? JPS_COMMA_OR_END : JPS_DONE;
+    }
+
+    if (!ok) {
+        tokens.destroy();
+        return false;
+    }
+    out_json->text = text;
+    out_json->length = length;
+    out_json->tokens = tokens;
+    return true;
+}
+
+void destroy_json(Json *json) {
+    json->tokens.destroy();
+    *json = {};
+}
+
+
+
+int json_first_child(Json *json, int container) {
+    if (container < 0 || json->tokens[container].count == 0) {
+        return -1;
+    }
+    return container + 1;
+}
+
+int json_next_sibling(Json *json, int container, int child) {
+    Json_Token *parent = &json->tokens[container];
+    u32 next = parent->type == JSON_OBJECT ? json->tokens[child+1].next : json->tokens[child].next;
+    return next < parent->next ? (int)next : -1;
+}
+
+int json_find(Json *json, int object, const char *key) {
+    if (object < 0 || json->tokens[object].type != JSON_OBJECT) {
+        return -1;
+    }
+    for (int child = json_first_child(json, object); child != -1; child = json_next_sibling(json, object, child)) {
+        if (json_equals(json, child, key)) {
+            return child + 1;
+        }
+    }
+    return -1;
+}
+
+int json_index(Json *json, int array, int index) {
+    if (array < 0 || json->tokens[array].type != JSON_ARRAY || index < 0 || (u32)index >= json->tokens[array].count) {
+        return -1;
+    }
+    int child = json_first_child(json, array);
+    for (int i = 0; i < index; i++) {
+        child = json_next_sibling(json, array, child);
+    }
+    return child;
+}
+
+bool json_equals(Json *json, int string, const char *str) {
+    if (string < 0 || json->tokens[string].type != JSON_STRING) {
+        return false;
+    }
+    Json_Token *token = &json->tokens[string];
+    if (!token->escaped) {
+        return strlen(str) == token->length && memcmp(json->text + token->start, str, token->length) == 0;
+    }
+    char buffer[256];
+    int length = json_copy_string(json, string, buffer, sizeof(buffer));
+    return length >= 0 && strcmp(buffer, str) == 0;
+}
+
+// exact for up to 15 significant digits and exponents within +-22, which is every number glTF exporters write
+static const double POWERS_OF_TEN[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+double json_number(Json *json, int token, double fallback) {
+    if (token < 0 || json->tokens[token].type != JSON_NUMBER) {
+        return fallback;
+    }
+    char *c = json->text + json->tokens[token].start;
+    char *end = c + json->tokens[token].length;
+    bool negative = *c == '-';
+    if (negative) c += 1;
+
+    u64 mantissa = 0;
+    int exponent = 0;
+    int digits = 0;
+    for (; c < end && is_digit(*c); c++) {
+        if (digits < 19) { mantissa = mantissa * 10 + (*c - '0'); digits += (mantissa != 0); }
+        else             { exponent += 1; }
+    }
+    if (c < end && *c == '.') {
+        for (c++; c < end && is_digit(*c); c++) {
+            if (digits < 19) { mantissa = mantissa * 10 + (*c - '0'); digits += (mantissa != 0); exponent -= 1; }
+        }
+    }
+    if (c < end && (*c == 'e' || *c == 'E')) {
+        c += 1;
+        bool negative_exponent = *c == '-';
+        if (*c == '-' || *c == '+') c += 1;
+        int e = 0;
+        for (; c < end && is_digit(*c); c++) {
+            if (e < 10000) e = e * 10 + (*c - '0');
+        }
+        exponent += negative_exponent ? -e : e;
+    }
+
+    double result = (double)mantissa;
+    if (exponent < 0 && exponent >= -22)     result /= POWERS_OF_TEN[-exponent];
+    else if (exponent > 0 && exponent <= 22) result *= POWERS_OF_TEN[exponent];
+    else if (exponent != 0)                  result *= pow(10.0, exponent);
+    return negative ? -result : result;
+}
+
+int json_int(Json *json, int token, int fallback) {
+    if (token < 0 || json->tokens[token].type != JSON_NUMBER) {
+        return fallback;
+    }
+    double number = json_number(json, token);
+    // out of range casts are undefined, anything that big is broken anyway
+    if (!(number >= INT_MIN && number <= INT_MAX)) {
+        return fallback;
+    }
+    return (int)number;
+}
+
+bool json_bool(Json *json, int token, bool fallback) {
+    if (token < 0) {
+        return fallback;
+    }
+    if (json->tokens[token].type == JSON_TRUE)  return true;
+    if (json->tokens[token].type == JSON_FALSE) return false;
+    return fallback;
+}
+
+static int hex_digit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static u32 read_hex4(char *c, char *end) {
+    if (end - c < 4) {
+        return 0xffffffff;
+    }
+    u32 value = 0;
+    for (int i = 0; i < 4; i++) {
+        int digit = hex_digit(c[i]);
+        if (digit < 0) return 0xffffffff;
+        value = value * 16 + digit;
+    }
+    return value;
+}
+
+int json_copy_string(Json *json, int string, char *buffer, int buffer_size) {
+    if (string < 0 || json->tokens[string].type != JSON_STRING || buffer_size <= 0) {
+        return -1;
+    }
+    Json_Token *token = &json->tokens[string];
+    char *c = json->text + token->start;
+    char *end = c + token->length;
+    int length = 0;
+    while (c < end) {
+        char utf8[4];
+        int utf8_length = 1;
+        if (*c != '\\') {
+            utf8[0] = *c++;
+        }
+        else {
+            c += 1;
+            switch (*c++) {
+                case '"':  utf8[0] = '"';  break;
+                case '\\': utf8[0] = '\\'; break;
+                case '/':  utf8[0] = '/';  break;
+                case 'b':  utf8[0] = '\b'; break;
+                case 'f':  utf8[0] = '\f'; break;
+                case 'n':  utf8[0] = '\n'; break;
+                case 'r':  utf8[0] = '\r'; break;
+                case 't':  utf8[0] = '\t'; break;
+                case 'u': {
+                    u32 codepoint = read_hex4(c, end);
+                    if (codepoint == 0xffffffff) return -1;
+                    c += 4;
+                    if (codepoint >= 0xd800 && codepoint < 0xdc00 && end - c >= 6 && c[0] == '\\' && c[1] == 'u') {
+                        u32 low = read_hex4(c + 2, end);
+                        if (low >= 0xdc00 && low < 0xe000) {
+                            codepoint = 0x10000 + ((codepoint - 0xd800) << 10) + (low - 0xdc00);
+                            c += 6;
+                        }
+                    }
+                    if (codepoint < 0x80) {
+                        utf8[0] = (char)codepoint;
+                    }
+                    else if (codepoint < 0x800) {
+                        utf8[0] = (char)(0xc0 | (codepoint >> 6));
+                        utf8[1] = (char)(0x80 | (codepoint & 0x3f));
+                        utf8_length = 2;
+                    }
+                    else if (codepoint < 0x10000) {
+                        utf8[0] = (char)(0xe0 | (codepoint >> 12));
+                        utf8[1] = (char)(0x80 | ((codepoint >> 6) & 0x3f));
+                        utf8[2] = (char)(0x80 | (codepoint & 0x3f));
+                        utf8_length = 3;
+                    }
+                    else {
+                        utf8[0] = (char)(0xf0 | (codepoint >> 18));
+                        utf8[1] = (char)(0x80 | ((codepoint >> 12) & 0x3f));
+                        utf8[2] = (char)(0x80 | ((codepoint >> 6) & 0x3f));
+                        utf8[3] = (char)(0x80 | (codepoint & 0x3f));
+                        utf8_length = 4;
+                    }
+                    break;
+                }
+                default: return -1;
+            }
+        }
+        if (length + utf8_length >= buffer_size) {
+            return -1;
+        }
+        memcpy(buffer + length, utf8, utf8_length);
+        length += utf8_length;
+    }
+    buffer[length] = '\0';
+    return length;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "basic.h"
+
+//
+// In-situ JSON tokenizer. One pass over the text makes a flat array of tokens that point back into
+// it, nothing is copied or converted until it's asked for. The text isn't modified either so it can
+// be a read-only file mapping.
+//
+// Tokens are stored in document order, a container's children come right after it. Every token has
+// the index of the token after its whole subtree in next, so walking the children of a container is
+//
+//   for (int child = json_first_child(json, container); child != -1; child = json_next_sibling(json, container, child))
+//
+// and object children go key, value, key, value. json_find() does that looking for a key.
+//
+// Numbers are parsed when they're read, strings are unescaped when they're copied out.
+//
+
+enum Json_Type : u8 {
+    JSON_OBJECT,
+    JSON_ARRAY,
+    JSON_STRING,
+    JSON_NUMBER,
+    JSON_TRUE,
+    JSON_FALSE,
+    JSON_NULL,
+};
+
+struct Json_Token {
+    u32 start;  // offset into the text. strings start after the opening quote.
+    u32 length; // strings don't include the quotes. containers cover the brackets.
+    u32 next;   // the token after this one and everything inside it
+    u32 count;  // number of elements for arrays, number of keys for objects
+    Json_Type type;
+    bool escaped; // strings with a backslash in them, json_equals() and json_copy_string() handle those
+};
+
+struct Json {
+    char *text;
+    i64 length;
+    Array<Json_Token> tokens; // tokens[0] is the root
+};
+
+// Returns false and prints where for anything that isn't valid JSON. text only has to live as long as
+// the Json does.
+bool parse_json(char *text, i64 length, Allocator allocator, Json *out_json);
+void destroy_json(Json *json);
+
+// -1 if the container is empty. For objects these walk the keys, the value is always key+1.
+int json_first_child(Json *json, int container);
+int json_next_sibling(Json *json, int container, int child);
+
+// Value for key in object, -1 if it's missing or object isn't an object.
+int json_find(Json *json, int object, const char *key);
+// The index'th element of array, -1 if there aren't that many. Walks the array, iterate with the
+// functions above instead of calling this in a loop.
+int json_index(Json *json, int array, int index);
+
+bool   json_equals(Json *json, int string, const char *str);
+double json_number(Json *json, int token, double fallback = 0); // fallback if token is -1 or not a number
+int    json_int(Json *json, int token, int fallback = 0);
+bool   json_bool(Json *json, int token, bool fallback = false);
+// Unescaped and null terminated. Returns the length, or -1 if it isn't a string or doesn't fit.
+int    json_copy_string(Json *json, int string, char *buffer, int buffer_size);
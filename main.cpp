@@ -2,16 +2,41 @@
 #include <stdlib.h>
 
 #define DEVELOPER
+// #define ASSIMP_IMPORT // cooks models that aren't glTF/GLB through assimp, links assimp-vc141-mtd.lib. without it only glTF/GLB can be cooked.
+// #define COMPARE_MODEL_LOAD_TIMES // prints how long sponza takes and how much memory it peaks at through assimp, the native glTF loader and the .cffmodel
+
+#if defined(COMPARE_MODEL_LOAD_TIMES) && !defined(ASSIMP_IMPORT)
+#define ASSIMP_IMPORT // the comparison loads through assimp too
+#endif
 
 #define CFF_APPLICATION_IMPLEMENTATION
 #include "application.h"
 #include "basic.h"
 #include "math.h"
 #include "renderer.h"
+#include "external/dearimgui/imgui.h"
 
 #ifdef DEVELOPER
+#include "model_import.cpp"
+#ifdef ASSIMP_IMPORT
 #include "assimp_loader.cpp"
 #endif
+#include "gltf_loader.cpp"
+#endif
+
+#ifdef COMPARE_MODEL_LOAD_TIMES
+#include <psapi.h>
+static u64 peak_working_set() {
+    PROCESS_MEMORY_COUNTERS counters = {};
+    GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+    return counters.PeakWorkingSetSize;
+}
+static u64 current_working_set() {
+    PROCESS_MEMORY_COUNTERS counters = {};
+    GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+    return counters.WorkingSetSize;
+}
+#endif
 
 /*
 TODO:
@@ -59,6 +84,10 @@ void main() {
     render_options.exposure_modifier = 0.1;
     render_options.ambient_modifier  = 1;
     render_options.do_shadows        = true;
+    render_options.depth_only_shadows = true;
+    render_options.do_mesh_lods      = true;
+    render_options.lod_pixel_error   = 1;
+    render_options.do_cluster_culling = true;
     render_options.sun_color         = v3(1, 0.7, 0.3);
     render_options.sun_intensity     = 200;
     render_options.do_fog            = true;
@@ -68,10 +97,75 @@ void main() {
     Model translucent_cube_model = create_cube_model(default_allocator());
     translucent_cube_model.meshes[0].material.has_transparency = true;
 
-    Model helmet_model = load_model_from_file("sponza/DamagedHelmet.gltf", default_allocator());
-    Model sponza_model = load_model_from_file("sponza/sponza.glb", default_allocator());
+#ifdef COMPARE_MODEL_LOAD_TIMES
+    {
+        // note(josh): each path gets its own texture cache so neither one gets the other's textures for free.
+        // windows can't reset the peak working set so the native loader goes first and is measured from
+        // the working set it started with, assimp is whatever it adds to the peak on top of that (0 if
+        // it never gets past it). the decoded textures are in both numbers.
+        u64 native_start_set = current_working_set();
+        Texture_Cache native_textures = make_texture_cache(default_allocator());
+        double native_start_time = time_now();
+        Model native_sponza = load_model_gltf("sponza/sponza.glb", default_allocator(), &native_textures, VL_COMPACT);
+        double native_time = time_now() - native_start_time;
+        u64 native_peak = peak_working_set() - native_start_set;
+        destroy_model(native_sponza);
+        destroy_texture_cache(&native_textures);
+
+        u64 assimp_start_peak = peak_working_set();
+        Texture_Cache assimp_textures = make_texture_cache(default_allocator());
+        double assimp_start_time = time_now();
+        Model assimp_sponza = load_model_from_file("sponza/sponza.glb", default_allocator(), &assimp_textures, VL_COMPACT);
+        double assimp_time = time_now() - assimp_start_time;
+        u64 assimp_peak_growth = peak_working_set() - assimp_start_peak;
+        print_texture_cache_stats(&assimp_textures);
+        destroy_model(assimp_sponza);
+        destroy_texture_cache(&assimp_textures);
+
+        ensure_model_cooked("sponza/sponza.glb", "sponza/sponza.cffmodel", default_allocator(), VL_COMPACT);
+        Texture_Cache cooked_textures = make_texture_cache(default_allocator());
+        double cooked_start_time = time_now();
+        Model cooked_sponza = {};
+        load_cooked_model("sponza/sponza.cffmodel", default_allocator(), &cooked_textures, &cooked_sponza, VL_COMPACT);
+        double cooked_time = time_now() - cooked_start_time;
+        destroy_model(cooked_sponza);
+        destroy_texture_cache(&cooked_textures);
+
+        printf("sponza load: assimp %.2fms, native glTF %.2fms, cooked %.2fms\n", assimp_time * 1000, native_time * 1000, cooked_time * 1000);
+        printf("sponza peak working set: native glTF +%.1fMB, assimp +%.1fMB on top of that\n", native_peak / (1024.0 * 1024.0), assimp_peak_growth / (1024.0 * 1024.0));
+    }
+#endif
+
+    Texture_Cache texture_cache = make_texture_cache(default_allocator());
+#ifdef DEVELOPER
+    Model helmet_model = load_model_cooked("sponza/DamagedHelmet.gltf", "sponza/DamagedHelmet.cffmodel", default_allocator(), &texture_cache, VL_COMPACT);
+    Model sponza_model = load_model_cooked("sponza/sponza.glb", "sponza/sponza.cffmodel", default_allocator(), &texture_cache, VL_COMPACT, true);
+#else
+    Model helmet_model = {};
+    Model sponza_model = {};
+    bool helmet_loaded = load_cooked_model("sponza/DamagedHelmet.cffmodel", default_allocator(), &texture_cache, &helmet_model, VL_COMPACT);
+    bool sponza_loaded = load_cooked_model("sponza/sponza.cffmodel", default_allocator(), &texture_cache, &sponza_model, VL_COMPACT, true);
+    assert(helmet_loaded && sponza_loaded);
+#endif
+    print_texture_cache_stats(&texture_cache);
     sponza_model.meshes[8].material.roughness = 0.2;
 
+    double bvh_build_start_time = time_now();
+    build_model_bvhs(&helmet_model, default_allocator());
+    build_model_bvhs(&sponza_model, default_allocator());
+    Array<BVH_Instance> bvh_instances = make_array<BVH_Instance>(default_allocator(), helmet_model.meshes.count + sponza_model.meshes.count);
+    append_bvh_instances(&helmet_model, construct_model_matrix(v3(0, 4, 0), v3(1, 1, 1), axis_angle(v3(0, 1, 0), to_radians(90))), &bvh_instances);
+    append_bvh_instances(&sponza_model, m4_identity(), &bvh_instances);
+    Scene_BVH scene_bvh = build_scene_bvh(bvh_instances.data, bvh_instances.count, default_allocator());
+    printf("Built BVHs for %d meshes in %.2fms\n", bvh_instances.count, (time_now() - bvh_build_start_time) * 1000);
+    int num_helmet_instances = helmet_model.meshes.count;
+    bvh_instances.destroy(); // build_scene_bvh() keeps its own copy
+
+    double cluster_build_start_time = time_now();
+    build_model_clusters(&helmet_model, default_allocator());
+    build_model_clusters(&sponza_model, default_allocator());
+    printf("Built clusters for %d meshes in %.2fms\n", helmet_model.meshes.count + sponza_model.meshes.count, (time_now() - cluster_build_start_time) * 1000);
+
     Vector3 camera_position = {};
     Quaternion camera_orientation = quaternion_identity();
 
@@ -126,6 +220,22 @@ void main() {
             camera_orientation = result;
         }
 
+        // what's under the middle of the screen, picked through the scene BVH
+        if (ImGui::Begin("Picking")) {
+            Ray ray = {camera_position, quaternion_forward(camera_orientation)};
+            BVH_Ray_Hit hit;
+            if (bvh_raycast(&scene_bvh, ray, FLT_MAX, &hit)) {
+                bool is_helmet = hit.instance < num_helmet_instances;
+                int mesh = is_helmet ? hit.instance : hit.instance - num_helmet_instances;
+                ImGui::Text("%s mesh %d, triangle %d", is_helmet ? "helmet" : "sponza", mesh, hit.triangle);
+                ImGui::Text("distance %.2f", hit.t);
+            }
+            else {
+                ImGui::Text("nothing");
+            }
+        }
+        ImGui::End();
+
         render_queue.clear();
 
         Draw_Command helmet_draw_command = {};
@@ -160,4 +270,6 @@ void main() {
         dear_imgui_render(true);
         present(true);
     }
+
+    destroy_scene_bvh(&scene_bvh);
 }
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "math.h"
+#include "simd.h"
 
 #include <math.h>
 
@@ -424,8 +425,19 @@ Quaternion axis_angle(Vector3 axis, float angle_radians) {
 }
 
 Quaternion slerp(Quaternion a, Quaternion b, float t) {
+    // note(josh): take the short way around. q and -q are the same rotation.
     float cos_theta = dot(a, b);
-    float angle = cos(cos_theta);
+    if (cos_theta < 0) {
+        b = -b;
+        cos_theta = -cos_theta;
+    }
+
+    // nearly parallel, sin(angle) goes to zero so just nlerp
+    if (cos_theta > 0.9995f) {
+        return nlerp(a, b, t);
+    }
+
+    float angle = acos(cos_theta);
 
     float s1 = sin((1.0f - t) * angle);
     float s2 = sin(t * angle);
@@ -439,6 +451,14 @@ Quaternion slerp(Quaternion a, Quaternion b, float t) {
     return result;
 }
 
+Quaternion nlerp(Quaternion a, Quaternion b, float t) {
+    if (dot(a, b) < 0) {
+        b = -b;
+    }
+    Quaternion result = (a * (1.0f - t)) + (b * t);
+    return normalize(result);
+}
+
 Quaternion quaternion_difference(Quaternion a, Quaternion b) {
     if (dot(a, b) < 0) {
         return normalize(inverse(a) * -b);
@@ -864,17 +884,120 @@ Matrix4 construct_view_matrix(Vector3 position, Quaternion orientation) {
 }
 
 Matrix4 construct_model_matrix(Vector3 position, Vector3 scale, Quaternion orientation) {
-    Matrix4 t = construct_translation_matrix(position);
-    Matrix4 s = construct_scale_matrix(scale);
-    Matrix4 r = quaternion_to_matrix4(orientation);
-    Matrix4 model_matrix = (t * r) * s;
-    return model_matrix;
+    return construct_trs_matrix(position, orientation, scale);
 }
 
+// note(josh): this is translation * rotation * scale written out directly instead of building
+// three Matrix4s and multiplying them together. the rotation part is scaled by 2/|q|^2 rather
+// than normalizing q first, which gives the same result as quaternion_to_matrix4(normalize(q))
+// without the sqrt. only the 12 meaningful terms are computed, the last row is always 0 0 0 1.
 Matrix4 construct_trs_matrix(Vector3 t, Quaternion r, Vector3 s) {
-    Matrix4 translation = construct_translation_matrix(t);
-    Matrix4 rotation = quaternion_to_matrix4(r);
-    Matrix4 scale = construct_scale_matrix(s);
-    return translation * (rotation * scale);
-}
+    float sqr_len = (r.x*r.x) + (r.y*r.y) + (r.z*r.z) + (r.w*r.w);
+    float s2 = 2.0f / sqr_len;
+
+    float xx = r.x * r.x * s2;
+    float yy = r.y * r.y * s2;
+    float zz = r.z * r.z * s2;
+    float xy = r.x * r.y * s2;
+    float xz = r.x * r.z * s2;
+    float yz = r.y * r.z * s2;
+    float wx = r.w * r.x * s2;
+    float wy = r.w * r.y * s2;
+    float wz = r.w * r.z * s2;
+
+    Matrix4 result;
 
+    result.elements[0][0] = (1.0f - (yy + zz)) * s.x;
+    result.elements[0][1] = (xy + wz)          * s.x;
+    result.elements[0][2] = (xz - wy)          * s.x;
+    result.elements[0][3] = 0.0f;
+
+    result.elements[1][0] = (xy - wz)          * s.y;
+    result.elements[1][1] = (1.0f - (xx + zz)) * s.y;
+    result.elements[1][2] = (yz + wx)          * s.y;
+    result.elements[1][3] = 0.0f;
+
+    result.elements[2][0] = (xz + wy)          * s.z;
+    result.elements[2][1] = (yz - wx)          * s.z;
+    result.elements[2][2] = (1.0f - (xx + yy)) * s.z;
+    result.elements[2][3] = 0.0f;
+
+    result.elements[3][0] = t.x;
+    result.elements[3][1] = t.y;
+    result.elements[3][2] = t.z;
+    result.elements[3][3] = 1.0f;
+
+    return result;
+}
+
+void construct_model_matrices(Matrix4 *out_matrices, Transform_Stream *transforms) {
+    Transform_Stream *ts = transforms;
+    f32xN one = f32xN_set1(1.0f);
+    f32xN two = f32xN_set1(2.0f);
+    int count = ts->count;
+    int i = 0;
+    for (; i + SIMD_WIDTH <= count; i += SIMD_WIDTH) {
+        f32xN qx = f32xN_load(ts->qx + i);
+        f32xN qy = f32xN_load(ts->qy + i);
+        f32xN qz = f32xN_load(ts->qz + i);
+        f32xN qw = f32xN_load(ts->qw + i);
+        f32xN sx = f32xN_load(ts->sx + i);
+        f32xN sy = f32xN_load(ts->sy + i);
+        f32xN sz = f32xN_load(ts->sz + i);
+
+        // see construct_trs_matrix()
+        f32xN sqr_len = f32xN_madd(qw, qw, f32xN_madd(qz, qz, f32xN_madd(qy, qy, f32xN_mul(qx, qx))));
+        f32xN s2 = f32xN_div(two, sqr_len);
+        f32xN x2 = f32xN_mul(qx, s2);
+        f32xN y2 = f32xN_mul(qy, s2);
+        f32xN z2 = f32xN_mul(qz, s2);
+        f32xN xx = f32xN_mul(qx, x2);
+        f32xN yy = f32xN_mul(qy, y2);
+        f32xN zz = f32xN_mul(qz, z2);
+        f32xN xy = f32xN_mul(qx, y2);
+        f32xN xz = f32xN_mul(qx, z2);
+        f32xN yz = f32xN_mul(qy, z2);
+        f32xN wx = f32xN_mul(qw, x2);
+        f32xN wy = f32xN_mul(qw, y2);
+        f32xN wz = f32xN_mul(qw, z2);
+
+        // note(josh): the 9 rotation*scale terms go through the stack to get back to one matrix per
+        // lane, the translation is copied straight from the input arrays below
+        float terms[9][SIMD_WIDTH];
+        f32xN_store(terms[0], f32xN_mul(f32xN_sub(one, f32xN_add(yy, zz)), sx));
+        f32xN_store(terms[1], f32xN_mul(f32xN_add(xy, wz), sx));
+        f32xN_store(terms[2], f32xN_mul(f32xN_sub(xz, wy), sx));
+        f32xN_store(terms[3], f32xN_mul(f32xN_sub(xy, wz), sy));
+        f32xN_store(terms[4], f32xN_mul(f32xN_sub(one, f32xN_add(xx, zz)), sy));
+        f32xN_store(terms[5], f32xN_mul(f32xN_add(yz, wx), sy));
+        f32xN_store(terms[6], f32xN_mul(f32xN_add(xz, wy), sz));
+        f32xN_store(terms[7], f32xN_mul(f32xN_sub(yz, wx), sz));
+        f32xN_store(terms[8], f32xN_mul(f32xN_sub(one, f32xN_add(xx, yy)), sz));
+
+        for (int lane = 0; lane < SIMD_WIDTH; lane++) {
+            Matrix4 *m = &out_matrices[i + lane];
+            m->elements[0][0] = terms[0][lane];
+            m->elements[0][1] = terms[1][lane];
+            m->elements[0][2] = terms[2][lane];
+            m->elements[0][3] = 0.0f;
+            m->elements[1][0] = terms[3][lane];
+            m->elements[1][1] = terms[4][lane];
+            m->elements[1][2] = terms[5][lane];
+            m->elements[1][3] = 0.0f;
+            m->elements[2][0] = terms[6][lane];
+            m->elements[2][1] = terms[7][lane];
+            m->elements[2][2] = terms[8][lane];
+            m->elements[2][3] = 0.0f;
+            m->elements[3][0] = ts->px[i + lane];
+            m->elements[3][1] = ts->py[i + lane];
+            m->elements[3][2] = ts->pz[i + lane];
+            m->elements[3][3] = 1.0f;
+        }
+    }
+    for (; i < count; i++) {
+        Vector3 t = v3(ts->px[i], ts->py[i], ts->pz[i]);
+        Vector3 s = v3(ts->sx[i], ts->sy[i], ts->sz[i]);
+        Quaternion r = quaternion(ts->qx[i], ts->qy[i], ts->qz[i], ts->qw[i]);
+        out_matrices[i] = construct_trs_matrix(t, r, s);
+    }
+}
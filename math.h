@@ -178,6 +178,7 @@ Quaternion normalize          (Quaternion q);
 Quaternion inverse            (Quaternion q);
 Quaternion axis_angle         (Vector3 axis, float angle_radians);
 Quaternion slerp              (Quaternion a, Quaternion b, float t);
+Quaternion nlerp              (Quaternion a, Quaternion b, float t);
 Quaternion quaternion_difference(Quaternion a, Quaternion b);
 float      angle_between_quaternions(Quaternion a, Quaternion b);
 Vector3    quaternion_right   (Quaternion q);
@@ -243,4 +244,23 @@ Quaternion quaternion_look_at   (Vector3 eye, Vector3 center, Vector3 up);
 
 Matrix4 construct_view_matrix (Vector3 position, Quaternion orientation);
 Matrix4 construct_model_matrix(Vector3 position, Vector3 scale, Quaternion orientation);
-Matrix4 construct_trs_matrix(Vector3 t, Quaternion r, Vector3 s);
\ No newline at end of file
+Matrix4 construct_trs_matrix(Vector3 t, Quaternion r, Vector3 s);
+
+// structure-of-arrays transforms, one float array per component. the caller owns the arrays.
+struct Transform_Stream {
+    float *px = {};
+    float *py = {};
+    float *pz = {};
+    float *sx = {};
+    float *sy = {};
+    float *sz = {};
+    float *qx = {};
+    float *qy = {};
+    float *qz = {};
+    float *qw = {};
+    int count = {};
+};
+
+// builds transforms->count model matrices, equivalent to calling construct_model_matrix() on each
+// element, just SIMD_WIDTH of them at a time.
+void construct_model_matrices(Matrix4 *out_matrices, Transform_Stream *transforms);
@@ -0,0 +1,1364 @@
+#include "mesh_optimizer.h"
+
+#include "math.h"
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+
+struct Vertex_Hasher {
+    byte *vertices;
+    int vertex_size;
+    float inverse_epsilon; // 0 for bytewise comparisons
+};
+
+static inline u32 hash_mix(u32 h, u32 k) {
+    // note(josh): murmur2's inner loop
+    k *= 0x5bd1e995;
+    k ^= k >> 24;
+    k *= 0x5bd1e995;
+    h *= 0x5bd1e995;
+    h ^= k;
+    return h;
+}
+
+static inline i32 snap_to_grid(float value, float inverse_epsilon) {
+    return (i32)floorf(value * inverse_epsilon + 0.5f);
+}
+
+static u32 hash_vertex(Vertex_Hasher *hasher, u32 index) {
+    byte *vertex = hasher->vertices + (u64)index * hasher->vertex_size;
+    u32 h = 0;
+    if (hasher->inverse_epsilon > 0) {
+        for (int i = 0; i < hasher->vertex_size / 4; i++) {
+            float value;
+            memcpy(&value, vertex + i * 4, 4);
+            h = hash_mix(h, (u32)snap_to_grid(value, hasher->inverse_epsilon));
+        }
+        return h;
+    }
+
+    int i = 0;
+    for (; i + 4 <= hasher->vertex_size; i += 4) {
+        u32 word;
+        memcpy(&word, vertex + i, 4);
+        h = hash_mix(h, word);
+    }
+    for (; i < hasher->vertex_size; i++) {
+        h = hash_mix(h, vertex[i]);
+    }
+    return h;
+}
+
+static bool vertices_equal(Vertex_Hasher *hasher, u32 a, u32 b) {
+    byte *vertex_a = hasher->vertices + (u64)a * hasher->vertex_size;
+    byte *vertex_b = hasher->vertices + (u64)b * hasher->vertex_size;
+    if (hasher->inverse_epsilon > 0) {
+        for (int i = 0; i < hasher->vertex_size / 4; i++) {
+            float value_a, value_b;
+            memcpy(&value_a, vertex_a + i * 4, 4);
+            memcpy(&value_b, vertex_b + i * 4, 4);
+            if (snap_to_grid(value_a, hasher->inverse_epsilon) != snap_to_grid(value_b, hasher->inverse_epsilon)) {
+                return false;
+            }
+        }
+        return true;
+    }
+    return memcmp(vertex_a, vertex_b, hasher->vertex_size) == 0;
+}
+
+int generate_vertex_remap(u32 *out_remap, u32 *indices, int num_indices, void *vertices, int num_vertices, int vertex_size, float epsilon) {
+    assert(indices != nullptr || num_indices == num_vertices);
+    assert(epsilon == 0 || vertex_size % 4 == 0);
+    memset(out_remap, 0xff, sizeof(u32) * num_vertices);
+
+    Vertex_Hasher hasher = {};
+    hasher.vertices = (byte *)vertices;
+    hasher.vertex_size = vertex_size;
+    hasher.inverse_epsilon = epsilon > 0 ? 1.0f / epsilon : 0;
+
+    // open addressing, holds vertex indices. at most half full so probes stay short.
+    i64 table_size = next_power_of_2((i64)num_vertices * 2);
+    if (table_size < 16) table_size = 16;
+    u32 *table = (u32 *)alloc(default_allocator(), sizeof(u32) * table_size);
+    defer(free(default_allocator(), table));
+    memset(table, 0xff, sizeof(u32) * table_size);
+    u32 table_mask = (u32)(table_size - 1);
+
+    int num_unique = 0;
+    for (int i = 0; i < num_indices; i++) {
+        u32 index = indices ? indices[i] : (u32)i;
+        assert(index < (u32)num_vertices);
+        if (out_remap[index] != MESH_REMAP_UNUSED) {
+            continue;
+        }
+
+        u32 slot = hash_vertex(&hasher, index) & table_mask;
+        for (;;) {
+            u32 existing = table[slot];
+            if (existing == MESH_REMAP_UNUSED) {
+                table[slot] = index;
+                out_remap[index] = num_unique++;
+                break;
+            }
+            if (vertices_equal(&hasher, existing, index)) {
+                out_remap[index] = out_remap[existing];
+                break;
+            }
+            slot = (slot + 1) & table_mask;
+        }
+    }
+    return num_unique;
+}
+
+void remap_vertex_buffer(void *out_vertices, void *vertices, int num_vertices, int vertex_size, u32 *remap) {
+    assert(out_vertices != vertices);
+    for (int i = 0; i < num_vertices; i++) {
+        if (remap[i] != MESH_REMAP_UNUSED) {
+            memcpy((byte *)out_vertices + (u64)remap[i] * vertex_size, (byte *)vertices + (u64)i * vertex_size, vertex_size);
+        }
+    }
+}
+
+void remap_index_buffer(u32 *out_indices, u32 *indices, int num_indices, u32 *remap) {
+    for (int i = 0; i < num_indices; i++) {
+        u32 index = indices ? indices[i] : (u32)i;
+        assert(remap[index] != MESH_REMAP_UNUSED);
+        out_indices[i] = remap[index];
+    }
+}
+
+
+
+struct Triangle_Adjacency {
+    u32 *counts;    // triangles using each vertex
+    u32 *offsets;   // into triangles
+    u32 *triangles;
+};
+
+static Triangle_Adjacency build_triangle_adjacency(u32 *indices, int num_indices, int num_vertices, Allocator allocator) {
+    Triangle_Adjacency adjacency = {};
+    adjacency.counts = (u32 *)alloc(allocator, sizeof(u32) * (num_vertices + 1));
+    adjacency.offsets = (u32 *)alloc(allocator, sizeof(u32) * (num_vertices + 1));
+    adjacency.triangles = (u32 *)alloc(allocator, sizeof(u32) * (num_indices + 1));
+    memset(adjacency.counts, 0, sizeof(u32) * num_vertices);
+    for (int i = 0; i < num_indices; i++) {
+        assert(indices[i] < (u32)num_vertices);
+        adjacency.counts[indices[i]] += 1;
+    }
+    u32 offset = 0;
+    for (int v = 0; v < num_vertices; v++) {
+        adjacency.offsets[v] = offset;
+        offset += adjacency.counts[v];
+    }
+    for (int i = 0; i < num_indices; i++) {
+        u32 v = indices[i];
+        adjacency.triangles[adjacency.offsets[v]++] = i / 3;
+    }
+    // the fill pass moved every offset to the end of its range, move them back
+    for (int v = 0; v < num_vertices; v++) {
+        adjacency.offsets[v] -= adjacency.counts[v];
+    }
+    return adjacency;
+}
+
+static void destroy_triangle_adjacency(Triangle_Adjacency *adjacency, Allocator allocator) {
+    free(allocator, adjacency->counts);
+    free(allocator, adjacency->offsets);
+    free(allocator, adjacency->triangles);
+}
+
+// note(josh): a FIFO cache can be simulated with a timestamp per vertex: a vertex is in the cache if
+// fewer than cache_size vertices were added since it was. time starts at cache_size+1 so nothing is
+// in the cache to begin with, resetting is just moving time forward by cache_size+1.
+static inline bool fifo_cache_miss(u32 *cache_times, u32 *time, u32 vertex, int cache_size) {
+    if (*time - cache_times[vertex] > (u32)cache_size) {
+        cache_times[vertex] = *time;
+        *time += 1;
+        return true;
+    }
+    return false;
+}
+
+void optimize_vertex_cache(u32 *out_indices, u32 *indices, int num_indices, int num_vertices, int cache_size, u32 *out_clusters, int *out_num_clusters) {
+    assert(num_indices % 3 == 0);
+    assert(out_indices != indices);
+    Allocator allocator = default_allocator();
+    int num_triangles = num_indices / 3;
+    if (out_num_clusters) *out_num_clusters = 0;
+    if (num_triangles == 0) {
+        return;
+    }
+
+    Triangle_Adjacency adjacency = build_triangle_adjacency(indices, num_indices, num_vertices, allocator);
+    defer(destroy_triangle_adjacency(&adjacency, allocator));
+
+    u32 *live_triangles = (u32 *)alloc(allocator, sizeof(u32) * num_vertices);
+    defer(free(allocator, live_triangles));
+    memcpy(live_triangles, adjacency.counts, sizeof(u32) * num_vertices);
+
+    u32 *cache_times = (u32 *)alloc(allocator, sizeof(u32) * num_vertices);
+    defer(free(allocator, cache_times));
+    memset(cache_times, 0, sizeof(u32) * num_vertices);
+
+    bool *emitted = (bool *)alloc(allocator, sizeof(bool) * num_triangles);
+    defer(free(allocator, emitted));
+    memset(emitted, 0, sizeof(bool) * num_triangles);
+
+    // every emitted index gets pushed once, so this can't overflow
+    u32 *dead_end_stack = (u32 *)alloc(allocator, sizeof(u32) * num_indices);
+    defer(free(allocator, dead_end_stack));
+    int dead_end_top = 0;
+
+    Array<u32> candidates = make_array<u32>(allocator, 64);
+    defer(candidates.destroy());
+
+    u32 time = cache_size + 1;
+    int scan_cursor = 0;
+    int num_emitted = 0;
+    int fan_vertex = 0;
+    while (scan_cursor < num_vertices && live_triangles[scan_cursor] == 0) scan_cursor++;
+    fan_vertex = scan_cursor < num_vertices ? scan_cursor : -1;
+    while (fan_vertex >= 0) {
+        // a fan that starts on a vertex that isn't cached anymore is a cold restart, which is where the
+        // overdraw optimizer is allowed to cut
+        if (out_clusters && time - cache_times[fan_vertex] > (u32)cache_size) {
+            out_clusters[(*out_num_clusters)++] = num_emitted;
+        }
+
+        candidates.clear();
+        u32 *fan = &adjacency.triangles[adjacency.offsets[fan_vertex]];
+        for (u32 i = 0; i < adjacency.counts[fan_vertex]; i++) {
+            u32 triangle = fan[i];
+            if (emitted[triangle]) {
+                continue;
+            }
+            emitted[triangle] = true;
+            for (int corner = 0; corner < 3; corner++) {
+                u32 vertex = indices[triangle * 3 + corner];
+                out_indices[num_emitted * 3 + corner] = vertex;
+                dead_end_stack[dead_end_top++] = vertex;
+                candidates.append(vertex);
+                live_triangles[vertex] -= 1;
+                fifo_cache_miss(cache_times, &time, vertex, cache_size);
+            }
+            num_emitted += 1;
+        }
+
+        // next fan: the candidate that will still be in the cache after its remaining triangles go
+        // through, and the oldest of those since it's about to fall out
+        int next = -1;
+        int best_priority = -1;
+        Foreach (candidate, candidates) {
+            if (live_triangles[*candidate] == 0) {
+                continue;
+            }
+            int priority = 0;
+            int age = (int)(time - cache_times[*candidate]);
+            if (age + 2 * (int)live_triangles[*candidate] <= cache_size) {
+                priority = age;
+            }
+            if (priority > best_priority) {
+                best_priority = priority;
+                next = *candidate;
+            }
+        }
+        while (next == -1 && dead_end_top > 0) {
+            u32 vertex = dead_end_stack[--dead_end_top];
+            if (live_triangles[vertex] > 0) {
+                next = vertex;
+            }
+        }
+        while (next == -1 && scan_cursor < num_vertices) {
+            if (live_triangles[scan_cursor] > 0) {
+                next = scan_cursor;
+            }
+            else {
+                scan_cursor += 1;
+            }
+        }
+        fan_vertex = next;
+    }
+    assert(num_emitted == num_triangles);
+}
+
+static int count_triangle_misses(u32 *cache_times, u32 *time, u32 *triangle, int cache_size) {
+    int misses = 0;
+    for (int corner = 0; corner < 3; corner++) {
+        misses += fifo_cache_miss(cache_times, time, triangle[corner], cache_size);
+    }
+    return misses;
+}
+
+struct Overdraw_Cluster {
+    int start;
+    int count; // triangles
+    float sort_key;
+};
+
+void optimize_overdraw(u32 *out_indices, u32 *indices, int num_indices, void *positions, int num_vertices, int vertex_stride, float threshold, int cache_size) {
+    assert(num_indices % 3 == 0);
+    assert(out_indices != indices);
+    Allocator allocator = default_allocator();
+    int num_triangles = num_indices / 3;
+    if (num_triangles == 0) {
+        return;
+    }
+
+    u32 *cache_times = (u32 *)alloc(allocator, sizeof(u32) * num_vertices);
+    defer(free(allocator, cache_times));
+    memset(cache_times, 0, sizeof(u32) * num_vertices);
+    u32 time = cache_size + 1;
+
+    // hard boundaries wherever a triangle misses on all three vertices, the cache is cold there
+    // anyway so drawing the pieces in a different order costs nothing
+    Array<int> hard_boundaries = make_array<int>(allocator, 64);
+    defer(hard_boundaries.destroy());
+    for (int i = 0; i < num_triangles; i++) {
+        if (count_triangle_misses(cache_times, &time, &indices[i * 3], cache_size) == 3 || i == 0) {
+            hard_boundaries.append(i);
+        }
+    }
+    hard_boundaries.append(num_triangles);
+
+    // soft boundaries: split each hard cluster as soon as the piece so far is within threshold of the
+    // cluster's own ACMR, so the extra cold starts only cost what threshold allows
+    Array<Overdraw_Cluster> clusters = make_array<Overdraw_Cluster>(allocator, hard_boundaries.count * 2);
+    defer(clusters.destroy());
+    for (int h = 0; h + 1 < hard_boundaries.count; h++) {
+        int start = hard_boundaries[h];
+        int end = hard_boundaries[h + 1];
+        time += cache_size + 1;
+        int cluster_misses = 0;
+        for (int i = start; i < end; i++) {
+            cluster_misses += count_triangle_misses(cache_times, &time, &indices[i * 3], cache_size);
+        }
+        float cluster_threshold = threshold * (float)cluster_misses / (float)(end - start);
+
+        time += cache_size + 1;
+        int piece_start = start;
+        int piece_misses = 0;
+        for (int i = start; i < end; i++) {
+            piece_misses += count_triangle_misses(cache_times, &time, &indices[i * 3], cache_size);
+            int piece_triangles = i - piece_start + 1;
+            if ((float)piece_misses / (float)piece_triangles <= cluster_threshold) {
+                clusters.append({piece_start, piece_triangles, 0});
+                piece_start = i + 1;
+                piece_misses = 0;
+                time += cache_size + 1;
+            }
+        }
+        if (piece_start < end) {
+            clusters.append({piece_start, end - piece_start, 0});
+        }
+    }
+
+    // sort by how much each cluster faces away from the middle of the mesh, outward facing ones go first
+    byte *position_data = (byte *)positions;
+    #define CLUSTER_POSITION(index) (*(Vector3 *)(position_data + (u64)(index) * vertex_stride))
+    Vector3 mesh_centroid = {};
+    float mesh_area = 0;
+    for (int i = 0; i < num_triangles; i++) {
+        Vector3 a = CLUSTER_POSITION(indices[i * 3 + 0]);
+        Vector3 b = CLUSTER_POSITION(indices[i * 3 + 1]);
+        Vector3 c = CLUSTER_POSITION(indices[i * 3 + 2]);
+        float area = length(cross(b - a, c - a));
+        mesh_centroid += (a + b + c) * (area / 3.0f);
+        mesh_area += area;
+    }
+    if (mesh_area > 0) {
+        mesh_centroid = mesh_centroid / mesh_area;
+    }
+    Foreach (cluster, clusters) {
+        Vector3 centroid = {};
+        Vector3 normal = {};
+        float area = 0;
+        for (int i = cluster->start; i < cluster->start + cluster->count; i++) {
+            Vector3 a = CLUSTER_POSITION(indices[i * 3 + 0]);
+            Vector3 b = CLUSTER_POSITION(indices[i * 3 + 1]);
+            Vector3 c = CLUSTER_POSITION(indices[i * 3 + 2]);
+            Vector3 n = cross(b - a, c - a); // length is twice the area, which is the weight we want
+            float triangle_area = length(n);
+            centroid += (a + b + c) * (triangle_area / 3.0f);
+            normal += n;
+            area += triangle_area;
+        }
+        float normal_length = length(normal);
+        if (area > 0 && normal_length > 0) {
+            cluster->sort_key = dot(centroid / area - mesh_centroid, normal / normal_length);
+        }
+    }
+    #undef CLUSTER_POSITION
+
+    // note(josh): insertion sort would be quadratic on big meshes and qsort isn't stable, so sort an
+    // index array and tie-break on the original order
+    Array<int> order = make_array<int>(allocator, clusters.count);
+    defer(order.destroy());
+    For (i, clusters) {
+        order.append(i);
+    }
+    std::stable_sort(order.data, order.data + order.count, [&](int a, int b) { return clusters[a].sort_key > clusters[b].sort_key; });
+
+    int num_written = 0;
+    Foreach (cluster_index, order) {
+        Overdraw_Cluster *cluster = &clusters[*cluster_index];
+        memcpy(&out_indices[num_written], &indices[cluster->start * 3], sizeof(u32) * 3 * cluster->count);
+        num_written += cluster->count * 3;
+    }
+    assert(num_written == num_indices);
+}
+
+int optimize_vertex_fetch_remap(u32 *out_remap, u32 *indices, int num_indices, int num_vertices) {
+    memset(out_remap, 0xff, sizeof(u32) * num_vertices);
+    int next = 0;
+    for (int i = 0; i < num_indices; i++) {
+        u32 index = indices[i];
+        assert(index < (u32)num_vertices);
+        if (out_remap[index] == MESH_REMAP_UNUSED) {
+            out_remap[index] = next++;
+        }
+    }
+    return next;
+}
+
+
+
+struct Quadric {
+    // x^T a x + 2 b.x + c with a symmetric, and the triangle area that went into it
+    float a00, a11, a22, a01, a02, a12;
+    float b0, b1, b2;
+    float c;
+    float weight;
+};
+
+static Quadric plane_quadric(Vector3 normal, float distance, float weight) {
+    Quadric q = {};
+    q.a00 = weight * normal.x * normal.x;
+    q.a11 = weight * normal.y * normal.y;
+    q.a22 = weight * normal.z * normal.z;
+    q.a01 = weight * normal.x * normal.y;
+    q.a02 = weight * normal.x * normal.z;
+    q.a12 = weight * normal.y * normal.z;
+    q.b0 = weight * normal.x * distance;
+    q.b1 = weight * normal.y * distance;
+    q.b2 = weight * normal.z * distance;
+    q.c = weight * distance * distance;
+    q.weight = weight;
+    return q;
+}
+
+static void quadric_add(Quadric *q, Quadric *other) {
+    float *dst = &q->a00;
+    float *src = &other->a00;
+    for (int i = 0; i < (int)(sizeof(Quadric) / sizeof(float)); i++) {
+        dst[i] += src[i];
+    }
+}
+
+static float quadric_error(Quadric *q, Vector3 p) {
+    float rx = q->a00 * p.x + q->a01 * p.y + q->a02 * p.z;
+    float ry = q->a01 * p.x + q->a11 * p.y + q->a12 * p.z;
+    float rz = q->a02 * p.x + q->a12 * p.y + q->a22 * p.z;
+    float error = p.x * rx + p.y * ry + p.z * rz + 2 * (q->b0 * p.x + q->b1 * p.y + q->b2 * p.z) + q->c;
+    return error > 0 ? error : 0; // float cancellation can take it slightly under
+}
+
+// note(josh): for attributes, each triangle's values are fit with a linear function g.x + d across its
+// plane and a vertex's error is how far its value is from that at its position, summed over the
+// triangles like the plane distances are (Hoppe 1999). an attribute that changes linearly over the
+// surface costs nothing to simplify, it just gets interpolated across the bigger triangles.
+struct Attribute_Quadric {
+    float gg00, gg11, gg22, gg01, gg02, gg12; // sum of w g g^T
+    float gd0, gd1, gd2;                      // sum of w g d
+    float g0, g1, g2;                         // sum of w g
+    float d;                                  // sum of w d
+    float dd;                                 // sum of w d^2
+};
+
+static Attribute_Quadric attribute_quadric(Vector3 p0, Vector3 p1, Vector3 p2, float a0, float a1, float a2, float weight) {
+    // gradient g = s e1 + t e2 in the triangle's plane with g.e1 = a1-a0 and g.e2 = a2-a0
+    Vector3 e1 = p1 - p0;
+    Vector3 e2 = p2 - p0;
+    float d11 = dot(e1, e1);
+    float d12 = dot(e1, e2);
+    float d22 = dot(e2, e2);
+    float determinant = d11 * d22 - d12 * d12;
+    Attribute_Quadric q = {};
+    if (determinant == 0) return q;
+    float s = ((a1 - a0) * d22 - (a2 - a0) * d12) / determinant;
+    float t = ((a2 - a0) * d11 - (a1 - a0) * d12) / determinant;
+    Vector3 g = e1 * s + e2 * t;
+    float d = a0 - dot(g, p0);
+    q.gg00 = weight * g.x * g.x;
+    q.gg11 = weight * g.y * g.y;
+    q.gg22 = weight * g.z * g.z;
+    q.gg01 = weight * g.x * g.y;
+    q.gg02 = weight * g.x * g.z;
+    q.gg12 = weight * g.y * g.z;
+    q.gd0 = weight * g.x * d;
+    q.gd1 = weight * g.y * d;
+    q.gd2 = weight * g.z * d;
+    q.g0 = weight * g.x;
+    q.g1 = weight * g.y;
+    q.g2 = weight * g.z;
+    q.d = weight * d;
+    q.dd = weight * d * d;
+    return q;
+}
+
+static void attribute_quadric_add(Attribute_Quadric *q, Attribute_Quadric *other) {
+    float *dst = &q->gg00;
+    float *src = &other->gg00;
+    for (int i = 0; i < (int)(sizeof(Attribute_Quadric) / sizeof(float)); i++) {
+        dst[i] += src[i];
+    }
+}
+
+enum Simplify_Vertex_Kind : u8 {
+    SVK_MANIFOLD, // one wedge, free to move anywhere
+    SVK_SEAM,     // several wedges at the same position, can only move along the seam
+    SVK_LOCKED,   // on an open border or a non-manifold edge, never moves
+};
+
+struct Simplifier {
+    u32 *indices;
+    Triangle_Adjacency adjacency;
+    Vector3 *points;    // scaled to the unit cube
+    u32 *groups;        // vertices at the same position share a group
+    u32 *wedge_next;    // circular list of the used vertices in each group
+    u8 *kinds;          // per group, Simplify_Vertex_Kind
+    Quadric *quadrics;  // per vertex
+
+    int num_attributes;
+    float *attributes;                      // num_attributes per vertex, already multiplied by their weights
+    Attribute_Quadric *attribute_quadrics;  // num_attributes per vertex
+};
+
+static float attribute_error(Simplifier *s, u32 vertex, u32 target) {
+    Vector3 p = s->points[target];
+    float weight = s->quadrics[vertex].weight;
+    float error = 0;
+    for (int i = 0; i < s->num_attributes; i++) {
+        Attribute_Quadric *q = &s->attribute_quadrics[(u64)vertex * s->num_attributes + i];
+        float value = s->attributes[(u64)target * s->num_attributes + i];
+        float rx = q->gg00 * p.x + q->gg01 * p.y + q->gg02 * p.z;
+        float ry = q->gg01 * p.x + q->gg11 * p.y + q->gg12 * p.z;
+        float rz = q->gg02 * p.x + q->gg12 * p.y + q->gg22 * p.z;
+        error += p.x * rx + p.y * ry + p.z * rz
+               + 2 * (q->gd0 * p.x + q->gd1 * p.y + q->gd2 * p.z)
+               - 2 * value * (q->g0 * p.x + q->g1 * p.y + q->g2 * p.z + q->d)
+               + value * value * weight + q->dd;
+    }
+    return error > 0 ? error : 0;
+}
+
+// the wedge of target_group that shares a triangle with vertex, MESH_REMAP_UNUSED if there isn't one
+static u32 find_wedge_target(Simplifier *s, u32 vertex, u32 target_group) {
+    u32 *triangles = &s->adjacency.triangles[s->adjacency.offsets[vertex]];
+    for (u32 t = 0; t < s->adjacency.counts[vertex]; t++) {
+        u32 *triangle = &s->indices[triangles[t] * 3];
+        for (int k = 0; k < 3; k++) {
+            if (s->groups[triangle[k]] == target_group) {
+                return triangle[k];
+            }
+        }
+    }
+    return MESH_REMAP_UNUSED;
+}
+
+// true if moving vertex onto target turns any of the triangles that survive the collapse over
+static bool collapse_flips_triangle(Simplifier *s, u32 vertex, u32 target) {
+    u32 *triangles = &s->adjacency.triangles[s->adjacency.offsets[vertex]];
+    for (u32 t = 0; t < s->adjacency.counts[vertex]; t++) {
+        u32 *triangle = &s->indices[triangles[t] * 3];
+        int k = triangle[0] == vertex ? 0 : triangle[1] == vertex ? 1 : 2;
+        u32 b = triangle[(k + 1) % 3];
+        u32 c = triangle[(k + 2) % 3];
+        if (s->groups[b] == s->groups[target] || s->groups[c] == s->groups[target]) {
+            continue; // this one collapses to nothing
+        }
+        Vector3 pb = s->points[b];
+        Vector3 pc = s->points[c];
+        Vector3 before = cross(pb - s->points[vertex], pc - s->points[vertex]);
+        Vector3 after  = cross(pb - s->points[target], pc - s->points[target]);
+        if (dot(before, after) <= 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// cost of moving every wedge of from onto the matching wedge of to's group, FLT_MAX if that isn't
+// allowed. the cost includes the attributes, out_error gets the squared distance part on its own.
+// out_targets gets the matching wedge for each wedge in from's list if not null.
+static float collapse_cost(Simplifier *s, u32 from, u32 to, float *out_error, u32 *out_targets) {
+    u8 kind = s->kinds[s->groups[from]];
+    if (kind == SVK_LOCKED) return FLT_MAX;
+    if (kind == SVK_SEAM && s->kinds[s->groups[to]] == SVK_MANIFOLD) return FLT_MAX;
+
+    float error = 0;
+    float attribute_cost = 0;
+    float weight = 0;
+    int num_wedges = 0;
+    u32 wedge = from;
+    do {
+        u32 target = MESH_REMAP_UNUSED;
+        if (s->adjacency.counts[wedge] > 0) {
+            // note(josh): a manifold vertex only has the one wedge. a seam vertex has to bring all of them
+            // along the seam together, which means every wedge needs a triangle with a wedge of to in it.
+            target = kind == SVK_SEAM ? find_wedge_target(s, wedge, s->groups[to]) : to;
+            if (target == MESH_REMAP_UNUSED || collapse_flips_triangle(s, wedge, target)) {
+                return FLT_MAX;
+            }
+            Vector3 p = s->points[target];
+            error += quadric_error(&s->quadrics[wedge], p) + quadric_error(&s->quadrics[target], p);
+            if (s->num_attributes) {
+                attribute_cost += attribute_error(s, wedge, target) + attribute_error(s, target, target);
+            }
+            weight += s->quadrics[wedge].weight + s->quadrics[target].weight;
+        }
+        if (out_targets) out_targets[num_wedges] = target;
+        num_wedges += 1;
+        wedge = s->wedge_next[wedge];
+    } while (wedge != from);
+    if (weight == 0) weight = 1;
+    *out_error = error / weight;
+    return (error + attribute_cost) / weight;
+}
+
+// drops triangles that have two corners at the same position, returns the new index count
+static int remove_degenerate_triangles(u32 *indices, int num_indices, u32 *groups) {
+    int count = 0;
+    for (int i = 0; i < num_indices; i += 3) {
+        u32 a = groups[indices[i + 0]];
+        u32 b = groups[indices[i + 1]];
+        u32 c = groups[indices[i + 2]];
+        if (a != b && b != c && a != c) {
+            indices[count + 0] = indices[i + 0];
+            indices[count + 1] = indices[i + 1];
+            indices[count + 2] = indices[i + 2];
+            count += 3;
+        }
+    }
+    return count;
+}
+
+struct Edge_Collapse {
+    u32 from;
+    u32 to;
+    float cost;  // what they're ranked by
+    float error; // squared distance, what's checked against the target
+};
+
+float simplify_scale(void *positions, int num_vertices, int vertex_stride) {
+    Vector3 min = v3( FLT_MAX,  FLT_MAX,  FLT_MAX);
+    Vector3 max = v3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    for (int v = 0; v < num_vertices; v++) {
+        Vector3 p;
+        memcpy(&p, (byte *)positions + (u64)v * vertex_stride, sizeof(p));
+        for (int i = 0; i < 3; i++) {
+            if (p[i] < min[i]) min[i] = p[i];
+            if (p[i] > max[i]) max[i] = p[i];
+        }
+    }
+    float extent = 0;
+    for (int i = 0; i < 3; i++) {
+        if (max[i] - min[i] > extent) extent = max[i] - min[i];
+    }
+    return extent;
+}
+
+int simplify_mesh(u32 *out_indices, u32 *indices, int num_indices, void *positions, int num_vertices, int vertex_stride, int target_index_count, float target_error, float *attributes, int attribute_stride, float *attribute_weights, int num_attributes, float *out_error) {
+    assert(num_indices % 3 == 0);
+    assert(num_attributes == 0 || (attributes != nullptr && attribute_weights != nullptr));
+    Allocator allocator = default_allocator();
+    if (out_error) *out_error = 0;
+    if (out_indices != indices) {
+        memcpy(out_indices, indices, sizeof(u32) * num_indices);
+    }
+    if (num_indices <= target_index_count) {
+        return num_indices;
+    }
+
+    Simplifier s = {};
+    s.indices = out_indices;
+    s.num_attributes = num_attributes;
+
+    // positions get grouped before scaling so rounding can't merge two that were different
+    s.points = (Vector3 *)alloc(allocator, sizeof(Vector3) * num_vertices);
+    defer(free(allocator, s.points));
+    for (int v = 0; v < num_vertices; v++) {
+        memcpy(&s.points[v], (byte *)positions + (u64)v * vertex_stride, sizeof(Vector3));
+    }
+    s.groups = (u32 *)alloc(allocator, sizeof(u32) * num_vertices);
+    defer(free(allocator, s.groups));
+    int num_groups = generate_vertex_remap(s.groups, nullptr, num_vertices, s.points, num_vertices, sizeof(Vector3));
+
+    Vector3 min = v3(FLT_MAX, FLT_MAX, FLT_MAX);
+    for (int v = 0; v < num_vertices; v++) {
+        for (int i = 0; i < 3; i++) {
+            if (s.points[v][i] < min[i]) min[i] = s.points[v][i];
+        }
+    }
+    float extent = simplify_scale(positions, num_vertices, vertex_stride);
+    float inverse_extent = extent > 0 ? 1.0f / extent : 0;
+    for (int v = 0; v < num_vertices; v++) {
+        s.points[v] = (s.points[v] - min) * inverse_extent;
+    }
+
+    int count = remove_degenerate_triangles(out_indices, num_indices, s.groups);
+
+    s.wedge_next = (u32 *)alloc(allocator, sizeof(u32) * num_vertices);
+    defer(free(allocator, s.wedge_next));
+    u32 *group_first = (u32 *)alloc(allocator, sizeof(u32) * num_groups);
+    defer(free(allocator, group_first));
+    memset(s.wedge_next, 0xff, sizeof(u32) * num_vertices);
+    memset(group_first, 0xff, sizeof(u32) * num_groups);
+    for (int i = 0; i < count; i++) {
+        u32 v = out_indices[i];
+        if (s.wedge_next[v] != MESH_REMAP_UNUSED) continue;
+        u32 first = group_first[s.groups[v]];
+        if (first == MESH_REMAP_UNUSED) {
+            group_first[s.groups[v]] = v;
+            s.wedge_next[v] = v;
+        }
+        else {
+            s.wedge_next[v] = s.wedge_next[first];
+            s.wedge_next[first] = v;
+        }
+    }
+
+    // classify by counting how many triangles use each edge between groups. once is an open border and
+    // more than twice is non-manifold, both lock their ends in place.
+    s.kinds = (u8 *)alloc(allocator, sizeof(u8) * num_groups);
+    defer(free(allocator, s.kinds));
+    memset(s.kinds, SVK_MANIFOLD, sizeof(u8) * num_groups);
+    {
+        u64 *edges = (u64 *)alloc(allocator, sizeof(u64) * (count + 1));
+        defer(free(allocator, edges));
+        for (int i = 0; i < count; i++) {
+            u32 a = s.groups[out_indices[i]];
+            u32 b = s.groups[out_indices[i - i % 3 + (i + 1) % 3]];
+            edges[i] = a < b ? ((u64)a << 32) | b : ((u64)b << 32) | a;
+        }
+        std::sort(edges, edges + count);
+        for (int i = 0; i < count;) {
+            int run = 1;
+            while (i + run < count && edges[i + run] == edges[i]) run += 1;
+            if (run != 2) {
+                s.kinds[edges[i] >> 32] = SVK_LOCKED;
+                s.kinds[edges[i] & 0xffffffff] = SVK_LOCKED;
+            }
+            i += run;
+        }
+        for (int g = 0; g < num_groups; g++) {
+            u32 first = group_first[g];
+            if (s.kinds[g] == SVK_MANIFOLD && first != MESH_REMAP_UNUSED && s.wedge_next[first] != first) {
+                s.kinds[g] = SVK_SEAM;
+            }
+        }
+    }
+
+    s.quadrics = (Quadric *)alloc(allocator, sizeof(Quadric) * num_vertices);
+    defer(free(allocator, s.quadrics));
+    memset(s.quadrics, 0, sizeof(Quadric) * num_vertices);
+    for (int i = 0; i < count; i += 3) {
+        Vector3 p0 = s.points[out_indices[i + 0]];
+        Vector3 n = cross(s.points[out_indices[i + 1]] - p0, s.points[out_indices[i + 2]] - p0);
+        float double_area = length(n);
+        if (double_area == 0) continue;
+        n /= double_area;
+        Quadric q = plane_quadric(n, -dot(n, p0), double_area * 0.5f);
+        for (int k = 0; k < 3; k++) {
+            quadric_add(&s.quadrics[out_indices[i + k]], &q);
+        }
+    }
+
+    if (num_attributes) {
+        s.attributes = (float *)alloc(allocator, sizeof(float) * num_vertices * num_attributes);
+        s.attribute_quadrics = (Attribute_Quadric *)alloc(allocator, sizeof(Attribute_Quadric) * num_vertices * num_attributes);
+        memset(s.attribute_quadrics, 0, sizeof(Attribute_Quadric) * num_vertices * num_attributes);
+        for (int v = 0; v < num_vertices; v++) {
+            float *source = (float *)((byte *)attributes + (u64)v * attribute_stride);
+            for (int i = 0; i < num_attributes; i++) {
+                s.attributes[(u64)v * num_attributes + i] = source[i] * attribute_weights[i];
+            }
+        }
+        for (int i = 0; i < count; i += 3) {
+            u32 *triangle = &out_indices[i];
+            Vector3 p0 = s.points[triangle[0]];
+            Vector3 p1 = s.points[triangle[1]];
+            Vector3 p2 = s.points[triangle[2]];
+            float area = length(cross(p1 - p0, p2 - p0)) * 0.5f;
+            for (int a = 0; a < num_attributes; a++) {
+                float *values = s.attributes + a;
+                Attribute_Quadric q = attribute_quadric(p0, p1, p2, values[(u64)triangle[0] * num_attributes], values[(u64)triangle[1] * num_attributes], values[(u64)triangle[2] * num_attributes], area);
+                for (int k = 0; k < 3; k++) {
+                    attribute_quadric_add(&s.attribute_quadrics[(u64)triangle[k] * num_attributes + a], &q);
+                }
+            }
+        }
+    }
+    defer(if (num_attributes) { free(allocator, s.attributes); free(allocator, s.attribute_quadrics); });
+
+    u32 *collapse_remap = (u32 *)alloc(allocator, sizeof(u32) * num_vertices);
+    defer(free(allocator, collapse_remap));
+    u8 *group_locked = (u8 *)alloc(allocator, sizeof(u8) * num_groups);
+    defer(free(allocator, group_locked));
+    Array<Edge_Collapse> collapses = make_array<Edge_Collapse>(allocator, count / 3 + 1);
+    defer(collapses.destroy());
+    Array<u32> targets = make_array<u32>(allocator, 16);
+    defer(targets.destroy());
+
+    float error_limit = target_error * target_error;
+    float result_error = 0;
+    // note(josh): in passes, like meshoptimizer: rank every edge, then take the cheapest collapses that
+    // don't touch each other, then rebuild. each pass removes a good fraction of what's left.
+    while (count > target_index_count) {
+        s.adjacency = build_triangle_adjacency(out_indices, count, num_vertices, allocator);
+        defer(destroy_triangle_adjacency(&s.adjacency, allocator));
+
+        collapses.clear();
+        for (int i = 0; i < count; i++) {
+            u32 a = out_indices[i];
+            u32 b = out_indices[i - i % 3 + (i + 1) % 3];
+            // every edge that can collapse is in exactly two triangles, once each way around
+            if (s.groups[a] > s.groups[b]) continue;
+            float error_ab, error_ba;
+            float cost_ab = collapse_cost(&s, a, b, &error_ab, nullptr);
+            float cost_ba = collapse_cost(&s, b, a, &error_ba, nullptr);
+            Edge_Collapse collapse = cost_ab <= cost_ba ? Edge_Collapse{a, b, cost_ab, error_ab} : Edge_Collapse{b, a, cost_ba, error_ba};
+            if (collapse.cost != FLT_MAX && collapse.error <= error_limit) {
+                collapses.append(collapse);
+            }
+        }
+        if (collapses.count == 0) {
+            break;
+        }
+        std::sort(collapses.data, collapses.data + collapses.count, [](const Edge_Collapse &a, const Edge_Collapse &b) { return a.cost < b.cost; });
+
+        // an edge collapse removes about two triangles. past the ones we need, only take ones about as
+        // cheap so this pass doesn't make expensive collapses that a later pass would have avoided.
+        int collapse_goal = (count - target_index_count) / 6;
+        float pass_limit = collapses[collapse_goal < collapses.count ? collapse_goal : collapses.count - 1].cost * 1.5f;
+
+        for (int v = 0; v < num_vertices; v++) collapse_remap[v] = v;
+        memset(group_locked, 0, sizeof(u8) * num_groups);
+        int triangles_removed = 0;
+        int num_applied = 0;
+        Foreach (collapse, collapses) {
+            if (collapse->cost > pass_limit) break;
+            if ((count / 3 - triangles_removed) * 3 <= target_index_count) break;
+            u32 from_group = s.groups[collapse->from];
+            u32 to_group = s.groups[collapse->to];
+            if (group_locked[from_group] || group_locked[to_group]) continue;
+
+            int num_wedges = 0;
+            u32 wedge = collapse->from;
+            do { num_wedges += 1; wedge = s.wedge_next[wedge]; } while (wedge != collapse->from);
+            targets.reserve(num_wedges);
+            // note(josh): re-evaluated since the quadrics it was ranked with may have grown this pass
+            float error;
+            float cost = collapse_cost(&s, collapse->from, collapse->to, &error, targets.data);
+            if (cost == FLT_MAX || error > error_limit) continue;
+
+            wedge = collapse->from;
+            for (int w = 0; w < num_wedges; w++, wedge = s.wedge_next[wedge]) {
+                u32 target = targets.data[w];
+                if (target == MESH_REMAP_UNUSED) continue; // a wedge nothing uses anymore
+                collapse_remap[wedge] = target;
+                quadric_add(&s.quadrics[target], &s.quadrics[wedge]);
+                for (int i = 0; i < num_attributes; i++) {
+                    attribute_quadric_add(&s.attribute_quadrics[(u64)target * num_attributes + i], &s.attribute_quadrics[(u64)wedge * num_attributes + i]);
+                }
+                u32 *triangles = &s.adjacency.triangles[s.adjacency.offsets[wedge]];
+                for (u32 t = 0; t < s.adjacency.counts[wedge]; t++) {
+                    u32 *triangle = &out_indices[triangles[t] * 3];
+                    if (s.groups[triangle[0]] == to_group || s.groups[triangle[1]] == to_group || s.groups[triangle[2]] == to_group) {
+                        triangles_removed += 1;
+                    }
+                }
+            }
+            group_locked[from_group] = 1;
+            group_locked[to_group] = 1;
+            if (error > result_error) result_error = error;
+            num_applied += 1;
+        }
+        if (num_applied == 0) {
+            break;
+        }
+
+        for (int i = 0; i < count; i++) {
+            out_indices[i] = collapse_remap[out_indices[i]];
+        }
+        count = remove_degenerate_triangles(out_indices, count, s.groups);
+    }
+
+    if (out_error) *out_error = sqrtf(result_error);
+    return count;
+}
+
+
+int meshlet_bound(int num_indices, int max_vertices, int max_triangles) {
+    // note(josh): a meshlet is only closed once the next triangle doesn't fit, so it has at least
+    // max_vertices-2 vertices or max_triangles triangles, and every vertex of it is a new index
+    int by_vertices = (num_indices + max_vertices - 3) / (max_vertices - 2);
+    int by_triangles = (num_indices / 3 + max_triangles - 1) / max_triangles;
+    return by_vertices > by_triangles ? by_vertices : by_triangles;
+}
+
+static inline Vector3 read_position(void *positions, int vertex_stride, u32 vertex) {
+    Vector3 p;
+    memcpy(&p, (byte *)positions + (u64)vertex * vertex_stride, sizeof(p));
+    return p;
+}
+
+static Vector3 triangle_normal(Vector3 a, Vector3 b, Vector3 c) {
+    Vector3 n = cross(b - a, c - a);
+    float len = length(n);
+    return len > 0 ? n / len : v3(0, 0, 0);
+}
+
+#define MESHLET_NOT_LOCAL 0xff
+
+int build_meshlets(Meshlet *out_meshlets, u32 *out_vertices, u8 *out_triangles, u32 *indices, int num_indices, void *positions, int num_vertices, int vertex_stride, int max_vertices, int max_triangles) {
+    assert(num_indices % 3 == 0);
+    assert(max_vertices >= 3 && max_vertices < MESHLET_NOT_LOCAL);
+    assert(max_triangles >= 1);
+    Allocator allocator = default_allocator();
+    int num_triangles = num_indices / 3;
+
+    // note(josh): adjacency goes by position so the walk carries on across UV and normal seams, which
+    // would otherwise cut the mesh up into lots of small islands
+    Vector3 *points = (Vector3 *)alloc(allocator, sizeof(Vector3) * (num_vertices + 1));
+    defer(free(allocator, points));
+    for (int v = 0; v < num_vertices; v++) {
+        points[v] = read_position(positions, vertex_stride, v);
+    }
+    u32 *groups = (u32 *)alloc(allocator, sizeof(u32) * (num_vertices + 1));
+    defer(free(allocator, groups));
+    int num_groups = generate_vertex_remap(groups, nullptr, num_vertices, points, num_vertices, sizeof(Vector3));
+    u32 *group_indices = (u32 *)alloc(allocator, sizeof(u32) * (num_indices + 1));
+    defer(free(allocator, group_indices));
+    for (int i = 0; i < num_indices; i++) {
+        group_indices[i] = groups[indices[i]];
+    }
+    Triangle_Adjacency adjacency = build_triangle_adjacency(group_indices, num_indices, num_groups, allocator);
+    defer(destroy_triangle_adjacency(&adjacency, allocator));
+
+    Vector3 *normals = (Vector3 *)alloc(allocator, sizeof(Vector3) * (num_triangles + 1));
+    defer(free(allocator, normals));
+    Vector3 *centroids = (Vector3 *)alloc(allocator, sizeof(Vector3) * (num_triangles + 1));
+    defer(free(allocator, centroids));
+    float total_area = 0;
+    for (int t = 0; t < num_triangles; t++) {
+        u32 *tri = &indices[t * 3];
+        Vector3 a = points[tri[0]];
+        Vector3 b = points[tri[1]];
+        Vector3 c = points[tri[2]];
+        normals[t] = triangle_normal(a, b, c);
+        centroids[t] = (a + b + c) / 3.0f;
+        total_area += length(cross(b - a, c - a)) * 0.5f;
+    }
+    // roughly the radius a full meshlet of average triangles covers, what distances are measured against
+    float expected_radius = num_triangles > 0 ? sqrtf(total_area / num_triangles * max_triangles / PI) * 0.5f : 0;
+    float inverse_radius_squared = expected_radius > 0 ? 1.0f / (expected_radius * expected_radius) : 0;
+
+    bool *emitted = (bool *)alloc(allocator, sizeof(bool) * (num_triangles + 1));
+    defer(free(allocator, emitted));
+    memset(emitted, 0, sizeof(bool) * num_triangles);
+
+    // where each vertex is in the current meshlet's vertex list
+    u8 *local = (u8 *)alloc(allocator, sizeof(u8) * (num_vertices + 1));
+    defer(free(allocator, local));
+    memset(local, MESHLET_NOT_LOCAL, sizeof(u8) * num_vertices);
+
+    int num_meshlets = 0;
+    Meshlet meshlet = {};
+    Vector3 normal_sum = {};
+    Vector3 centroid_sum = {};
+    int seed = 0;
+    for (int emitted_count = 0; emitted_count < num_triangles; emitted_count++) {
+        // note(josh): grow through the triangles that share a vertex with the meshlet. the fewest new
+        // vertices wins, ties go to the one closest to the middle of the meshlet and facing the same
+        // way as the rest, so meshlets come out round with narrow normal cones. adjacency only holds
+        // triangles that haven't been emitted yet.
+        Vector3 axis = v3(0, 0, 0);
+        float axis_length = length(normal_sum);
+        if (axis_length > 0) axis = normal_sum / axis_length;
+        Vector3 center = meshlet.triangle_count > 0 ? centroid_sum / (float)meshlet.triangle_count : v3(0, 0, 0);
+        int best = -1;
+        int best_new_vertices = 4;
+        float best_score = FLT_MAX;
+        for (u32 i = 0; i < meshlet.vertex_count; i++) {
+            u32 group = groups[out_vertices[meshlet.vertex_offset + i]];
+            u32 *neighbours = &adjacency.triangles[adjacency.offsets[group]];
+            for (u32 n = 0; n < adjacency.counts[group]; n++) {
+                u32 triangle = neighbours[n];
+                u32 *tri = &indices[triangle * 3];
+                int new_vertices = (local[tri[0]] == MESHLET_NOT_LOCAL) + (local[tri[1]] == MESHLET_NOT_LOCAL) + (local[tri[2]] == MESHLET_NOT_LOCAL);
+                if (new_vertices > best_new_vertices) {
+                    continue;
+                }
+                float score = (1 + sqr_length(centroids[triangle] - center) * inverse_radius_squared) * (1.5f - dot(normals[triangle], axis));
+                if (new_vertices < best_new_vertices || score < best_score) {
+                    best_new_vertices = new_vertices;
+                    best_score = score;
+                    best = triangle;
+                }
+            }
+        }
+        if (best == -1) {
+            // nothing left that touches the meshlet, carry on from the next triangle in index order
+            while (emitted[seed]) seed++;
+            best = seed;
+        }
+
+        u32 *tri = &indices[best * 3];
+        u32 new_vertices = (local[tri[0]] == MESHLET_NOT_LOCAL) + (local[tri[1]] == MESHLET_NOT_LOCAL) + (local[tri[2]] == MESHLET_NOT_LOCAL);
+        if (meshlet.vertex_count + new_vertices > (u32)max_vertices || meshlet.triangle_count + 1 > (u32)max_triangles) {
+            for (u32 i = 0; i < meshlet.vertex_count; i++) {
+                local[out_vertices[meshlet.vertex_offset + i]] = MESHLET_NOT_LOCAL;
+            }
+            out_meshlets[num_meshlets++] = meshlet;
+            meshlet.vertex_offset += meshlet.vertex_count;
+            meshlet.triangle_offset += meshlet.triangle_count * 3;
+            meshlet.vertex_count = 0;
+            meshlet.triangle_count = 0;
+            normal_sum = v3(0, 0, 0);
+            centroid_sum = v3(0, 0, 0);
+        }
+
+        for (int corner = 0; corner < 3; corner++) {
+            u32 vertex = tri[corner];
+            if (local[vertex] == MESHLET_NOT_LOCAL) {
+                local[vertex] = (u8)meshlet.vertex_count;
+                out_vertices[meshlet.vertex_offset + meshlet.vertex_count] = vertex;
+                meshlet.vertex_count += 1;
+            }
+            out_triangles[meshlet.triangle_offset + meshlet.triangle_count * 3 + corner] = local[vertex];
+
+            // swap the triangle out of the adjacency
+            u32 group = groups[vertex];
+            u32 *neighbours = &adjacency.triangles[adjacency.offsets[group]];
+            for (u32 n = 0; n < adjacency.counts[group]; n++) {
+                if (neighbours[n] == (u32)best) {
+                    neighbours[n] = neighbours[adjacency.counts[group] - 1];
+                    adjacency.counts[group] -= 1;
+                    break;
+                }
+            }
+        }
+        meshlet.triangle_count += 1;
+        emitted[best] = true;
+        normal_sum += normals[best];
+        centroid_sum += centroids[best];
+    }
+    if (meshlet.triangle_count > 0) {
+        out_meshlets[num_meshlets++] = meshlet;
+    }
+    return num_meshlets;
+}
+
+Meshlet_Bounds compute_meshlet_bounds(Meshlet *meshlet, u32 *meshlet_vertices, u8 *meshlet_triangles, void *positions, int vertex_stride) {
+    Meshlet_Bounds bounds = {};
+    if (meshlet->vertex_count == 0) {
+        bounds.cone_cutoff = 2;
+        return bounds;
+    }
+    u32 *vertices = &meshlet_vertices[meshlet->vertex_offset];
+    u8 *triangles = &meshlet_triangles[meshlet->triangle_offset];
+
+    bounds.min = v3( FLT_MAX,  FLT_MAX,  FLT_MAX);
+    bounds.max = v3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    for (u32 i = 0; i < meshlet->vertex_count; i++) {
+        Vector3 p = read_position(positions, vertex_stride, vertices[i]);
+        for (int axis = 0; axis < 3; axis++) {
+            if (p[axis] < bounds.min[axis]) bounds.min[axis] = p[axis];
+            if (p[axis] > bounds.max[axis]) bounds.max[axis] = p[axis];
+        }
+    }
+
+    // note(josh): Ritter's sphere. start from two far apart points and grow to take in any that are
+    // outside, usually within a few percent of the smallest sphere.
+    Vector3 first = read_position(positions, vertex_stride, vertices[0]);
+    Vector3 a = first;
+    Vector3 b = first;
+    float furthest = 0;
+    for (u32 i = 0; i < meshlet->vertex_count; i++) {
+        Vector3 p = read_position(positions, vertex_stride, vertices[i]);
+        if (length(p - first) > furthest) { furthest = length(p - first); a = p; }
+    }
+    furthest = 0;
+    for (u32 i = 0; i < meshlet->vertex_count; i++) {
+        Vector3 p = read_position(positions, vertex_stride, vertices[i]);
+        if (length(p - a) > furthest) { furthest = length(p - a); b = p; }
+    }
+    bounds.center = (a + b) * 0.5f;
+    bounds.radius = length(b - a) * 0.5f;
+    for (u32 i = 0; i < meshlet->vertex_count; i++) {
+        Vector3 p = read_position(positions, vertex_stride, vertices[i]);
+        float distance = length(p - bounds.center);
+        if (distance > bounds.radius) {
+            float radius = (bounds.radius + distance) * 0.5f;
+            bounds.center += (p - bounds.center) * ((radius - bounds.radius) / distance);
+            bounds.radius = radius;
+        }
+    }
+
+    // normal cone. the axis is the average normal and the cutoff is the widest triangle from it, if
+    // that's past ~84 degrees there's no view the whole cluster is backfacing from and it's never culled
+    Vector3 normal_sum = {};
+    for (u32 t = 0; t < meshlet->triangle_count; t++) {
+        u8 *tri = &triangles[t * 3];
+        normal_sum += triangle_normal(read_position(positions, vertex_stride, vertices[tri[0]]), read_position(positions, vertex_stride, vertices[tri[1]]), read_position(positions, vertex_stride, vertices[tri[2]]));
+    }
+    bounds.cone_apex = bounds.center;
+    bounds.cone_cutoff = 2;
+    float axis_length = length(normal_sum);
+    if (axis_length == 0) {
+        return bounds;
+    }
+    Vector3 axis = normal_sum / axis_length;
+    float min_dot = 1;
+    for (u32 t = 0; t < meshlet->triangle_count; t++) {
+        u8 *tri = &triangles[t * 3];
+        Vector3 n = triangle_normal(read_position(positions, vertex_stride, vertices[tri[0]]), read_position(positions, vertex_stride, vertices[tri[1]]), read_position(positions, vertex_stride, vertices[tri[2]]));
+        if (n.x == 0 && n.y == 0 && n.z == 0) continue; // degenerate, it never gets drawn
+        float d = dot(n, axis);
+        if (d < min_dot) min_dot = d;
+    }
+    bounds.cone_axis = axis;
+    if (min_dot <= 0.1f) {
+        return bounds;
+    }
+
+    // note(josh): move the apex back along the axis until it's behind every triangle's plane, then
+    // a camera outside the cone around it is behind all of them. degenerate triangles have a zero
+    // normal and don't constrain it.
+    float max_t = -FLT_MAX;
+    for (u32 t = 0; t < meshlet->triangle_count; t++) {
+        u8 *tri = &triangles[t * 3];
+        Vector3 p0 = read_position(positions, vertex_stride, vertices[tri[0]]);
+        Vector3 n = triangle_normal(p0, read_position(positions, vertex_stride, vertices[tri[1]]), read_position(positions, vertex_stride, vertices[tri[2]]));
+        float dn = dot(axis, n);
+        if (dn <= 0) continue;
+        float t_plane = dot(bounds.center - p0, n) / dn;
+        if (t_plane > max_t) max_t = t_plane;
+    }
+    if (max_t == -FLT_MAX) {
+        return bounds;
+    }
+    bounds.cone_apex = bounds.center - axis * max_t;
+    bounds.cone_cutoff = sqrtf(1 - min_dot * min_dot);
+    return bounds;
+}
+
+Meshlet_Culler make_meshlet_culler(Matrix4 model_view_projection, Vector3 camera_position, Vector3 view_direction, bool orthographic) {
+    Meshlet_Culler culler = {};
+    // note(josh): Gribb/Hartmann, each plane is the w row plus or minus another row of the matrix.
+    // near is -w <= z, which is looser than the 0 <= z D3D actually clips to, so it stays conservative.
+    Matrix4 m = model_view_projection;
+    Vector4 rows[4];
+    for (int row = 0; row < 4; row++) {
+        rows[row] = v4(m[0][row], m[1][row], m[2][row], m[3][row]);
+    }
+    for (int axis = 0; axis < 3; axis++) {
+        culler.planes[axis * 2 + 0] = rows[3] + rows[axis];
+        culler.planes[axis * 2 + 1] = rows[3] - rows[axis];
+    }
+    for (int i = 0; i < 6; i++) {
+        Vector4 plane = culler.planes[i];
+        float len = length(v3(plane.x, plane.y, plane.z));
+        if (len > 0) culler.planes[i] = plane / len;
+    }
+    culler.camera_position = camera_position;
+    culler.view_direction = normalize(view_direction);
+    culler.orthographic = orthographic;
+    return culler;
+}
+
+bool meshlet_visible(Meshlet_Culler *culler, Meshlet_Bounds *bounds) {
+    for (int i = 0; i < 6; i++) {
+        Vector4 plane = culler->planes[i];
+        if (plane.x * bounds->center.x + plane.y * bounds->center.y + plane.z * bounds->center.z + plane.w < -bounds->radius) {
+            return false;
+        }
+    }
+    if (bounds->cone_cutoff >= 1) {
+        return true;
+    }
+    Vector3 view = culler->view_direction;
+    if (!culler->orthographic) {
+        view = bounds->cone_apex - culler->camera_position;
+        float distance = length(view);
+        if (distance == 0) {
+            return true;
+        }
+        view = view / distance;
+    }
+    return dot(view, bounds->cone_axis) < bounds->cone_cutoff;
+}
+
+
+
+
+static int count_used_vertices(u32 *indices, int num_indices, int num_vertices, Allocator allocator) {
+    bool *used = (bool *)alloc(allocator, sizeof(bool) * (num_vertices + 1));
+    defer(free(allocator, used));
+    memset(used, 0, sizeof(bool) * num_vertices);
+    int count = 0;
+    for (int i = 0; i < num_indices; i++) {
+        if (!used[indices[i]]) {
+            used[indices[i]] = true;
+            count += 1;
+        }
+    }
+    return count;
+}
+
+Vertex_Cache_Stats analyze_vertex_cache(u32 *indices, int num_indices, int num_vertices, int cache_size) {
+    Allocator allocator = default_allocator();
+    Vertex_Cache_Stats stats = {};
+    if (num_indices == 0) {
+        return stats;
+    }
+    u32 *cache_times = (u32 *)alloc(allocator, sizeof(u32) * num_vertices);
+    defer(free(allocator, cache_times));
+    memset(cache_times, 0, sizeof(u32) * num_vertices);
+    u32 time = cache_size + 1;
+    for (int i = 0; i < num_indices; i++) {
+        stats.vertices_transformed += fifo_cache_miss(cache_times, &time, indices[i], cache_size);
+    }
+    stats.acmr = (float)stats.vertices_transformed / (float)(num_indices / 3);
+    stats.atvr = (float)stats.vertices_transformed / (float)count_used_vertices(indices, num_indices, num_vertices, allocator);
+    return stats;
+}
+
+#define FETCH_CACHE_LINE_SIZE 64
+#define FETCH_CACHE_SETS 64
+#define FETCH_CACHE_WAYS 4
+
+Vertex_Fetch_Stats analyze_vertex_fetch(u32 *indices, int num_indices, int num_vertices, int vertex_size) {
+    Vertex_Fetch_Stats stats = {};
+    if (num_indices == 0) {
+        return stats;
+    }
+    u64 lines[FETCH_CACHE_SETS][FETCH_CACHE_WAYS];
+    u64 last_used[FETCH_CACHE_SETS][FETCH_CACHE_WAYS];
+    memset(lines, 0xff, sizeof(lines));
+    memset(last_used, 0, sizeof(last_used));
+    u64 time = 1;
+    for (int i = 0; i < num_indices; i++) {
+        u64 first_byte = (u64)indices[i] * vertex_size;
+        u64 last_byte = first_byte + vertex_size - 1;
+        for (u64 line = first_byte / FETCH_CACHE_LINE_SIZE; line <= last_byte / FETCH_CACHE_LINE_SIZE; line++) {
+            u64 *set_lines = lines[line % FETCH_CACHE_SETS];
+            u64 *set_last_used = last_used[line % FETCH_CACHE_SETS];
+            int hit_way = -1;
+            int oldest_way = 0;
+            for (int way = 0; way < FETCH_CACHE_WAYS; way++) {
+                if (set_lines[way] == line) hit_way = way;
+                if (set_last_used[way] < set_last_used[oldest_way]) oldest_way = way;
+            }
+            if (hit_way == -1) {
+                stats.bytes_fetched += FETCH_CACHE_LINE_SIZE;
+                hit_way = oldest_way;
+                set_lines[hit_way] = line;
+            }
+            set_last_used[hit_way] = time++;
+        }
+    }
+    int used_vertices = count_used_vertices(indices, num_indices, num_vertices, default_allocator());
+    stats.overfetch = (float)stats.bytes_fetched / (float)((i64)used_vertices * vertex_size);
+    return stats;
+}
+
+#define OVERDRAW_RESOLUTION 256
+
+static void rasterize_overdraw_view(u32 *indices, int num_indices, Vector3 *view_positions, float *depth_buffer, Overdraw_Stats *stats) {
+    for (int i = 0; i < OVERDRAW_RESOLUTION * OVERDRAW_RESOLUTION; i++) {
+        depth_buffer[i] = FLT_MAX;
+    }
+    for (int t = 0; t < num_indices; t += 3) {
+        Vector3 a = view_positions[indices[t + 0]];
+        Vector3 b = view_positions[indices[t + 1]];
+        Vector3 c = view_positions[indices[t + 2]];
+        float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+        if (area == 0) {
+            continue;
+        }
+        if (area < 0) {
+            // no backface culling, just flip so the edge functions come out positive inside
+            Vector3 temp = b; b = c; c = temp;
+            area = -area;
+        }
+        int min_x = (int)fmaxf(floorf(fminf(a.x, fminf(b.x, c.x))), 0);
+        int min_y = (int)fmaxf(floorf(fminf(a.y, fminf(b.y, c.y))), 0);
+        int max_x = (int)fminf(ceilf(fmaxf(a.x, fmaxf(b.x, c.x))), OVERDRAW_RESOLUTION - 1);
+        int max_y = (int)fminf(ceilf(fmaxf(a.y, fmaxf(b.y, c.y))), OVERDRAW_RESOLUTION - 1);
+        for (int y = min_y; y <= max_y; y++) {
+            for (int x = min_x; x <= max_x; x++) {
+                float px = x + 0.5f;
+                float py = y + 0.5f;
+                float w0 = (c.x - b.x) * (py - b.y) - (c.y - b.y) * (px - b.x);
+                float w1 = (a.x - c.x) * (py - c.y) - (a.y - c.y) * (px - c.x);
+                float w2 = (b.x - a.x) * (py - a.y) - (b.y - a.y) * (px - a.x);
+                if (w0 < 0 || w1 < 0 || w2 < 0) {
+                    continue;
+                }
+                float depth = (w0 * a.z + w1 * b.z + w2 * c.z) / area;
+                float *stored = &depth_buffer[y * OVERDRAW_RESOLUTION + x];
+                if (depth < *stored) {
+                    *stored = depth;
+                    stats->pixels_shaded += 1;
+                }
+            }
+        }
+    }
+    for (int i = 0; i < OVERDRAW_RESOLUTION * OVERDRAW_RESOLUTION; i++) {
+        stats->pixels_covered += depth_buffer[i] != FLT_MAX;
+    }
+}
+
+Overdraw_Stats analyze_overdraw(u32 *indices, int num_indices, void *positions, int num_vertices, int vertex_stride) {
+    Allocator allocator = default_allocator();
+    Overdraw_Stats stats = {};
+    if (num_indices == 0) {
+        return stats;
+    }
+
+    Vector3 min = v3( FLT_MAX,  FLT_MAX,  FLT_MAX);
+    Vector3 max = v3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    for (int i = 0; i < num_indices; i++) {
+        Vector3 p = *(Vector3 *)((byte *)positions + (u64)indices[i] * vertex_stride);
+        min = v3(fminf(min.x, p.x), fminf(min.y, p.y), fminf(min.z, p.z));
+        max = v3(fmaxf(max.x, p.x), fmaxf(max.y, p.y), fmaxf(max.z, p.z));
+    }
+    Vector3 extent = max - min;
+    float largest = fmaxf(extent.x, fmaxf(extent.y, extent.z));
+    float scale = largest > 0 ? (OVERDRAW_RESOLUTION - 1) / largest : 0;
+
+    Vector3 *view_positions = (Vector3 *)alloc(allocator, sizeof(Vector3) * num_vertices);
+    defer(free(allocator, view_positions));
+    float *depth_buffer = (float *)alloc(allocator, sizeof(float) * OVERDRAW_RESOLUTION * OVERDRAW_RESOLUTION);
+    defer(free(allocator, depth_buffer));
+
+    // looking down each axis from both sides: the other two axes are the screen, the view axis is depth
+    for (int axis = 0; axis < 3; axis++) {
+        for (int side = 0; side < 2; side++) {
+            for (int v = 0; v < num_vertices; v++) {
+                Vector3 p = (*(Vector3 *)((byte *)positions + (u64)v * vertex_stride) - min) * scale;
+                float screen_x = p[(axis + 1) % 3];
+                float screen_y = p[(axis + 2) % 3];
+                float depth = side == 0 ? p[axis] : -p[axis];
+                view_positions[v] = v3(screen_x, screen_y, depth);
+            }
+            rasterize_overdraw_view(indices, num_indices, view_positions, depth_buffer, &stats);
+        }
+    }
+    stats.overdraw = stats.pixels_covered > 0 ? (float)stats.pixels_shaded / (float)stats.pixels_covered : 0;
+    return stats;
+}
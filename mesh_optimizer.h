@@ -0,0 +1,157 @@
+#pragma once
+
+#include "basic.h"
+#include "math.h"
+
+//
+// Mesh processing for the loader and the cooker. Everything here works on raw vertex data with a
+// stride rather than on the renderer's Vertex struct so it can run on any layout.
+//
+// A remap table maps each old vertex index to its new one. Vertices that nothing references get
+// MESH_REMAP_UNUSED.
+//
+
+#define MESH_REMAP_UNUSED 0xffffffffu
+
+// Finds vertices that are identical to an earlier one and numbers the unique ones in the order the
+// index stream first uses them. indices can be null for an unindexed mesh, then the vertices are
+// used in order and num_indices must equal num_vertices.
+//
+// With epsilon == 0 vertices are compared bytewise. With epsilon > 0 the vertex is read as
+// vertex_size/4 floats which are snapped to a grid of that spacing before comparing, so values that
+// differ by float noise merge. Two values that land either side of a grid line still don't, which is
+// fine for cleaning up duplicated exports but isn't a general "merge everything within epsilon".
+//
+// out_remap must have room for num_vertices entries. Returns the number of unique vertices.
+int generate_vertex_remap(u32 *out_remap, u32 *indices, int num_indices, void *vertices, int num_vertices, int vertex_size, float epsilon = 0);
+
+// out_vertices must have room for the unique count generate_vertex_remap() returned and can't be
+// the same memory as vertices.
+void remap_vertex_buffer(void *out_vertices, void *vertices, int num_vertices, int vertex_size, u32 *remap);
+
+// indices can be null for an unindexed mesh, same as above. Can be done in place.
+void remap_index_buffer(u32 *out_indices, u32 *indices, int num_indices, u32 *remap);
+
+
+
+// Index buffer optimization. The usual order is optimize_vertex_cache(), then optimize_overdraw() on
+// its output, then optimize_vertex_fetch_remap() and remapping the vertices and indices with it.
+// None of them change which triangles are drawn or their winding, only the order.
+
+// Tipsify (Sander, Nehab, Barczak 2007): reorders triangles so vertices get reused while they're
+// still in a post-transform cache of cache_size entries. Linear time. If out_clusters isn't null it
+// gets the index of the first triangle of every cluster, places where the walk had to restart
+// somewhere cold, and the count goes in out_num_clusters; out_clusters needs room for
+// num_indices/3 entries. Can't be done in place.
+#define DEFAULT_VERTEX_CACHE_SIZE 16
+void optimize_vertex_cache(u32 *out_indices, u32 *indices, int num_indices, int num_vertices, int cache_size = DEFAULT_VERTEX_CACHE_SIZE, u32 *out_clusters = nullptr, int *out_num_clusters = nullptr);
+
+// Splits a cache-optimized index buffer into clusters and sorts them so the ones facing out from the
+// middle of the mesh are drawn first, which lets them depth-reject what's behind them. threshold is
+// how much worse than the cache-optimized ACMR the result may get, 1.05 allows 5%. positions are
+// float3s vertex_stride bytes apart. Can't be done in place.
+void optimize_overdraw(u32 *out_indices, u32 *indices, int num_indices, void *positions, int num_vertices, int vertex_stride, float threshold = 1.05f, int cache_size = DEFAULT_VERTEX_CACHE_SIZE);
+
+// Remap that numbers vertices in the order the index buffer first uses them, so the vertex fetches
+// walk forward through memory. Apply it with remap_vertex_buffer()/remap_index_buffer(). Returns the
+// number of vertices that are actually used.
+int optimize_vertex_fetch_remap(u32 *out_remap, u32 *indices, int num_indices, int num_vertices);
+
+
+
+// Simplification. Quadric error metrics (Garland, Heckbert 1997) with every edge collapse moving a
+// vertex onto one of its neighbours, so no new vertices are made and the result indexes the same
+// vertex buffer, a LOD is just another index range.
+//
+// positions are float3s vertex_stride bytes apart. attributes are optional, num_attributes floats per
+// vertex attribute_stride bytes apart. The change in each of them times attribute_weights[i] is added
+// to the cost collapses are ranked by, so flat areas with a texture or normal gradient across them
+// don't go first. Vertices on open borders or non-manifold edges never move, and ones split across a
+// UV or normal seam only move along the seam so it doesn't open up.
+//
+// Stops at target_index_count or once the next collapse would move the surface further than
+// target_error, whichever comes first. Errors are geometric, distances relative to simplify_scale(),
+// so 0.01 is 1% of the mesh's size. out_error gets the largest one the result has. Returns the index
+// count. Can be done in place.
+int simplify_mesh(u32 *out_indices, u32 *indices, int num_indices, void *positions, int num_vertices, int vertex_stride, int target_index_count, float target_error, float *attributes = nullptr, int attribute_stride = 0, float *attribute_weights = nullptr, int num_attributes = 0, float *out_error = nullptr);
+
+// The largest side of the mesh's bounding box, multiply simplify_mesh() errors by it to get distances.
+float simplify_scale(void *positions, int num_vertices, int vertex_stride);
+
+
+
+// Meshlets, small clusters of triangles with bounds tight enough to cull them one by one. A meshlet's
+// triangles index its own list of vertices with u8s, and the lists index the mesh's vertex buffer.
+#define MESHLET_MAX_VERTICES 64
+#define MESHLET_MAX_TRIANGLES 124
+
+struct Meshlet {
+    u32 vertex_offset;   // into the meshlet vertices
+    u32 triangle_offset; // into the meshlet triangles, 3 u8s per triangle
+    u32 vertex_count;
+    u32 triangle_count;
+};
+
+// The most meshlets build_meshlets() can make. The vertices and triangles it writes need room for that
+// many times max_vertices u32s and max_triangles*3 u8s.
+int meshlet_bound(int num_indices, int max_vertices = MESHLET_MAX_VERTICES, int max_triangles = MESHLET_MAX_TRIANGLES);
+
+// Grows each meshlet through triangles that share a vertex with it, taking the one that adds the fewest
+// new vertices and leans towards the ones facing the same way so the normal cones stay narrow.
+// Returns the number of meshlets.
+int build_meshlets(Meshlet *out_meshlets, u32 *out_vertices, u8 *out_triangles, u32 *indices, int num_indices, void *positions, int num_vertices, int vertex_stride, int max_vertices = MESHLET_MAX_VERTICES, int max_triangles = MESHLET_MAX_TRIANGLES);
+
+// The normal cone: the whole meshlet is backfacing when the direction from the camera to cone_apex
+// is within asin(cone_cutoff) of cone_axis. cone_cutoff >= 1 means there's no such view. min and max
+// are the box around the vertices, center and radius a sphere around them.
+struct Meshlet_Bounds {
+    Vector3 center;
+    float radius;
+    Vector3 min;
+    Vector3 max;
+    Vector3 cone_apex;
+    Vector3 cone_axis;
+    float cone_cutoff;
+};
+
+Meshlet_Bounds compute_meshlet_bounds(Meshlet *meshlet, u32 *meshlet_vertices, u8 *meshlet_triangles, void *positions, int vertex_stride);
+
+// Frustum and backface cone test, all in the model space of the mesh. The projection is the usual
+// one for this codebase, backfaces are the ones wound counter-clockwise on screen. view_direction is
+// only used for orthographic projections, where it replaces the direction from the camera.
+struct Meshlet_Culler {
+    Vector4 planes[6]; // xyz points into the frustum
+    Vector3 camera_position;
+    Vector3 view_direction;
+    bool orthographic;
+};
+
+Meshlet_Culler make_meshlet_culler(Matrix4 model_view_projection, Vector3 camera_position, Vector3 view_direction, bool orthographic);
+bool meshlet_visible(Meshlet_Culler *culler, Meshlet_Bounds *bounds);
+
+
+// CPU models of the GPU for checking the optimizations offline.
+
+struct Vertex_Cache_Stats {
+    int vertices_transformed;
+    float acmr; // average cache miss ratio, transformed vertices per triangle. 0.5 is the best possible for big grids, 3 the worst.
+    float atvr; // average transformed vertex ratio, transformed vertices per vertex. 1 is ideal.
+};
+// FIFO post-transform cache like most GPUs had, which is what the optimizers above target.
+Vertex_Cache_Stats analyze_vertex_cache(u32 *indices, int num_indices, int num_vertices, int cache_size = DEFAULT_VERTEX_CACHE_SIZE);
+
+struct Vertex_Fetch_Stats {
+    i64 bytes_fetched;
+    float overfetch; // bytes fetched / bytes in the used vertices. 1 is ideal.
+};
+// 16KB 4-way set associative LRU cache with 64 byte lines in front of the vertex buffer.
+Vertex_Fetch_Stats analyze_vertex_fetch(u32 *indices, int num_indices, int num_vertices, int vertex_size);
+
+struct Overdraw_Stats {
+    i64 pixels_covered;
+    i64 pixels_shaded;
+    float overdraw; // shaded / covered. 1 is ideal.
+};
+// Rasterizes the mesh into a 256x256 depth buffer from each of the 6 axis directions, without
+// backface culling, counting a pixel as shaded when it passes the depth test.
+Overdraw_Stats analyze_overdraw(u32 *indices, int num_indices, void *positions, int num_vertices, int vertex_stride);
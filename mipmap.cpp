@@ -0,0 +1,465 @@
+#include "mipmap.h"
+#include "simd.h"
+
+#include "math.h"
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+int mipmap_count(int width, int height) {
+    int size = width > height ? width : height;
+    int count = 1;
+    while (size > 1) {
+        size /= 2;
+        count += 1;
+    }
+    return count;
+}
+
+int mipmap_level_dimension(int size, int level) {
+    int result = size >> level;
+    return result > 0 ? result : 1;
+}
+
+i64 mipmap_level_offset(Image_Format format, int width, int height, int level) {
+    i64 offset = 0;
+    for (int i = 0; i < level; i++) {
+        offset += image_level_size(format, mipmap_level_dimension(width, i), mipmap_level_dimension(height, i));
+    }
+    return offset;
+}
+
+i64 mipmap_chain_size(Image_Format format, int width, int height, int num_levels) {
+    return mipmap_level_offset(format, width, height, num_levels);
+}
+
+
+
+//
+// sRGB
+//
+// Decoding is a table lookup. Encoding compares against the linear values halfway between each pair
+// of neighbouring 8 bit values, which rounds exactly the way encoding the float and then rounding
+// would, without a pow() per texel. A coarse table indexed by the linear value gets within a step or
+// two of the answer so there's only a compare or two left to do.
+//
+
+#define SRGB_ENCODE_BUCKETS 4096
+
+struct Srgb_Tables {
+    float to_linear[256];
+    float thresholds[256];                // linear value halfway between sRGB i and i+1, FLT_MAX for 255
+    byte  encode_start[SRGB_ENCODE_BUCKETS + 1]; // the encoding of linear bucket / SRGB_ENCODE_BUCKETS
+};
+
+static float srgb_to_linear(float value) {
+    if (value <= 0.04045f) {
+        return value / 12.92f;
+    }
+    return powf((value + 0.055f) / 1.055f, 2.4f);
+}
+
+static Srgb_Tables make_srgb_tables() {
+    Srgb_Tables tables = {};
+    for (int i = 0; i < 256; i++) {
+        tables.to_linear[i] = srgb_to_linear(i / 255.0f);
+    }
+    for (int i = 0; i < 255; i++) {
+        tables.thresholds[i] = srgb_to_linear((i + 0.5f) / 255.0f);
+    }
+    tables.thresholds[255] = FLT_MAX;
+    int value = 0;
+    for (int i = 0; i <= SRGB_ENCODE_BUCKETS; i++) {
+        float linear = (float)i / SRGB_ENCODE_BUCKETS;
+        while (linear > tables.thresholds[value]) value += 1;
+        tables.encode_start[i] = (byte)value;
+    }
+    return tables;
+}
+
+static Srgb_Tables *srgb_tables() {
+    // note(josh): function statics are initialized once even with several threads cooking at once
+    static Srgb_Tables tables = make_srgb_tables();
+    return &tables;
+}
+
+// value is in [0, 1], fix_up_level() clamps everything before it gets here
+static inline byte linear_to_srgb8(Srgb_Tables *tables, float value) {
+    int result = tables->encode_start[(int)(value * SRGB_ENCODE_BUCKETS)];
+    while (value > tables->thresholds[result]) result += 1;
+    return (byte)result;
+}
+
+static inline byte unorm8(float value) {
+    int result = (int)(value * 255.0f + 0.5f);
+    if (result < 0) result = 0;
+    if (result > 255) result = 255;
+    return (byte)result;
+}
+
+
+
+//
+// Filtering
+//
+// Output texel x of a 2x downsample sits between source texels 2x and 2x+1. Tap t reads source
+// texel 2x + t with t in [first_tap, first_tap + num_taps), and the weights are symmetric around
+// the half-texel between taps 0 and 1.
+//
+
+#define MAX_MIPMAP_TAPS 8
+
+struct Mipmap_Kernel {
+    float weights[MAX_MIPMAP_TAPS];
+    int first_tap;
+    int num_taps;
+};
+
+static double bessel_i0(double x) {
+    double sum = 1;
+    double term = 1;
+    for (int k = 1; k < 32; k++) {
+        term *= (x / (2 * k)) * (x / (2 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+static Mipmap_Kernel make_mipmap_kernel(Mipmap_Filter filter) {
+    Mipmap_Kernel kernel = {};
+    switch (filter) {
+        case MIPMAP_FILTER_BOX: {
+            kernel.first_tap = 0;
+            kernel.num_taps = 2;
+            kernel.weights[0] = 0.5f;
+            kernel.weights[1] = 0.5f;
+            break;
+        }
+        case MIPMAP_FILTER_KAISER: {
+            // sinc cut off at the new Nyquist, windowed to 4 source texels either side. alpha = 4 is
+            // the usual tradeoff between ringing and blur.
+            const double radius = 4;
+            const double alpha = 4;
+            kernel.first_tap = -3;
+            kernel.num_taps = 8;
+            double sum = 0;
+            double weights[MAX_MIPMAP_TAPS];
+            for (int i = 0; i < kernel.num_taps; i++) {
+                double distance = (kernel.first_tap + i) - 0.5;
+                double x = distance * 0.5 * PI;
+                double sinc = sin(x) / x;
+                double window_x = distance / radius;
+                double window = bessel_i0(alpha * sqrt(1 - window_x * window_x)) / bessel_i0(alpha);
+                weights[i] = sinc * window;
+                sum += weights[i];
+            }
+            for (int i = 0; i < kernel.num_taps; i++) {
+                kernel.weights[i] = (float)(weights[i] / sum);
+            }
+            break;
+        }
+        default: {
+            assert(false);
+        }
+    }
+    return kernel;
+}
+
+static inline int wrap_index(int index, int size) {
+    int result = index % size;
+    return result < 0 ? result + size : result;
+}
+
+static inline int floor_div2(int value) {
+    return value >= 0 ? value / 2 : -((-value + 1) / 2);
+}
+
+// SoA, one plane per channel
+struct Float_Image {
+    float *channels[4];
+    int width;
+    int height;
+};
+
+static Float_Image make_float_image(int width, int height, Allocator allocator) {
+    Float_Image image = {};
+    image.width = width;
+    image.height = height;
+    assert((i64)width * height * sizeof(float) < 0x7fffffff);
+    for (int c = 0; c < 4; c++) {
+        image.channels[c] = (float *)alloc(allocator, width * height * (int)sizeof(float));
+    }
+    return image;
+}
+
+static void destroy_float_image(Float_Image *image, Allocator allocator) {
+    for (int c = 0; c < 4; c++) {
+        free(allocator, image->channels[c]);
+    }
+    *image = {};
+}
+
+// src -> dst at half the width. each source row gets split into its even and odd texels, padded with
+// wrapped texels at both ends, so every tap is a contiguous load at x plus a constant.
+static void downsample_rows(Float_Image *src, Mipmap_Kernel *kernel, Float_Image *dst, float *scratch) {
+    int dst_width = dst->width;
+    if (src->width == 1) {
+        for (int c = 0; c < 4; c++) {
+            memcpy(dst->channels[c], src->channels[c], sizeof(float) * src->height);
+        }
+        return;
+    }
+
+    int first_offset = floor_div2(kernel->first_tap);
+    int last_offset = floor_div2(kernel->first_tap + kernel->num_taps - 1);
+    int padded_width = dst_width + last_offset - first_offset;
+    float *even = scratch;
+    float *odd = scratch + padded_width;
+    float *tap_rows[MAX_MIPMAP_TAPS];
+    for (int t = 0; t < kernel->num_taps; t++) {
+        int tap = kernel->first_tap + t;
+        tap_rows[t] = ((tap & 1) ? odd : even) + (floor_div2(tap) - first_offset);
+    }
+
+    for (int c = 0; c < 4; c++) {
+        for (int y = 0; y < src->height; y++) {
+            float *row = src->channels[c] + (i64)y * src->width;
+            for (int p = 0; p < padded_width; p++) {
+                int x = 2 * (p + first_offset);
+                if (x >= 0 && x + 1 < src->width) {
+                    even[p] = row[x];
+                    odd[p]  = row[x + 1];
+                }
+                else {
+                    even[p] = row[wrap_index(x,     src->width)];
+                    odd[p]  = row[wrap_index(x + 1, src->width)];
+                }
+            }
+
+            float *out = dst->channels[c] + (i64)y * dst_width;
+            int x = 0;
+            for (; x + SIMD_WIDTH <= dst_width; x += SIMD_WIDTH) {
+                f32xN sum = f32xN_zero();
+                for (int t = 0; t < kernel->num_taps; t++) {
+                    sum = f32xN_madd(f32xN_load(tap_rows[t] + x), f32xN_set1(kernel->weights[t]), sum);
+                }
+                f32xN_store(out + x, sum);
+            }
+            for (; x < dst_width; x++) {
+                float sum = 0;
+                for (int t = 0; t < kernel->num_taps; t++) {
+                    sum += tap_rows[t][x] * kernel->weights[t];
+                }
+                out[x] = sum;
+            }
+        }
+    }
+}
+
+// src -> dst at half the height, whole rows at a time
+static void downsample_columns(Float_Image *src, Mipmap_Kernel *kernel, Float_Image *dst) {
+    int width = dst->width;
+    if (src->height == 1) {
+        for (int c = 0; c < 4; c++) {
+            memcpy(dst->channels[c], src->channels[c], sizeof(float) * width);
+        }
+        return;
+    }
+
+    for (int c = 0; c < 4; c++) {
+        for (int y = 0; y < dst->height; y++) {
+            float *rows[MAX_MIPMAP_TAPS];
+            for (int t = 0; t < kernel->num_taps; t++) {
+                rows[t] = src->channels[c] + (i64)wrap_index(2 * y + kernel->first_tap + t, src->height) * width;
+            }
+
+            float *out = dst->channels[c] + (i64)y * width;
+            int x = 0;
+            for (; x + SIMD_WIDTH <= width; x += SIMD_WIDTH) {
+                f32xN sum = f32xN_zero();
+                for (int t = 0; t < kernel->num_taps; t++) {
+                    sum = f32xN_madd(f32xN_load(rows[t] + x), f32xN_set1(kernel->weights[t]), sum);
+                }
+                f32xN_store(out + x, sum);
+            }
+            for (; x < width; x++) {
+                float sum = 0;
+                for (int t = 0; t < kernel->num_taps; t++) {
+                    sum += rows[t][x] * kernel->weights[t];
+                }
+                out[x] = sum;
+            }
+        }
+    }
+}
+
+// Kaiser rings past [0, 1] at hard edges, and normal maps come out of the filter shorter than unit
+// length. Done in place so the next level is filtered from what this one actually stores.
+static void fix_up_level(Float_Image *image, Mipmap_Settings settings) {
+    int count = image->width * image->height;
+    f32xN zero = f32xN_zero();
+    f32xN one = f32xN_set1(1);
+    f32xN two = f32xN_set1(2);
+    f32xN half = f32xN_set1(0.5f);
+    f32xN tiny = f32xN_set1(1e-12f);
+    float *r = image->channels[0];
+    float *g = image->channels[1];
+    float *b = image->channels[2];
+    float *a = image->channels[3];
+    int i = 0;
+    for (; i + SIMD_WIDTH <= count; i += SIMD_WIDTH) {
+        f32xN rgb[3] = {f32xN_load(r + i), f32xN_load(g + i), f32xN_load(b + i)};
+        if (settings.normal_map) {
+            f32xN n[3];
+            for (int c = 0; c < 3; c++) {
+                n[c] = f32xN_sub(f32xN_mul(rgb[c], two), one);
+            }
+            f32xN length_squared = f32xN_madd(n[0], n[0], f32xN_madd(n[1], n[1], f32xN_mul(n[2], n[2])));
+            // a texel whose neighbours cancel out completely keeps its (zero) vector
+            f32xN scale = f32xN_div(one, f32xN_sqrt(f32xN_max(length_squared, tiny)));
+            scale = f32xN_select(f32xN_cmp_gt(length_squared, tiny), one, scale);
+            for (int c = 0; c < 3; c++) {
+                rgb[c] = f32xN_madd(f32xN_mul(n[c], scale), half, half);
+            }
+        }
+        f32xN_store(r + i, f32xN_clamp(rgb[0], zero, one));
+        f32xN_store(g + i, f32xN_clamp(rgb[1], zero, one));
+        f32xN_store(b + i, f32xN_clamp(rgb[2], zero, one));
+        f32xN_store(a + i, f32xN_clamp(f32xN_load(a + i), zero, one));
+    }
+    for (; i < count; i++) {
+        float rgb[3] = {r[i], g[i], b[i]};
+        if (settings.normal_map) {
+            float n[3] = {rgb[0] * 2 - 1, rgb[1] * 2 - 1, rgb[2] * 2 - 1};
+            float length_squared = n[0] * n[0] + n[1] * n[1] + n[2] * n[2];
+            float scale = length_squared > 1e-12f ? 1.0f / sqrtf(length_squared) : 1.0f;
+            for (int c = 0; c < 3; c++) {
+                rgb[c] = n[c] * scale * 0.5f + 0.5f;
+            }
+        }
+        r[i] = rgb[0] < 0 ? 0 : (rgb[0] > 1 ? 1 : rgb[0]);
+        g[i] = rgb[1] < 0 ? 0 : (rgb[1] > 1 ? 1 : rgb[1]);
+        b[i] = rgb[2] < 0 ? 0 : (rgb[2] > 1 ? 1 : rgb[2]);
+        a[i] = a[i] < 0 ? 0 : (a[i] > 1 ? 1 : a[i]);
+    }
+}
+
+
+
+//
+// Alpha coverage, from Castaño's "Computing Alpha Mipmaps". Blurring the alpha of something like a
+// leaf texture shrinks the area above the cutoff level by level, so the level's alpha gets scaled by
+// whatever makes its coverage match level 0's again.
+//
+
+static float alpha_coverage(float *alpha, int count, float cutoff) {
+    f32xN covered = f32xN_zero();
+    f32xN one = f32xN_set1(1);
+    f32xN cutoff_n = f32xN_set1(cutoff);
+    int i = 0;
+    for (; i + SIMD_WIDTH <= count; i += SIMD_WIDTH) {
+        covered = f32xN_add(covered, f32xN_and(f32xN_cmp_gt(f32xN_load(alpha + i), cutoff_n), one));
+    }
+    float lanes[SIMD_WIDTH];
+    f32xN_store(lanes, covered);
+    float total = 0;
+    for (int lane = 0; lane < SIMD_WIDTH; lane++) {
+        total += lanes[lane];
+    }
+    for (; i < count; i++) {
+        if (alpha[i] > cutoff) total += 1;
+    }
+    return total / count;
+}
+
+// the scale that brings the coverage of alpha at cutoff to target_coverage
+static float alpha_coverage_scale(float *alpha, int count, float cutoff, float target_coverage) {
+    // coverage only goes down as the threshold goes up, so binary search for the threshold at which
+    // this level has the target coverage and scale that threshold onto the cutoff
+    float low = 0;
+    float high = 1;
+    for (int i = 0; i < 12; i++) {
+        float middle = (low + high) * 0.5f;
+        if (alpha_coverage(alpha, count, middle) > target_coverage) {
+            low = middle;
+        }
+        else {
+            high = middle;
+        }
+    }
+    // small levels can't hit the target exactly, take whichever side of it is closer
+    float low_error = fabsf(alpha_coverage(alpha, count, low) - target_coverage);
+    float high_error = fabsf(alpha_coverage(alpha, count, high) - target_coverage);
+    float threshold = low_error < high_error ? low : high;
+    if (threshold < 1e-4f) {
+        return 1;
+    }
+    return cutoff / threshold;
+}
+
+
+
+static void encode_level(Float_Image *image, Mipmap_Settings settings, float alpha_scale, byte *out) {
+    Srgb_Tables *tables = srgb_tables();
+    int count = image->width * image->height;
+    for (int i = 0; i < count; i++) {
+        for (int c = 0; c < 3; c++) {
+            float value = image->channels[c][i];
+            out[i * 4 + c] = settings.srgb ? linear_to_srgb8(tables, value) : unorm8(value);
+        }
+        out[i * 4 + 3] = unorm8(image->channels[3][i] * alpha_scale);
+    }
+}
+
+void generate_mipmaps(byte *pixels, int width, int height, Mipmap_Settings settings, int num_levels, byte *out_chain, Allocator allocator) {
+    assert(width > 0 && height > 0);
+    assert(num_levels >= 1 && num_levels <= mipmap_count(width, height));
+    memcpy(out_chain, pixels, (i64)width * height * 4);
+    if (num_levels == 1) {
+        return;
+    }
+
+    Mipmap_Kernel kernel = make_mipmap_kernel(settings.filter);
+    Srgb_Tables *tables = srgb_tables();
+
+    Float_Image level = make_float_image(width, height, allocator);
+    int count = width * height;
+    for (int i = 0; i < count; i++) {
+        byte *pixel = pixels + i * 4;
+        for (int c = 0; c < 3; c++) {
+            level.channels[c][i] = settings.srgb ? tables->to_linear[pixel[c]] : pixel[c] / 255.0f;
+        }
+        level.channels[3][i] = pixel[3] / 255.0f;
+    }
+
+    float target_coverage = 0;
+    if (settings.alpha_cutoff > 0) {
+        target_coverage = alpha_coverage(level.channels[3], count, settings.alpha_cutoff);
+    }
+
+    // note(josh): the intermediate is the widest thing after level 0 so it's allocated once for the
+    // whole chain, same for the padded even/odd rows
+    Float_Image rows = make_float_image(mipmap_level_dimension(width, 1), height, allocator);
+    float *scratch = (float *)alloc(allocator, (int)sizeof(float) * 2 * (mipmap_level_dimension(width, 1) + MAX_MIPMAP_TAPS));
+    for (int i = 1; i < num_levels; i++) {
+        Float_Image next = make_float_image(mipmap_level_dimension(width, i), mipmap_level_dimension(height, i), allocator);
+        rows.width = next.width;
+        rows.height = level.height;
+        downsample_rows(&level, &kernel, &rows, scratch);
+        downsample_columns(&rows, &kernel, &next);
+        fix_up_level(&next, settings);
+
+        float alpha_scale = 1;
+        if (settings.alpha_cutoff > 0) {
+            alpha_scale = alpha_coverage_scale(next.channels[3], next.width * next.height, settings.alpha_cutoff, target_coverage);
+        }
+        encode_level(&next, settings, alpha_scale, out_chain + mipmap_level_offset(IMAGE_FORMAT_RGBA8, width, height, i));
+
+        destroy_float_image(&level, allocator);
+        level = next;
+    }
+    free(allocator, scratch);
+    destroy_float_image(&rows, allocator);
+    destroy_float_image(&level, allocator);
+}
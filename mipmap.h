@@ -0,0 +1,49 @@
+#pragma once
+
+#include "basic.h"
+#include "texture_compression.h"
+
+//
+// CPU mipmap chain generation for RGBA8 images.
+//
+// Each level is filtered from the one above it in float and only rounded to 8 bits on the way out,
+// so the rounding doesn't pile up down the chain. Filtering happens on linear values: sRGB images are
+// decoded first and re-encoded after, otherwise the smaller levels of anything with contrast come out
+// too dark. The downsample is separable, rows then columns, with both passes running along the row
+// in f32xN lanes.
+//
+// Levels are always floor(size / 2) down to 1x1 like D3D expects. Addressing wraps at the edges, the
+// same as the TWM_LINEAR_WRAP sampler model textures are drawn with.
+//
+// One call does one image on the calling thread, callers with several images run them across threads
+// instead, see ensure_model_textures_cooked() and preload_cached_textures().
+//
+
+enum Mipmap_Filter {
+    MIPMAP_FILTER_BOX,    // 2x2 average, cheap, a bit blurry and aliases a bit
+    MIPMAP_FILTER_KAISER, // Kaiser windowed sinc over 8x8 texels, sharper, what the cooker uses
+
+    MIPMAP_FILTER_COUNT,
+};
+
+struct Mipmap_Settings {
+    Mipmap_Filter filter;
+    bool srgb;          // RGB is sRGB encoded. alpha is always linear.
+    bool normal_map;    // RGB is a unit vector * 0.5 + 0.5, each level gets renormalized
+    float alpha_cutoff; // if > 0, alpha of each level is scaled so the fraction of texels above the
+                        // cutoff matches level 0, so alpha tested and blended foliage doesn't thin
+                        // out into nothing in the distance
+};
+
+// Number of levels down to 1x1.
+int mipmap_count(int width, int height);
+
+// Size of one level. Levels of a chain are stored back to back, largest first, with nothing
+// between them. That's how create_texture() takes them and how .cfftexture files store them.
+int mipmap_level_dimension(int size, int level);
+i64 mipmap_level_offset(Image_Format format, int width, int height, int level);
+i64 mipmap_chain_size(Image_Format format, int width, int height, int num_levels);
+
+// pixels is tightly packed RGBA8. out_chain gets num_levels levels in the layout above, level 0
+// being a copy of pixels, so mipmap_chain_size(IMAGE_FORMAT_RGBA8, ...) bytes.
+void generate_mipmaps(byte *pixels, int width, int height, Mipmap_Settings settings, int num_levels, byte *out_chain, Allocator allocator);
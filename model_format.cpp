@@ -0,0 +1,247 @@
+#include "model_format.h"
+
+#include <stdio.h>
+#include <string.h>
+
+Model_Cooker make_model_cooker(u32 vertex_size, Allocator allocator) {
+    Model_Cooker cooker = {};
+    cooker.vertex_size = vertex_size;
+    cooker.meshes = make_array<Cffmodel_Mesh>(allocator, 64);
+    cooker.materials = make_array<Cffmodel_Material>(allocator, 16);
+    cooker.strings = make_array<char>(allocator, 1024);
+    cooker.blobs = make_array<byte>(allocator, 1024 * 1024);
+    cooker.strings.append('\0'); // offset 0 is the empty string
+    return cooker;
+}
+
+void destroy_model_cooker(Model_Cooker *cooker) {
+    cooker->meshes.destroy();
+    cooker->materials.destroy();
+    cooker->strings.destroy();
+    cooker->blobs.destroy();
+}
+
+u32 model_cooker_add_string(Model_Cooker *cooker, char *str) {
+    if (str == nullptr || str[0] == '\0') {
+        return 0;
+    }
+    u32 offset = (u32)cooker->strings.count;
+    for (char *c = str; *c; c++) {
+        cooker->strings.append(*c);
+    }
+    cooker->strings.append('\0');
+    return offset;
+}
+
+int model_cooker_add_material(Model_Cooker *cooker, Cffmodel_Material material) {
+    cooker->materials.append(material);
+    return cooker->materials.count - 1;
+}
+
+static u64 align_up(u64 offset, u64 alignment) {
+    return (offset + alignment - 1) & ~(alignment - 1);
+}
+
+// returns the offset of size bytes at the end of blobs, the caller fills them in
+static u64 reserve_blob(Array<byte> *blobs, i64 size) {
+    i64 offset = (i64)align_up(blobs->count, CFFMODEL_BLOB_ALIGNMENT);
+    if (offset + size > blobs->capacity) {
+        i64 grown = (i64)blobs->capacity * 2;
+        assert(offset + size < 0x7fffffff && "cooked models are limited to 2GB of geometry");
+        blobs->reserve((int)(grown > offset + size && grown < 0x7fffffff ? grown : offset + size));
+    }
+    memset(blobs->data + blobs->count, 0, offset - blobs->count);
+    blobs->count = (int)(offset + size);
+    return (u64)offset;
+}
+
+static u64 append_blob(Array<byte> *blobs, void *data, i64 size) {
+    u64 offset = reserve_blob(blobs, size);
+    memcpy(blobs->data + offset, data, size);
+    return offset;
+}
+
+void model_cooker_add_mesh(Model_Cooker *cooker, void *vertices, Vector3 *positions, int num_vertices, u32 *indices, int num_indices, int material_index, Cffmodel_Lod *lods, int num_lods) {
+    assert(material_index >= -1 && material_index < cooker->materials.count);
+    assert(num_lods >= 0 && num_lods <= CFFMODEL_MAX_LODS);
+    Cffmodel_Mesh mesh = {};
+    mesh.num_vertices = num_vertices;
+    mesh.num_indices = num_indices;
+    mesh.material_index = material_index;
+    if (num_lods == 0) {
+        mesh.num_lods = 1;
+        mesh.lods[0] = {0, (u32)num_indices, 0};
+    }
+    else {
+        assert(lods[0].first_index == 0);
+        mesh.num_lods = num_lods;
+        for (int i = 0; i < num_lods; i++) {
+            assert(lods[i].first_index + lods[i].num_indices <= (u32)num_indices);
+            mesh.lods[i] = lods[i];
+        }
+    }
+    mesh.index_size = num_vertices <= 0x10000 ? sizeof(u16) : sizeof(u32);
+    mesh.vertices_offset = append_blob(&cooker->blobs, vertices, (i64)num_vertices * cooker->vertex_size);
+    mesh.positions_offset = append_blob(&cooker->blobs, positions, (i64)num_vertices * sizeof(Vector3));
+    if (num_indices > 0) {
+        if (mesh.index_size == sizeof(u16)) {
+            mesh.indices_offset = reserve_blob(&cooker->blobs, (i64)num_indices * sizeof(u16));
+            u16 *narrow = (u16 *)(cooker->blobs.data + mesh.indices_offset);
+            for (int i = 0; i < num_indices; i++) {
+                assert(indices[i] < (u32)num_vertices);
+                narrow[i] = (u16)indices[i];
+            }
+        }
+        else {
+            mesh.indices_offset = append_blob(&cooker->blobs, indices, (i64)num_indices * sizeof(u32));
+        }
+    }
+
+    Vector3 min = v3( FLT_MAX,  FLT_MAX,  FLT_MAX);
+    Vector3 max = v3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    for (int i = 0; i < num_vertices; i++) {
+        Vector3 p = positions[i];
+        if (p.x < min.x) min.x = p.x;
+        if (p.y < min.y) min.y = p.y;
+        if (p.z < min.z) min.z = p.z;
+        if (p.x > max.x) max.x = p.x;
+        if (p.y > max.y) max.y = p.y;
+        if (p.z > max.z) max.z = p.z;
+    }
+    for (int i = 0; i < 3; i++) {
+        mesh.bounds_min[i] = min[i];
+        mesh.bounds_max[i] = max[i];
+    }
+    cooker->meshes.append(mesh);
+}
+
+bool write_cooked_model(Model_Cooker *cooker, char *filename) {
+    Cffmodel_Header header = {};
+    header.magic = CFFMODEL_MAGIC;
+    header.version = CFFMODEL_VERSION;
+    header.vertex_size = cooker->vertex_size;
+    header.num_meshes = cooker->meshes.count;
+    header.num_materials = cooker->materials.count;
+    header.meshes_offset = sizeof(Cffmodel_Header);
+    header.materials_offset = header.meshes_offset + cooker->meshes.count * sizeof(Cffmodel_Mesh);
+    header.strings_offset = header.materials_offset + cooker->materials.count * sizeof(Cffmodel_Material);
+    header.strings_size = cooker->strings.count;
+    u64 blobs_offset = align_up(header.strings_offset + header.strings_size, CFFMODEL_BLOB_ALIGNMENT);
+    header.file_size = blobs_offset + cooker->blobs.count;
+
+    // write into a temporary and rename so a crash halfway through doesn't leave a file that looks valid
+    char temp_filename[1024];
+    snprintf(temp_filename, sizeof(temp_filename), "%s.tmp", filename);
+    FILE *file = fopen(temp_filename, "wb");
+    if (file == nullptr) {
+        printf("write_cooked_model() couldn't open %s for writing\n", temp_filename);
+        return false;
+    }
+
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    Foreach (mesh, cooker->meshes) {
+        Cffmodel_Mesh relocated = *mesh;
+        relocated.vertices_offset += blobs_offset;
+        relocated.positions_offset += blobs_offset;
+        if (relocated.num_indices > 0) {
+            relocated.indices_offset += blobs_offset;
+        }
+        ok = ok && fwrite(&relocated, sizeof(relocated), 1, file) == 1;
+    }
+    if (cooker->materials.count) ok = ok && fwrite(cooker->materials.data, sizeof(Cffmodel_Material), cooker->materials.count, file) == (u64)cooker->materials.count;
+    ok = ok && fwrite(cooker->strings.data, 1, cooker->strings.count, file) == (u64)cooker->strings.count;
+    byte padding[CFFMODEL_BLOB_ALIGNMENT] = {};
+    u64 padding_size = blobs_offset - (header.strings_offset + header.strings_size);
+    if (padding_size) ok = ok && fwrite(padding, 1, padding_size, file) == padding_size;
+    if (cooker->blobs.count) ok = ok && fwrite(cooker->blobs.data, 1, cooker->blobs.count, file) == (u64)cooker->blobs.count;
+    ok = (fclose(file) == 0) && ok;
+
+    if (!ok) {
+        printf("write_cooked_model() failed writing %s\n", temp_filename);
+        remove(temp_filename);
+        return false;
+    }
+    remove(filename);
+    if (rename(temp_filename, filename) != 0) {
+        printf("write_cooked_model() couldn't rename %s to %s\n", temp_filename, filename);
+        remove(temp_filename);
+        return false;
+    }
+    return true;
+}
+
+
+
+static bool range_in_file(u64 offset, u64 size, u64 file_size) {
+    return offset <= file_size && size <= file_size - offset;
+}
+
+bool open_cooked_model(char *filename, u32 vertex_size, Cooked_Model_File *out_model) {
+    *out_model = {};
+    Mapped_File file;
+    if (!map_entire_file(filename, &file)) {
+        return false;
+    }
+
+    // note(josh): everything after this only reads the tables. a file that fails any of these is stale or
+    // truncated, the caller should cook it again.
+    u64 size = (u64)file.size;
+    Cffmodel_Header *header = (Cffmodel_Header *)file.data;
+    bool valid = size >= sizeof(Cffmodel_Header)
+              && header->magic == CFFMODEL_MAGIC
+              && header->version == CFFMODEL_VERSION
+              && header->vertex_size == vertex_size
+              && header->file_size == size
+              && range_in_file(header->meshes_offset,    (u64)header->num_meshes * sizeof(Cffmodel_Mesh), size)
+              && range_in_file(header->materials_offset, (u64)header->num_materials * sizeof(Cffmodel_Material), size)
+              && range_in_file(header->strings_offset,   header->strings_size, size)
+              && header->strings_size > 0
+              && file.data[header->strings_offset + header->strings_size - 1] == '\0'
+              && header->meshes_offset % alignof(Cffmodel_Mesh) == 0
+              && header->materials_offset % alignof(Cffmodel_Material) == 0;
+
+    if (valid) {
+        Cffmodel_Mesh *meshes = (Cffmodel_Mesh *)(file.data + header->meshes_offset);
+        for (u32 i = 0; i < header->num_meshes && valid; i++) {
+            Cffmodel_Mesh *mesh = &meshes[i];
+            valid = range_in_file(mesh->vertices_offset,  (u64)mesh->num_vertices * vertex_size, size)
+                 && range_in_file(mesh->positions_offset, (u64)mesh->num_vertices * sizeof(Vector3), size)
+                 && (mesh->index_size == sizeof(u16) || mesh->index_size == sizeof(u32))
+                 && range_in_file(mesh->indices_offset,   (u64)mesh->num_indices * mesh->index_size, size)
+                 && mesh->positions_offset % alignof(Vector3) == 0
+                 && mesh->indices_offset % mesh->index_size == 0
+                 && mesh->material_index >= -1 && mesh->material_index < (i32)header->num_materials
+                 && mesh->num_lods >= 1 && mesh->num_lods <= CFFMODEL_MAX_LODS
+                 && mesh->lods[0].first_index == 0;
+            for (u32 lod = 0; lod < mesh->num_lods && valid; lod++) {
+                valid = mesh->lods[lod].num_indices % 3 == 0
+                     && mesh->lods[lod].num_indices <= mesh->num_indices
+                     && mesh->lods[lod].first_index <= mesh->num_indices - mesh->lods[lod].num_indices;
+            }
+        }
+        Cffmodel_Material *materials = (Cffmodel_Material *)(file.data + header->materials_offset);
+        for (u32 i = 0; i < header->num_materials && valid; i++) {
+            for (int map = 0; map < MM_COUNT; map++) {
+                valid = valid && materials[i].texture_paths[map] < header->strings_size;
+            }
+        }
+    }
+
+    if (!valid) {
+        printf("open_cooked_model(): %s is out of date or corrupt\n", filename);
+        unmap_file(&file);
+        return false;
+    }
+
+    out_model->file = file;
+    out_model->header = header;
+    out_model->meshes = (Cffmodel_Mesh *)(file.data + header->meshes_offset);
+    out_model->materials = (Cffmodel_Material *)(file.data + header->materials_offset);
+    out_model->strings = (char *)(file.data + header->strings_offset);
+    return true;
+}
+
+void close_cooked_model(Cooked_Model_File *model) {
+    unmap_file(&model->file);
+    *model = {};
+}
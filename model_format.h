@@ -0,0 +1,130 @@
+#pragma once
+
+#include "basic.h"
+#include "math.h"
+
+//
+// .cffmodel, the cooked model format.
+//
+// Importing through assimp means parsing the source file, running its post-processing and then
+// copying every vertex field by field, which takes seconds for sponza. Cooking does all of that
+// once and writes the result out in exactly the layout the renderer uses, so loading is mapping
+// the file and handing pointers into it to create_buffer().
+//
+// Layout, all offsets are from the start of the file:
+//
+//   Cffmodel_Header
+//   Cffmodel_Mesh     x num_meshes
+//   Cffmodel_Material x num_materials
+//   string table, null terminated strings. offset 0 is always the empty string.
+//   blobs: per mesh the vertices, the positions and the indices, each CFFMODEL_BLOB_ALIGNMENT aligned
+//
+// Everything is little-endian and fixed size. Bump CFFMODEL_VERSION whenever any of it changes,
+// or the Vertex struct does, and old files will be rejected and re-cooked.
+//
+
+#define CFFMODEL_MAGIC 0x4d464643 // "CFFM"
+#define CFFMODEL_VERSION 5
+#define CFFMODEL_BLOB_ALIGNMENT 64
+#define CFFMODEL_MAX_LODS 5
+
+enum Material_Map {
+    MM_ALBEDO,
+    MM_NORMAL,
+    MM_METALLIC,
+    MM_ROUGHNESS,
+    MM_EMISSION,
+    MM_AO,
+
+    MM_COUNT,
+};
+
+struct Cffmodel_Header {
+    u32 magic;
+    u32 version;
+    u32 vertex_size; // size of the vertex layout it was cooked with, see Vertex_Layout
+    u32 num_meshes;
+    u32 num_materials;
+    u32 pad;
+    u64 meshes_offset;
+    u64 materials_offset;
+    u64 strings_offset;
+    u64 strings_size;
+    u64 file_size;
+};
+
+// A range of the mesh's indices. lods[0] is the full mesh and starts at 0, the rest are simplified
+// versions of it that use the same vertices.
+struct Cffmodel_Lod {
+    u32 first_index;
+    u32 num_indices;
+    float error;          // furthest the surface moved from lods[0], in model space
+};
+
+struct Cffmodel_Mesh {
+    u64 vertices_offset;  // num_vertices Vertex structs, ready for a vertex buffer
+    u64 positions_offset; // num_vertices Vector3s, the CPU copy for BVHs and such
+    u64 indices_offset;   // num_indices of index_size bytes each, every LOD's, 0 if the mesh isn't indexed
+    u32 num_vertices;
+    u32 num_indices;
+    i32 material_index;   // -1 for none
+    float bounds_min[3];
+    float bounds_max[3];
+    u32 index_size;       // 2 if num_vertices fits in a u16, 4 otherwise
+    u32 num_lods;
+    Cffmodel_Lod lods[CFFMODEL_MAX_LODS];
+};
+
+#define CFFMODEL_MATERIAL_TRANSPARENT (1 << 0)
+
+struct Cffmodel_Material {
+    u32 texture_paths[MM_COUNT]; // string table offsets, relative to the .cffmodel's directory. 0 for no texture.
+    u32 srgb_textures;           // bit per Material_Map, set if that texture holds sRGB color
+    u32 flags;
+    float ambient;
+    float metallic;
+    float roughness;
+    u32 pad;
+};
+
+static_assert(sizeof(Cffmodel_Header)   == 64, "Cffmodel_Header layout changed, bump CFFMODEL_VERSION");
+static_assert(sizeof(Cffmodel_Mesh)     == 128, "Cffmodel_Mesh layout changed, bump CFFMODEL_VERSION");
+static_assert(sizeof(Cffmodel_Material) == 48, "Cffmodel_Material layout changed, bump CFFMODEL_VERSION");
+
+
+
+// Writing. Add materials and meshes in any order, meshes refer to materials by the index
+// model_cooker_add_material() returned. Indices always come in as u32s, meshes with few enough
+// vertices get them written as u16s. lods index into indices, with no lods the whole of indices is
+// the only one.
+struct Model_Cooker {
+    u32 vertex_size;
+    Array<Cffmodel_Mesh> meshes;
+    Array<Cffmodel_Material> materials;
+    Array<char> strings;
+    Array<byte> blobs; // offsets in meshes are relative to the start of this until the file is written
+};
+
+Model_Cooker make_model_cooker(u32 vertex_size, Allocator allocator);
+void destroy_model_cooker(Model_Cooker *cooker);
+u32  model_cooker_add_string(Model_Cooker *cooker, char *str);
+int  model_cooker_add_material(Model_Cooker *cooker, Cffmodel_Material material);
+void model_cooker_add_mesh(Model_Cooker *cooker, void *vertices, Vector3 *positions, int num_vertices, u32 *indices, int num_indices, int material_index, Cffmodel_Lod *lods = nullptr, int num_lods = 0);
+bool write_cooked_model(Model_Cooker *cooker, char *filename);
+
+
+
+// Reading. open_cooked_model() maps the file and checks that the header and every table entry
+// point inside it, it never looks at the vertex data.
+struct Cooked_Model_File {
+    Mapped_File file;
+    Cffmodel_Header *header;
+    Cffmodel_Mesh *meshes;
+    Cffmodel_Material *materials;
+    char *strings;
+};
+
+bool open_cooked_model(char *filename, u32 vertex_size, Cooked_Model_File *out_model);
+void close_cooked_model(Cooked_Model_File *model);
+
+static inline void *cooked_model_blob(Cooked_Model_File *model, u64 offset) { return model->file.data + offset; }
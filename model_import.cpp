@@ -0,0 +1,305 @@
+#include "application.h"
+#include "renderer.h"
+
+//
+// The parts of turning a source model into a Model or a .cffmodel that don't care which file format
+// it came from. assimp_loader.cpp and gltf_loader.cpp fill in Imported_Meshes and Imported_Materials
+// and hand them to these.
+//
+
+// A mesh with its transform already applied, in the layout the renderer uses.
+struct Imported_Mesh {
+    Array<Vertex> vertices;
+    Array<u32> indices;
+    bool has_tangents;      // came with the file, otherwise finish_imported_meshes() generates them
+    bool has_vertex_colors; // only so the compact layout can say it's dropping them
+    int material;           // index into the importer's materials, -1 for none
+    char *name;             // only lives as long as the source file
+};
+
+Imported_Mesh make_imported_mesh(Allocator allocator, int num_vertices, int num_indices) {
+    Imported_Mesh mesh = {};
+    mesh.vertices = make_array<Vertex>(allocator, num_vertices > 0 ? num_vertices : 1);
+    mesh.indices = make_array<u32>(allocator, num_indices > 0 ? num_indices : 1);
+    mesh.material = -1;
+    return mesh;
+}
+
+// Tangents for all the meshes that didn't come with any are generated in one go so they spread
+// across threads together, then everything is optimized. The cooker writes out whatever order comes
+// out of here, so cooked models get this for free.
+void finish_imported_meshes(Array<Imported_Mesh> *meshes, Allocator allocator, Mesh_Optimization_Report *report) {
+    Array<Array<Vertex> *> tangent_vertices = make_array<Array<Vertex> *>(allocator, meshes->count > 0 ? meshes->count : 1);
+    defer(tangent_vertices.destroy());
+    Array<Array<u32> *> tangent_indices = make_array<Array<u32> *>(allocator, meshes->count > 0 ? meshes->count : 1);
+    defer(tangent_indices.destroy());
+    Foreach (mesh, *meshes) {
+        if (!mesh->has_tangents) {
+            tangent_vertices.append(&mesh->vertices);
+            tangent_indices.append(&mesh->indices);
+        }
+    }
+    generate_vertex_tangents(tangent_vertices.data, tangent_indices.data, tangent_vertices.count);
+
+    Foreach (mesh, *meshes) {
+        optimize_mesh(&mesh->vertices, &mesh->indices, report);
+    }
+}
+
+void destroy_imported_meshes(Array<Imported_Mesh> meshes) {
+    Foreach (mesh, meshes) {
+        mesh->vertices.destroy();
+        mesh->indices.destroy();
+    }
+    meshes.destroy();
+}
+
+// note(josh): each use of a mesh gets a copy since generate_mesh_lods() appends to the indices
+static void copy_imported_mesh(Imported_Mesh *mesh, Array<Vertex> *out_vertices, Array<u32> *out_indices) {
+    out_vertices->reserve(mesh->vertices.count);
+    memcpy(out_vertices->data, mesh->vertices.data, sizeof(Vertex) * mesh->vertices.count);
+    out_vertices->count = mesh->vertices.count;
+    out_indices->reserve(mesh->indices.count);
+    memcpy(out_indices->data, mesh->indices.data, sizeof(u32) * mesh->indices.count);
+    out_indices->count = mesh->indices.count;
+}
+
+
+
+// Texture paths are kept as they are in the source file, relative to its directory, so the same
+// material can be either loaded right away or written into a cooked model.
+struct Imported_Material {
+    char *texture_paths[MM_COUNT];
+    u32 srgb_textures;
+    float ambient;
+    float metallic;
+    float roughness;
+    bool has_transparency;
+};
+
+static void set_imported_texture(Imported_Material *material, Material_Map map, char *path, bool srgb) {
+    if (material->texture_paths[map] != nullptr) {
+        return;
+    }
+    material->texture_paths[map] = path;
+    if (srgb) {
+        material->srgb_textures |= (1 << map);
+    }
+}
+
+PBR_Material create_imported_material(Imported_Material *imported, char *directory, Texture_Cache *texture_cache, Allocator allocator) {
+    PBR_Material material = {};
+    material.cbuffer_handle = create_pbr_material_cbuffer();
+    material.ambient = imported->ambient;
+    material.metallic = imported->metallic;
+    material.roughness = imported->roughness;
+    material.has_transparency = imported->has_transparency;
+    for (int map = 0; map < MM_COUNT; map++) {
+        if (imported->texture_paths[map] == nullptr) {
+            continue;
+        }
+        char *path = resolve_texture_path(directory, imported->texture_paths[map], allocator);
+        defer(free(allocator, path));
+        Texture_Format format = (imported->srgb_textures & (1 << map)) ? TF_R8G8B8A8_UINT_SRGB : TF_R8G8B8A8_UINT;
+        *get_material_map(&material, (Material_Map)map) = get_cached_texture(texture_cache, path, format, TWM_LINEAR_WRAP);
+    }
+    return material;
+}
+
+// One PBR_Material per imported material, the ones no mesh uses are left zeroed. The textures of
+// all of them are decoded in parallel before any material is created.
+Array<PBR_Material> create_imported_materials(Array<Imported_Material> imported_materials, Array<Imported_Mesh> meshes, char *directory, Texture_Cache *texture_cache, Allocator allocator) {
+    Array<bool> material_used = make_array<bool>(allocator, imported_materials.count > 0 ? imported_materials.count : 1);
+    defer(material_used.destroy());
+    For (i, imported_materials) {
+        material_used.append(false);
+    }
+    Foreach (mesh, meshes) {
+        if (mesh->material != -1) {
+            material_used[mesh->material] = true;
+        }
+    }
+
+    Array<Texture_Request> texture_requests = make_array<Texture_Request>(allocator, imported_materials.count * MM_COUNT + 1);
+    defer(texture_requests.destroy());
+    For (i, imported_materials) {
+        if (!material_used[i]) {
+            continue;
+        }
+        for (int map = 0; map < MM_COUNT; map++) {
+            if (imported_materials[i].texture_paths[map] == nullptr) {
+                continue;
+            }
+            Texture_Request request = {};
+            request.path = resolve_texture_path(directory, imported_materials[i].texture_paths[map], allocator);
+            request.format = (imported_materials[i].srgb_textures & (1 << map)) ? TF_R8G8B8A8_UINT_SRGB : TF_R8G8B8A8_UINT;
+            request.wrap_mode = TWM_LINEAR_WRAP;
+            texture_requests.append(request);
+        }
+    }
+    preload_cached_textures(texture_cache, texture_requests.data, texture_requests.count);
+    Foreach (request, texture_requests) {
+        free(allocator, request->path);
+    }
+
+    Array<PBR_Material> materials = make_array<PBR_Material>(allocator, imported_materials.count > 0 ? imported_materials.count : 1);
+    For (i, imported_materials) {
+        PBR_Material material = {};
+        if (material_used[i]) {
+            material = create_imported_material(&imported_materials[i], directory, texture_cache, allocator);
+        }
+        materials.append(material);
+    }
+    return materials;
+}
+
+Cffmodel_Material cook_imported_material(Imported_Material *imported, Model_Cooker *cooker) {
+    Cffmodel_Material material = {};
+    for (int map = 0; map < MM_COUNT; map++) {
+        material.texture_paths[map] = model_cooker_add_string(cooker, imported->texture_paths[map]);
+    }
+    material.srgb_textures = imported->srgb_textures;
+    material.flags = imported->has_transparency ? CFFMODEL_MATERIAL_TRANSPARENT : 0;
+    material.ambient = imported->ambient;
+    material.metallic = imported->metallic;
+    material.roughness = imported->roughness;
+    return material;
+}
+
+
+
+// Scratch arrays reused from one mesh to the next while building a model.
+struct Mesh_Import_Scratch {
+    Array<Vertex> vertices;
+    Array<u32> indices;
+    Array<Vector3> positions;
+    Array<Compact_Vertex> compact_vertices;
+};
+
+Mesh_Import_Scratch make_mesh_import_scratch(Allocator allocator, Vertex_Layout layout) {
+    Mesh_Import_Scratch scratch = {};
+    scratch.vertices = make_array<Vertex>(allocator, 1024);
+    scratch.indices = make_array<u32>(allocator, 1024);
+    scratch.positions = make_array<Vector3>(allocator, 1024);
+    scratch.compact_vertices = make_array<Compact_Vertex>(allocator, layout == VL_COMPACT ? 1024 : 0);
+    return scratch;
+}
+
+void destroy_mesh_import_scratch(Mesh_Import_Scratch *scratch) {
+    scratch->vertices.destroy();
+    scratch->indices.destroy();
+    scratch->positions.destroy();
+    scratch->compact_vertices.destroy();
+}
+
+// the vertices in the layout they're drawn with, points into scratch
+static void *pack_imported_vertices(Imported_Mesh *mesh, Vertex_Layout layout, Mesh_Import_Scratch *scratch) {
+    if (layout != VL_COMPACT) {
+        return scratch->vertices.data;
+    }
+    if (mesh->has_vertex_colors) printf("%s: the compact vertex layout drops vertex colors\n", mesh->name ? mesh->name : "mesh");
+    scratch->compact_vertices.reserve(scratch->vertices.count);
+    pack_compact_vertices(scratch->compact_vertices.data, scratch->vertices.data, scratch->vertices.count);
+    scratch->compact_vertices.count = scratch->vertices.count;
+    return scratch->compact_vertices.data;
+}
+
+// Makes the GPU buffers and LODs for mesh and appends it to out_model. material is null for none.
+void add_imported_mesh(Imported_Mesh *mesh, PBR_Material *material, Vertex_Layout layout, Allocator allocator, Mesh_Import_Scratch *scratch, Mesh_Lod_Report *lod_report, Model *out_model) {
+    Array<Vertex> &vertices = scratch->vertices;
+    Array<u32> &indices = scratch->indices;
+    copy_imported_mesh(mesh, &vertices, &indices);
+    Mesh_Lod lods[MAX_MESH_LODS];
+    int num_lods = generate_mesh_lods(&vertices, &indices, lods, lod_report);
+
+    void *vertex_data = pack_imported_vertices(mesh, layout, scratch);
+    Buffer vertex_buffer = create_buffer(BT_VERTEX, vertex_data, vertices.count * vertex_layout_size(layout));
+    Index_Type index_type;
+    Buffer index_buffer = create_index_buffer(indices.data, indices.count, vertices.count, &index_type);
+
+    Array<Vector3> cpu_positions = make_array<Vector3>(allocator, vertices.count);
+    Foreach (vertex, vertices) {
+        cpu_positions.append(vertex->position);
+    }
+    Array<u32> cpu_indices = make_array<u32>(allocator, lods[0].num_indices);
+    memcpy(cpu_indices.data, indices.data, lods[0].num_indices * sizeof(indices[0]));
+    cpu_indices.count = lods[0].num_indices;
+
+    Buffer position_buffer = create_buffer(BT_VERTEX, cpu_positions.data, cpu_positions.count * sizeof(cpu_positions[0]));
+
+    Loaded_Mesh loaded_mesh = {};
+    loaded_mesh.vertex_buffer = vertex_buffer;
+    loaded_mesh.position_buffer = position_buffer;
+    loaded_mesh.vertex_layout = layout;
+    loaded_mesh.num_vertices = vertices.count;
+    loaded_mesh.index_buffer = index_buffer;
+    loaded_mesh.index_type = index_type;
+    loaded_mesh.num_indices = lods[0].num_indices;
+    memcpy(loaded_mesh.lods, lods, sizeof(lods[0]) * num_lods);
+    loaded_mesh.num_lods = num_lods;
+    if (material) {
+        // note(josh): meshes get a copy so they can still be tweaked individually, the cbuffer
+        // and textures are shared
+        assert(material->cbuffer_handle != nullptr);
+        loaded_mesh.material = *material;
+        loaded_mesh.has_material = true;
+    }
+    loaded_mesh.positions = cpu_positions;
+    loaded_mesh.indices = cpu_indices;
+    set_mesh_bounds(&loaded_mesh);
+    out_model->meshes.append(loaded_mesh);
+}
+
+// The .cffmodel version of add_imported_mesh(). material_index is the cooker's, -1 for none.
+void cook_imported_mesh(Imported_Mesh *mesh, int material_index, Mesh_Import_Scratch *scratch, Mesh_Lod_Report *lod_report, Model_Cooker *cooker) {
+    Array<Vertex> &vertices = scratch->vertices;
+    Array<u32> &indices = scratch->indices;
+    copy_imported_mesh(mesh, &vertices, &indices);
+    Mesh_Lod lods[MAX_MESH_LODS];
+    int num_lods = generate_mesh_lods(&vertices, &indices, lods, lod_report);
+    Cffmodel_Lod cooked_lods[MAX_MESH_LODS];
+    for (int lod = 0; lod < num_lods; lod++) {
+        cooked_lods[lod] = {(u32)lods[lod].first_index, (u32)lods[lod].num_indices, lods[lod].error};
+    }
+
+    scratch->positions.clear();
+    Foreach (vertex, vertices) {
+        scratch->positions.append(vertex->position);
+    }
+    void *vertex_data = pack_imported_vertices(mesh, cooker->vertex_size == sizeof(Compact_Vertex) ? VL_COMPACT : VL_FULL, scratch);
+    model_cooker_add_mesh(cooker, vertex_data, scratch->positions.data, vertices.count, indices.data, indices.count, material_index, cooked_lods, num_lods);
+}
+
+
+
+void print_model_import_report(char *filename, int num_source_vertices, Model *model, Mesh_Optimization_Report *report, Mesh_Lod_Report *lod_report, Vertex_Layout layout) {
+    int num_welded_vertices = 0;
+    i64 num_indices = 0;
+    i64 index_bytes = 0;
+    Foreach (mesh, model->meshes) {
+        num_welded_vertices += mesh->num_vertices;
+        num_indices += total_mesh_indices(mesh);
+        index_bytes += (i64)total_mesh_indices(mesh) * index_type_size(mesh->index_type);
+    }
+    printf("%s: welded %d vertices down to %d\n", filename, num_source_vertices, num_welded_vertices);
+    print_mesh_optimization_report(filename, report);
+    print_mesh_lod_report(filename, lod_report);
+    print_vertex_buffer_memory(filename, num_welded_vertices, layout);
+    print_index_buffer_memory(filename, num_indices, index_bytes);
+}
+
+void print_cooked_import_report(char *filename, int num_source_vertices, Model_Cooker *cooker, Mesh_Optimization_Report *report, Mesh_Lod_Report *lod_report, Vertex_Layout layout) {
+    int num_welded_vertices = 0;
+    i64 num_indices = 0;
+    i64 index_bytes = 0;
+    Foreach (mesh, cooker->meshes) {
+        num_welded_vertices += mesh->num_vertices;
+        num_indices += mesh->num_indices;
+        index_bytes += (i64)mesh->num_indices * mesh->index_size;
+    }
+    printf("%s: welded %d vertices down to %d\n", filename, num_source_vertices, num_welded_vertices);
+    print_mesh_optimization_report(filename, report);
+    print_mesh_lod_report(filename, lod_report);
+    print_vertex_buffer_memory(filename, num_welded_vertices, layout);
+    print_index_buffer_memory(filename, num_indices, index_bytes);
+}
@@ -0,0 +1,315 @@
+#include "packing.h"
+
+#include "half.h"
+#include "simd.h"
+
+#include <math.h>
+
+// note(josh): everything rounds with the current rounding mode (nearest even by default) so the
+// scalar and SSE versions agree exactly. cvtps2dq does the same thing.
+static inline i32 round_to_i32(float f) {
+    return (i32)nearbyintf(f);
+}
+
+static inline float sign_not_zero(float f) {
+    return f >= 0.0f ? 1.0f : -1.0f;
+}
+
+u32 pack_unorm(float v, int bits) {
+    ASSERT(bits > 0 && bits <= 24);
+    float max = (float)((1u << bits) - 1);
+    return (u32)round_to_i32(clamp(v, 0.0f, 1.0f) * max);
+}
+
+float unpack_unorm(u32 v, int bits) {
+    ASSERT(bits > 0 && bits <= 24);
+    float max = (float)((1u << bits) - 1);
+    return (float)v / max;
+}
+
+i32 pack_snorm(float v, int bits) {
+    ASSERT(bits > 1 && bits <= 24);
+    float max = (float)((1 << (bits - 1)) - 1);
+    return round_to_i32(clamp(v, -1.0f, 1.0f) * max);
+}
+
+float unpack_snorm(i32 v, int bits) {
+    ASSERT(bits > 1 && bits <= 24);
+    float max = (float)((1 << (bits - 1)) - 1);
+    // note(josh): the most negative value is one step past -1, D3D clamps it to -1 too
+    return fmaxf((float)v / max, -1.0f);
+}
+
+// sign extends the low `bits` bits of v
+static inline i32 sign_extend(u32 v, int bits) {
+    return ((i32)(v << (32 - bits))) >> (32 - bits);
+}
+
+u32 pack_unorm_10_10_10_2(Vector4 v) {
+    return pack_unorm(v.x, 10)
+        | (pack_unorm(v.y, 10) << 10)
+        | (pack_unorm(v.z, 10) << 20)
+        | (pack_unorm(v.w, 2)  << 30);
+}
+
+Vector4 unpack_unorm_10_10_10_2(u32 packed) {
+    return v4(unpack_unorm((packed >>  0) & 0x3ff, 10),
+              unpack_unorm((packed >> 10) & 0x3ff, 10),
+              unpack_unorm((packed >> 20) & 0x3ff, 10),
+              unpack_unorm((packed >> 30) & 0x3,   2));
+}
+
+u32 pack_rgba8(Vector4 color) {
+    return pack_unorm(color.x, 8)
+        | (pack_unorm(color.y, 8) << 8)
+        | (pack_unorm(color.z, 8) << 16)
+        | (pack_unorm(color.w, 8) << 24);
+}
+
+Vector4 unpack_rgba8(u32 packed) {
+    return v4(unpack_unorm((packed >>  0) & 0xff, 8),
+              unpack_unorm((packed >>  8) & 0xff, 8),
+              unpack_unorm((packed >> 16) & 0xff, 8),
+              unpack_unorm((packed >> 24) & 0xff, 8));
+}
+
+u32 pack_half2(Vector2 uv) {
+    // note(josh): go through the bulk path so this rounds the same as pack_half2_batch()
+    u16 halves[2];
+    halves_from_floats(halves, &uv.x, 2);
+    return (u32)halves[0] | ((u32)halves[1] << 16);
+}
+
+Vector2 unpack_half2(u32 packed) {
+    u16 halves[2] = { (u16)(packed & 0xffff), (u16)(packed >> 16) };
+    Vector2 result;
+    floats_from_halves(&result.x, halves, 2);
+    return result;
+}
+
+
+
+Vector2 oct_encode(Vector3 n) {
+    float l1 = fabsf(n.x) + fabsf(n.y) + fabsf(n.z);
+    Vector2 p = v2(n.x / l1, n.y / l1);
+    if (n.z < 0) {
+        // fold the bottom half of the octahedron out over the corners
+        p = v2((1.0f - fabsf(p.y)) * sign_not_zero(p.x),
+               (1.0f - fabsf(p.x)) * sign_not_zero(p.y));
+    }
+    return p;
+}
+
+Vector3 oct_decode(Vector2 e) {
+    Vector3 n = v3(e.x, e.y, 1.0f - fabsf(e.x) - fabsf(e.y));
+    float t = fmaxf(-n.z, 0.0f);
+    n.x += n.x >= 0 ? -t : t;
+    n.y += n.y >= 0 ? -t : t;
+    return normalize(n);
+}
+
+u16 pack_oct16(Vector3 n) {
+    Vector2 e = oct_encode(n);
+    u32 x = (u32)pack_snorm(e.x, 8) & 0xff;
+    u32 y = (u32)pack_snorm(e.y, 8) & 0xff;
+    return (u16)(x | (y << 8));
+}
+
+Vector3 unpack_oct16(u16 packed) {
+    return oct_decode(v2(unpack_snorm(sign_extend(packed, 8), 8), unpack_snorm(sign_extend(packed >> 8, 8), 8)));
+}
+
+u32 pack_oct24(Vector3 n) {
+    Vector2 e = oct_encode(n);
+    u32 x = (u32)pack_snorm(e.x, 12) & 0xfff;
+    u32 y = (u32)pack_snorm(e.y, 12) & 0xfff;
+    return x | (y << 12);
+}
+
+Vector3 unpack_oct24(u32 packed) {
+    return oct_decode(v2(unpack_snorm(sign_extend(packed, 12), 12), unpack_snorm(sign_extend(packed >> 12, 12), 12)));
+}
+
+u32 pack_oct32(Vector3 n) {
+    Vector2 e = oct_encode(n);
+    u32 x = (u32)pack_snorm(e.x, 16) & 0xffff;
+    u32 y = (u32)pack_snorm(e.y, 16) & 0xffff;
+    return x | (y << 16);
+}
+
+Vector3 unpack_oct32(u32 packed) {
+    return oct_decode(v2(unpack_snorm(sign_extend(packed, 16), 16), unpack_snorm(sign_extend(packed >> 16, 16), 16)));
+}
+
+
+
+u32 pack_tangent_oct(Vector3 tangent, float bitangent_sign) {
+    Vector2 e = oct_encode(tangent);
+    return pack_unorm(e.x * 0.5f + 0.5f, 10)
+        | (pack_unorm(e.y * 0.5f + 0.5f, 10) << 10)
+        | ((bitangent_sign < 0 ? 0u : 3u) << 30);
+}
+
+void unpack_tangent_oct(u32 packed, Vector3 *out_tangent, float *out_bitangent_sign) {
+    Vector4 v = unpack_unorm_10_10_10_2(packed);
+    *out_tangent = oct_decode(v2(v.x * 2.0f - 1.0f, v.y * 2.0f - 1.0f));
+    *out_bitangent_sign = v.w > 0.5f ? 1.0f : -1.0f;
+}
+
+Packed_Tangent_Frame pack_tangent_frame(Vector3 normal, Vector3 tangent, float bitangent_sign) {
+    Matrix4 m = m4_identity();
+    m[0] = v4(tangent.x, tangent.y, tangent.z, 0);
+    Vector3 bitangent = cross(normal, tangent);
+    m[1] = v4(bitangent.x, bitangent.y, bitangent.z, 0);
+    m[2] = v4(normal.x, normal.y, normal.z, 0);
+    Quaternion q = normalize(matrix4_to_quaternion(m));
+
+    // note(josh): q and -q are the same rotation so we use the sign of w to store whether the frame
+    // is mirrored. that only works if w can't be zero, so clamp it to the smallest snorm16 step and
+    // shrink xyz to keep it unit length.
+    if (q.w < 0) {
+        q = -q;
+    }
+    const float bias = 1.0f / 32767.0f;
+    if (q.w < bias) {
+        float s = sqrtf(1.0f - bias * bias);
+        q.x *= s;
+        q.y *= s;
+        q.z *= s;
+        q.w = bias;
+    }
+    if (bitangent_sign < 0) {
+        q = -q;
+    }
+
+    Packed_Tangent_Frame result;
+    result.x = (i16)pack_snorm(q.x, 16);
+    result.y = (i16)pack_snorm(q.y, 16);
+    result.z = (i16)pack_snorm(q.z, 16);
+    result.w = (i16)pack_snorm(q.w, 16);
+    return result;
+}
+
+void unpack_tangent_frame(Packed_Tangent_Frame packed, Vector3 *out_normal, Vector3 *out_tangent, Vector3 *out_bitangent) {
+    Quaternion q = quaternion(unpack_snorm(packed.x, 16), unpack_snorm(packed.y, 16), unpack_snorm(packed.z, 16), unpack_snorm(packed.w, 16));
+    float sign = q.w < 0 ? -1.0f : 1.0f;
+    q = normalize(q);
+    *out_tangent = quaternion_right(q);
+    *out_normal  = quaternion_forward(q);
+    *out_bitangent = cross(*out_normal, *out_tangent) * sign;
+}
+
+float tangent_frame_sign(Vector3 normal, Vector3 tangent, Vector3 bitangent) {
+    return dot(cross(normal, tangent), bitangent) < 0 ? -1.0f : 1.0f;
+}
+
+
+
+// four Vector3s at a time as three SoA registers
+static inline void load_vector3x4(Vector3 *v, f32x4 *x, f32x4 *y, f32x4 *z) {
+    *x = _mm_setr_ps(v[0].x, v[1].x, v[2].x, v[3].x);
+    *y = _mm_setr_ps(v[0].y, v[1].y, v[2].y, v[3].y);
+    *z = _mm_setr_ps(v[0].z, v[1].z, v[2].z, v[3].z);
+}
+
+static inline void oct_encode_x4(f32x4 x, f32x4 y, f32x4 z, f32x4 *out_x, f32x4 *out_y) {
+    f32x4 one = f32x4_set1(1.0f);
+    f32x4 l1 = f32x4_add(f32x4_add(f32x4_abs(x), f32x4_abs(y)), f32x4_abs(z));
+    f32x4 px = f32x4_div(x, l1);
+    f32x4 py = f32x4_div(y, l1);
+    f32x4 sx = f32x4_select(f32x4_cmp_lt(px, f32x4_zero()), one, f32x4_neg(one));
+    f32x4 sy = f32x4_select(f32x4_cmp_lt(py, f32x4_zero()), one, f32x4_neg(one));
+    f32x4 fx = f32x4_mul(f32x4_sub(one, f32x4_abs(py)), sx);
+    f32x4 fy = f32x4_mul(f32x4_sub(one, f32x4_abs(px)), sy);
+    f32x4 below = f32x4_cmp_lt(z, f32x4_zero());
+    *out_x = f32x4_select(below, px, fx);
+    *out_y = f32x4_select(below, py, fy);
+}
+
+static inline i32x4 pack_snorm_x4(f32x4 v, int bits) {
+    float max = (float)((1 << (bits - 1)) - 1);
+    v = f32x4_clamp(v, f32x4_set1(-1.0f), f32x4_set1(1.0f));
+    return f32x4_to_i32x4(f32x4_mul(v, f32x4_set1(max)));
+}
+
+static inline i32x4 pack_unorm_x4(f32x4 v, int bits) {
+    float max = (float)((1u << bits) - 1);
+    v = f32x4_clamp(v, f32x4_zero(), f32x4_set1(1.0f));
+    return f32x4_to_i32x4(f32x4_mul(v, f32x4_set1(max)));
+}
+
+void pack_oct16_batch(u16 *out, Vector3 *normals, int count) {
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        f32x4 x, y, z, ex, ey;
+        load_vector3x4(normals + i, &x, &y, &z);
+        oct_encode_x4(x, y, z, &ex, &ey);
+        i32x4 mask = i32x4_set1(0xff);
+        i32x4 packed = i32x4_or(i32x4_and(pack_snorm_x4(ex, 8), mask), i32x4_shl(i32x4_and(pack_snorm_x4(ey, 8), mask), 8));
+        // sign extend from 16 bits so the saturating pack leaves the values alone
+        packed = i32x4_sar(i32x4_shl(packed, 16), 16);
+        _mm_storel_epi64((__m128i *)(out + i), _mm_packs_epi32(packed, packed));
+    }
+    for (; i < count; i++) {
+        out[i] = pack_oct16(normals[i]);
+    }
+}
+
+void pack_oct32_batch(u32 *out, Vector3 *normals, int count) {
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        f32x4 x, y, z, ex, ey;
+        load_vector3x4(normals + i, &x, &y, &z);
+        oct_encode_x4(x, y, z, &ex, &ey);
+        i32x4 packed = i32x4_or(i32x4_and(pack_snorm_x4(ex, 16), i32x4_set1(0xffff)), i32x4_shl(pack_snorm_x4(ey, 16), 16));
+        i32x4_store(out + i, packed);
+    }
+    for (; i < count; i++) {
+        out[i] = pack_oct32(normals[i]);
+    }
+}
+
+void pack_tangent_oct_batch(u32 *out, Vector3 *tangents, float *bitangent_signs, int count) {
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        f32x4 x, y, z, ex, ey;
+        load_vector3x4(tangents + i, &x, &y, &z);
+        oct_encode_x4(x, y, z, &ex, &ey);
+        f32x4 half = f32x4_set1(0.5f);
+        i32x4 px = pack_unorm_x4(f32x4_madd(ex, half, half), 10);
+        i32x4 py = pack_unorm_x4(f32x4_madd(ey, half, half), 10);
+        f32x4 negative = f32x4_cmp_lt(f32x4_load(bitangent_signs + i), f32x4_zero());
+        i32x4 alpha = i32x4_shl(_mm_andnot_si128(f32x4_cast_i32x4(negative), i32x4_set1(3)), 30);
+        i32x4_store(out + i, i32x4_or(i32x4_or(px, i32x4_shl(py, 10)), alpha));
+    }
+    for (; i < count; i++) {
+        out[i] = pack_tangent_oct(tangents[i], bitangent_signs[i]);
+    }
+}
+
+void pack_rgba8_batch(u32 *out, Vector4 *colors, int count) {
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        // note(josh): each color is already one register, transpose to SoA
+        f32x4 r = _mm_loadu_ps(&colors[i+0].x);
+        f32x4 g = _mm_loadu_ps(&colors[i+1].x);
+        f32x4 b = _mm_loadu_ps(&colors[i+2].x);
+        f32x4 a = _mm_loadu_ps(&colors[i+3].x);
+        _MM_TRANSPOSE4_PS(r, g, b, a);
+        i32x4 packed = pack_unorm_x4(r, 8);
+        packed = i32x4_or(packed, i32x4_shl(pack_unorm_x4(g, 8), 8));
+        packed = i32x4_or(packed, i32x4_shl(pack_unorm_x4(b, 8), 16));
+        packed = i32x4_or(packed, i32x4_shl(pack_unorm_x4(a, 8), 24));
+        i32x4_store(out + i, packed);
+    }
+    for (; i < count; i++) {
+        out[i] = pack_rgba8(colors[i]);
+    }
+}
+
+void pack_half2_batch(u32 *out, Vector2 *uvs, int count) {
+    // note(josh): Vector2s are just pairs of floats and two little-endian halves are a u32 with u in
+    // the low bits, so this is one bulk conversion.
+    static_assert(sizeof(Vector2) == sizeof(float) * 2, "Vector2 must be two packed floats");
+    halves_from_floats((u16 *)out, &uvs[0].x, count * 2);
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "basic.h"
+#include "math.h"
+
+//
+// Quantization helpers for squeezing vertex attributes down.
+//
+// snorm values map [-1, 1] to [-(2^(bits-1)-1), 2^(bits-1)-1] like D3D's _SNORM formats, unorm
+// values map [0, 1] to [0, 2^bits-1] like the _UNORM formats. Inputs are clamped and rounded to
+// nearest, so a round trip is off by at most half a step.
+//
+
+u32   pack_unorm  (float v, int bits);
+float unpack_unorm(u32 v, int bits);
+i32   pack_snorm  (float v, int bits);
+float unpack_snorm(i32 v, int bits);
+
+// DXGI_FORMAT_R10G10B10A2_UNORM layout, x in the low bits
+u32     pack_unorm_10_10_10_2  (Vector4 v);
+Vector4 unpack_unorm_10_10_10_2(u32 packed);
+
+// DXGI_FORMAT_R8G8B8A8_UNORM layout, r in the low byte
+u32     pack_rgba8  (Vector4 color);
+Vector4 unpack_rgba8(u32 packed);
+
+// DXGI_FORMAT_R16G16_FLOAT layout, u in the low half
+u32     pack_half2  (Vector2 uv);
+Vector2 unpack_half2(u32 packed);
+
+
+
+//
+// Octahedral unit vectors. The sphere is projected onto an octahedron and unfolded into a square,
+// which spends bits much more evenly than storing xyz. Max angular error of a round trip:
+//   16 bit (8+8):   ~0.95 degrees
+//   24 bit (12+12): ~0.06 degrees
+//   32 bit (16+16): ~0.004 degrees
+// The 16 and 32 bit versions are R8G8_SNORM and R16G16_SNORM layouts so a shader can fetch them
+// and call its own oct decode on the result. The 24 bit version lives in the low 24 bits.
+//
+
+Vector2 oct_encode(Vector3 n); // n must be normalized, result is in [-1, 1]
+Vector3 oct_decode(Vector2 e); // returns a normalized vector
+
+u16     pack_oct16  (Vector3 n);
+Vector3 unpack_oct16(u16 packed);
+u32     pack_oct24  (Vector3 n);
+Vector3 unpack_oct24(u32 packed);
+u32     pack_oct32  (Vector3 n);
+Vector3 unpack_oct32(u32 packed);
+
+
+
+//
+// Tangent frames
+//
+
+// Octahedral tangent plus the bitangent sign, R10G10B10A2_UNORM layout: x and y are the oct
+// coordinates remapped to [0, 1], z is unused and alpha is 1 for a positive sign and 0 for a
+// negative one. The bitangent is then cross(normal, tangent) * sign. Max error ~0.24 degrees.
+u32  pack_tangent_oct  (Vector3 tangent, float bitangent_sign);
+void unpack_tangent_oct(u32 packed, Vector3 *out_tangent, float *out_bitangent_sign);
+
+// The whole normal/tangent/bitangent frame as one quaternion in R16G16B16A16_SNORM. Mirrored
+// frames (bitangent_sign < 0) are stored with a negative w, so w is kept away from zero.
+// tangent and normal should be orthonormal. Max error of any axis ~0.004 degrees.
+struct Packed_Tangent_Frame {
+    i16 x, y, z, w;
+};
+
+Packed_Tangent_Frame pack_tangent_frame  (Vector3 normal, Vector3 tangent, float bitangent_sign);
+void                 unpack_tangent_frame(Packed_Tangent_Frame packed, Vector3 *out_normal, Vector3 *out_tangent, Vector3 *out_bitangent);
+
+// bitangent_sign for a frame given its three axes, +1 for right handed and -1 for mirrored UVs
+float tangent_frame_sign(Vector3 normal, Vector3 tangent, Vector3 bitangent);
+
+
+
+//
+// Batch encoders, SSE2 four at a time. Same results as calling the scalar versions in a loop.
+//
+
+void pack_oct16_batch       (u16 *out, Vector3 *normals, int count);
+void pack_oct32_batch       (u32 *out, Vector3 *normals, int count);
+void pack_tangent_oct_batch (u32 *out, Vector3 *tangents, float *bitangent_signs, int count);
+void pack_rgba8_batch       (u32 *out, Vector4 *colors, int count);
+void pack_half2_batch       (u32 *out, Vector2 *uvs, int count);
@@ -13,6 +13,21 @@ Texture2D   shadow_map2   : register(t8);
 Texture2D   shadow_map3   : register(t9);
 Texture2D   shadow_map4   : register(t10);
 
+// radiance reflected by a white lambertian surface facing N from the skybox, not counting skybox_color.
+// the cosine lobe, 1/pi and the basis constants are already folded into skybox_sh on the CPU.
+float3 sh_diffuse_ambient(float3 N) {
+    float3 result = skybox_sh[0].rgb;
+    result += skybox_sh[1].rgb * N.y;
+    result += skybox_sh[2].rgb * N.z;
+    result += skybox_sh[3].rgb * N.x;
+    result += skybox_sh[4].rgb * (N.x * N.y);
+    result += skybox_sh[5].rgb * (N.y * N.z);
+    result += skybox_sh[6].rgb * (3.0 * N.z * N.z - 1.0);
+    result += skybox_sh[7].rgb * (N.x * N.z);
+    result += skybox_sh[8].rgb * (N.x * N.x - N.y * N.y);
+    return max(result, 0);
+}
+
 int sun_can_see_point(float3 position, row_major matrix sun_matrix, Texture2D shadow_map_texture) {
     float4 position_sun_space = mul(sun_matrix, float4(position, 1.0));
     float3 proj_coords = position_sun_space.xyz / position_sun_space.w; // todo(josh): check for divide by zero?
@@ -71,8 +86,9 @@ float calculate_shadow(Texture2D shadow_map_texture, row_major matrix sun_matrix
 PS_OUTPUT main(PS_INPUT input) {
     float3 N = normalize(input.normal);
     if (has_normal_map == 1) {
-        N = normal_map.Sample(main_sampler, input.texcoord.xy).rgb;
-        N = N * 2.0 - 1.0;
+        // note(josh): normal maps are cooked to BC5 which only stores x and y, z is always positive in tangent space
+        float2 xy = normal_map.Sample(main_sampler, input.texcoord.xy).rg * 2.0 - 1.0;
+        N = float3(xy, sqrt(saturate(1.0 - dot(xy, xy))));
         N = normalize(mul(input.tbn, N));
     }
     float4 normal_as_color = float4(N * 0.5 + 0.5, 1.0);
@@ -90,7 +106,11 @@ PS_OUTPUT main(PS_INPUT input) {
     if (has_ao_map) {
         ao = ao_map.Sample(main_sampler, input.texcoord.xy).r;
     }
-    output_color.rgb *= (ambient * ambient_modifier) * ao;
+    float3 ambient_light = float3(1, 1, 1);
+    if (has_skybox_map) {
+        ambient_light = sh_diffuse_ambient(N) * skybox_color.rgb;
+    }
+    output_color.rgb *= ambient_light * (ambient * ambient_modifier) * ao;
 
     for (int point_light_index = 0; point_light_index < num_point_lights; point_light_index++) {
         float3 light_position = point_light_positions[point_light_index].xyz;
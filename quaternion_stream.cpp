@@ -0,0 +1,228 @@
+#include "quaternion_stream.h"
+
+#include "simd.h"
+
+#include <math.h>
+
+Quaternion_Stream make_quaternion_stream(int count, Allocator allocator) {
+    ASSERT(count >= 0);
+    Quaternion_Stream stream = {};
+    stream.count = count;
+    stream.allocator = allocator;
+    if (count > 0) {
+        // note(josh): one block for all four components
+        float *block = (float *)alloc(allocator, sizeof(float) * count * 4, 32);
+        stream.x = block;
+        stream.y = block + count;
+        stream.z = block + count * 2;
+        stream.w = block + count * 3;
+    }
+    return stream;
+}
+
+void destroy_quaternion_stream(Quaternion_Stream *stream) {
+    if (stream->x) {
+        free(stream->allocator, stream->x);
+    }
+    *stream = {};
+}
+
+Quaternion quaternion_stream_get(Quaternion_Stream *stream, int index) {
+    ASSERT(index >= 0 && index < stream->count);
+    return quaternion(stream->x[index], stream->y[index], stream->z[index], stream->w[index]);
+}
+
+void quaternion_stream_set(Quaternion_Stream *stream, int index, Quaternion q) {
+    ASSERT(index >= 0 && index < stream->count);
+    stream->x[index] = q.x;
+    stream->y[index] = q.y;
+    stream->z[index] = q.z;
+    stream->w[index] = q.w;
+}
+
+void quaternion_stream_from_array(Quaternion_Stream *stream, Quaternion *quaternions, int count) {
+    ASSERT(count <= stream->count);
+    for (int i = 0; i < count; i++) {
+        stream->x[i] = quaternions[i].x;
+        stream->y[i] = quaternions[i].y;
+        stream->z[i] = quaternions[i].z;
+        stream->w[i] = quaternions[i].w;
+    }
+}
+
+void quaternion_stream_to_array(Quaternion_Stream *stream, Quaternion *out_quaternions, int count) {
+    ASSERT(count <= stream->count);
+    for (int i = 0; i < count; i++) {
+        out_quaternions[i].x = stream->x[i];
+        out_quaternions[i].y = stream->y[i];
+        out_quaternions[i].z = stream->z[i];
+        out_quaternions[i].w = stream->w[i];
+    }
+}
+
+
+
+// note(josh): the slerp correction is from Arseny Kapoulkine's "Approximating slerp". slerp's
+// t -> angle mapping is nonlinear and nlerp's is linear-ish in the other direction, so we bend t
+// with a cubic that vanishes at 0, 0.5 and 1 and whose strength depends on the angle between the
+// two quaternions (through d = |cos(angle)|).
+static inline float slerp_correct_t(float t, float d) {
+    float A = 1.0904f + d * (-3.2452f + d * (3.55645f - d * 1.43519f));
+    float B = 0.848013f + d * (-1.06021f + d * 0.215638f);
+    float k = A * (t - 0.5f) * (t - 0.5f) + B;
+    return t + t * (t - 0.5f) * (t - 1.0f) * k;
+}
+
+static inline f32xN slerp_correct_t(f32xN t, f32xN d) {
+    f32xN A = f32xN_madd(d, f32xN_set1(-1.43519f), f32xN_set1(3.55645f));
+    A = f32xN_madd(d, A, f32xN_set1(-3.2452f));
+    A = f32xN_madd(d, A, f32xN_set1(1.0904f));
+    f32xN B = f32xN_madd(d, f32xN_set1(0.215638f), f32xN_set1(-1.06021f));
+    B = f32xN_madd(d, B, f32xN_set1(0.848013f));
+    f32xN th = f32xN_sub(t, f32xN_set1(0.5f));
+    f32xN k = f32xN_madd(f32xN_mul(A, th), th, B);
+    f32xN c = f32xN_mul(f32xN_mul(t, th), f32xN_sub(t, f32xN_set1(1.0f)));
+    return f32xN_madd(c, k, t);
+}
+
+// 1/sqrt(x) from the hardware estimate plus one newton step, good to ~22 bits
+static inline f32xN rsqrt_nr(f32xN x) {
+    f32xN y = f32xN_rsqrt_approx(x);
+    f32xN xyy = f32xN_mul(f32xN_mul(x, y), y);
+    return f32xN_mul(f32xN_mul(f32xN_set1(0.5f), y), f32xN_sub(f32xN_set1(3.0f), xyy));
+}
+
+static void blend_quaternion_streams(Quaternion_Stream *out, Quaternion_Stream *a, Quaternion_Stream *b, float t, float *ts, bool correct) {
+    ASSERT(a->count == b->count);
+    ASSERT(out->count == a->count);
+    int count = a->count;
+    int i = 0;
+    for (; i + SIMD_WIDTH <= count; i += SIMD_WIDTH) {
+        f32xN ax = f32xN_load(a->x + i);
+        f32xN ay = f32xN_load(a->y + i);
+        f32xN az = f32xN_load(a->z + i);
+        f32xN aw = f32xN_load(a->w + i);
+        f32xN bx = f32xN_load(b->x + i);
+        f32xN by = f32xN_load(b->y + i);
+        f32xN bz = f32xN_load(b->z + i);
+        f32xN bw = f32xN_load(b->w + i);
+        f32xN vt = ts ? f32xN_load(ts + i) : f32xN_set1(t);
+
+        f32xN d = f32xN_mul(ax, bx);
+        d = f32xN_madd(ay, by, d);
+        d = f32xN_madd(az, bz, d);
+        d = f32xN_madd(aw, bw, d);
+
+        // flip b onto a's hemisphere by xoring in the sign of the dot product
+        f32xN sign = f32xN_sign_bits(d);
+        bx = f32xN_xor(bx, sign);
+        by = f32xN_xor(by, sign);
+        bz = f32xN_xor(bz, sign);
+        bw = f32xN_xor(bw, sign);
+
+        if (correct) {
+            vt = slerp_correct_t(vt, f32xN_abs(d));
+        }
+
+        f32xN s = f32xN_sub(f32xN_set1(1.0f), vt);
+        f32xN rx = f32xN_madd(ax, s, f32xN_mul(bx, vt));
+        f32xN ry = f32xN_madd(ay, s, f32xN_mul(by, vt));
+        f32xN rz = f32xN_madd(az, s, f32xN_mul(bz, vt));
+        f32xN rw = f32xN_madd(aw, s, f32xN_mul(bw, vt));
+
+        f32xN len2 = f32xN_mul(rx, rx);
+        len2 = f32xN_madd(ry, ry, len2);
+        len2 = f32xN_madd(rz, rz, len2);
+        len2 = f32xN_madd(rw, rw, len2);
+        f32xN il = rsqrt_nr(len2);
+
+        f32xN_store(out->x + i, f32xN_mul(rx, il));
+        f32xN_store(out->y + i, f32xN_mul(ry, il));
+        f32xN_store(out->z + i, f32xN_mul(rz, il));
+        f32xN_store(out->w + i, f32xN_mul(rw, il));
+    }
+
+    for (; i < count; i++) {
+        Quaternion qa = quaternion_stream_get(a, i);
+        Quaternion qb = quaternion_stream_get(b, i);
+        float vt = ts ? ts[i] : t;
+        float d = dot(qa, qb);
+        if (d < 0) {
+            qb = -qb;
+        }
+        if (correct) {
+            vt = slerp_correct_t(vt, fabsf(d));
+        }
+        quaternion_stream_set(out, i, normalize((qa * (1.0f - vt)) + (qb * vt)));
+    }
+}
+
+void quaternion_stream_nlerp(Quaternion_Stream *out, Quaternion_Stream *a, Quaternion_Stream *b, float t) {
+    blend_quaternion_streams(out, a, b, t, nullptr, false);
+}
+
+void quaternion_stream_nlerp_weights(Quaternion_Stream *out, Quaternion_Stream *a, Quaternion_Stream *b, float *t) {
+    blend_quaternion_streams(out, a, b, 0, t, false);
+}
+
+void quaternion_stream_slerp_approx(Quaternion_Stream *out, Quaternion_Stream *a, Quaternion_Stream *b, float t) {
+    blend_quaternion_streams(out, a, b, t, nullptr, true);
+}
+
+void quaternion_stream_slerp_approx_weights(Quaternion_Stream *out, Quaternion_Stream *a, Quaternion_Stream *b, float *t) {
+    blend_quaternion_streams(out, a, b, 0, t, true);
+}
+
+void quaternion_stream_normalize(Quaternion_Stream *stream) {
+    int count = stream->count;
+    int i = 0;
+    for (; i + SIMD_WIDTH <= count; i += SIMD_WIDTH) {
+        f32xN x = f32xN_load(stream->x + i);
+        f32xN y = f32xN_load(stream->y + i);
+        f32xN z = f32xN_load(stream->z + i);
+        f32xN w = f32xN_load(stream->w + i);
+        f32xN len2 = f32xN_mul(x, x);
+        len2 = f32xN_madd(y, y, len2);
+        len2 = f32xN_madd(z, z, len2);
+        len2 = f32xN_madd(w, w, len2);
+        f32xN il = rsqrt_nr(len2);
+        f32xN_store(stream->x + i, f32xN_mul(x, il));
+        f32xN_store(stream->y + i, f32xN_mul(y, il));
+        f32xN_store(stream->z + i, f32xN_mul(z, il));
+        f32xN_store(stream->w + i, f32xN_mul(w, il));
+    }
+    for (; i < count; i++) {
+        quaternion_stream_set(stream, i, normalize(quaternion_stream_get(stream, i)));
+    }
+}
+
+void quaternion_stream_multiply(Quaternion_Stream *out, Quaternion_Stream *a, Quaternion_Stream *b) {
+    ASSERT(a->count == b->count);
+    ASSERT(out->count == a->count);
+    int count = a->count;
+    int i = 0;
+    for (; i + SIMD_WIDTH <= count; i += SIMD_WIDTH) {
+        f32xN ax = f32xN_load(a->x + i);
+        f32xN ay = f32xN_load(a->y + i);
+        f32xN az = f32xN_load(a->z + i);
+        f32xN aw = f32xN_load(a->w + i);
+        f32xN bx = f32xN_load(b->x + i);
+        f32xN by = f32xN_load(b->y + i);
+        f32xN bz = f32xN_load(b->z + i);
+        f32xN bw = f32xN_load(b->w + i);
+
+        // see operator *(Quaternion, Quaternion)
+        f32xN rx = f32xN_madd(aw, bx, f32xN_sub(f32xN_madd(ay, bz, f32xN_mul(ax, bw)), f32xN_mul(az, by)));
+        f32xN ry = f32xN_madd(aw, by, f32xN_sub(f32xN_madd(az, bx, f32xN_mul(ay, bw)), f32xN_mul(ax, bz)));
+        f32xN rz = f32xN_madd(aw, bz, f32xN_sub(f32xN_madd(ax, by, f32xN_mul(az, bw)), f32xN_mul(ay, bx)));
+        f32xN rw = f32xN_sub(f32xN_sub(f32xN_sub(f32xN_mul(aw, bw), f32xN_mul(ax, bx)), f32xN_mul(ay, by)), f32xN_mul(az, bz));
+
+        f32xN_store(out->x + i, rx);
+        f32xN_store(out->y + i, ry);
+        f32xN_store(out->z + i, rz);
+        f32xN_store(out->w + i, rw);
+    }
+    for (; i < count; i++) {
+        quaternion_stream_set(out, i, quaternion_stream_get(a, i) * quaternion_stream_get(b, i));
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "basic.h"
+#include "math.h"
+
+//
+// Structure-of-arrays quaternions for doing the same operation on lots of rotations at once,
+// i.e. blending two skeleton poses joint by joint.
+//
+// All of the kernels allow out to alias either input.
+//
+
+struct Quaternion_Stream {
+    float *x = {};
+    float *y = {};
+    float *z = {};
+    float *w = {};
+    int count = {};
+    Allocator allocator = {};
+};
+
+Quaternion_Stream make_quaternion_stream(int count, Allocator allocator = default_allocator());
+void destroy_quaternion_stream(Quaternion_Stream *stream);
+
+Quaternion quaternion_stream_get(Quaternion_Stream *stream, int index);
+void       quaternion_stream_set(Quaternion_Stream *stream, int index, Quaternion q);
+void       quaternion_stream_from_array(Quaternion_Stream *stream, Quaternion *quaternions, int count);
+void       quaternion_stream_to_array(Quaternion_Stream *stream, Quaternion *out_quaternions, int count);
+
+// normalized lerp, flipping b onto a's hemisphere first so we blend the short way around.
+// the _weights versions take one t per element.
+void quaternion_stream_nlerp(Quaternion_Stream *out, Quaternion_Stream *a, Quaternion_Stream *b, float t);
+void quaternion_stream_nlerp_weights(Quaternion_Stream *out, Quaternion_Stream *a, Quaternion_Stream *b, float *t);
+
+// nlerp with t warped by a polynomial in t and |dot(a, b)| so the result follows slerp()
+// without any trig. max error against slerp() is ~0.0008 radians (0.04 degrees) over all angles and t.
+void quaternion_stream_slerp_approx(Quaternion_Stream *out, Quaternion_Stream *a, Quaternion_Stream *b, float t);
+void quaternion_stream_slerp_approx_weights(Quaternion_Stream *out, Quaternion_Stream *a, Quaternion_Stream *b, float *t);
+
+void quaternion_stream_normalize(Quaternion_Stream *stream);
+
+// out[i] = a[i] * b[i], same convention as Quaternion operator *
+void quaternion_stream_multiply(Quaternion_Stream *out, Quaternion_Stream *a, Quaternion_Stream *b);
@@ -0,0 +1,474 @@
+#include "random.h"
+#include "simd.h"
+#include "fastmath.h"
+
+#include <math.h>
+
+// used to expand a 64 bit seed into full generator states, as recommended by the xoshiro authors
+static u64 splitmix64(u64 *state) {
+    u64 z = (*state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+static inline u32 rotl32(u32 x, int k) { return (x << k) | (x >> (32 - k)); }
+static inline u64 rotl64(u64 x, int k) { return (x << k) | (x >> (64 - k)); }
+
+
+
+#define PCG32_MULTIPLIER 6364136223846793005ull
+
+PCG32 make_pcg32(u64 seed, u64 stream) {
+    // same seeding as pcg32_srandom_r() in the reference implementation so the outputs match it
+    PCG32 rng = {};
+    rng.increment = (stream << 1) | 1;
+    next_u32(&rng);
+    rng.state += seed;
+    next_u32(&rng);
+    return rng;
+}
+
+u32 next_u32(PCG32 *rng) {
+    u64 old = rng->state;
+    rng->state = old * PCG32_MULTIPLIER + rng->increment;
+    u32 xorshifted = (u32)(((old >> 18) ^ old) >> 27);
+    u32 rotation = (u32)(old >> 59);
+    return (xorshifted >> rotation) | (xorshifted << ((0u - rotation) & 31));
+}
+
+void pcg32_advance(PCG32 *rng, u64 delta) {
+    // note(josh): delta steps of state*m+c collapse into a single state*M+C, built up one bit of
+    // delta at a time by squaring the step (Brown, "Random Number Generation with Arbitrary Strides")
+    u64 current_multiplier = PCG32_MULTIPLIER;
+    u64 current_increment = rng->increment;
+    u64 total_multiplier = 1;
+    u64 total_increment = 0;
+    while (delta > 0) {
+        if (delta & 1) {
+            total_multiplier *= current_multiplier;
+            total_increment = total_increment * current_multiplier + current_increment;
+        }
+        current_increment = (current_multiplier + 1) * current_increment;
+        current_multiplier *= current_multiplier;
+        delta >>= 1;
+    }
+    rng->state = total_multiplier * rng->state + total_increment;
+}
+
+u32 random_bounded(PCG32 *rng, u32 bound) {
+    assert(bound > 0);
+    u64 m = (u64)next_u32(rng) * bound;
+    u32 low = (u32)m;
+    if (low < bound) {
+        u32 threshold = (0u - bound) % bound;
+        while (low < threshold) {
+            m = (u64)next_u32(rng) * bound;
+            low = (u32)m;
+        }
+    }
+    return (u32)(m >> 32);
+}
+
+
+
+Xoshiro128 make_xoshiro128(u64 seed) {
+    Xoshiro128 rng = {};
+    u64 a = splitmix64(&seed);
+    u64 b = splitmix64(&seed);
+    rng.s[0] = (u32)a; rng.s[1] = (u32)(a >> 32);
+    rng.s[2] = (u32)b; rng.s[3] = (u32)(b >> 32);
+    return rng;
+}
+
+u32 next_u32(Xoshiro128 *rng) {
+    u32 *s = rng->s;
+    u32 result = s[0] + s[3];
+    u32 t = s[1] << 9;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl32(s[3], 11);
+    return result;
+}
+
+// a jump is the state after next_u32() has been called 2^k times. that's a linear map on the state
+// bits, and the polynomials below (from the reference implementation) pick which of the next 128
+// states get xor'd together to make it.
+static void xoshiro128_jump_with(Xoshiro128 *rng, const u32 polynomial[4]) {
+    u32 s[4] = {};
+    for (int i = 0; i < 4; i++) {
+        for (int b = 0; b < 32; b++) {
+            if (polynomial[i] & (1u << b)) {
+                for (int k = 0; k < 4; k++) s[k] ^= rng->s[k];
+            }
+            next_u32(rng);
+        }
+    }
+    for (int k = 0; k < 4; k++) rng->s[k] = s[k];
+}
+
+void xoshiro128_jump(Xoshiro128 *rng) {
+    static const u32 JUMP[4] = { 0x8764000b, 0xf542d2d3, 0x6fa035c3, 0x77f2db5b };
+    xoshiro128_jump_with(rng, JUMP);
+}
+
+void xoshiro128_long_jump(Xoshiro128 *rng) {
+    static const u32 LONG_JUMP[4] = { 0xb523952e, 0x0b6f099f, 0xccf5a0ef, 0x1c580662 };
+    xoshiro128_jump_with(rng, LONG_JUMP);
+}
+
+
+
+Xoshiro256 make_xoshiro256(u64 seed) {
+    Xoshiro256 rng = {};
+    for (int i = 0; i < 4; i++) {
+        rng.s[i] = splitmix64(&seed);
+    }
+    return rng;
+}
+
+u64 next_u64(Xoshiro256 *rng) {
+    u64 *s = rng->s;
+    u64 result = s[0] + s[3];
+    u64 t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl64(s[3], 45);
+    return result;
+}
+
+static void xoshiro256_jump_with(Xoshiro256 *rng, const u64 polynomial[4]) {
+    u64 s[4] = {};
+    for (int i = 0; i < 4; i++) {
+        for (int b = 0; b < 64; b++) {
+            if (polynomial[i] & (1ull << b)) {
+                for (int k = 0; k < 4; k++) s[k] ^= rng->s[k];
+            }
+            next_u64(rng);
+        }
+    }
+    for (int k = 0; k < 4; k++) rng->s[k] = s[k];
+}
+
+void xoshiro256_jump(Xoshiro256 *rng) {
+    static const u64 JUMP[4] = { 0x180ec6d33cfd0abaull, 0xd5a61266f0c9392cull, 0xa9582618e03fc9aaull, 0x39abdc4529b1661cull };
+    xoshiro256_jump_with(rng, JUMP);
+}
+
+void xoshiro256_long_jump(Xoshiro256 *rng) {
+    static const u64 LONG_JUMP[4] = { 0x76e15d3efefdcbbfull, 0xc5004e441c522fb3ull, 0x77710069854ee241ull, 0x39109bb02acbe635ull };
+    xoshiro256_jump_with(rng, LONG_JUMP);
+}
+
+
+
+Xoshiro128_x8 make_xoshiro128_x8(u64 seed) {
+    Xoshiro128_x8 rng = {};
+    Xoshiro128 lane_rng = make_xoshiro128(seed);
+    for (int lane = 0; lane < 8; lane++) {
+        for (int k = 0; k < 4; k++) {
+            rng.s[k][lane] = lane_rng.s[k];
+        }
+        xoshiro128_jump(&lane_rng);
+    }
+    return rng;
+}
+
+Xoshiro128 xoshiro128_x8_lane(Xoshiro128_x8 *rng, int lane) {
+    assert(lane >= 0 && lane < 8);
+    Xoshiro128 result = {};
+    for (int k = 0; k < 4; k++) {
+        result.s[k] = rng->s[k][lane];
+    }
+    return result;
+}
+
+// note(josh): the 8 lanes are always 8 lanes, with AVX they are one register and without it they
+// are two groups of 4 that run one after the other. each group keeps its state in registers for the
+// whole fill.
+#define XOSHIRO_X8_GROUPS (8 / SIMD_WIDTH)
+
+struct Xoshiro128_Lanes {
+    i32xN s0, s1, s2, s3;
+};
+
+static inline Xoshiro128_Lanes load_lanes(Xoshiro128_x8 *rng, int group) {
+    Xoshiro128_Lanes lanes;
+    lanes.s0 = i32xN_load(&rng->s[0][group * SIMD_WIDTH]);
+    lanes.s1 = i32xN_load(&rng->s[1][group * SIMD_WIDTH]);
+    lanes.s2 = i32xN_load(&rng->s[2][group * SIMD_WIDTH]);
+    lanes.s3 = i32xN_load(&rng->s[3][group * SIMD_WIDTH]);
+    return lanes;
+}
+
+static inline void store_lanes(Xoshiro128_x8 *rng, int group, Xoshiro128_Lanes lanes) {
+    i32xN_store(&rng->s[0][group * SIMD_WIDTH], lanes.s0);
+    i32xN_store(&rng->s[1][group * SIMD_WIDTH], lanes.s1);
+    i32xN_store(&rng->s[2][group * SIMD_WIDTH], lanes.s2);
+    i32xN_store(&rng->s[3][group * SIMD_WIDTH], lanes.s3);
+}
+
+static inline i32xN next_lanes(Xoshiro128_Lanes *l) {
+    i32xN result = i32xN_add(l->s0, l->s3);
+    i32xN t = i32xN_shl(l->s1, 9);
+    l->s2 = i32xN_xor(l->s2, l->s0);
+    l->s3 = i32xN_xor(l->s3, l->s1);
+    l->s1 = i32xN_xor(l->s1, l->s2);
+    l->s0 = i32xN_xor(l->s0, l->s3);
+    l->s2 = i32xN_xor(l->s2, t);
+    l->s3 = i32xN_or(i32xN_shl(l->s3, 11), i32xN_shr(l->s3, 21));
+    return result;
+}
+
+static inline f32xN lanes_to_unit_float(i32xN bits) {
+    return f32xN_mul(i32xN_to_f32xN(i32xN_shr(bits, 8)), f32xN_set1(1.0f / 16777216.0f));
+}
+
+void random_u32_batch(Xoshiro128_x8 *rng, u32 *out, int count) {
+    assert(count >= 0);
+    int full = count / 8;
+    for (int group = 0; group < XOSHIRO_X8_GROUPS; group++) {
+        Xoshiro128_Lanes lanes = load_lanes(rng, group);
+        for (int i = 0; i < full; i++) {
+            i32xN_store(out + i*8 + group*SIMD_WIDTH, next_lanes(&lanes));
+        }
+        store_lanes(rng, group, lanes);
+    }
+    if (count > full*8) {
+        u32 last[8];
+        random_u32_batch(rng, last, 8);
+        for (int i = full*8; i < count; i++) {
+            out[i] = last[i - full*8];
+        }
+    }
+}
+
+void random_range_batch(Xoshiro128_x8 *rng, float *out, int count, float min, float max) {
+    assert(count >= 0);
+    f32xN base = f32xN_set1(min);
+    f32xN scale = f32xN_set1(max - min);
+    int full = count / 8;
+    for (int group = 0; group < XOSHIRO_X8_GROUPS; group++) {
+        Xoshiro128_Lanes lanes = load_lanes(rng, group);
+        for (int i = 0; i < full; i++) {
+            f32xN_store(out + i*8 + group*SIMD_WIDTH, f32xN_madd(lanes_to_unit_float(next_lanes(&lanes)), scale, base));
+        }
+        store_lanes(rng, group, lanes);
+    }
+    if (count > full*8) {
+        float last[8];
+        random_range_batch(rng, last, 8, min, max);
+        for (int i = full*8; i < count; i++) {
+            out[i] = last[i - full*8];
+        }
+    }
+}
+
+void random_float_batch(Xoshiro128_x8 *rng, float *out, int count) {
+    random_range_batch(rng, out, count, 0, 1);
+}
+
+void sample_unit_sphere_batch(Xoshiro128_x8 *rng, float *out_x, float *out_y, float *out_z, int count) {
+    assert(count >= 0);
+    int full = count / 8;
+    for (int group = 0; group < XOSHIRO_X8_GROUPS; group++) {
+        Xoshiro128_Lanes lanes = load_lanes(rng, group);
+        for (int i = 0; i < full; i++) {
+            f32xN u1 = lanes_to_unit_float(next_lanes(&lanes));
+            f32xN u2 = lanes_to_unit_float(next_lanes(&lanes));
+            f32xN z = f32xN_madd(u1, f32xN_set1(-2.0f), f32xN_set1(1.0f));
+            f32xN r = f32xN_sqrt(f32xN_max(f32xN_zero(), f32xN_sub(f32xN_set1(1.0f), f32xN_mul(z, z))));
+            f32xN s, c;
+            sincos_fast(f32xN_mul(u2, f32xN_set1((float)TAU)), &s, &c);
+            int offset = i*8 + group*SIMD_WIDTH;
+            f32xN_store(out_x + offset, f32xN_mul(r, c));
+            f32xN_store(out_y + offset, f32xN_mul(r, s));
+            f32xN_store(out_z + offset, z);
+        }
+        store_lanes(rng, group, lanes);
+    }
+    if (count > full*8) {
+        float x[8], y[8], z[8];
+        sample_unit_sphere_batch(rng, x, y, z, 8);
+        for (int i = full*8; i < count; i++) {
+            out_x[i] = x[i - full*8];
+            out_y[i] = y[i - full*8];
+            out_z[i] = z[i - full*8];
+        }
+    }
+}
+
+void sample_unit_disk_batch(Xoshiro128_x8 *rng, float *out_x, float *out_y, int count) {
+    assert(count >= 0);
+    // note(josh): polar rather than the concentric mapping sample_unit_disk() uses. it's the same
+    // uniform distribution and doesn't need per-lane branches, concentric only matters when the
+    // inputs are stratified and these aren't.
+    int full = count / 8;
+    for (int group = 0; group < XOSHIRO_X8_GROUPS; group++) {
+        Xoshiro128_Lanes lanes = load_lanes(rng, group);
+        for (int i = 0; i < full; i++) {
+            f32xN r = f32xN_sqrt(lanes_to_unit_float(next_lanes(&lanes)));
+            f32xN u2 = lanes_to_unit_float(next_lanes(&lanes));
+            f32xN s, c;
+            sincos_fast(f32xN_mul(u2, f32xN_set1((float)TAU)), &s, &c);
+            int offset = i*8 + group*SIMD_WIDTH;
+            f32xN_store(out_x + offset, f32xN_mul(r, c));
+            f32xN_store(out_y + offset, f32xN_mul(r, s));
+        }
+        store_lanes(rng, group, lanes);
+    }
+    if (count > full*8) {
+        float x[8], y[8];
+        sample_unit_disk_batch(rng, x, y, 8);
+        for (int i = full*8; i < count; i++) {
+            out_x[i] = x[i - full*8];
+            out_y[i] = y[i - full*8];
+        }
+    }
+}
+
+
+
+Vector3 sample_unit_sphere(float u1, float u2) {
+    float z = 1.0f - 2.0f * u1;
+    float r = sqrtf(fmaxf(0.0f, 1.0f - z*z));
+    float phi = (float)TAU * u2;
+    return v3(r * cosf(phi), r * sinf(phi), z);
+}
+
+Vector2 sample_unit_disk(float u1, float u2) {
+    // Shirley and Chiu's concentric mapping, squares map to wedges so stratified inputs stay stratified
+    float x = 2.0f * u1 - 1.0f;
+    float y = 2.0f * u2 - 1.0f;
+    if (x == 0 && y == 0) {
+        return v2(0, 0);
+    }
+    float r, theta;
+    if (fabsf(x) > fabsf(y)) {
+        r = x;
+        theta = (float)(PI / 4) * (y / x);
+    }
+    else {
+        r = y;
+        theta = (float)(PI / 2) - (float)(PI / 4) * (x / y);
+    }
+    return v2(r * cosf(theta), r * sinf(theta));
+}
+
+// orthonormal basis around n without normalizing or branching on a threshold (Duff et al. 2017)
+static void make_basis(Vector3 n, Vector3 *out_tangent, Vector3 *out_bitangent) {
+    float sign = copysignf(1.0f, n.z);
+    float a = -1.0f / (sign + n.z);
+    float b = n.x * n.y * a;
+    *out_tangent   = v3(1.0f + sign * n.x * n.x * a, sign * b, -sign * n.x);
+    *out_bitangent = v3(b, sign + n.y * n.y * a, -n.y);
+}
+
+static Vector3 to_basis(Vector3 normal, float x, float y, float z) {
+    Vector3 tangent, bitangent;
+    make_basis(normal, &tangent, &bitangent);
+    return tangent * x + bitangent * y + normal * z;
+}
+
+Vector3 sample_hemisphere(Vector3 normal, float u1, float u2) {
+    float z = u1;
+    float r = sqrtf(fmaxf(0.0f, 1.0f - z*z));
+    float phi = (float)TAU * u2;
+    return to_basis(normal, r * cosf(phi), r * sinf(phi), z);
+}
+
+Vector3 sample_cosine_hemisphere(Vector3 normal, float u1, float u2) {
+    // Malley's method, project uniform disk points up onto the hemisphere
+    Vector2 d = sample_unit_disk(u1, u2);
+    float z = sqrtf(fmaxf(0.0f, 1.0f - d.x*d.x - d.y*d.y));
+    return to_basis(normal, d.x, d.y, z);
+}
+
+
+
+static u32 reverse_bits(u32 x) {
+    x = ((x >> 1) & 0x55555555) | ((x & 0x55555555) << 1);
+    x = ((x >> 2) & 0x33333333) | ((x & 0x33333333) << 2);
+    x = ((x >> 4) & 0x0f0f0f0f) | ((x & 0x0f0f0f0f) << 4);
+    x = ((x >> 8) & 0x00ff00ff) | ((x & 0x00ff00ff) << 8);
+    return (x >> 16) | (x << 16);
+}
+
+float radical_inverse_base2(u32 index) {
+    return u32_to_unit_float(reverse_bits(index));
+}
+
+Vector2 hammersley(u32 index, u32 count) {
+    assert(index < count);
+    return v2((float)index / (float)count, radical_inverse_base2(index));
+}
+
+// first entries of new-joe-kuo-6.21201: degree s of the primitive polynomial, its coefficients a,
+// and the initial direction numbers m
+struct Sobol_Polynomial {
+    u32 s;
+    u32 a;
+    u32 m[5];
+};
+
+static const Sobol_Polynomial SOBOL_POLYNOMIALS[SOBOL_MAX_DIMENSIONS - 1] = {
+    {1, 0, {1}},
+    {2, 1, {1, 3}},
+    {3, 1, {1, 3, 1}},
+    {3, 2, {1, 1, 1}},
+    {4, 1, {1, 1, 3, 3}},
+    {4, 4, {1, 3, 5, 13}},
+    {5, 2, {1, 1, 5, 5, 17}},
+};
+
+struct Sobol_Directions {
+    u32 v[SOBOL_MAX_DIMENSIONS][32];
+};
+
+static Sobol_Directions make_sobol_directions() {
+    Sobol_Directions d = {};
+    for (int i = 0; i < 32; i++) {
+        d.v[0][i] = 1u << (31 - i);
+    }
+    for (int dimension = 1; dimension < SOBOL_MAX_DIMENSIONS; dimension++) {
+        Sobol_Polynomial p = SOBOL_POLYNOMIALS[dimension - 1];
+        u32 *v = d.v[dimension];
+        for (u32 i = 0; i < 32; i++) {
+            if (i < p.s) {
+                v[i] = p.m[i] << (31 - i);
+                continue;
+            }
+            v[i] = v[i - p.s] ^ (v[i - p.s] >> p.s);
+            for (u32 k = 1; k < p.s; k++) {
+                if ((p.a >> (p.s - 1 - k)) & 1) {
+                    v[i] ^= v[i - k];
+                }
+            }
+        }
+    }
+    return d;
+}
+
+static const Sobol_Directions SOBOL_DIRECTIONS = make_sobol_directions();
+
+u32 sobol_u32(u32 index, int dimension, u32 scramble) {
+    assert(dimension >= 0 && dimension < SOBOL_MAX_DIMENSIONS);
+    const u32 *v = SOBOL_DIRECTIONS.v[dimension];
+    u32 result = scramble;
+    // note(josh): masking instead of branching on each bit, the bits of consecutive indices are
+    // too random for the branch predictor
+    for (int i = 0; index != 0; i++, index >>= 1) {
+        result ^= v[i] & (0u - (index & 1));
+    }
+    return result;
+}
+
+float sobol(u32 index, int dimension, u32 scramble) {
+    return u32_to_unit_float(sobol_u32(index, dimension, scramble));
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "basic.h"
+#include "math.h"
+
+//
+// Fast non-cryptographic random numbers, sampling helpers and low-discrepancy sequences.
+//
+// PCG32 is the small general purpose one: 16 bytes of state, good statistical quality, and any
+// number of independent streams from the same seed. Xoshiro128/Xoshiro256 are the xoshiro128+ and
+// xoshiro256+ generators, the fastest option when all you want is floats (the + variants have weak
+// low bits, which the float conversions here throw away). Xoshiro128_x8 runs 8 xoshiro128+ streams
+// side by side with SIMD for filling big arrays, e.g. particle spawns.
+//
+// For per-thread streams either give each thread its own PCG32 stream id or make one xoshiro state
+// and jump() a copy per thread. Jumped streams never overlap within 2^64 (xoshiro128) or 2^128
+// (xoshiro256) numbers.
+//
+// All the generators are deterministic for a given seed on every platform and SIMD width.
+//
+
+struct PCG32 {
+    u64 state;
+    u64 increment; // always odd, selects the stream
+};
+
+PCG32 make_pcg32(u64 seed, u64 stream = 0);
+u32   next_u32(PCG32 *rng);
+void  pcg32_advance(PCG32 *rng, u64 delta); // skips ahead delta numbers in O(log delta)
+
+
+
+struct Xoshiro128 {
+    u32 s[4];
+};
+
+Xoshiro128 make_xoshiro128(u64 seed);
+u32  next_u32(Xoshiro128 *rng);
+void xoshiro128_jump(Xoshiro128 *rng);      // equivalent to 2^64 calls of next_u32()
+void xoshiro128_long_jump(Xoshiro128 *rng); // equivalent to 2^96 calls of next_u32()
+
+struct Xoshiro256 {
+    u64 s[4];
+};
+
+Xoshiro256 make_xoshiro256(u64 seed);
+u64  next_u64(Xoshiro256 *rng);
+void xoshiro256_jump(Xoshiro256 *rng);      // equivalent to 2^128 calls of next_u64()
+void xoshiro256_long_jump(Xoshiro256 *rng); // equivalent to 2^192 calls of next_u64()
+
+
+
+// uniform in [0, 1). floats use the top 24 bits so every value is exactly representable.
+static inline float  u32_to_unit_float(u32 bits)  { return (bits >> 8) * (1.0f / 16777216.0f); }
+static inline double u64_to_unit_double(u64 bits) { return (bits >> 11) * (1.0 / 9007199254740992.0); }
+
+static inline float random_float(PCG32 *rng)      { return u32_to_unit_float(next_u32(rng)); }
+static inline float random_float(Xoshiro128 *rng) { return u32_to_unit_float(next_u32(rng)); }
+static inline float random_float(Xoshiro256 *rng) { return u32_to_unit_float((u32)(next_u64(rng) >> 32)); }
+
+// uniform in [min, max)
+static inline float random_range(PCG32 *rng, float min, float max)      { return min + (max - min) * random_float(rng); }
+static inline float random_range(Xoshiro128 *rng, float min, float max) { return min + (max - min) * random_float(rng); }
+static inline float random_range(Xoshiro256 *rng, float min, float max) { return min + (max - min) * random_float(rng); }
+
+// unbiased uniform integer in [0, bound), Lemire's multiply and reject
+u32 random_bounded(PCG32 *rng, u32 bound);
+
+
+
+// 8 xoshiro128+ streams, each one a jump() further along than the previous lane. Lane i of the
+// batch functions gives the same numbers as next_u32() on lane i's scalar state, so results don't
+// depend on whether the build has AVX.
+struct Xoshiro128_x8 {
+    u32 s[4][8];
+};
+
+Xoshiro128_x8 make_xoshiro128_x8(u64 seed);
+Xoshiro128 xoshiro128_x8_lane(Xoshiro128_x8 *rng, int lane);
+
+// Fill count values. count doesn't have to be a multiple of 8 but whatever is left over of the last
+// batch of 8 is thrown away, so for reproducible streams keep count a multiple of 8.
+void random_u32_batch   (Xoshiro128_x8 *rng, u32 *out, int count);
+void random_float_batch (Xoshiro128_x8 *rng, float *out, int count); // [0, 1)
+void random_range_batch (Xoshiro128_x8 *rng, float *out, int count, float min, float max);
+
+// SoA batches of sampled points, see the scalar versions below. These use the fastmath sin/cos.
+void sample_unit_sphere_batch(Xoshiro128_x8 *rng, float *out_x, float *out_y, float *out_z, int count);
+void sample_unit_disk_batch  (Xoshiro128_x8 *rng, float *out_x, float *out_y, int count);
+
+
+
+// Warps from two uniform numbers in [0, 1) to a distribution. They take the numbers rather than a
+// generator so the same code works with any of the generators above and with the low-discrepancy
+// sequences below.
+Vector3 sample_unit_sphere(float u1, float u2);                       // uniform on the surface
+Vector3 sample_hemisphere(Vector3 normal, float u1, float u2);        // uniform, normal must be normalized
+Vector3 sample_cosine_hemisphere(Vector3 normal, float u1, float u2); // pdf = cos(theta)/pi
+Vector2 sample_unit_disk(float u1, float u2);                         // uniform, concentric mapping
+
+
+
+// Low-discrepancy sequences, for sample patterns that should cover the domain evenly: shadow
+// filtering kernels, SSAO/SSR kernels, TAA jitter, etc.
+float   radical_inverse_base2(u32 index); // van der Corput
+Vector2 hammersley(u32 index, u32 count); // point index of a count point Hammersley set
+
+// Sobol sequence with Joe-Kuo direction numbers. Dimension 0 is the van der Corput sequence and
+// every prefix of 2^k points is stratified in each dimension. scramble is xor'd into the result as a
+// random digital shift, which keeps the stratification while decorrelating different uses.
+#define SOBOL_MAX_DIMENSIONS 8
+u32   sobol_u32(u32 index, int dimension, u32 scramble = 0);
+float sobol(u32 index, int dimension, u32 scramble = 0);
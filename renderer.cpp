@@ -3,7 +3,13 @@
 #define STB_TRUETYPE_IMPLEMENTATION
 #include "stb_truetype.h"
 
-#include "half.cpp"
+#include "half.h"
+#include "packing.h"
+#include "fastmath.h"
+#include "threading.h"
+#include "mesh_optimizer.h"
+#include "tangent_space.h"
+#include "cooked_texture.h"
 
 #include "external/dearimgui/imgui.h"
 
@@ -11,13 +17,47 @@ struct Renderer_State {
     Render_Pass_Desc *current_render_pass;
     Buffer pass_cbuffer_handle;
     Buffer model_cbuffer_handle;
+
+    // draw_model() swaps these in for meshes with a different vertex layout, see create_renderer3d()
+    Vertex_Shader layout_vertex_shaders[VL_COUNT];
+    Vertex_Format layout_vertex_formats[VL_COUNT];
+
+    // what draw_mesh() last bound, so meshes sharing buffers don't rebind them. forgotten at the start
+    // of every pass in case something else bound its own in between.
+    Buffer bound_vertex_buffer;
+    int bound_vertex_stride;
+    Buffer bound_index_buffer;
+    Index_Type bound_index_type;
+
+    // the culled cluster indices of every model draw go into this one dynamic index buffer, appended
+    // one after the other and discarded when they reach the end, see begin_model_draw()
+    Buffer culled_index_buffer;
+    int culled_index_capacity;
+    int culled_index_cursor;
+
+    // scratch for the arrays a model draw needs, cleared at the start of render_scene(). each
+    // end_model_draw() gives its memory back too, so it only ever has to fit one model.
+    Arena frame_arena;
+
+    Draw_Stats frame_draw_stats;  // reset at the start of render_scene()
+    Draw_Stats last_frame_stats;
+    Draw_Stats last_shadow_stats; // just the shadow map passes of the last frame
 };
 
 Renderer_State renderer_state;
 
+#ifndef RENDERER_FRAME_ARENA_SIZE
+#define RENDERER_FRAME_ARENA_SIZE (16 * 1024 * 1024)
+#endif
+
+#define INITIAL_CULLED_INDEX_CAPACITY (1024 * 1024)
+
 void init_renderer(Window *window) {
     renderer_state.pass_cbuffer_handle  = create_buffer(BT_CONSTANT, nullptr, sizeof(Pass_CBuffer));
     renderer_state.model_cbuffer_handle = create_buffer(BT_CONSTANT, nullptr, sizeof(Model_CBuffer));
+    renderer_state.culled_index_capacity = INITIAL_CULLED_INDEX_CAPACITY;
+    renderer_state.culled_index_buffer = create_dynamic_buffer(BT_INDEX, sizeof(u32) * renderer_state.culled_index_capacity);
+    init_arena(&renderer_state.frame_arena, (byte *)alloc(default_allocator(), RENDERER_FRAME_ARENA_SIZE), RENDERER_FRAME_ARENA_SIZE);
 }
 
 
@@ -29,7 +69,522 @@ Model create_model(Allocator allocator) {
 }
 
 void destroy_model(Model model) {
+    Foreach (mesh, model.meshes) {
+        mesh->positions.destroy();
+        mesh->indices.destroy();
+        if (mesh->bvh) {
+            Allocator allocator = mesh->bvh->bvh.nodes.allocator;
+            destroy_triangle_bvh(mesh->bvh);
+            free(allocator, mesh->bvh);
+        }
+        if (mesh->clusters) {
+            Allocator allocator = mesh->clusters->indices.allocator;
+            mesh->clusters->clusters.destroy();
+            mesh->clusters->indices.destroy();
+            free(allocator, mesh->clusters);
+        }
+    }
     model.meshes.destroy();
+    unmap_file(&model.cooked_file);
+}
+
+bool load_cooked_model(char *filename, Allocator allocator, Texture_Cache *texture_cache, Model *out_model, Vertex_Layout layout, bool merge_meshes) {
+    Cooked_Model_File cooked;
+    if (!open_cooked_model(filename, vertex_layout_size(layout), &cooked)) {
+        return false;
+    }
+
+    char *directory = path_directory(filename, allocator);
+    defer(if (directory) free(allocator, directory));
+
+    // decode every texture up front so it happens in parallel, the material loop below only does lookups
+    Array<Texture_Request> texture_requests = make_array<Texture_Request>(allocator, cooked.header->num_materials * MM_COUNT + 1);
+    defer(texture_requests.destroy());
+    for (u32 i = 0; i < cooked.header->num_materials; i++) {
+        Cffmodel_Material *cooked_material = &cooked.materials[i];
+        for (int map = 0; map < MM_COUNT; map++) {
+            if (cooked_material->texture_paths[map] == 0) {
+                continue;
+            }
+            Texture_Request request = {};
+            request.path = resolve_texture_path(directory, cooked.strings + cooked_material->texture_paths[map], allocator);
+            request.format = (cooked_material->srgb_textures & (1 << map)) ? TF_R8G8B8A8_UINT_SRGB : TF_R8G8B8A8_UINT;
+            request.wrap_mode = TWM_LINEAR_WRAP;
+            texture_requests.append(request);
+        }
+    }
+    preload_cached_textures(texture_cache, texture_requests.data, texture_requests.count);
+    Foreach (request, texture_requests) {
+        free(allocator, request->path);
+    }
+
+    // note(josh): materials are shared between meshes in the file so they only get created once here
+    Array<PBR_Material> materials = make_array<PBR_Material>(allocator, cooked.header->num_materials);
+    defer(materials.destroy());
+    for (u32 i = 0; i < cooked.header->num_materials; i++) {
+        Cffmodel_Material *cooked_material = &cooked.materials[i];
+        PBR_Material material = {};
+        material.cbuffer_handle = create_pbr_material_cbuffer();
+        material.ambient = cooked_material->ambient;
+        material.metallic = cooked_material->metallic;
+        material.roughness = cooked_material->roughness;
+        material.has_transparency = (cooked_material->flags & CFFMODEL_MATERIAL_TRANSPARENT) != 0;
+        for (int map = 0; map < MM_COUNT; map++) {
+            if (cooked_material->texture_paths[map] == 0) {
+                continue;
+            }
+            char *path = resolve_texture_path(directory, cooked.strings + cooked_material->texture_paths[map], allocator);
+            defer(free(allocator, path));
+            Texture_Format format = (cooked_material->srgb_textures & (1 << map)) ? TF_R8G8B8A8_UINT_SRGB : TF_R8G8B8A8_UINT;
+            *get_material_map(&material, (Material_Map)map) = get_cached_texture(texture_cache, path, format, TWM_LINEAR_WRAP);
+        }
+        materials.append(material);
+    }
+
+    // note(josh): merged meshes are copied into one staging copy of each buffer. indices stay relative
+    // to their mesh so they only need widening to u32s if some mesh's already are.
+    int vertex_size = vertex_layout_size(layout);
+    i64 merged_vertices = 0;
+    i64 merged_indices = 0;
+    Index_Type merged_index_type = IT_U16;
+    for (u32 i = 0; i < cooked.header->num_meshes; i++) {
+        merged_vertices += cooked.meshes[i].num_vertices;
+        merged_indices += cooked.meshes[i].num_indices;
+        if (cooked.meshes[i].index_size != sizeof(u16)) merged_index_type = IT_U32;
+    }
+    byte *merged_vertex_data = nullptr;
+    Vector3 *merged_position_data = nullptr;
+    byte *merged_index_data = nullptr;
+    if (merge_meshes) {
+        ASSERTF(merged_vertices * vertex_size < 0x7fffffff && merged_indices * index_type_size(merged_index_type) < 0x7fffffff, "%s is too big to merge into one buffer", filename);
+        merged_vertex_data = (byte *)alloc(allocator, (int)(merged_vertices * vertex_size) + 1);
+        merged_position_data = (Vector3 *)alloc(allocator, (int)(merged_vertices * sizeof(Vector3)) + 1);
+        merged_index_data = (byte *)alloc(allocator, (int)(merged_indices * index_type_size(merged_index_type)) + 1);
+    }
+    defer(if (merge_meshes) {
+        free(allocator, merged_vertex_data);
+        free(allocator, merged_position_data);
+        free(allocator, merged_index_data);
+    });
+
+    Model model = create_model(allocator);
+    model.meshes.reserve(cooked.header->num_meshes);
+    int base_vertex = 0;
+    int base_index = 0;
+    for (u32 i = 0; i < cooked.header->num_meshes; i++) {
+        Cffmodel_Mesh *cooked_mesh = &cooked.meshes[i];
+        void *vertices = cooked_model_blob(&cooked, cooked_mesh->vertices_offset);
+        Vector3 *positions = (Vector3 *)cooked_model_blob(&cooked, cooked_mesh->positions_offset);
+        void *indices = cooked_model_blob(&cooked, cooked_mesh->indices_offset);
+
+        Loaded_Mesh mesh = {};
+        mesh.vertex_layout = layout;
+        mesh.num_vertices = cooked_mesh->num_vertices;
+        mesh.index_type = cooked_mesh->index_size == sizeof(u16) ? IT_U16 : IT_U32;
+        if (merge_meshes) {
+            memcpy(merged_vertex_data + (i64)base_vertex * vertex_size, vertices, (i64)cooked_mesh->num_vertices * vertex_size);
+            memcpy(merged_position_data + base_vertex, positions, (i64)cooked_mesh->num_vertices * sizeof(Vector3));
+            if (merged_index_type == mesh.index_type) {
+                memcpy(merged_index_data + (i64)base_index * index_type_size(merged_index_type), indices, (i64)cooked_mesh->num_indices * cooked_mesh->index_size);
+            }
+            else {
+                u16 *narrow = (u16 *)indices;
+                u32 *wide = (u32 *)merged_index_data + base_index;
+                for (u32 index = 0; index < cooked_mesh->num_indices; index++) {
+                    wide[index] = narrow[index];
+                }
+            }
+            mesh.base_vertex = base_vertex;
+            mesh.base_index = base_index;
+            base_vertex += cooked_mesh->num_vertices;
+            base_index += cooked_mesh->num_indices;
+        }
+        else {
+            mesh.vertex_buffer = create_buffer(BT_VERTEX, vertices, cooked_mesh->num_vertices * vertex_size);
+            mesh.position_buffer = create_buffer(BT_VERTEX, positions, cooked_mesh->num_vertices * sizeof(Vector3));
+            mesh.index_buffer = create_buffer(BT_INDEX, indices, cooked_mesh->num_indices * cooked_mesh->index_size);
+        }
+        mesh.num_indices = cooked_mesh->lods[0].num_indices;
+        static_assert(MAX_MESH_LODS == CFFMODEL_MAX_LODS, "");
+        for (u32 lod = 0; lod < cooked_mesh->num_lods; lod++) {
+            Cffmodel_Lod *cooked_lod = &cooked_mesh->lods[lod];
+            mesh.lods[lod] = {(int)cooked_lod->first_index, (int)cooked_lod->num_indices, cooked_lod->error};
+        }
+        mesh.num_lods = cooked_mesh->num_lods;
+        mesh.bounds_min = v3(cooked_mesh->bounds_min[0], cooked_mesh->bounds_min[1], cooked_mesh->bounds_min[2]);
+        mesh.bounds_max = v3(cooked_mesh->bounds_max[0], cooked_mesh->bounds_max[1], cooked_mesh->bounds_max[2]);
+        if (cooked_mesh->material_index >= 0) {
+            mesh.material = materials[cooked_mesh->material_index];
+            mesh.has_material = true;
+        }
+        // the CPU copies stay in the mapped file, destroy_model() unmaps it. u16 indices get widened
+        // into their own array since everything on the CPU side takes u32s.
+        mesh.positions = make_array<Vector3>(positions, cooked_mesh->num_vertices);
+        mesh.positions.count = cooked_mesh->num_vertices;
+        if (mesh.index_type == IT_U16) {
+            u16 *narrow = (u16 *)indices;
+            mesh.indices = make_array<u32>(allocator, mesh.num_indices);
+            for (int index = 0; index < mesh.num_indices; index++) {
+                mesh.indices.append(narrow[index]);
+            }
+        }
+        else {
+            mesh.indices = make_array<u32>(mesh.num_indices ? (u32 *)indices : nullptr, mesh.num_indices);
+            mesh.indices.count = mesh.num_indices;
+        }
+        model.meshes.append(mesh);
+    }
+    if (merge_meshes) {
+        Buffer vertex_buffer = create_buffer(BT_VERTEX, merged_vertex_data, (int)(merged_vertices * vertex_size));
+        Buffer position_buffer = create_buffer(BT_VERTEX, merged_position_data, (int)(merged_vertices * sizeof(Vector3)));
+        Buffer index_buffer = merged_indices ? create_buffer(BT_INDEX, merged_index_data, (int)(merged_indices * index_type_size(merged_index_type))) : nullptr;
+        Foreach (mesh, model.meshes) {
+            mesh->vertex_buffer = vertex_buffer;
+            mesh->position_buffer = position_buffer;
+            mesh->index_buffer = index_buffer;
+            mesh->index_type = merged_index_type;
+        }
+        model.merged_buffers = true;
+    }
+    model.cooked_file = cooked.file;
+    *out_model = model;
+
+    i64 num_vertices = 0;
+    i64 num_indices = 0;
+    i64 index_bytes = 0;
+    Foreach (mesh, model.meshes) {
+        num_vertices += mesh->num_vertices;
+        num_indices += total_mesh_indices(mesh);
+        index_bytes += (i64)total_mesh_indices(mesh) * index_type_size(mesh->index_type);
+    }
+    print_vertex_buffer_memory(filename, num_vertices, layout);
+    print_index_buffer_memory(filename, num_indices, index_bytes);
+    return true;
+}
+
+int vertex_layout_size(Vertex_Layout layout) {
+    switch (layout) {
+        case VL_FULL:    return sizeof(Vertex);
+        case VL_COMPACT: return sizeof(Compact_Vertex);
+        default: {
+            ASSERTF(false, "Unknown vertex layout: %d", layout);
+            return 0;
+        }
+    }
+}
+
+Compact_Vertex pack_compact_vertex(Vertex *vertex) {
+    Vector3 normal = vertex->normal;
+    float normal_length = length(normal);
+    normal = normal_length > 0 ? normal / normal_length : v3(0, 0, 1);
+
+    // note(josh): generate_vertex_tangents() frames are already orthonormal but ones that came with the
+    // model don't have to be, gram-schmidt them. if there's nothing left (no UVs) any perpendicular
+    // vector will do.
+    Vector3 tangent = vertex->tangent - normal * dot(normal, vertex->tangent);
+    float tangent_length = length(tangent);
+    if (tangent_length > 1e-6f) {
+        tangent = tangent / tangent_length;
+    }
+    else {
+        tangent = normalize(cross(normal, fabsf(normal.x) < 0.9f ? v3(1, 0, 0) : v3(0, 1, 0)));
+    }
+
+    Compact_Vertex compact = {};
+    compact.position = vertex->position;
+    compact.tex_coord = pack_half2(v2(vertex->tex_coord.x, vertex->tex_coord.y));
+    compact.normal = pack_oct32(normal);
+    compact.tangent = pack_tangent_oct(tangent, tangent_frame_sign(normal, tangent, vertex->bitangent));
+    return compact;
+}
+
+// same thing compact_vertex.hlsl does
+Vertex unpack_compact_vertex(Compact_Vertex *compact) {
+    Vertex vertex = {};
+    vertex.position = compact->position;
+    Vector2 tex_coord = unpack_half2(compact->tex_coord);
+    vertex.tex_coord = v3(tex_coord.x, tex_coord.y, 0);
+    vertex.color = v4(1, 1, 1, 1);
+    vertex.normal = unpack_oct32(compact->normal);
+    float bitangent_sign;
+    unpack_tangent_oct(compact->tangent, &vertex.tangent, &bitangent_sign);
+    vertex.bitangent = cross(vertex.normal, vertex.tangent) * bitangent_sign;
+    return vertex;
+}
+
+void pack_compact_vertices(Compact_Vertex *out, Vertex *vertices, int count) {
+    for (int i = 0; i < count; i++) {
+        out[i] = pack_compact_vertex(&vertices[i]);
+    }
+}
+
+void print_vertex_buffer_memory(char *name, i64 num_vertices, Vertex_Layout layout) {
+    i64 bytes = num_vertices * vertex_layout_size(layout);
+    i64 full_bytes = num_vertices * sizeof(Vertex);
+    printf("%s: %d bytes per vertex, %.2f MB of vertex buffers, %.2f MB less than Vertex would be\n",
+        name, vertex_layout_size(layout), bytes / (1024.0 * 1024.0), (full_bytes - bytes) / (1024.0 * 1024.0));
+}
+
+void print_index_buffer_memory(char *name, i64 num_indices, i64 index_bytes) {
+    i64 full_bytes = num_indices * sizeof(u32);
+    printf("%s: %.2f MB of index buffers, %.2f MB less than all u32s would be\n",
+        name, index_bytes / (1024.0 * 1024.0), (full_bytes - index_bytes) / (1024.0 * 1024.0));
+}
+
+Buffer create_index_buffer(u32 *indices, int num_indices, int num_vertices, Index_Type *out_type) {
+    *out_type = IT_U32;
+    if (num_indices == 0) {
+        return nullptr;
+    }
+    if (num_vertices > 0x10000) {
+        return create_buffer(BT_INDEX, indices, num_indices * sizeof(u32));
+    }
+
+    *out_type = IT_U16;
+    u16 *narrow = (u16 *)alloc(default_allocator(), sizeof(u16) * num_indices);
+    defer(free(default_allocator(), narrow));
+    for (int i = 0; i < num_indices; i++) {
+        ASSERT(indices[i] < (u32)num_vertices);
+        narrow[i] = (u16)indices[i];
+    }
+    return create_buffer(BT_INDEX, narrow, num_indices * sizeof(u16));
+}
+
+int weld_vertices(Array<Vertex> *vertices, Array<u32> *indices) {
+    int num_vertices = vertices->count;
+    if (num_vertices == 0) {
+        return 0;
+    }
+    bool indexed = indices->count > 0;
+    int num_indices = indexed ? indices->count : num_vertices;
+
+    u32 *remap = (u32 *)alloc(default_allocator(), sizeof(u32) * num_vertices);
+    defer(free(default_allocator(), remap));
+    int num_unique = generate_vertex_remap(remap, indexed ? indices->data : nullptr, num_indices, vertices->data, num_vertices, sizeof(Vertex));
+
+    Vertex *unique_vertices = (Vertex *)alloc(default_allocator(), sizeof(Vertex) * num_unique);
+    defer(free(default_allocator(), unique_vertices));
+    remap_vertex_buffer(unique_vertices, vertices->data, num_vertices, sizeof(Vertex), remap);
+    memcpy(vertices->data, unique_vertices, sizeof(Vertex) * num_unique);
+    vertices->count = num_unique;
+
+    indices->reserve(num_indices);
+    remap_index_buffer(indices->data, indexed ? indices->data : nullptr, num_indices, remap);
+    indices->count = num_indices;
+    return num_vertices - num_unique;
+}
+
+void generate_vertex_tangents(Array<Vertex> **vertices, Array<u32> **indices, int num_meshes) {
+    Tangent_Mesh *meshes = (Tangent_Mesh *)alloc(default_allocator(), sizeof(Tangent_Mesh) * (num_meshes > 0 ? num_meshes : 1));
+    defer(free(default_allocator(), meshes));
+    int total_indices = 0;
+    for (int i = 0; i < num_meshes; i++) {
+        total_indices += indices[i]->count;
+    }
+    Vector4 *corner_tangents = (Vector4 *)alloc(default_allocator(), sizeof(Vector4) * (total_indices > 0 ? total_indices : 1));
+    defer(free(default_allocator(), corner_tangents));
+
+    int first_corner = 0;
+    for (int i = 0; i < num_meshes; i++) {
+        Tangent_Mesh *mesh = &meshes[i];
+        *mesh = {};
+        mesh->indices = indices[i]->data;
+        mesh->num_indices = indices[i]->count;
+        mesh->positions = &vertices[i]->data[0].position;
+        mesh->normals = &vertices[i]->data[0].normal;
+        mesh->tex_coords = &vertices[i]->data[0].tex_coord;
+        mesh->num_vertices = vertices[i]->count;
+        mesh->vertex_stride = sizeof(Vertex);
+        mesh->out_tangents = corner_tangents + first_corner;
+        first_corner += indices[i]->count;
+    }
+    generate_tangents(meshes, num_meshes);
+
+    // note(josh): every corner in the same group around a vertex gets exactly the same frame, so a
+    // corner only needs a copy of its vertex when its frame is a different one. the copies of a
+    // vertex are chained through next_copies.
+    for (int i = 0; i < num_meshes; i++) {
+        Array<Vertex> *mesh_vertices = vertices[i];
+        int num_original = mesh_vertices->count;
+        if (num_original == 0) {
+            continue;
+        }
+        Array<Vector4> frames = make_array<Vector4>(default_allocator(), num_original); // w is 0 until a vertex has its frame
+        defer(frames.destroy());
+        Array<u32> next_copies = make_array<u32>(default_allocator(), num_original);
+        defer(next_copies.destroy());
+        for (int v = 0; v < num_original; v++) {
+            frames.append({});
+            next_copies.append(MESH_REMAP_UNUSED);
+        }
+
+        For (corner, *indices[i]) {
+            u32 *index = &(*indices[i])[corner];
+            Vector4 frame = meshes[i].out_tangents[corner];
+            u32 copy = *index;
+            while (frames[copy].w != 0 && memcmp(&frames[copy], &frame, sizeof(frame)) != 0) {
+                if (next_copies[copy] == MESH_REMAP_UNUSED) {
+                    next_copies[copy] = (u32)mesh_vertices->count;
+                    mesh_vertices->append((*mesh_vertices)[*index]);
+                    frames.append({});
+                    next_copies.append(MESH_REMAP_UNUSED);
+                }
+                copy = next_copies[copy];
+            }
+            *index = copy;
+            if (frames[copy].w != 0) {
+                continue;
+            }
+            frames[copy] = frame;
+
+            Vertex *vertex = &(*mesh_vertices)[copy];
+            Vector3 normal = vertex->normal;
+            float normal_length = length(normal);
+            normal = normal_length > 0 ? normal / normal_length : v3(0, 0, 1);
+            vertex->tangent = v3(frame.x, frame.y, frame.z);
+            vertex->bitangent = cross(normal, vertex->tangent) * frame.w;
+        }
+    }
+}
+
+
+
+void optimize_mesh(Array<Vertex> *vertices, Array<u32> *indices, Mesh_Optimization_Report *report) {
+    int num_vertices = vertices->count;
+    int num_indices = indices->count;
+    if (num_indices == 0) {
+        return;
+    }
+    if (report) {
+        report->num_triangles += num_indices / 3;
+        report->transformed_before += analyze_vertex_cache(indices->data, num_indices, num_vertices).vertices_transformed;
+        report->fetched_before += analyze_vertex_fetch(indices->data, num_indices, num_vertices, sizeof(Vertex)).bytes_fetched;
+    }
+
+    u32 *scratch = (u32 *)alloc(default_allocator(), sizeof(u32) * num_indices);
+    defer(free(default_allocator(), scratch));
+    optimize_vertex_cache(scratch, indices->data, num_indices, num_vertices);
+    optimize_overdraw(indices->data, scratch, num_indices, &vertices->data[0].position, num_vertices, sizeof(Vertex));
+
+    u32 *remap = (u32 *)alloc(default_allocator(), sizeof(u32) * num_vertices);
+    defer(free(default_allocator(), remap));
+    int num_used = optimize_vertex_fetch_remap(remap, indices->data, num_indices, num_vertices);
+    Vertex *reordered = (Vertex *)alloc(default_allocator(), sizeof(Vertex) * num_used);
+    defer(free(default_allocator(), reordered));
+    remap_vertex_buffer(reordered, vertices->data, num_vertices, sizeof(Vertex), remap);
+    memcpy(vertices->data, reordered, sizeof(Vertex) * num_used);
+    vertices->count = num_used;
+    remap_index_buffer(indices->data, indices->data, num_indices, remap);
+
+    if (report) {
+        report->vertex_bytes += (i64)num_used * sizeof(Vertex);
+        report->transformed_after += analyze_vertex_cache(indices->data, num_indices, num_used).vertices_transformed;
+        report->fetched_after += analyze_vertex_fetch(indices->data, num_indices, num_used, sizeof(Vertex)).bytes_fetched;
+    }
+}
+
+void print_mesh_optimization_report(char *name, Mesh_Optimization_Report *report) {
+    if (report->num_triangles == 0 || report->vertex_bytes == 0) {
+        return;
+    }
+    float triangles = (float)report->num_triangles;
+    float vertex_bytes = (float)report->vertex_bytes;
+    printf("%s: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, vertex overfetch %.3f -> %.3f\n", name,
+        report->transformed_before / triangles, report->transformed_after / triangles,
+        report->transformed_before * sizeof(Vertex) / vertex_bytes, report->transformed_after * sizeof(Vertex) / vertex_bytes,
+        report->fetched_before / vertex_bytes, report->fetched_after / vertex_bytes);
+}
+
+// note(josh): each LOD is simplified from the one before it, which is a lot faster than starting from
+// lods[0] every time but means the errors add up. per level, relative to the size of the mesh.
+#define MESH_LOD_MAX_ERROR 0.05f
+#define MESH_LOD_MIN_TRIANGLES 32
+
+int generate_mesh_lods(Array<Vertex> *vertices, Array<u32> *indices, Mesh_Lod *out_lods, Mesh_Lod_Report *report) {
+    int full_count = indices->count;
+    out_lods[0] = {0, full_count, 0};
+    if (report) {
+        report->num_meshes += 1;
+        report->meshes_with_lod[0] += 1;
+        report->full_triangles[0] += full_count / 3;
+        report->lod_triangles[0] += full_count / 3;
+    }
+    if (full_count / 3 < MESH_LOD_MIN_TRIANGLES * 2) {
+        return 1;
+    }
+
+    // note(josh): tex_coord.xy and the normal steer the simplifier, color and tex_coord.z don't. the
+    // weights are low on purpose, normals change wherever the surface curves and anything higher
+    // starts trading shape away to keep them.
+    static_assert(offsetof(Vertex, normal) - offsetof(Vertex, tex_coord) == 7 * sizeof(float), "attribute weights below assume this layout");
+    float attribute_weights[10] = {
+        0.1f, 0.1f, 0,          // tex_coord
+        0, 0, 0, 0,             // color
+        0.05f, 0.05f, 0.05f,    // normal
+    };
+    Vector3 *positions = &vertices->data[0].position;
+    float *attributes = &vertices->data[0].tex_coord.x;
+    float scale = simplify_scale(positions, vertices->count, sizeof(Vertex));
+
+    u32 *simplified = (u32 *)alloc(default_allocator(), sizeof(u32) * full_count);
+    defer(free(default_allocator(), simplified));
+    u32 *optimized = (u32 *)alloc(default_allocator(), sizeof(u32) * full_count);
+    defer(free(default_allocator(), optimized));
+
+    int num_lods = 1;
+    float error = 0;
+    while (num_lods < MAX_MESH_LODS) {
+        Mesh_Lod *previous = &out_lods[num_lods - 1];
+        int target = previous->num_indices / 6 * 3;
+        if (target / 3 < MESH_LOD_MIN_TRIANGLES) {
+            break;
+        }
+        float lod_error = 0;
+        int count = simplify_mesh(simplified, &indices->data[previous->first_index], previous->num_indices, positions, vertices->count, sizeof(Vertex),
+            target, MESH_LOD_MAX_ERROR, attributes, sizeof(Vertex), attribute_weights, ARRAYSIZE(attribute_weights), &lod_error);
+        // not worth a level if it barely got smaller, the next one wouldn't either
+        if (count == 0 || count > previous->num_indices * 3 / 4) {
+            break;
+        }
+        optimize_vertex_cache(optimized, simplified, count, vertices->count);
+
+        int first_index = indices->count;
+        indices->reserve(first_index + count);
+        memcpy(&indices->data[first_index], optimized, sizeof(u32) * count);
+        indices->count = first_index + count;
+
+        error += lod_error;
+        out_lods[num_lods] = {first_index, count, error * scale};
+        if (report) {
+            report->meshes_with_lod[num_lods] += 1;
+            report->full_triangles[num_lods] += full_count / 3;
+            report->lod_triangles[num_lods] += count / 3;
+            if (error > report->max_error[num_lods]) report->max_error[num_lods] = error;
+        }
+        num_lods += 1;
+    }
+    return num_lods;
+}
+
+void print_mesh_lod_report(char *name, Mesh_Lod_Report *report) {
+    for (int lod = 1; lod < MAX_MESH_LODS; lod++) {
+        if (report->meshes_with_lod[lod] == 0) {
+            break;
+        }
+        printf("%s: LOD%d for %d of %d meshes, %.1f%% of their triangles, error up to %.2f%% of mesh size\n", name, lod,
+            report->meshes_with_lod[lod], report->num_meshes, 100.0 * report->lod_triangles[lod] / report->full_triangles[lod], 100.0 * report->max_error[lod]);
+    }
+}
+
+void set_mesh_bounds(Loaded_Mesh *mesh) {
+    mesh->bounds_min = v3( FLT_MAX,  FLT_MAX,  FLT_MAX);
+    mesh->bounds_max = v3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    Foreach (position, mesh->positions) {
+        for (int i = 0; i < 3; i++) {
+            if ((*position)[i] < mesh->bounds_min[i]) mesh->bounds_min[i] = (*position)[i];
+            if ((*position)[i] > mesh->bounds_max[i]) mesh->bounds_max[i] = (*position)[i];
+        }
+    }
 }
 
 Model create_cube_model(Allocator allocator) {
@@ -88,21 +643,390 @@ Model create_cube_model(Allocator allocator) {
         {{ (0.5f),  (0.5f),  (0.5f)}, {1, 0, 0}, {1, 1, 1, 1}, { 0,  1,  0}, { 1,  0,  0}, { 0,  0,  1}}, // 22
     };
 
-    Buffer cube_vertex_buffer = create_buffer(BT_VERTEX, cube_vertices, sizeof(cube_vertices[0]) * ARRAYSIZE(cube_vertices));
+    // note(josh): the table above is written out per triangle, welding gets it back to 24 vertices and 36 indices
+    Array<Vertex> vertices = make_array<Vertex>(allocator, ARRAYSIZE(cube_vertices));
+    defer(vertices.destroy());
+    for (int i = 0; i < ARRAYSIZE(cube_vertices); i++) {
+        vertices.append(cube_vertices[i]);
+    }
+    Array<u32> indices = make_array<u32>(allocator, ARRAYSIZE(cube_vertices));
+    weld_vertices(&vertices, &indices);
+    optimize_mesh(&vertices, &indices);
+
     Loaded_Mesh cube_loaded_mesh = {};
-    cube_loaded_mesh.vertex_buffer = cube_vertex_buffer;
-    cube_loaded_mesh.num_vertices = ARRAYSIZE(cube_vertices);
+    cube_loaded_mesh.vertex_buffer = create_buffer(BT_VERTEX, vertices.data, sizeof(Vertex) * vertices.count);
+    cube_loaded_mesh.num_vertices = vertices.count;
+    cube_loaded_mesh.index_buffer = create_index_buffer(indices.data, indices.count, vertices.count, &cube_loaded_mesh.index_type);
+    cube_loaded_mesh.num_indices = indices.count;
+    cube_loaded_mesh.lods[0] = {0, indices.count, 0};
+    cube_loaded_mesh.num_lods = 1;
     cube_loaded_mesh.has_material = true;
     cube_loaded_mesh.material.cbuffer_handle = create_pbr_material_cbuffer();
     cube_loaded_mesh.material.ambient = 0.5;
     cube_loaded_mesh.material.roughness = 0.3;
     cube_loaded_mesh.material.metallic = 0;
+    cube_loaded_mesh.positions = make_array<Vector3>(allocator, vertices.count);
+    Foreach (vertex, vertices) {
+        cube_loaded_mesh.positions.append(vertex->position);
+    }
+    cube_loaded_mesh.position_buffer = create_buffer(BT_VERTEX, cube_loaded_mesh.positions.data, sizeof(Vector3) * vertices.count);
+    cube_loaded_mesh.indices = indices;
+    set_mesh_bounds(&cube_loaded_mesh);
     Model cube_model = create_model(allocator);
     cube_model.meshes.append(cube_loaded_mesh);
     return cube_model;
 }
 
+void build_model_bvhs(Model *model, Allocator allocator) {
+    Foreach (mesh, model->meshes) {
+        if (mesh->bvh) {
+            continue;
+        }
+        u32 *indices = nullptr;
+        int num_triangles = mesh->positions.count / 3;
+        if (mesh->indices.count > 0) {
+            indices = mesh->indices.data;
+            num_triangles = mesh->indices.count / 3;
+        }
+        mesh->bvh = NEW(allocator, Triangle_BVH);
+        *mesh->bvh = build_triangle_bvh(mesh->positions.data, indices, num_triangles, allocator);
+    }
+}
+
+void append_bvh_instances(Model *model, Matrix4 transform, Array<BVH_Instance> *out_instances) {
+    Foreach (mesh, model->meshes) {
+        ASSERT(mesh->bvh != nullptr);
+        BVH_Instance instance = {};
+        instance.mesh = mesh->bvh;
+        instance.transform = transform;
+        out_instances->append(instance);
+    }
+}
+
+void build_model_clusters(Model *model, Allocator allocator) {
+    Foreach (mesh, model->meshes) {
+        if (mesh->clusters || mesh->indices.count == 0) {
+            continue;
+        }
+        int num_indices = mesh->lods[0].num_indices;
+        int bound = meshlet_bound(num_indices);
+        Meshlet *meshlets = (Meshlet *)alloc(allocator, sizeof(Meshlet) * bound);
+        defer(free(allocator, meshlets));
+        u32 *meshlet_vertices = (u32 *)alloc(allocator, sizeof(u32) * bound * MESHLET_MAX_VERTICES);
+        defer(free(allocator, meshlet_vertices));
+        u8 *meshlet_triangles = (u8 *)alloc(allocator, sizeof(u8) * bound * MESHLET_MAX_TRIANGLES * 3);
+        defer(free(allocator, meshlet_triangles));
+        int num_meshlets = build_meshlets(meshlets, meshlet_vertices, meshlet_triangles, mesh->indices.data, num_indices, mesh->positions.data, mesh->positions.count, sizeof(Vector3));
+
+        mesh->clusters = NEW(allocator, Mesh_Clusters);
+        mesh->clusters->clusters = make_array<Mesh_Cluster>(allocator, num_meshlets);
+        mesh->clusters->indices = make_array<u32>(allocator, num_indices);
+        for (int i = 0; i < num_meshlets; i++) {
+            Meshlet *meshlet = &meshlets[i];
+            Mesh_Cluster cluster = {};
+            cluster.bounds = compute_meshlet_bounds(meshlet, meshlet_vertices, meshlet_triangles, mesh->positions.data, sizeof(Vector3));
+            cluster.first_index = mesh->clusters->indices.count;
+            cluster.num_indices = meshlet->triangle_count * 3;
+            for (u32 corner = 0; corner < meshlet->triangle_count * 3; corner++) {
+                mesh->clusters->indices.append(meshlet_vertices[meshlet->vertex_offset + meshlet_triangles[meshlet->triangle_offset + corner]]);
+            }
+            mesh->clusters->clusters.append(cluster);
+        }
+    }
+}
+
+int cull_mesh_clusters(Mesh_Clusters *clusters, Meshlet_Culler *culler, Array<u32> *out_indices) {
+    int triangles_culled = 0;
+    if (out_indices->count + clusters->indices.count > out_indices->capacity) {
+        out_indices->reserve(out_indices->capacity * 2 + clusters->indices.count);
+    }
+    Foreach (cluster, clusters->clusters) {
+        if (!meshlet_visible(culler, &cluster->bounds)) {
+            triangles_culled += cluster->num_indices / 3;
+            continue;
+        }
+        memcpy(&out_indices->data[out_indices->count], &clusters->indices.data[cluster->first_index], sizeof(u32) * cluster->num_indices);
+        out_indices->count += cluster->num_indices;
+    }
+    return triangles_culled;
+}
+
+
+
+Texture *get_material_map(PBR_Material *material, Material_Map map) {
+    switch (map) {
+        case MM_ALBEDO:    return &material->albedo_map;
+        case MM_NORMAL:    return &material->normal_map;
+        case MM_METALLIC:  return &material->metallic_map;
+        case MM_ROUGHNESS: return &material->roughness_map;
+        case MM_EMISSION:  return &material->emission_map;
+        case MM_AO:        return &material->ao_map;
+    }
+    assert(false);
+    return nullptr;
+}
+
+Texture_Cache make_texture_cache(Allocator allocator) {
+    Texture_Cache cache = {};
+    cache.allocator = allocator;
+    cache.entries = make_array<Texture_Cache_Entry>(allocator, 64);
+    cache.lookup = make_hashtable<u64, int>(allocator, 128);
+    return cache;
+}
+
+void destroy_texture_cache(Texture_Cache *cache) {
+    Foreach (entry, cache->entries) {
+        if (entry->texture.valid) {
+            destroy_texture(entry->texture);
+        }
+        free(cache->allocator, entry->path);
+    }
+    cache->entries.destroy();
+    cache->lookup.destroy();
+    *cache = {};
+}
 
+static u64 texture_cache_key(char *path, Texture_Format format, Texture_Wrap_Mode wrap_mode) {
+    // note(josh): fnv64 like hash_key() but over the string instead of the pointer
+    u64 h = 0xcbf29ce484222325;
+    for (char *c = path; *c; c++) {
+        h = (h * 0x100000001b3) ^ u64((u8)*c);
+    }
+    h = (h * 0x100000001b3) ^ u64(format);
+    h = (h * 0x100000001b3) ^ u64(wrap_mode);
+    return h;
+}
+
+static i64 texture_memory_size(Texture texture) {
+    if (!texture.valid) {
+        return 0;
+    }
+    i64 size = 0;
+    for (int i = 0; i < texture.description.mipmap_count; i++) {
+        size += texture_level_size(texture.description.format, mipmap_level_dimension(texture.description.width, i), mipmap_level_dimension(texture.description.height, i));
+    }
+    return size;
+}
+
+char *resolve_texture_path(char *directory, char *path, Allocator allocator) {
+    String_Builder path_sb = make_string_builder(allocator);
+    if (directory) {
+        path_sb.printf("%s/", directory);
+    }
+    path_sb.print(path);
+    return path_sb.string(); // note(josh): the builder's buffer is the string, free() it when done
+}
+
+static Texture_Cache_Entry *find_cache_entry(Texture_Cache *cache, u64 key, char *path, Texture_Format format, Texture_Wrap_Mode wrap_mode) {
+    int *first = cache->lookup.get(key);
+    if (first == nullptr) {
+        return nullptr;
+    }
+    for (int index = *first; index != -1; index = cache->entries[index].next_with_same_key) {
+        Texture_Cache_Entry *entry = &cache->entries[index];
+        if (entry->format == format && entry->wrap_mode == wrap_mode && strcmp(entry->path, path) == 0) {
+            return entry;
+        }
+    }
+    return nullptr;
+}
+
+static void add_cache_entry(Texture_Cache *cache, u64 key, char *path, Texture_Format format, Texture_Wrap_Mode wrap_mode, Texture texture) {
+    // note(josh): failed loads are cached too so a missing file only gets reported once
+    Texture_Cache_Entry entry = {};
+    int path_length = strlen(path);
+    entry.path = (char *)alloc(cache->allocator, path_length + 1);
+    memcpy(entry.path, path, path_length + 1);
+    entry.format = format;
+    entry.wrap_mode = wrap_mode;
+    entry.texture = texture;
+    entry.next_with_same_key = -1;
+    cache->entries.append(entry);
+    int index = cache->entries.count - 1;
+
+    // note(josh): a different path (or format, or wrap mode) that hashes to a key that's already in use gets
+    // chained onto the end of that key's entries, so it's still owned by the cache and destroyed with it.
+    int *first = cache->lookup.get(key);
+    if (first == nullptr) {
+        cache->lookup.insert(key, index);
+    }
+    else {
+        int last = *first;
+        while (cache->entries[last].next_with_same_key != -1) {
+            last = cache->entries[last].next_with_same_key;
+        }
+        cache->entries[last].next_with_same_key = index;
+    }
+    cache->texture_memory += texture_memory_size(texture);
+}
+
+// note(josh): a cooked version of the file is used when there's an up to date one, see cooked_texture.h.
+// otherwise the file is decoded to RGBA8 and gets box filtered mips like create_texture_from_file()
+// does, on the decoding thread so they're made in parallel across textures.
+struct Texture_Decode {
+    Texture_Request request;
+    u64 key;
+    Cooked_Texture_File cooked; // mapped if there's a cooked version
+    byte *mipmaps;              // the decoded file's mip chain if there isn't, null if neither could be loaded
+    int num_levels;
+    int width;
+    int height;
+};
+
+static void decode_textures(void *userdata, int start, int end) {
+    Texture_Decode *decodes = (Texture_Decode *)userdata;
+    for (int i = start; i < end; i++) {
+        Texture_Decode *decode = &decodes[i];
+        if (find_cooked_texture(decode->request.path, &decode->cooked)) {
+            continue;
+        }
+        byte *color_data = load_texture_data_from_file(decode->request.path, &decode->width, &decode->height);
+        if (color_data == nullptr) {
+            continue;
+        }
+        Mipmap_Settings mipmap_settings = {};
+        mipmap_settings.filter = MIPMAP_FILTER_BOX;
+        mipmap_settings.srgb = decode->request.format == TF_R8G8B8A8_UINT_SRGB;
+        decode->num_levels = mipmap_count(decode->width, decode->height);
+        decode->mipmaps = (byte *)alloc(default_allocator(), (int)mipmap_chain_size(IMAGE_FORMAT_RGBA8, decode->width, decode->height, decode->num_levels));
+        generate_mipmaps(color_data, decode->width, decode->height, mipmap_settings, decode->num_levels, decode->mipmaps, default_allocator());
+        delete_texture_data(color_data);
+    }
+}
+
+// the cooked file's format with the sRGB-ness of the format that was asked for
+static Texture_Format cooked_texture_format(Image_Format format, Texture_Format requested) {
+    bool srgb = requested == TF_R8G8B8A8_UINT_SRGB || requested == TF_BC1_UNORM_SRGB || requested == TF_BC3_UNORM_SRGB || requested == TF_BC7_UNORM_SRGB;
+    switch (format) {
+        case IMAGE_FORMAT_RGBA8: return srgb ? TF_R8G8B8A8_UINT_SRGB : TF_R8G8B8A8_UINT;
+        case IMAGE_FORMAT_BC1:   return srgb ? TF_BC1_UNORM_SRGB : TF_BC1_UNORM;
+        case IMAGE_FORMAT_BC3:   return srgb ? TF_BC3_UNORM_SRGB : TF_BC3_UNORM;
+        case IMAGE_FORMAT_BC4:   return TF_BC4_UNORM;
+        case IMAGE_FORMAT_BC5:   return TF_BC5_UNORM;
+        case IMAGE_FORMAT_BC7:   return srgb ? TF_BC7_UNORM_SRGB : TF_BC7_UNORM;
+        default: {
+            assert(false);
+            return TF_INVALID;
+        }
+    }
+}
+
+// uploads what decode_textures() loaded and frees it
+static Texture upload_decoded_texture(Texture_Decode *decode) {
+    Texture_Description texture_description = {};
+    texture_description.wrap_mode = decode->request.wrap_mode;
+    texture_description.type = TT_2D;
+    if (decode->cooked.header) {
+        texture_description.width = decode->cooked.header->width;
+        texture_description.height = decode->cooked.header->height;
+        texture_description.format = cooked_texture_format((Image_Format)decode->cooked.header->format, decode->request.format);
+        texture_description.color_data = cooked_texture_level(&decode->cooked, 0);
+        texture_description.mipmap_count = decode->cooked.header->num_levels;
+        Texture texture = create_texture(texture_description);
+        close_cooked_texture(&decode->cooked);
+        return texture;
+    }
+    if (decode->mipmaps) {
+        texture_description.width = decode->width;
+        texture_description.height = decode->height;
+        texture_description.format = decode->request.format;
+        texture_description.color_data = decode->mipmaps;
+        texture_description.mipmap_count = decode->num_levels;
+        Texture texture = create_texture(texture_description);
+        free(default_allocator(), decode->mipmaps);
+        decode->mipmaps = nullptr;
+        return texture;
+    }
+    printf("couldn't load texture %s\n", decode->request.path);
+    return {};
+}
+
+static Texture load_texture_uncached(char *path, Texture_Format format, Texture_Wrap_Mode wrap_mode) {
+    Texture_Decode decode = {};
+    decode.request.path = path;
+    decode.request.format = format;
+    decode.request.wrap_mode = wrap_mode;
+    decode_textures(&decode, 0, 1);
+    return upload_decoded_texture(&decode);
+}
+
+Texture get_cached_texture(Texture_Cache *cache, char *path, Texture_Format format, Texture_Wrap_Mode wrap_mode) {
+    cache->num_requests += 1;
+    u64 key = texture_cache_key(path, format, wrap_mode);
+    Texture_Cache_Entry *entry = find_cache_entry(cache, key, path, format, wrap_mode);
+    if (entry) {
+        cache->requested_memory += texture_memory_size(entry->texture);
+        return entry->texture;
+    }
+
+    double load_start = time_now();
+    Texture texture = load_texture_uncached(path, format, wrap_mode);
+    cache->load_seconds += time_now() - load_start;
+    add_cache_entry(cache, key, path, format, wrap_mode, texture);
+    cache->requested_memory += texture_memory_size(texture);
+    return texture;
+}
+
+void preload_cached_textures(Texture_Cache *cache, Texture_Request *requests, int count) {
+    double load_start = time_now();
+
+    Array<Texture_Decode> decodes = make_array<Texture_Decode>(cache->allocator, count > 0 ? count : 1);
+    defer(decodes.destroy());
+    Hashtable<u64, bool> queued = make_hashtable<u64, bool>(cache->allocator, count * 2 + 1);
+    defer(queued.destroy());
+    for (int i = 0; i < count; i++) {
+        Texture_Request *request = &requests[i];
+        u64 key = texture_cache_key(request->path, request->format, request->wrap_mode);
+        if (find_cache_entry(cache, key, request->path, request->format, request->wrap_mode)) {
+            continue;
+        }
+        if (queued.contains(key)) {
+            // note(josh): almost always the same texture requested twice, but could be a different one with a colliding key
+            bool duplicate = false;
+            Foreach (decode, decodes) {
+                if (decode->key == key && decode->request.format == request->format && decode->request.wrap_mode == request->wrap_mode && strcmp(decode->request.path, request->path) == 0) {
+                    duplicate = true;
+                    break;
+                }
+            }
+            if (duplicate) {
+                continue;
+            }
+        }
+        queued.insert(key, true);
+        Texture_Decode decode = {};
+        decode.request = *request;
+        decode.key = key;
+        decodes.append(decode);
+    }
+
+    // note(josh): decoding (file read + png/jpg decompression + mips, or mapping the cooked file) is the slow part
+    // and is thread safe, the uploads have to happen on this thread. going in groups keeps the number of decoded images alive
+    // at once bounded instead of holding all of sponza's textures in memory before the first upload.
+    int group_size = num_hardware_threads() * 2;
+    if (group_size < 8) group_size = 8;
+    for (int group_start = 0; group_start < decodes.count; group_start += group_size) {
+        int group_count = decodes.count - group_start;
+        if (group_count > group_size) group_count = group_size;
+        Texture_Decode *group = &decodes[group_start];
+        parallel_for(group_count, 1, decode_textures, group);
+
+        for (int i = 0; i < group_count; i++) {
+            Texture_Decode *decode = &group[i];
+            Texture texture = upload_decoded_texture(decode);
+            add_cache_entry(cache, decode->key, decode->request.path, decode->request.format, decode->request.wrap_mode, texture);
+        }
+    }
+
+    cache->load_seconds += time_now() - load_start;
+}
+
+void print_texture_cache_stats(Texture_Cache *cache) {
+    printf("Texture cache: %d textures for %d requests, %.1fMB (%.1fMB uncached), %.2fms loading\n",
+        cache->entries.count, cache->num_requests,
+        cache->texture_memory / (1024.0 * 1024.0), cache->requested_memory / (1024.0 * 1024.0),
+        cache->load_seconds * 1000);
+}
 
 void flush_pbr_material(Buffer buffer, PBR_Material material, Render_Options options) {
     PBR_Material_CBuffer material_cbuffer = {};
@@ -215,6 +1139,8 @@ void begin_render_pass(Render_Pass_Desc *pass) {
 
     assert(renderer_state.current_render_pass == nullptr);
     renderer_state.current_render_pass = pass;
+    renderer_state.bound_vertex_buffer = nullptr;
+    renderer_state.bound_index_buffer = nullptr;
     Pass_CBuffer pass_cbuffer = {};
     pass_cbuffer.screen_dimensions = v2((float)viewport_width, (float)viewport_height);
     pass_cbuffer.view_matrix = construct_view_matrix(pass->camera_position, pass->camera_orientation);
@@ -233,31 +1159,245 @@ void end_render_pass() {
 }
 
 void draw_mesh(Buffer vertex_buffer, Buffer index_buffer, int num_vertices, int num_indices, Vector3 position, Vector3 scale, Quaternion orientation, Vector4 color) {
+    draw_mesh(vertex_buffer, index_buffer, num_vertices, num_indices, construct_model_matrix(position, scale, orientation), color);
+}
+
+void draw_mesh(Buffer vertex_buffer, Buffer index_buffer, int num_vertices, int num_indices, Matrix4 model_matrix, Vector4 color, int vertex_stride, Index_Type index_type, int first_index, int base_vertex) {
     Model_CBuffer model_cbuffer = {};
-    model_cbuffer.model_matrix = construct_model_matrix(position, scale, orientation);
+    model_cbuffer.model_matrix = model_matrix;
     model_cbuffer.model_color = color;
 
     update_buffer(renderer_state.model_cbuffer_handle, &model_cbuffer, sizeof(Model_CBuffer));
     bind_constant_buffers(&renderer_state.model_cbuffer_handle, 1, CBS_MODEL);
 
-    u32 strides[1] = {sizeof(Vertex)};
-    u32 offsets[1] = {0};
-    bind_vertex_buffers(&vertex_buffer, 1, 0, strides, offsets);
-    bind_index_buffer(index_buffer, 0);
+    if (vertex_buffer != renderer_state.bound_vertex_buffer || vertex_stride != renderer_state.bound_vertex_stride) {
+        u32 strides[1] = {(u32)vertex_stride};
+        u32 offsets[1] = {0};
+        bind_vertex_buffers(&vertex_buffer, 1, 0, strides, offsets);
+        renderer_state.bound_vertex_buffer = vertex_buffer;
+        renderer_state.bound_vertex_stride = vertex_stride;
+        renderer_state.frame_draw_stats.buffer_binds += 1;
+    }
+    if (index_buffer != renderer_state.bound_index_buffer || index_type != renderer_state.bound_index_type) {
+        bind_index_buffer(index_buffer, 0, index_type);
+        renderer_state.bound_index_buffer = index_buffer;
+        renderer_state.bound_index_type = index_type;
+        renderer_state.frame_draw_stats.buffer_binds += 1;
+    }
 
-    issue_draw_call(num_vertices, num_indices);
+    issue_draw_call(num_vertices, num_indices, 0, first_index, base_vertex);
+
+    renderer_state.frame_draw_stats.draw_calls += 1;
+    renderer_state.frame_draw_stats.triangles += num_indices / 3;
+    renderer_state.frame_draw_stats.vertex_bytes_bound += (i64)num_vertices * vertex_stride;
+    renderer_state.frame_draw_stats.index_bytes_bound += (i64)num_indices * index_type_size(index_type);
 }
 
-void draw_model(Model model, Vector3 position, Vector3 scale, Quaternion orientation, Vector4 color, Render_Options options, bool draw_transparency) {
+void draw_mesh_depth_only(Buffer position_buffer, Buffer index_buffer, int num_vertices, int num_indices, Matrix4 model_matrix, Index_Type index_type, int first_index, int base_vertex) {
+    draw_mesh(position_buffer, index_buffer, num_vertices, num_indices, model_matrix, v4(1, 1, 1, 1), sizeof(Vector3), index_type, first_index, base_vertex);
+}
+
+Lod_Selector make_lod_selector(Render_Pass_Desc *pass, float max_pixel_error) {
+    Texture target = pass->render_target_bindings.color_bindings[0].texture;
+    if (!target.valid) {
+        target = pass->render_target_bindings.depth_binding.texture;
+    }
+    Lod_Selector selector = {};
+    selector.camera_position = pass->camera_position;
+    // note(josh): clip space y is projection[1][1] * y / w and the viewport is 2 tall in clip space
+    selector.pixels_per_unit = pass->projection_matrix[1][1] * 0.5f * target.description.height;
+    selector.orthographic = pass->projection_matrix[3][3] == 1;
+    selector.max_pixel_error = max_pixel_error;
+    return selector;
+}
+
+int select_mesh_lod(Loaded_Mesh *mesh, Matrix4 model_matrix, float model_scale, Lod_Selector *selector) {
+    float distance = 1;
+    if (!selector->orthographic) {
+        Vector4 center = v4((mesh->bounds_min + mesh->bounds_max) * 0.5f);
+        center.w = 1;
+        center = model_matrix * center;
+        float radius = length(mesh->bounds_max - mesh->bounds_min) * 0.5f * model_scale;
+        distance = length(v3(center) - selector->camera_position) - radius;
+        if (distance <= 0) {
+            return 0; // inside the bounds
+        }
+    }
+    float pixels_per_model_unit = selector->pixels_per_unit * model_scale / distance;
+    for (int lod = mesh->num_lods - 1; lod > 0; lod--) {
+        if (mesh->lods[lod].error * pixels_per_model_unit <= selector->max_pixel_error) {
+            return lod;
+        }
+    }
+    return 0;
+}
+
+static float largest_scale_axis(Vector3 scale) {
+    float result = fabsf(scale.x);
+    if (fabsf(scale.y) > result) result = fabsf(scale.y);
+    if (fabsf(scale.z) > result) result = fabsf(scale.z);
+    return result;
+}
+
+// What each mesh of a model draws in the current pass: a LOD's range of its own index buffer, or at
+// lods[0] with cluster culling on, the clusters that survived out of one index buffer the whole model
+// shares for the pass.
+struct Mesh_Draw {
+    bool skip;
+    bool culled;
+    Buffer index_buffer;
+    Index_Type index_type;
+    int first_index;
+    int num_indices;
+};
+
+struct Model_Draw {
+    Array<Mesh_Draw> meshes; // in renderer_state.frame_arena
+    int frame_arena_mark;
+};
+
+static Meshlet_Culler make_model_culler(Render_Pass_Desc *pass, Matrix4 model_matrix) {
+    Matrix4 view_matrix = construct_view_matrix(pass->camera_position, pass->camera_orientation);
+    Matrix4 world_to_model = inverse(model_matrix);
+    Vector3 camera_position = v3(world_to_model * v4(pass->camera_position.x, pass->camera_position.y, pass->camera_position.z, 1));
+    Vector3 view_direction = v3(world_to_model * v4(quaternion_forward(pass->camera_orientation)));
+    return make_meshlet_culler(pass->projection_matrix * view_matrix * model_matrix, camera_position, view_direction, pass->projection_matrix[3][3] == 1);
+}
+
+// depth_only passes draw every mesh, the others only the ones whose transparency matches draw_transparency
+static Model_Draw begin_model_draw(Model model, Matrix4 model_matrix, Vector3 scale, Render_Options options, bool depth_only, bool draw_transparency) {
+    Model_Draw draw = {};
+    draw.frame_arena_mark = renderer_state.frame_arena.cur_offset;
+    Allocator frame_allocator = arena_allocator(&renderer_state.frame_arena);
+    draw.meshes = make_array<Mesh_Draw>(frame_allocator, model.meshes.count);
+
+    // note(josh): reserve for every cluster surviving so cull_mesh_clusters() never grows the array,
+    // growing in an arena would leave the old copy behind
+    int max_culled_indices = 0;
+    if (options.do_cluster_culling) {
+        Foreach (mesh, model.meshes) {
+            if (mesh->clusters) {
+                max_culled_indices += mesh->clusters->indices.count;
+            }
+        }
+    }
+    Array<u32> culled_indices = {};
+    if (max_culled_indices > 0) {
+        culled_indices = make_array<u32>(frame_allocator, max_culled_indices);
+    }
+
+    float model_scale = largest_scale_axis(scale);
+    Lod_Selector selector = make_lod_selector(renderer_state.current_render_pass, options.lod_pixel_error);
+    Meshlet_Culler culler = {};
+    if (options.do_cluster_culling) {
+        culler = make_model_culler(renderer_state.current_render_pass, model_matrix);
+    }
     Foreach (mesh, model.meshes) {
-        if (mesh->has_material) {
-            if (mesh->material.has_transparency != draw_transparency) {
-                continue;
+        Mesh_Draw mesh_draw = {};
+        if (!depth_only && mesh->has_material && mesh->material.has_transparency != draw_transparency) {
+            mesh_draw.skip = true;
+            draw.meshes.append(mesh_draw);
+            continue;
+        }
+        int lod = options.do_mesh_lods ? select_mesh_lod(mesh, model_matrix, model_scale, &selector) : 0;
+        if (options.do_cluster_culling && lod == 0 && mesh->clusters) {
+            mesh_draw.culled = true;
+            mesh_draw.index_type = IT_U32;
+            mesh_draw.first_index = culled_indices.count;
+            renderer_state.frame_draw_stats.triangles_culled += cull_mesh_clusters(mesh->clusters, &culler, &culled_indices);
+            mesh_draw.num_indices = culled_indices.count - mesh_draw.first_index;
+            mesh_draw.skip = mesh_draw.num_indices == 0;
+        }
+        else {
+            mesh_draw.index_buffer = mesh->index_buffer;
+            mesh_draw.index_type = mesh->index_type;
+            mesh_draw.first_index = mesh->base_index + mesh->lods[lod].first_index;
+            mesh_draw.num_indices = mesh->lods[lod].num_indices;
+        }
+        draw.meshes.append(mesh_draw);
+    }
+
+    if (culled_indices.count > 0) {
+        if (culled_indices.count > renderer_state.culled_index_capacity) {
+            // note(josh): the old buffer stays alive until the draws queued with it are done, D3D holds a reference
+            destroy_buffer(renderer_state.culled_index_buffer);
+            while (renderer_state.culled_index_capacity < culled_indices.count) {
+                renderer_state.culled_index_capacity *= 2;
             }
+            renderer_state.culled_index_buffer = create_dynamic_buffer(BT_INDEX, sizeof(u32) * renderer_state.culled_index_capacity);
+            renderer_state.culled_index_cursor = renderer_state.culled_index_capacity; // force a discard below
+            renderer_state.bound_index_buffer = nullptr; // a new buffer could land on the old address
+        }
+
+        // note(josh): appending past what earlier draws this frame read from is safe to write without waiting.
+        // when it doesn't fit anymore, discard and start over at the front of fresh memory.
+        Buffer_Map_Mode map_mode = BMM_WRITE_NO_OVERWRITE;
+        if (renderer_state.culled_index_cursor + culled_indices.count > renderer_state.culled_index_capacity) {
+            map_mode = BMM_WRITE_DISCARD;
+            renderer_state.culled_index_cursor = 0;
+        }
+        u32 *mapped = (u32 *)map_buffer(renderer_state.culled_index_buffer, map_mode);
+        memcpy(&mapped[renderer_state.culled_index_cursor], culled_indices.data, sizeof(u32) * culled_indices.count);
+        unmap_buffer(renderer_state.culled_index_buffer);
+
+        Foreach (mesh_draw, draw.meshes) {
+            if (mesh_draw->culled) {
+                mesh_draw->index_buffer = renderer_state.culled_index_buffer;
+                mesh_draw->first_index += renderer_state.culled_index_cursor;
+            }
+        }
+        renderer_state.culled_index_cursor += culled_indices.count;
+    }
+    return draw;
+}
+
+static void end_model_draw(Model_Draw *draw) {
+    // note(josh): model draws don't nest, so hand everything begin_model_draw() took back to the arena
+    renderer_state.frame_arena.cur_offset = draw->frame_arena_mark;
+}
+
+void draw_model_depth_only(Model model, Vector3 position, Vector3 scale, Quaternion orientation, Render_Options options) {
+    Matrix4 model_matrix = construct_model_matrix(position, scale, orientation);
+    Model_Draw model_draw = begin_model_draw(model, model_matrix, scale, options, true, false);
+    defer(end_model_draw(&model_draw));
+    For (i, model.meshes) {
+        Loaded_Mesh *mesh = &model.meshes[i];
+        Mesh_Draw *mesh_draw = &model_draw.meshes[i];
+        if (mesh_draw->skip) {
+            continue;
+        }
+        draw_mesh_depth_only(mesh->position_buffer, mesh_draw->index_buffer, mesh->num_vertices, mesh_draw->num_indices, model_matrix, mesh_draw->index_type, mesh_draw->first_index, mesh->base_vertex);
+    }
+}
+
+void draw_model(Model model, Vector3 position, Vector3 scale, Quaternion orientation, Vector4 color, Render_Options options, bool draw_transparency) {
+    // note(josh): every mesh in a model shares the same transform so only build the matrix once
+    Matrix4 model_matrix = construct_model_matrix(position, scale, orientation);
+    Model_Draw model_draw = begin_model_draw(model, model_matrix, scale, options, false, draw_transparency);
+    defer(end_model_draw(&model_draw));
+    // note(josh): passes bind vertex.hlsl for the full layout themselves. compact meshes need its twin
+    // and their own input layout, which get swapped in here and swapped back out after.
+    Vertex_Layout bound_layout = VL_FULL;
+    For (i, model.meshes) {
+        Loaded_Mesh *mesh = &model.meshes[i];
+        Mesh_Draw *mesh_draw = &model_draw.meshes[i];
+        if (mesh_draw->skip) {
+            continue;
+        }
+        if (mesh->has_material) {
             ASSERT(mesh->material.cbuffer_handle);
             flush_pbr_material(mesh->material.cbuffer_handle, mesh->material, options);
         }
-        draw_mesh(mesh->vertex_buffer, mesh->index_buffer, mesh->num_vertices, mesh->num_indices, position, scale, orientation, color);
+        if (mesh->vertex_layout != bound_layout) {
+            bound_layout = mesh->vertex_layout;
+            bind_vertex_shader(renderer_state.layout_vertex_shaders[bound_layout]);
+            bind_vertex_format(renderer_state.layout_vertex_formats[bound_layout]);
+        }
+        draw_mesh(mesh->vertex_buffer, mesh_draw->index_buffer, mesh->num_vertices, mesh_draw->num_indices, model_matrix, color, vertex_layout_size(mesh->vertex_layout), mesh_draw->index_type, mesh_draw->first_index, mesh->base_vertex);
+    }
+    if (bound_layout != VL_FULL) {
+        bind_vertex_shader(renderer_state.layout_vertex_shaders[VL_FULL]);
+        bind_vertex_format(renderer_state.layout_vertex_formats[VL_FULL]);
     }
 }
 
@@ -321,6 +1461,22 @@ void draw_render_options_editor_window(Render_Options *render_options) {
 
         ImGui::Text("Exposure");
         ImGui::SliderFloat("exposure modifier", &render_options->exposure_modifier, 0, 1);
+        ImGui::Separator();
+
+        ImGui::Text("Options");
+        ImGui::Checkbox("depth only shadow passes", &render_options->depth_only_shadows);
+        ImGui::Checkbox("mesh LODs",                &render_options->do_mesh_lods);
+        ImGui::SliderFloat("LOD pixel error",       &render_options->lod_pixel_error, 0, 8);
+        ImGui::Checkbox("cluster culling",          &render_options->do_cluster_culling);
+        ImGui::Separator();
+
+        ImGui::Text("Stats");
+        Draw_Stats *frame = &renderer_state.last_frame_stats;
+        Draw_Stats *shadow = &renderer_state.last_shadow_stats;
+        ImGui::Text("frame:  %d draws, %lld triangles, %.2f MB vertices, %.2f MB indices bound", frame->draw_calls, frame->triangles, frame->vertex_bytes_bound / (1024.0 * 1024.0), frame->index_bytes_bound / (1024.0 * 1024.0));
+        ImGui::Text("shadow: %d draws, %lld triangles, %.2f MB vertices, %.2f MB indices bound", shadow->draw_calls, shadow->triangles, shadow->vertex_bytes_bound / (1024.0 * 1024.0), shadow->index_bytes_bound / (1024.0 * 1024.0));
+        ImGui::Text("cluster culling rejected %lld triangles, %lld of them in shadow passes", frame->triangles_culled, shadow->triangles_culled);
+        ImGui::Text("buffer binds: %d, %d of them in shadow passes", frame->buffer_binds, shadow->buffer_binds);
     }
     ImGui::End();
 }
@@ -445,6 +1601,26 @@ void create_renderer3d(Renderer3D *out_renderer, Window *window) {
     };
     out_renderer->default_vertex_format = create_vertex_format(vertex_fields, ARRAYSIZE(vertex_fields), out_renderer->vertex_shader);
 
+    out_renderer->compact_vertex_shader = compile_vertex_shader_from_file(L"compact_vertex.hlsl");
+    Vertex_Field compact_vertex_fields[] = {
+        {"SV_POSITION", "position",  offsetof(Compact_Vertex, position),  VFT_FLOAT3,          VFST_PER_VERTEX},
+        {"TEXCOORD",    "tex_coord", offsetof(Compact_Vertex, tex_coord), VFT_HALF2,           VFST_PER_VERTEX},
+        {"NORMAL",      "normal",    offsetof(Compact_Vertex, normal),    VFT_SNORM16_2,       VFST_PER_VERTEX},
+        {"TANGENT",     "tangent",   offsetof(Compact_Vertex, tangent),   VFT_UNORM10_10_10_2, VFST_PER_VERTEX},
+    };
+    out_renderer->compact_vertex_format = create_vertex_format(compact_vertex_fields, ARRAYSIZE(compact_vertex_fields), out_renderer->compact_vertex_shader);
+
+    renderer_state.layout_vertex_shaders[VL_FULL]    = out_renderer->vertex_shader;
+    renderer_state.layout_vertex_formats[VL_FULL]    = out_renderer->default_vertex_format;
+    renderer_state.layout_vertex_shaders[VL_COMPACT] = out_renderer->compact_vertex_shader;
+    renderer_state.layout_vertex_formats[VL_COMPACT] = out_renderer->compact_vertex_format;
+
+    out_renderer->depth_vertex_shader = compile_vertex_shader_from_file(L"depth_vertex.hlsl");
+    Vertex_Field depth_vertex_fields[] = {
+        {"SV_POSITION", "position", 0, VFT_FLOAT3, VFST_PER_VERTEX},
+    };
+    out_renderer->depth_vertex_format = create_vertex_format(depth_vertex_fields, ARRAYSIZE(depth_vertex_fields), out_renderer->depth_vertex_shader);
+
     out_renderer->cube_model = create_cube_model(default_allocator());
 
     // create skybox
@@ -468,6 +1644,10 @@ void create_renderer3d(Renderer3D *out_renderer, Window *window) {
     out_renderer->skybox_texture = create_texture(skybox_desc);
     set_cubemap_textures(out_renderer->skybox_texture, skybox_faces);
 
+    // note(josh): ambient lighting comes from this rather than from convolving the cubemap on the GPU
+    assert(skybox_width == skybox_height);
+    out_renderer->skybox_sh = sh9_project_cubemap(skybox_faces, skybox_width);
+
     for (int idx = 0; idx < ARRAYSIZE(skybox_faces); idx++) {
         delete_texture_data(skybox_faces[idx]);
     }
@@ -651,6 +1831,9 @@ void render_scene(Renderer3D *renderer, Array<Draw_Command> render_queue, Vector
     defer(ff_vertices.destroy());
     ff_begin(&ff, &ff_vertices);
 
+    renderer_state.frame_draw_stats = {};
+    arena_clear(&renderer_state.frame_arena);
+
     bind_vertex_format(renderer->default_vertex_format);
     set_cull_mode(CM_BACKFACE);
     set_depth_test(true);
@@ -658,6 +1841,7 @@ void render_scene(Renderer3D *renderer, Array<Draw_Command> render_queue, Vector
     set_alpha_blend(true);
 
     float cascade_distances[5] = {0, 2, 10, 30, 100};
+    Draw_Stats stats_before_shadows = renderer_state.frame_draw_stats;
     Texture shadow_map_buffers[NUM_SHADOW_MAPS] = {};
     Matrix4 shadow_map_transforms[NUM_SHADOW_MAPS] = {};
     if (render_options.do_shadows) {
@@ -730,10 +1914,20 @@ void render_scene(Renderer3D *renderer, Array<Draw_Command> render_queue, Vector
             shadow_pass.projection_matrix = construct_orthographic_matrix(-shadow_camera_fov, shadow_camera_fov, -shadow_camera_fov, shadow_camera_fov, -shadow_camera_far_plane, shadow_camera_far_plane);
             begin_render_pass(&shadow_pass);
             defer(end_render_pass());
-            bind_shaders(renderer->vertex_shader, renderer->depth_pixel_shader);
-            Foreach (command, render_queue) {
-                draw_model(command->model, command->position, command->scale, command->orientation, command->color, render_options, false);
-                draw_model(command->model, command->position, command->scale, command->orientation, command->color, render_options, true);
+            if (render_options.depth_only_shadows) {
+                bind_shaders(renderer->depth_vertex_shader, renderer->depth_pixel_shader);
+                bind_vertex_format(renderer->depth_vertex_format);
+                Foreach (command, render_queue) {
+                    draw_model_depth_only(command->model, command->position, command->scale, command->orientation, render_options);
+                }
+                bind_vertex_format(renderer->default_vertex_format);
+            }
+            else {
+                bind_shaders(renderer->vertex_shader, renderer->depth_pixel_shader);
+                Foreach (command, render_queue) {
+                    draw_model(command->model, command->position, command->scale, command->orientation, command->color, render_options, false);
+                    draw_model(command->model, command->position, command->scale, command->orientation, command->color, render_options, true);
+                }
             }
 
             shadow_map_buffers[shadow_map_index] = shadow_map_render_target;
@@ -746,6 +1940,13 @@ void render_scene(Renderer3D *renderer, Array<Draw_Command> render_queue, Vector
             shadow_map_transforms[i] = m4_identity();
         }
     }
+    Draw_Stats *shadow_stats = &renderer_state.last_shadow_stats;
+    shadow_stats->draw_calls         = renderer_state.frame_draw_stats.draw_calls         - stats_before_shadows.draw_calls;
+    shadow_stats->triangles          = renderer_state.frame_draw_stats.triangles          - stats_before_shadows.triangles;
+    shadow_stats->triangles_culled   = renderer_state.frame_draw_stats.triangles_culled   - stats_before_shadows.triangles_culled;
+    shadow_stats->buffer_binds       = renderer_state.frame_draw_stats.buffer_binds       - stats_before_shadows.buffer_binds;
+    shadow_stats->vertex_bytes_bound = renderer_state.frame_draw_stats.vertex_bytes_bound - stats_before_shadows.vertex_bytes_bound;
+    shadow_stats->index_bytes_bound  = renderer_state.frame_draw_stats.index_bytes_bound  - stats_before_shadows.index_bytes_bound;
 
     Vector4 skybox_color = v4(10, 10, 10, 1);
 
@@ -775,6 +1976,7 @@ void render_scene(Renderer3D *renderer, Array<Draw_Command> render_queue, Vector
 
     lighting.has_skybox_map = 1;
     lighting.skybox_color   = skybox_color;
+    sh9_diffuse_shader_constants(renderer->skybox_sh, lighting.skybox_sh);
 
     lighting.bloom_slope     = render_options.bloom_slope;
     lighting.bloom_threshold = render_options.bloom_threshold;
@@ -878,16 +2080,14 @@ void render_scene(Renderer3D *renderer, Array<Draw_Command> render_queue, Vector
         assert(pixel_size == sizeof(u64));
         int pixels_length_in_bytes = renderer->auto_exposure_cpu_read_buffer.description.width * renderer->auto_exposure_cpu_read_buffer.description.height * pixel_size;
         int pixels_length_in_u64 = pixels_length_in_bytes / 8;
-        u64 middle_pixel = pixels[4 + (renderer->auto_exposure_cpu_read_buffer.description.width * 4)];
-        u16 middle_pixel_r = (u16)(middle_pixel >> 0);
-        u16 middle_pixel_g = (u16)(middle_pixel >> 16);
-        u16 middle_pixel_b = (u16)(middle_pixel >> 32);
-        u32 ru32 = half_to_float(middle_pixel_r);
-        float r = *((float *)(&ru32));
-        u32 gu32 = half_to_float(middle_pixel_g);
-        float g = *((float *)(&gu32));
-        u32 bu32 = half_to_float(middle_pixel_b);
-        float b = *((float *)(&bu32));
+        u64 *middle_pixel = &pixels[4 + (renderer->auto_exposure_cpu_read_buffer.description.width * 4)];
+        u16 halves[4];
+        memcpy(halves, middle_pixel, sizeof(halves));
+        float rgba[4];
+        floats_from_halves(rgba, halves, 4);
+        float r = rgba[0];
+        float g = rgba[1];
+        float b = rgba[2];
 
         Vector3 color = v3(r*r, g*g, b*b);
         float brightness = dot(color, v3(0.2, 0.7, 0.1)); // todo(josh): @CorrectBrightness (0.2, 0.7, 0.1) are not exact. martijn: "if you want the exact ones, look at wikipedia at the Y component of the RGB primaries of the sRGB color space"
@@ -1010,6 +2210,8 @@ void render_scene(Renderer3D *renderer, Array<Draw_Command> render_queue, Vector
         ff_end(&ff);
         */
     }
+
+    renderer_state.last_frame_stats = renderer_state.frame_draw_stats;
 }
 
 
@@ -1084,18 +2286,14 @@ void ff_line_circle(Fixed_Function *ff, Vector3 position, float radius, Vector3
         normal,
     };
     Matrix3 transform = m3(columns);
-    int last_theta = 0;
-    for (int theta = last_theta + resolution; theta <= 360; theta += resolution) {
-        float last_x = cos(to_radians((float)last_theta)) - sin(to_radians((float)last_theta)) * radius;
-        float last_y = sin(to_radians((float)last_theta)) + cos(to_radians((float)last_theta)) * radius;
-
-        float x = cos(to_radians((float)theta)) - sin(to_radians((float)theta)) * radius;
-        float y = sin(to_radians((float)theta)) + cos(to_radians((float)theta)) * radius;
-
-        Vector3 v0 = transform * v3(last_x, last_y, 0);
-        Vector3 v1 = transform * v3(x, y, 0);
-        ff_line(ff, position + v0, position + v1, color);
-        last_theta = theta;
+    // note(josh): one sincos per segment, the previous point is carried over from the last iteration
+    Vector3 last_point = transform * v3(radius, 0, 0);
+    for (int theta = resolution; theta <= 360; theta += resolution) {
+        float s, c;
+        sincos_fast(to_radians((float)theta), &s, &c);
+        Vector3 point = transform * v3(c * radius, s * radius, 0);
+        ff_line(ff, position + last_point, position + point, color);
+        last_point = point;
     }
 }
 
@@ -2,6 +2,10 @@
 
 #include "application.h"
 #include "math.h"
+#include "bvh.h"
+#include "spherical_harmonics.h"
+#include "model_format.h"
+#include "mesh_optimizer.h"
 #include "stb_truetype.h"
 
 void init_renderer(Window *window);
@@ -15,6 +19,37 @@ struct Vertex {
     Vector3 bitangent;
 };
 
+// 24 byte version of Vertex for drawing. Vertex color is dropped (it's white for everything we load)
+// and so is tex_coord.z, the normal and tangent are octahedral and the bitangent is rebuilt in
+// compact_vertex.hlsl from cross(normal, tangent) and the sign stored with the tangent.
+struct Compact_Vertex {
+    Vector3 position;
+    u32 tex_coord; // pack_half2(), R16G16_FLOAT
+    u32 normal;    // pack_oct32(), R16G16_SNORM
+    u32 tangent;   // pack_tangent_oct(), R10G10B10A2_UNORM
+};
+static_assert(sizeof(Compact_Vertex) == 24, "compact_vertex.hlsl and the compact vertex format expect 24 bytes");
+
+enum Vertex_Layout {
+    VL_FULL,    // Vertex
+    VL_COMPACT, // Compact_Vertex
+
+    VL_COUNT,
+};
+
+int vertex_layout_size(Vertex_Layout layout);
+
+// The tangent frame gets orthonormalized on the way in, so unpacking gives back a unit normal, a
+// unit tangent perpendicular to it and a bitangent on the same side as the original one.
+Compact_Vertex pack_compact_vertex(Vertex *vertex);
+Vertex         unpack_compact_vertex(Compact_Vertex *compact);
+void           pack_compact_vertices(Compact_Vertex *out, Vertex *vertices, int count);
+
+// "name: N bytes per vertex, X MB of vertex buffers, Y MB less than Vertex would be"
+void print_vertex_buffer_memory(char *name, i64 num_vertices, Vertex_Layout layout);
+// "name: X MB of index buffers, Y MB less than all u32s would be"
+void print_index_buffer_memory(char *name, i64 num_indices, i64 index_bytes);
+
 struct PBR_Material {
     Texture albedo_map;
     Texture normal_map;
@@ -31,24 +66,180 @@ struct PBR_Material {
 
 void flush_pbr_material(Buffer buffer, PBR_Material material);
 Buffer create_pbr_material_cbuffer();
+Texture *get_material_map(PBR_Material *material, Material_Map map);
+
+// Textures loaded from files, keyed on path, format and wrap mode, so an image that many materials
+// (or models) reference is decoded and uploaded once. The cache owns the textures.
+struct Texture_Cache_Entry {
+    char *path;
+    Texture_Format format;
+    Texture_Wrap_Mode wrap_mode;
+    Texture texture;
+    int next_with_same_key; // next entry whose texture_cache_key() collides with this one's, -1 if none
+};
+
+struct Texture_Cache {
+    Allocator allocator;
+    Array<Texture_Cache_Entry> entries;
+    Hashtable<u64, int> lookup; // texture_cache_key() -> index into entries of the first entry with that key
+
+    // stats for print_texture_cache_stats()
+    int num_requests;
+    i64 requested_memory; // what every request would have uploaded without the cache
+    i64 texture_memory;
+    double load_seconds;
+};
+
+Texture_Cache make_texture_cache(Allocator allocator);
+void destroy_texture_cache(Texture_Cache *cache);
+Texture get_cached_texture(Texture_Cache *cache, char *path, Texture_Format format, Texture_Wrap_Mode wrap_mode);
+
+// Loads every requested texture that isn't cached yet. The files are read and decoded in parallel
+// and uploaded on the calling thread, so loaders should gather all their paths and call this before
+// creating materials, after which get_cached_texture() for those paths is just a lookup.
+struct Texture_Request {
+    char *path;
+    Texture_Format format;
+    Texture_Wrap_Mode wrap_mode;
+};
+void preload_cached_textures(Texture_Cache *cache, Texture_Request *requests, int count);
+
+// directory/path, or just path if directory is null. Free the result with the same allocator.
+char *resolve_texture_path(char *directory, char *path, Allocator allocator);
+void print_texture_cache_stats(Texture_Cache *cache);
+
+// Simplified versions of a mesh, see generate_mesh_lods(). They're more ranges of the same index
+// buffer and use the same vertices, lods[0] is the mesh as it was loaded.
+#define MAX_MESH_LODS CFFMODEL_MAX_LODS
+struct Mesh_Lod {
+    int first_index;
+    int num_indices;
+    float error; // furthest the surface moved from lods[0], in model space
+};
+
+// lods[0] split into meshlets for culling on the CPU. Each cluster's triangles are a range of indices,
+// which index the mesh's vertex buffer like its own do.
+struct Mesh_Cluster {
+    Meshlet_Bounds bounds; // model space
+    int first_index;
+    int num_indices;
+};
+
+struct Mesh_Clusters {
+    Array<Mesh_Cluster> clusters;
+    Array<u32> indices;
+};
 
 struct Loaded_Mesh {
     Buffer vertex_buffer;
+    Buffer position_buffer; // tightly packed Vector3s, all the depth-only passes bind
+    Vertex_Layout vertex_layout;
     int num_vertices;
     Buffer index_buffer;
-    int num_indices;
+    Index_Type index_type;
+    int num_indices; // lods[0]'s, the index buffer has every LOD's after it
+    // where the mesh starts in its buffers, only non-zero when the model's meshes share them. indices
+    // are relative to the mesh either way, the draw adds base_vertex to them.
+    int base_vertex;
+    int base_index;
+    Mesh_Lod lods[MAX_MESH_LODS];
+    int num_lods;
+    Vector3 bounds_min; // model space
+    Vector3 bounds_max;
     PBR_Material material;
     bool has_material;
+
+    // CPU copy of the geometry for spatial queries. indices is empty for unindexed meshes and always
+    // u32s, whatever index_type the GPU copy uses.
+    Array<Vector3> positions;
+    Array<u32> indices;
+    Triangle_BVH *bvh; // null until build_model_bvhs()
+    Mesh_Clusters *clusters; // null until build_model_clusters()
 };
 
+// every LOD's indices, what the index buffer holds
+static inline int total_mesh_indices(Loaded_Mesh *mesh) {
+    Mesh_Lod *last = &mesh->lods[mesh->num_lods - 1];
+    return last->first_index + last->num_indices;
+}
+
+// bounds_min and bounds_max from positions
+void set_mesh_bounds(Loaded_Mesh *mesh);
+
 struct Model {
     Array<Loaded_Mesh> meshes;
+    Mapped_File cooked_file; // for cooked models, the meshes' positions and indices point into this
+    bool merged_buffers;     // every mesh's vertex, position and index buffer is the same one, see load_cooked_model()
 };
 
 Model create_model(Allocator allocator);
 void destroy_model(Model model);
 Model create_cube_model(Allocator allocator);
 
+// Index buffer holding u16s when num_vertices is small enough for every index to fit, u32s otherwise.
+// Returns null for an unindexed mesh. indices themselves are left as they are.
+Buffer create_index_buffer(u32 *indices, int num_indices, int num_vertices, Index_Type *out_type);
+
+// Merges identical vertices, see generate_vertex_remap(). An empty indices gets filled in so the mesh
+// always comes out indexed. Returns the number of vertices removed.
+int weld_vertices(Array<Vertex> *vertices, Array<u32> *indices);
+
+// Replaces tangent and bitangent of every vertex with its MikkTSpace frame, see tangent_space.h. The
+// tangent comes out unit length and perpendicular to the normal and the bitangent is sign *
+// cross(normal, tangent). Vertices whose corners get more than one frame, like where mirrored and
+// unmirrored UVs meet, are split and the indices pointed at the copies, so the meshes can grow. Meshes
+// must be indexed, they're all done in one go across threads.
+void generate_vertex_tangents(Array<Vertex> **vertices, Array<u32> **indices, int num_meshes);
+
+// Before/after totals of what optimize_mesh() did, summed over however many meshes it was given.
+// The counts come from the CPU models in mesh_optimizer.h, not from a GPU.
+struct Mesh_Optimization_Report {
+    i64 num_triangles;
+    i64 vertex_bytes;
+    i64 transformed_before;
+    i64 transformed_after;
+    i64 fetched_before;
+    i64 fetched_after;
+};
+
+// Reorders the triangles of an indexed mesh for the post-transform cache and overdraw, then
+// renumbers the vertices in the order the new index buffer uses them. Vertices nothing uses are
+// dropped. report can be null.
+void optimize_mesh(Array<Vertex> *vertices, Array<u32> *indices, Mesh_Optimization_Report *report = nullptr);
+void print_mesh_optimization_report(char *name, Mesh_Optimization_Report *report);
+
+// Per LOD level totals of what generate_mesh_lods() made, summed over however many meshes it was given.
+struct Mesh_Lod_Report {
+    int num_meshes;
+    int meshes_with_lod[MAX_MESH_LODS];
+    i64 full_triangles[MAX_MESH_LODS]; // lods[0] triangles of the meshes that have this level
+    i64 lod_triangles[MAX_MESH_LODS];
+    float max_error[MAX_MESH_LODS];    // relative to the size of the mesh, see simplify_scale()
+};
+
+// Simplifies the whole of indices into up to MAX_MESH_LODS-1 coarser versions, each aiming for half
+// the triangles of the one before, and appends them to indices. Stops early once simplifying stops
+// paying off. Call it after optimize_mesh(), the vertices aren't touched. Returns the number of LODs
+// including lods[0]. report can be null.
+int generate_mesh_lods(Array<Vertex> *vertices, Array<u32> *indices, Mesh_Lod *out_lods, Mesh_Lod_Report *report = nullptr);
+void print_mesh_lod_report(char *name, Mesh_Lod_Report *report);
+
+// Loads a .cffmodel, see model_format.h. Returns false if the file is missing, stale or corrupt.
+// The file has to have been cooked with the same layout. With merge_meshes all the meshes go in one
+// vertex, position and index buffer and draw_model() only binds them once.
+bool load_cooked_model(char *filename, Allocator allocator, Texture_Cache *texture_cache, Model *out_model, Vertex_Layout layout = VL_FULL, bool merge_meshes = false);
+
+void build_model_bvhs(Model *model, Allocator allocator);
+// one instance per mesh, all with the same transform. build_model_bvhs() must have been called first.
+void append_bvh_instances(Model *model, Matrix4 transform, Array<BVH_Instance> *out_instances);
+
+// Clusters for every indexed mesh. The cone test assumes backfaces get culled, which they do in every
+// pass that draws models.
+void build_model_clusters(Model *model, Allocator allocator);
+// Appends the indices of every cluster culler doesn't reject to out_indices, returns the number of
+// triangles it did reject.
+int cull_mesh_clusters(Mesh_Clusters *clusters, Meshlet_Culler *culler, Array<u32> *out_indices);
+
 struct Pass_CBuffer {
     Vector2 screen_dimensions;
     f32 pad[2];
@@ -99,6 +290,7 @@ struct Lighting_CBuffer {
     int has_skybox_map;
     float pad[2];
     Vector4 skybox_color;
+    Vector4 skybox_sh[9]; // see sh9_diffuse_shader_constants()
 };
 
 struct Blur_CBuffer {
@@ -197,7 +389,12 @@ struct Render_Options {
     bool do_emission_map;
     bool do_ao_map;
 
+    bool do_mesh_lods;
+    float lod_pixel_error; // how far on screen a LOD may move the surface, in pixels
+    bool do_cluster_culling; // meshes drawn at lods[0] only draw the clusters inside the frustum and facing the camera
+
     bool do_shadows;
+    bool depth_only_shadows; // draw shadow maps from Loaded_Mesh::position_buffer instead of the full vertices
     Quaternion sun_orientation;
     Vector3 sun_color;
     float sun_intensity;
@@ -222,6 +419,17 @@ struct Render_Options {
     Debug_Render_Mode debug_render_mode;
 };
 
+// What got bound for drawing, counted in draw_mesh() and draw_mesh_depth_only(). A buffer counts in
+// full every time a draw binds it, whether or not the GPU ends up reading all of it.
+struct Draw_Stats {
+    int draw_calls;
+    i64 triangles; // indexed draws only
+    i64 triangles_culled; // by cluster culling
+    int buffer_binds;     // vertex and index buffer binds, draw_mesh() skips the ones that are already bound
+    i64 vertex_bytes_bound;
+    i64 index_bytes_bound;
+};
+
 void draw_render_options_editor_window(Render_Options *render_options);
 
 struct Render_Pass_Desc {
@@ -233,8 +441,26 @@ struct Render_Pass_Desc {
 
 void begin_render_pass(Render_Pass_Desc *pass);
 void end_render_pass();
+
+// Screen-space error LOD selection. Built once per pass, a mesh then gets the coarsest LOD whose
+// error projects to at most max_pixel_error pixels at the nearest point of its bounds.
+struct Lod_Selector {
+    Vector3 camera_position;
+    float pixels_per_unit; // pixels a unit covers at a distance of 1, or at any distance if orthographic
+    bool orthographic;
+    float max_pixel_error;
+};
+
+Lod_Selector make_lod_selector(Render_Pass_Desc *pass, float max_pixel_error);
+// model_scale is the largest of the model's scale axes
+int select_mesh_lod(Loaded_Mesh *mesh, Matrix4 model_matrix, float model_scale, Lod_Selector *selector);
 void draw_mesh(Buffer vertex_buffer, Buffer index_buffer, int num_vertices, int num_indices, Vector3 position, Vector3 scale, Quaternion orientation, Vector4 color);
+void draw_mesh(Buffer vertex_buffer, Buffer index_buffer, int num_vertices, int num_indices, Matrix4 model_matrix, Vector4 color, int vertex_stride = sizeof(Vertex), Index_Type index_type = IT_U32, int first_index = 0, int base_vertex = 0);
 void draw_model(Model model, Vector3 position, Vector3 scale, Quaternion orientation, Vector4 color, Render_Options options, bool draw_transparency);
+// Positions only, for passes that just write depth. Expects depth_vertex.hlsl and the depth vertex
+// format to be bound. Draws every mesh regardless of transparency.
+void draw_mesh_depth_only(Buffer position_buffer, Buffer index_buffer, int num_vertices, int num_indices, Matrix4 model_matrix, Index_Type index_type = IT_U32, int first_index = 0, int base_vertex = 0);
+void draw_model_depth_only(Model model, Vector3 position, Vector3 scale, Quaternion orientation, Render_Options options);
 void draw_texture(Texture texture, Vector3 min, Vector3 max, float z_override = 0);
 
 
@@ -276,10 +502,15 @@ struct Renderer3D {
     Pixel_Shader  ssr_pixel_shader;
 
     Vertex_Format default_vertex_format;
+    Vertex_Shader compact_vertex_shader;
+    Vertex_Format compact_vertex_format;
+    Vertex_Shader depth_vertex_shader;
+    Vertex_Format depth_vertex_format;
 
     Model cube_model;
 
     Texture skybox_texture;
+    SH9_Color skybox_sh; // radiance of skybox_texture, before skybox_color is applied
 
     Texture shadow_map_color_buffers[NUM_SHADOW_MAPS];
     Texture shadow_map_depth_buffer;
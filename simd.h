@@ -0,0 +1,295 @@
+#pragma once
+
+//
+// Thin wrappers over SSE/AVX float intrinsics for writing SoA kernels.
+//
+// f32x4 is always available (SSE2 is part of x64). f32x8 is only available when the compiler
+// is targeting AVX (/arch:AVX or /arch:AVX2 on MSVC, -mavx on gcc/clang), in which case
+// CFF_SIMD_AVX is defined. f32xN is whichever of the two is widest, so kernels written against
+// f32xN get the 8-wide path for free when it's there and still compile everywhere else.
+//
+// Loads and stores are all unaligned, the arrays we feed these things come from our allocators
+// which only promise DEFAULT_ALIGNMENT.
+//
+
+#include "basic.h"
+
+#include <emmintrin.h>
+
+#if defined(__AVX__)
+#define CFF_SIMD_AVX
+#include <immintrin.h>
+#endif
+
+#if defined(__AVX2__) || defined(__FMA__)
+#define CFF_SIMD_FMA
+#endif
+
+// note(josh): MSVC doesn't define __F16C__ but every AVX2 part has it
+#if defined(__F16C__) || (defined(_MSC_VER) && defined(__AVX2__))
+#define CFF_SIMD_F16C
+#endif
+
+
+
+typedef __m128  f32x4;
+typedef __m128i i32x4;
+
+static inline f32x4 f32x4_zero()                          { return _mm_setzero_ps(); }
+static inline f32x4 f32x4_set1(float f)                   { return _mm_set1_ps(f); }
+static inline f32x4 f32x4_load(float *ptr)                { return _mm_loadu_ps(ptr); }
+static inline void  f32x4_store(float *ptr, f32x4 v)      { _mm_storeu_ps(ptr, v); }
+static inline f32x4 f32x4_add(f32x4 a, f32x4 b)           { return _mm_add_ps(a, b); }
+static inline f32x4 f32x4_sub(f32x4 a, f32x4 b)           { return _mm_sub_ps(a, b); }
+static inline f32x4 f32x4_mul(f32x4 a, f32x4 b)           { return _mm_mul_ps(a, b); }
+static inline f32x4 f32x4_div(f32x4 a, f32x4 b)           { return _mm_div_ps(a, b); }
+static inline f32x4 f32x4_min(f32x4 a, f32x4 b)           { return _mm_min_ps(a, b); }
+static inline f32x4 f32x4_max(f32x4 a, f32x4 b)           { return _mm_max_ps(a, b); }
+static inline f32x4 f32x4_sqrt(f32x4 a)                   { return _mm_sqrt_ps(a); }
+static inline f32x4 f32x4_rsqrt_approx(f32x4 a)           { return _mm_rsqrt_ps(a); } // note(josh): ~12 bits
+static inline f32x4 f32x4_rcp_approx(f32x4 a)             { return _mm_rcp_ps(a); }   // note(josh): ~12 bits
+static inline f32x4 f32x4_and(f32x4 a, f32x4 b)           { return _mm_and_ps(a, b); }
+static inline f32x4 f32x4_andnot(f32x4 a, f32x4 b)        { return _mm_andnot_ps(a, b); } // ~a & b
+static inline f32x4 f32x4_or(f32x4 a, f32x4 b)            { return _mm_or_ps(a, b); }
+static inline f32x4 f32x4_xor(f32x4 a, f32x4 b)           { return _mm_xor_ps(a, b); }
+static inline f32x4 f32x4_cmp_lt(f32x4 a, f32x4 b)        { return _mm_cmplt_ps(a, b); }
+static inline f32x4 f32x4_cmp_le(f32x4 a, f32x4 b)        { return _mm_cmple_ps(a, b); }
+static inline f32x4 f32x4_cmp_gt(f32x4 a, f32x4 b)        { return _mm_cmpgt_ps(a, b); }
+static inline f32x4 f32x4_cmp_ge(f32x4 a, f32x4 b)        { return _mm_cmpge_ps(a, b); }
+static inline f32x4 f32x4_cmp_eq(f32x4 a, f32x4 b)        { return _mm_cmpeq_ps(a, b); }
+static inline int   f32x4_mask(f32x4 a)                   { return _mm_movemask_ps(a); }
+static inline f32x4 f32x4_sign_mask()                     { return _mm_castsi128_ps(_mm_set1_epi32((int)0x80000000)); }
+static inline f32x4 f32x4_abs(f32x4 a)                    { return _mm_andnot_ps(f32x4_sign_mask(), a); }
+static inline f32x4 f32x4_neg(f32x4 a)                    { return _mm_xor_ps(f32x4_sign_mask(), a); }
+static inline f32x4 f32x4_sign_bits(f32x4 a)              { return _mm_and_ps(f32x4_sign_mask(), a); }
+// mask lanes that are set pick b, the rest pick a
+static inline f32x4 f32x4_select(f32x4 mask, f32x4 a, f32x4 b) { return _mm_or_ps(_mm_and_ps(mask, b), _mm_andnot_ps(mask, a)); }
+static inline i32x4 f32x4_to_i32x4(f32x4 a)               { return _mm_cvtps_epi32(a); }  // round to nearest
+static inline i32x4 f32x4_trunc_to_i32x4(f32x4 a)         { return _mm_cvttps_epi32(a); } // round toward zero
+static inline f32x4 i32x4_to_f32x4(i32x4 a)               { return _mm_cvtepi32_ps(a); }
+static inline i32x4 f32x4_cast_i32x4(f32x4 a)             { return _mm_castps_si128(a); }
+static inline f32x4 i32x4_cast_f32x4(i32x4 a)             { return _mm_castsi128_ps(a); }
+static inline f32x4 f32x4_round(f32x4 a)                  { return i32x4_to_f32x4(f32x4_to_i32x4(a)); } // note(josh): only valid for |a| < 2^31
+static inline f32x4 f32x4_floor(f32x4 a) {
+    f32x4 t = i32x4_to_f32x4(f32x4_trunc_to_i32x4(a));
+    return f32x4_sub(t, f32x4_and(f32x4_cmp_gt(t, a), f32x4_set1(1.0f)));
+}
+// a*b + c
+static inline f32x4 f32x4_madd(f32x4 a, f32x4 b, f32x4 c) {
+#ifdef CFF_SIMD_FMA
+    return _mm_fmadd_ps(a, b, c);
+#else
+    return _mm_add_ps(_mm_mul_ps(a, b), c);
+#endif
+}
+static inline f32x4 f32x4_clamp(f32x4 v, f32x4 lo, f32x4 hi) { return _mm_min_ps(_mm_max_ps(v, lo), hi); }
+
+static inline i32x4 i32x4_set1(int i)                     { return _mm_set1_epi32(i); }
+static inline i32x4 i32x4_load(void *ptr)                 { return _mm_loadu_si128((__m128i *)ptr); }
+static inline void  i32x4_store(void *ptr, i32x4 v)       { _mm_storeu_si128((__m128i *)ptr, v); }
+static inline i32x4 i32x4_add(i32x4 a, i32x4 b)           { return _mm_add_epi32(a, b); }
+static inline i32x4 i32x4_sub(i32x4 a, i32x4 b)           { return _mm_sub_epi32(a, b); }
+static inline i32x4 i32x4_and(i32x4 a, i32x4 b)           { return _mm_and_si128(a, b); }
+static inline i32x4 i32x4_or(i32x4 a, i32x4 b)            { return _mm_or_si128(a, b); }
+static inline i32x4 i32x4_xor(i32x4 a, i32x4 b)           { return _mm_xor_si128(a, b); }
+static inline i32x4 i32x4_shl(i32x4 a, int bits)          { return _mm_slli_epi32(a, bits); }
+static inline i32x4 i32x4_shr(i32x4 a, int bits)          { return _mm_srli_epi32(a, bits); } // logical
+static inline i32x4 i32x4_sar(i32x4 a, int bits)          { return _mm_srai_epi32(a, bits); } // arithmetic
+
+
+
+#ifdef CFF_SIMD_AVX
+
+typedef __m256  f32x8;
+typedef __m256i i32x8;
+
+static inline f32x8 f32x8_zero()                          { return _mm256_setzero_ps(); }
+static inline f32x8 f32x8_set1(float f)                   { return _mm256_set1_ps(f); }
+static inline f32x8 f32x8_load(float *ptr)                { return _mm256_loadu_ps(ptr); }
+static inline void  f32x8_store(float *ptr, f32x8 v)      { _mm256_storeu_ps(ptr, v); }
+static inline f32x8 f32x8_add(f32x8 a, f32x8 b)           { return _mm256_add_ps(a, b); }
+static inline f32x8 f32x8_sub(f32x8 a, f32x8 b)           { return _mm256_sub_ps(a, b); }
+static inline f32x8 f32x8_mul(f32x8 a, f32x8 b)           { return _mm256_mul_ps(a, b); }
+static inline f32x8 f32x8_div(f32x8 a, f32x8 b)           { return _mm256_div_ps(a, b); }
+static inline f32x8 f32x8_min(f32x8 a, f32x8 b)           { return _mm256_min_ps(a, b); }
+static inline f32x8 f32x8_max(f32x8 a, f32x8 b)           { return _mm256_max_ps(a, b); }
+static inline f32x8 f32x8_sqrt(f32x8 a)                   { return _mm256_sqrt_ps(a); }
+static inline f32x8 f32x8_rsqrt_approx(f32x8 a)           { return _mm256_rsqrt_ps(a); }
+static inline f32x8 f32x8_rcp_approx(f32x8 a)             { return _mm256_rcp_ps(a); }
+static inline f32x8 f32x8_and(f32x8 a, f32x8 b)           { return _mm256_and_ps(a, b); }
+static inline f32x8 f32x8_andnot(f32x8 a, f32x8 b)        { return _mm256_andnot_ps(a, b); }
+static inline f32x8 f32x8_or(f32x8 a, f32x8 b)            { return _mm256_or_ps(a, b); }
+static inline f32x8 f32x8_xor(f32x8 a, f32x8 b)           { return _mm256_xor_ps(a, b); }
+static inline f32x8 f32x8_cmp_lt(f32x8 a, f32x8 b)        { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+static inline f32x8 f32x8_cmp_le(f32x8 a, f32x8 b)        { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+static inline f32x8 f32x8_cmp_gt(f32x8 a, f32x8 b)        { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+static inline f32x8 f32x8_cmp_ge(f32x8 a, f32x8 b)        { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+static inline f32x8 f32x8_cmp_eq(f32x8 a, f32x8 b)        { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+static inline int   f32x8_mask(f32x8 a)                   { return _mm256_movemask_ps(a); }
+static inline f32x8 f32x8_sign_mask()                     { return _mm256_castsi256_ps(_mm256_set1_epi32((int)0x80000000)); }
+static inline f32x8 f32x8_abs(f32x8 a)                    { return _mm256_andnot_ps(f32x8_sign_mask(), a); }
+static inline f32x8 f32x8_neg(f32x8 a)                    { return _mm256_xor_ps(f32x8_sign_mask(), a); }
+static inline f32x8 f32x8_sign_bits(f32x8 a)              { return _mm256_and_ps(f32x8_sign_mask(), a); }
+static inline f32x8 f32x8_select(f32x8 mask, f32x8 a, f32x8 b) { return _mm256_blendv_ps(a, b, mask); }
+static inline i32x8 f32x8_to_i32x8(f32x8 a)               { return _mm256_cvtps_epi32(a); }
+static inline i32x8 f32x8_trunc_to_i32x8(f32x8 a)         { return _mm256_cvttps_epi32(a); }
+static inline f32x8 i32x8_to_f32x8(i32x8 a)               { return _mm256_cvtepi32_ps(a); }
+static inline i32x8 f32x8_cast_i32x8(f32x8 a)             { return _mm256_castps_si256(a); }
+static inline f32x8 i32x8_cast_f32x8(i32x8 a)             { return _mm256_castsi256_ps(a); }
+static inline f32x8 f32x8_round(f32x8 a)                  { return _mm256_round_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+static inline f32x8 f32x8_floor(f32x8 a)                  { return _mm256_floor_ps(a); }
+static inline f32x8 f32x8_madd(f32x8 a, f32x8 b, f32x8 c) {
+#ifdef CFF_SIMD_FMA
+    return _mm256_fmadd_ps(a, b, c);
+#else
+    return _mm256_add_ps(_mm256_mul_ps(a, b), c);
+#endif
+}
+static inline f32x8 f32x8_clamp(f32x8 v, f32x8 lo, f32x8 hi) { return _mm256_min_ps(_mm256_max_ps(v, lo), hi); }
+
+// note(josh): integer ops on 8 lanes need AVX2. without it we split into two SSE halves.
+static inline i32x8 i32x8_set1(int i)                     { return _mm256_set1_epi32(i); }
+static inline i32x8 i32x8_load(void *ptr)                 { return _mm256_loadu_si256((__m256i *)ptr); }
+static inline void  i32x8_store(void *ptr, i32x8 v)       { _mm256_storeu_si256((__m256i *)ptr, v); }
+#ifdef __AVX2__
+static inline i32x8 i32x8_add(i32x8 a, i32x8 b)           { return _mm256_add_epi32(a, b); }
+static inline i32x8 i32x8_sub(i32x8 a, i32x8 b)           { return _mm256_sub_epi32(a, b); }
+static inline i32x8 i32x8_and(i32x8 a, i32x8 b)           { return _mm256_and_si256(a, b); }
+static inline i32x8 i32x8_or(i32x8 a, i32x8 b)            { return _mm256_or_si256(a, b); }
+static inline i32x8 i32x8_xor(i32x8 a, i32x8 b)           { return _mm256_xor_si256(a, b); }
+static inline i32x8 i32x8_shl(i32x8 a, int bits)          { return _mm256_slli_epi32(a, bits); }
+static inline i32x8 i32x8_shr(i32x8 a, int bits)          { return _mm256_srli_epi32(a, bits); }
+static inline i32x8 i32x8_sar(i32x8 a, int bits)          { return _mm256_srai_epi32(a, bits); }
+#else
+#define CFF_SIMD__SPLIT_I32X8(name, expr) \
+    static inline i32x8 name(i32x8 a, i32x8 b) { \
+        __m128i alo = _mm256_castsi256_si128(a); __m128i ahi = _mm256_extractf128_si256(a, 1); \
+        __m128i blo = _mm256_castsi256_si128(b); __m128i bhi = _mm256_extractf128_si256(b, 1); \
+        return _mm256_insertf128_si256(_mm256_castsi128_si256(expr(alo, blo)), expr(ahi, bhi), 1); \
+    }
+CFF_SIMD__SPLIT_I32X8(i32x8_add, _mm_add_epi32)
+CFF_SIMD__SPLIT_I32X8(i32x8_sub, _mm_sub_epi32)
+CFF_SIMD__SPLIT_I32X8(i32x8_and, _mm_and_si128)
+CFF_SIMD__SPLIT_I32X8(i32x8_or,  _mm_or_si128)
+CFF_SIMD__SPLIT_I32X8(i32x8_xor, _mm_xor_si128)
+#undef CFF_SIMD__SPLIT_I32X8
+#define CFF_SIMD__SPLIT_I32X8_SHIFT(name, expr) \
+    static inline i32x8 name(i32x8 a, int bits) { \
+        __m128i alo = _mm256_castsi256_si128(a); __m128i ahi = _mm256_extractf128_si256(a, 1); \
+        return _mm256_insertf128_si256(_mm256_castsi128_si256(expr(alo, bits)), expr(ahi, bits), 1); \
+    }
+CFF_SIMD__SPLIT_I32X8_SHIFT(i32x8_shl, _mm_slli_epi32)
+CFF_SIMD__SPLIT_I32X8_SHIFT(i32x8_shr, _mm_srli_epi32)
+CFF_SIMD__SPLIT_I32X8_SHIFT(i32x8_sar, _mm_srai_epi32)
+#undef CFF_SIMD__SPLIT_I32X8_SHIFT
+#endif
+
+#endif // CFF_SIMD_AVX
+
+
+
+// f32xN is the widest float vector we have.
+
+#ifdef CFF_SIMD_AVX
+#define SIMD_WIDTH 8
+typedef f32x8 f32xN;
+typedef i32x8 i32xN;
+#define f32xN_zero            f32x8_zero
+#define f32xN_set1            f32x8_set1
+#define f32xN_load            f32x8_load
+#define f32xN_store           f32x8_store
+#define f32xN_add             f32x8_add
+#define f32xN_sub             f32x8_sub
+#define f32xN_mul             f32x8_mul
+#define f32xN_div             f32x8_div
+#define f32xN_min             f32x8_min
+#define f32xN_max             f32x8_max
+#define f32xN_sqrt            f32x8_sqrt
+#define f32xN_rsqrt_approx    f32x8_rsqrt_approx
+#define f32xN_rcp_approx      f32x8_rcp_approx
+#define f32xN_and             f32x8_and
+#define f32xN_andnot          f32x8_andnot
+#define f32xN_or              f32x8_or
+#define f32xN_xor             f32x8_xor
+#define f32xN_cmp_lt          f32x8_cmp_lt
+#define f32xN_cmp_le          f32x8_cmp_le
+#define f32xN_cmp_gt          f32x8_cmp_gt
+#define f32xN_cmp_ge          f32x8_cmp_ge
+#define f32xN_cmp_eq          f32x8_cmp_eq
+#define f32xN_mask            f32x8_mask
+#define f32xN_abs             f32x8_abs
+#define f32xN_neg             f32x8_neg
+#define f32xN_sign_bits       f32x8_sign_bits
+#define f32xN_select          f32x8_select
+#define f32xN_round           f32x8_round
+#define f32xN_floor           f32x8_floor
+#define f32xN_madd            f32x8_madd
+#define f32xN_clamp           f32x8_clamp
+#define f32xN_to_i32xN        f32x8_to_i32x8
+#define f32xN_trunc_to_i32xN  f32x8_trunc_to_i32x8
+#define i32xN_to_f32xN        i32x8_to_f32x8
+#define f32xN_cast_i32xN      f32x8_cast_i32x8
+#define i32xN_cast_f32xN      i32x8_cast_f32x8
+#define i32xN_set1            i32x8_set1
+#define i32xN_load            i32x8_load
+#define i32xN_store           i32x8_store
+#define i32xN_add             i32x8_add
+#define i32xN_sub             i32x8_sub
+#define i32xN_and             i32x8_and
+#define i32xN_or              i32x8_or
+#define i32xN_xor             i32x8_xor
+#define i32xN_shl             i32x8_shl
+#define i32xN_shr             i32x8_shr
+#define i32xN_sar             i32x8_sar
+#else
+#define SIMD_WIDTH 4
+typedef f32x4 f32xN;
+typedef i32x4 i32xN;
+#define f32xN_zero            f32x4_zero
+#define f32xN_set1            f32x4_set1
+#define f32xN_load            f32x4_load
+#define f32xN_store           f32x4_store
+#define f32xN_add             f32x4_add
+#define f32xN_sub             f32x4_sub
+#define f32xN_mul             f32x4_mul
+#define f32xN_div             f32x4_div
+#define f32xN_min             f32x4_min
+#define f32xN_max             f32x4_max
+#define f32xN_sqrt            f32x4_sqrt
+#define f32xN_rsqrt_approx    f32x4_rsqrt_approx
+#define f32xN_rcp_approx      f32x4_rcp_approx
+#define f32xN_and             f32x4_and
+#define f32xN_andnot          f32x4_andnot
+#define f32xN_or              f32x4_or
+#define f32xN_xor             f32x4_xor
+#define f32xN_cmp_lt          f32x4_cmp_lt
+#define f32xN_cmp_le          f32x4_cmp_le
+#define f32xN_cmp_gt          f32x4_cmp_gt
+#define f32xN_cmp_ge          f32x4_cmp_ge
+#define f32xN_cmp_eq          f32x4_cmp_eq
+#define f32xN_mask            f32x4_mask
+#define f32xN_abs             f32x4_abs
+#define f32xN_neg             f32x4_neg
+#define f32xN_sign_bits       f32x4_sign_bits
+#define f32xN_select          f32x4_select
+#define f32xN_round           f32x4_round
+#define f32xN_floor           f32x4_floor
+#define f32xN_madd            f32x4_madd
+#define f32xN_clamp           f32x4_clamp
+#define f32xN_to_i32xN        f32x4_to_i32x4
+#define f32xN_trunc_to_i32xN  f32x4_trunc_to_i32x4
+#define i32xN_to_f32xN        i32x4_to_f32x4
+#define f32xN_cast_i32xN      f32x4_cast_i32x4
+#define i32xN_cast_f32xN      i32x4_cast_f32x4
+#define i32xN_set1            i32x4_set1
+#define i32xN_load            i32x4_load
+#define i32xN_store           i32x4_store
+#define i32xN_add             i32x4_add
+#define i32xN_sub             i32x4_sub
+#define i32xN_and             i32x4_and
+#define i32xN_or              i32x4_or
+#define i32xN_xor             i32x4_xor
+#define i32xN_shl             i32x4_shl
+#define i32xN_shr             i32x4_shr
+#define i32xN_sar             i32x4_sar
+#endif
@@ -0,0 +1,236 @@
+#include "spherical_harmonics.h"
+#include "threading.h"
+#include "simd.h"
+
+#include <math.h>
+
+// normalization constants of the real SH basis functions
+#define SH_Y00 0.282094792f // 1/2 sqrt(1/pi)
+#define SH_Y1  0.488602512f // sqrt(3/(4pi))
+#define SH_Y2  1.092548431f // 1/2 sqrt(15/pi)
+#define SH_Y20 0.315391565f // 1/4 sqrt(5/pi)
+#define SH_Y22 0.546274215f // 1/4 sqrt(15/pi)
+
+// convolving with a clamped cosine scales each band by these (Ramamoorthi and Hanrahan 2001)
+#define SH_COSINE_A0 3.14159265358979324f
+#define SH_COSINE_A1 2.09439510239319549f
+#define SH_COSINE_A2 0.78539816339744831f
+
+void sh9_basis(Vector3 d, float out_basis[9]) {
+    out_basis[0] = SH_Y00;
+    out_basis[1] = SH_Y1 * d.y;
+    out_basis[2] = SH_Y1 * d.z;
+    out_basis[3] = SH_Y1 * d.x;
+    out_basis[4] = SH_Y2 * d.x * d.y;
+    out_basis[5] = SH_Y2 * d.y * d.z;
+    out_basis[6] = SH_Y20 * (3.0f * d.z * d.z - 1.0f);
+    out_basis[7] = SH_Y2 * d.x * d.z;
+    out_basis[8] = SH_Y22 * (d.x * d.x - d.y * d.y);
+}
+
+Vector3 sh9_evaluate(SH9_Color sh, Vector3 direction) {
+    float basis[9];
+    sh9_basis(direction, basis);
+    Vector3 result = {};
+    for (int i = 0; i < 9; i++) {
+        result += sh.coefficients[i] * basis[i];
+    }
+    return result;
+}
+
+static SH9_Color sh9_convolve_cosine(SH9_Color sh) {
+    static const float bands[9] = {
+        SH_COSINE_A0,
+        SH_COSINE_A1, SH_COSINE_A1, SH_COSINE_A1,
+        SH_COSINE_A2, SH_COSINE_A2, SH_COSINE_A2, SH_COSINE_A2, SH_COSINE_A2,
+    };
+    for (int i = 0; i < 9; i++) {
+        sh.coefficients[i] *= bands[i];
+    }
+    return sh;
+}
+
+Vector3 sh9_irradiance(SH9_Color radiance, Vector3 normal) {
+    return sh9_evaluate(sh9_convolve_cosine(radiance), normal);
+}
+
+void sh9_diffuse_shader_constants(SH9_Color radiance, Vector4 out_constants[9]) {
+    static const float constants[9] = {
+        SH_Y00, SH_Y1, SH_Y1, SH_Y1, SH_Y2, SH_Y2, SH_Y20, SH_Y2, SH_Y22,
+    };
+    SH9_Color irradiance = sh9_convolve_cosine(radiance);
+    for (int i = 0; i < 9; i++) {
+        Vector3 c = irradiance.coefficients[i] * (constants[i] / (float)PI);
+        out_constants[i] = v4(c.x, c.y, c.z, 0);
+    }
+}
+
+
+
+// D3D cubemap face layout: the texel at (u, v) in [-1, 1]^2 (v pointing down the image) looks
+// along major + u*u_axis + v*v_axis
+struct Cubemap_Face_Axes {
+    Vector3 major;
+    Vector3 u_axis;
+    Vector3 v_axis;
+};
+
+static const Cubemap_Face_Axes CUBEMAP_FACE_AXES[6] = {
+    {{ 1,  0,  0}, { 0,  0, -1}, { 0, -1,  0}}, // +x
+    {{-1,  0,  0}, { 0,  0,  1}, { 0, -1,  0}}, // -x
+    {{ 0,  1,  0}, { 1,  0,  0}, { 0,  0,  1}}, // +y
+    {{ 0, -1,  0}, { 1,  0,  0}, { 0,  0, -1}}, // -y
+    {{ 0,  0,  1}, { 1,  0,  0}, { 0, -1,  0}}, // +z
+    {{ 0,  0, -1}, {-1,  0,  0}, { 0, -1,  0}}, // -z
+};
+
+struct SH_Projection_Job {
+    byte **faces;
+    int face_size;
+    // one partial sum per face so the result doesn't depend on which thread did what
+    double sums[6][27];
+    double weight_sums[6];
+};
+
+// accumulates 9 basis functions x 3 channels for SIMD_WIDTH texels at once
+struct SH_Accumulator {
+    f32xN sums[27];
+    f32xN weight_sum;
+};
+
+static inline void accumulate_texels(SH_Accumulator *acc, f32xN x, f32xN y, f32xN z, f32xN weight, f32xN r, f32xN g, f32xN b) {
+    f32xN basis[9];
+    basis[0] = f32xN_set1(SH_Y00);
+    basis[1] = f32xN_mul(f32xN_set1(SH_Y1), y);
+    basis[2] = f32xN_mul(f32xN_set1(SH_Y1), z);
+    basis[3] = f32xN_mul(f32xN_set1(SH_Y1), x);
+    basis[4] = f32xN_mul(f32xN_set1(SH_Y2), f32xN_mul(x, y));
+    basis[5] = f32xN_mul(f32xN_set1(SH_Y2), f32xN_mul(y, z));
+    basis[6] = f32xN_mul(f32xN_set1(SH_Y20), f32xN_madd(f32xN_set1(3.0f), f32xN_mul(z, z), f32xN_set1(-1.0f)));
+    basis[7] = f32xN_mul(f32xN_set1(SH_Y2), f32xN_mul(x, z));
+    basis[8] = f32xN_mul(f32xN_set1(SH_Y22), f32xN_sub(f32xN_mul(x, x), f32xN_mul(y, y)));
+    f32xN wr = f32xN_mul(weight, r);
+    f32xN wg = f32xN_mul(weight, g);
+    f32xN wb = f32xN_mul(weight, b);
+    for (int i = 0; i < 9; i++) {
+        acc->sums[i*3+0] = f32xN_madd(basis[i], wr, acc->sums[i*3+0]);
+        acc->sums[i*3+1] = f32xN_madd(basis[i], wg, acc->sums[i*3+1]);
+        acc->sums[i*3+2] = f32xN_madd(basis[i], wb, acc->sums[i*3+2]);
+    }
+    acc->weight_sum = f32xN_add(acc->weight_sum, weight);
+}
+
+static void project_cubemap_faces(void *userdata, int start, int end) {
+    SH_Projection_Job *job = (SH_Projection_Job *)userdata;
+    int size = job->face_size;
+    float texel_size = 2.0f / size;
+    const float inv_255 = 1.0f / 255.0f;
+
+    float lane_offsets[SIMD_WIDTH];
+    for (int lane = 0; lane < SIMD_WIDTH; lane++) {
+        lane_offsets[lane] = (float)lane * texel_size;
+    }
+    f32xN lane_offset = f32xN_load(lane_offsets);
+
+    for (int face = start; face < end; face++) {
+        Cubemap_Face_Axes axes = CUBEMAP_FACE_AXES[face];
+        u32 *texels = (u32 *)job->faces[face];
+        for (int i = 0; i < 27; i++) {
+            job->sums[face][i] = 0;
+        }
+        job->weight_sums[face] = 0;
+
+        for (int row = 0; row < size; row++) {
+            // note(josh): floats are fine within a row, rows get summed into doubles so a 2k face
+            // doesn't lose precision
+            SH_Accumulator acc;
+            for (int i = 0; i < 27; i++) {
+                acc.sums[i] = f32xN_zero();
+            }
+            acc.weight_sum = f32xN_zero();
+
+            float v = (row + 0.5f) * texel_size - 1.0f;
+            f32xN row_x = f32xN_set1(axes.major.x + v * axes.v_axis.x);
+            f32xN row_y = f32xN_set1(axes.major.y + v * axes.v_axis.y);
+            f32xN row_z = f32xN_set1(axes.major.z + v * axes.v_axis.z);
+            f32xN one_plus_v2 = f32xN_set1(1.0f + v * v);
+            u32 *row_texels = texels + row * size;
+
+            int column = 0;
+            for (; column + SIMD_WIDTH <= size; column += SIMD_WIDTH) {
+                f32xN u = f32xN_add(f32xN_set1((column + 0.5f) * texel_size - 1.0f), lane_offset);
+                // the differential solid angle of a texel is proportional to 1/(1+u^2+v^2)^(3/2)
+                f32xN inv_length = f32xN_div(f32xN_set1(1.0f), f32xN_sqrt(f32xN_madd(u, u, one_plus_v2)));
+                f32xN weight = f32xN_mul(inv_length, f32xN_mul(inv_length, inv_length));
+                f32xN x = f32xN_mul(f32xN_madd(u, f32xN_set1(axes.u_axis.x), row_x), inv_length);
+                f32xN y = f32xN_mul(f32xN_madd(u, f32xN_set1(axes.u_axis.y), row_y), inv_length);
+                f32xN z = f32xN_mul(f32xN_madd(u, f32xN_set1(axes.u_axis.z), row_z), inv_length);
+
+                i32xN rgba = i32xN_load(row_texels + column);
+                i32xN mask = i32xN_set1(0xff);
+                f32xN r = f32xN_mul(i32xN_to_f32xN(i32xN_and(rgba, mask)),                   f32xN_set1(inv_255));
+                f32xN g = f32xN_mul(i32xN_to_f32xN(i32xN_and(i32xN_shr(rgba, 8), mask)),  f32xN_set1(inv_255));
+                f32xN b = f32xN_mul(i32xN_to_f32xN(i32xN_and(i32xN_shr(rgba, 16), mask)), f32xN_set1(inv_255));
+                accumulate_texels(&acc, x, y, z, weight, r, g, b);
+            }
+
+            float sums[27][SIMD_WIDTH];
+            float weight_sums[SIMD_WIDTH];
+            for (int i = 0; i < 27; i++) {
+                f32xN_store(sums[i], acc.sums[i]);
+            }
+            f32xN_store(weight_sums, acc.weight_sum);
+            for (int lane = 0; lane < SIMD_WIDTH; lane++) {
+                for (int i = 0; i < 27; i++) {
+                    job->sums[face][i] += sums[i][lane];
+                }
+                job->weight_sums[face] += weight_sums[lane];
+            }
+
+            // leftover texels when the face size isn't a multiple of the SIMD width
+            for (; column < size; column++) {
+                float u = (column + 0.5f) * texel_size - 1.0f;
+                float inv_length = 1.0f / sqrtf(1.0f + u*u + v*v);
+                float weight = inv_length * inv_length * inv_length;
+                Vector3 direction = (axes.major + axes.u_axis * u + axes.v_axis * v) * inv_length;
+                float basis[9];
+                sh9_basis(direction, basis);
+                u32 rgba = row_texels[column];
+                float rgb[3] = {(rgba & 0xff) * inv_255, ((rgba >> 8) & 0xff) * inv_255, ((rgba >> 16) & 0xff) * inv_255};
+                for (int i = 0; i < 9; i++) {
+                    for (int c = 0; c < 3; c++) {
+                        job->sums[face][i*3+c] += basis[i] * weight * rgb[c];
+                    }
+                }
+                job->weight_sums[face] += weight;
+            }
+        }
+    }
+}
+
+SH9_Color sh9_project_cubemap(byte *faces[6], int face_size) {
+    assert(face_size > 0);
+    SH_Projection_Job job = {};
+    job.faces = faces;
+    job.face_size = face_size;
+    parallel_for(6, 1, project_cubemap_faces, &job);
+
+    double sums[27] = {};
+    double weight_sum = 0;
+    for (int face = 0; face < 6; face++) {
+        for (int i = 0; i < 27; i++) {
+            sums[i] += job.sums[face][i];
+        }
+        weight_sum += job.weight_sums[face];
+    }
+
+    // note(josh): the weights are only proportional to solid angle, scale them so the whole sphere
+    // adds up to exactly 4pi. this also cancels most of the error from treating each texel's
+    // solid angle as constant across the texel.
+    double scale = 2.0 * TAU / weight_sum;
+    SH9_Color result = {};
+    for (int i = 0; i < 9; i++) {
+        result.coefficients[i] = v3((float)(sums[i*3+0] * scale), (float)(sums[i*3+1] * scale), (float)(sums[i*3+2] * scale));
+    }
+    return result;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "basic.h"
+#include "math.h"
+
+//
+// Order 2 (L2, 9 coefficient) spherical harmonics for RGB lighting.
+//
+// The usual use is projecting an environment cubemap once at load time and then getting diffuse
+// ambient lighting for any normal from the 9 coefficients, which is what a full irradiance
+// convolution of the cubemap would give you to within a few percent.
+//
+// Coefficients are in the real SH basis ordered (l,m) = (0,0) (1,-1) (1,0) (1,1) (2,-2) (2,-1)
+// (2,0) (2,1) (2,2), i.e. 1, y, z, x, xy, yz, 3z^2-1, xz, x^2-y^2 with the normalization constants
+// folded in.
+//
+
+struct SH9_Color {
+    Vector3 coefficients[9];
+};
+
+void sh9_basis(Vector3 direction, float out_basis[9]); // direction must be normalized
+
+// Projects a cubemap given as six square RGBA8 faces in D3D order (+x, -x, +y, -y, +z, -z) with
+// texels weighted by the solid angle they cover. Texels are read as linear UNORM, the same way the
+// GPU samples a TF_R8G8B8A8_UINT cubemap, and alpha is ignored. The faces are done in parallel.
+SH9_Color sh9_project_cubemap(byte *faces[6], int face_size);
+
+// radiance arriving from direction
+Vector3 sh9_evaluate(SH9_Color sh, Vector3 direction);
+
+// Irradiance at a surface with the given normal, i.e. the cosine weighted integral of the radiance
+// over the hemisphere around it. Divide by pi to get the radiance reflected by a white Lambertian
+// surface.
+Vector3 sh9_irradiance(SH9_Color radiance, Vector3 normal);
+
+// Packs radiance for the shaders. The cosine lobe, the 1/pi and the basis constants are all folded
+// in so evaluating them is a handful of multiply-adds, see sh_diffuse_ambient() in pixel.hlsl.
+void sh9_diffuse_shader_constants(SH9_Color radiance, Vector4 out_constants[9]);
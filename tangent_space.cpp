@@ -0,0 +1,415 @@
+#include "tangent_space.h"
+#include "simd.h"
+#include "threading.h"
+
+#include <algorithm>
+#include <float.h>
+#include <string.h>
+
+#define TANGENT_FRAME_MIRRORED   (1 << 0) // negative UV area, the bitangent sign is -1
+#define TANGENT_FRAME_DEGENERATE (1 << 1) // no UV area or no length, contributes nothing
+
+// one per corner of every triangle, grouped by vertex by build_vertex_corners()
+struct Vertex_Corner {
+    u32 corner; // local to the mesh
+    u32 prev;   // the other two vertices of its triangle
+    u32 next;
+};
+
+// what the vertex pass works out for each Vertex_Corner, kept out of them so the sort only scatters 12 bytes
+struct Corner_Group {
+    Vector3 sum; // the corner's weighted tangent, then for a group's root the group's sum, then its unit tangent
+    u32 flags;   // of the corner's triangle
+    int group;   // union-find parent
+};
+
+// note(josh): all the meshes are laid end to end. triangle_bases and vertex_bases have num_meshes+1
+// entries so the range of mesh i is [bases[i], bases[i+1]).
+struct Tangent_Job {
+    Tangent_Mesh *meshes;
+    int num_meshes;
+    int *triangle_bases;
+    int *vertex_bases;
+
+    int *corner_offsets;           // by global vertex, where its corners start in vertex_corners
+    int *corner_cursors;           // by global vertex, scratch for filling vertex_corners
+    Vertex_Corner *vertex_corners; // corners of every mesh's triangles, grouped by vertex
+    Corner_Group *corner_groups;   // parallel to vertex_corners
+};
+
+static inline Vector3 read_float3(void *data, int stride, u32 index) {
+    Vector3 v;
+    memcpy(&v, (byte *)data + (i64)index * stride, sizeof(v));
+    return v;
+}
+
+static inline Vector2 read_float2(void *data, int stride, u32 index) {
+    Vector2 v;
+    memcpy(&v, (byte *)data + (i64)index * stride, sizeof(v));
+    return v;
+}
+
+// note(josh): the per-corner math is nothing but these and math.cpp's versions can't be inlined from
+// here, which made it three times slower
+static inline float dot3(Vector3 a, Vector3 b) {
+    return a.x*b.x + a.y*b.y + a.z*b.z;
+}
+
+static inline Vector3 sub3(Vector3 a, Vector3 b) {
+    Vector3 result;
+    result.x = a.x - b.x;
+    result.y = a.y - b.y;
+    result.z = a.z - b.z;
+    return result;
+}
+
+static inline Vector3 scale3(Vector3 v, float f) {
+    Vector3 result;
+    result.x = v.x * f;
+    result.y = v.y * f;
+    result.z = v.z * f;
+    return result;
+}
+
+// the mesh item belongs to, bases as in Tangent_Job
+static int find_mesh(int *bases, int num_meshes, int item) {
+    return (int)(std::upper_bound(bases, bases + num_meshes + 1, item) - bases) - 1;
+}
+
+static bool not_zero(float f) {
+    return fabsf(f) > FLT_MIN;
+}
+
+static Vector3 perpendicular_tangent(Vector3 normal) {
+    if (!not_zero(sqr_length(normal))) {
+        return v3(1, 0, 0);
+    }
+    return normalize(cross(normal, fabsf(normal.x) < 0.9f * length(normal) ? v3(1, 0, 0) : v3(0, 1, 0)));
+}
+
+
+
+// corners waiting for weight_corner_tangents(), SoA so it can go SIMD_WIDTH at a time. a multiple
+// of 3 so it fills up with whole triangles.
+#define CORNER_BLOCK_SIZE (SIMD_WIDTH * 6)
+struct Corner_Block {
+    float normal[3][CORNER_BLOCK_SIZE];
+    float prev[3][CORNER_BLOCK_SIZE];    // edges from the corner's vertex to the triangle's other two
+    float next[3][CORNER_BLOCK_SIZE];
+    float tangent[3][CORNER_BLOCK_SIZE]; // the triangle's, zero when it's degenerate
+    float flags[CORNER_BLOCK_SIZE];      // the triangle's, passed through to the vertex pass in w
+    Vector4 *out[CORNER_BLOCK_SIZE];
+    int count;
+};
+
+static inline f32xN dot3_wide(f32xN ax, f32xN ay, f32xN az, f32xN bx, f32xN by, f32xN bz) {
+    return f32xN_madd(az, bz, f32xN_madd(ay, by, f32xN_mul(ax, bx)));
+}
+
+// rsqrt_approx() and a Newton step, good to ~22 bits. infinity or NaN for zero, callers mask those out.
+static inline f32xN rsqrt_wide(f32xN x) {
+    f32xN r = f32xN_rsqrt_approx(x);
+    f32xN half_x_r = f32xN_mul(f32xN_mul(f32xN_set1(-0.5f), x), r);
+    return f32xN_mul(r, f32xN_madd(half_x_r, r, f32xN_set1(1.5f)));
+}
+
+// Abramowitz and Stegun 4.4.46, |error| < 2e-8 before float rounding. the corner angles are only
+// weights and acosf() was a good part of the cost.
+static inline f32xN acos_wide(f32xN x) {
+    f32xN a = f32xN_abs(x);
+    f32xN p = f32xN_set1(-0.0012624911f);
+    p = f32xN_madd(p, a, f32xN_set1(0.0066700901f));
+    p = f32xN_madd(p, a, f32xN_set1(-0.0170881256f));
+    p = f32xN_madd(p, a, f32xN_set1(0.0308918810f));
+    p = f32xN_madd(p, a, f32xN_set1(-0.0501743046f));
+    p = f32xN_madd(p, a, f32xN_set1(0.0889789874f));
+    p = f32xN_madd(p, a, f32xN_set1(-0.2145988016f));
+    p = f32xN_madd(p, a, f32xN_set1(1.5707963050f));
+    f32xN result = f32xN_mul(f32xN_sqrt(f32xN_sub(f32xN_set1(1), a)), p);
+    return f32xN_select(f32xN_cmp_lt(x, f32xN_zero()), result, f32xN_sub(f32xN_set1((float)PI), result));
+}
+
+// each corner's tangent projected onto the plane of its vertex normal and weighted by the corner's
+// angle in that plane, into the corner's output for the vertex pass to sum. empties the block.
+static void weight_corner_tangents(Corner_Block *block) {
+    int count = block->count;
+    for (int i = count; i < CORNER_BLOCK_SIZE && i % SIMD_WIDTH != 0; i++) {
+        for (int axis = 0; axis < 3; axis++) {
+            block->normal[axis][i] = block->prev[axis][i] = block->next[axis][i] = block->tangent[axis][i] = 0;
+        }
+        block->flags[i] = 0;
+    }
+
+    f32xN tiny = f32xN_set1(FLT_MIN);
+    f32xN one = f32xN_set1(1);
+    for (int base = 0; base < count; base += SIMD_WIDTH) {
+        f32xN nx = f32xN_load(&block->normal[0][base]);
+        f32xN ny = f32xN_load(&block->normal[1][base]);
+        f32xN nz = f32xN_load(&block->normal[2][base]);
+        f32xN normal_length_sq = dot3_wide(nx, ny, nz, nx, ny, nz);
+        f32xN inverse_length = f32xN_select(f32xN_cmp_gt(normal_length_sq, tiny), one, rsqrt_wide(normal_length_sq));
+        nx = f32xN_mul(nx, inverse_length);
+        ny = f32xN_mul(ny, inverse_length);
+        nz = f32xN_mul(nz, inverse_length);
+
+        // the tangent and both edges minus their components along the normal
+        f32xN v[3][3];
+        float (*sources[3])[CORNER_BLOCK_SIZE] = {block->tangent, block->prev, block->next};
+        for (int j = 0; j < 3; j++) {
+            f32xN x = f32xN_load(&sources[j][0][base]);
+            f32xN y = f32xN_load(&sources[j][1][base]);
+            f32xN z = f32xN_load(&sources[j][2][base]);
+            f32xN d = f32xN_neg(dot3_wide(x, y, z, nx, ny, nz));
+            v[j][0] = f32xN_madd(nx, d, x);
+            v[j][1] = f32xN_madd(ny, d, y);
+            v[j][2] = f32xN_madd(nz, d, z);
+        }
+
+        f32xN tangent_length_sq = dot3_wide(v[0][0], v[0][1], v[0][2], v[0][0], v[0][1], v[0][2]);
+        f32xN edge_lengths_sq = f32xN_mul(dot3_wide(v[1][0], v[1][1], v[1][2], v[1][0], v[1][1], v[1][2]),
+                                          dot3_wide(v[2][0], v[2][1], v[2][2], v[2][0], v[2][1], v[2][2]));
+        f32xN cos_angle = f32xN_mul(dot3_wide(v[1][0], v[1][1], v[1][2], v[2][0], v[2][1], v[2][2]), rsqrt_wide(edge_lengths_sq));
+        cos_angle = f32xN_clamp(cos_angle, f32xN_set1(-1), one);
+        f32xN weight = f32xN_mul(acos_wide(cos_angle), rsqrt_wide(tangent_length_sq));
+        // no projected tangent or a collapsed corner contributes nothing, this also drops the NaNs from zero lengths
+        weight = f32xN_and(f32xN_and(f32xN_cmp_gt(tangent_length_sq, tiny), f32xN_cmp_gt(edge_lengths_sq, tiny)), weight);
+
+        float out[3][SIMD_WIDTH];
+        for (int axis = 0; axis < 3; axis++) {
+            f32xN_store(out[axis], f32xN_mul(v[0][axis], weight));
+        }
+        int lanes = count - base < SIMD_WIDTH ? count - base : SIMD_WIDTH;
+        for (int lane = 0; lane < lanes; lane++) {
+            Vector4 *result = block->out[base + lane];
+            result->x = out[0][lane];
+            result->y = out[1][lane];
+            result->z = out[2][lane];
+            result->w = block->flags[base + lane];
+        }
+    }
+    block->count = 0;
+}
+
+// every triangle's tangent, then each of its corners' share of the vertex's tangent into the corner's
+// output.
+//
+// note(josh): the per-corner part used to be in the vertex pass, where every corner had to gather its
+// triangle and two positions again. here they're already loaded and it goes SIMD_WIDTH corners at
+// a time.
+static void compute_triangle_tangents(void *userdata, int start, int end) {
+    Tangent_Job *job = (Tangent_Job *)userdata;
+    Corner_Block block;
+    block.count = 0;
+    int mesh_index = find_mesh(job->triangle_bases, job->num_meshes, start);
+    for (int i = start; i < end; i++) {
+        while (i >= job->triangle_bases[mesh_index+1]) {
+            mesh_index += 1;
+        }
+        Tangent_Mesh *mesh = &job->meshes[mesh_index];
+        u32 *corner = &mesh->indices[(i - job->triangle_bases[mesh_index]) * 3];
+
+        Vector3 positions[3];
+        for (int k = 0; k < 3; k++) {
+            positions[k] = read_float3(mesh->positions, mesh->vertex_stride, corner[k]);
+        }
+        Vector2 uv0 = read_float2(mesh->tex_coords, mesh->vertex_stride, corner[0]);
+        Vector2 uv1 = read_float2(mesh->tex_coords, mesh->vertex_stride, corner[1]);
+        Vector2 uv2 = read_float2(mesh->tex_coords, mesh->vertex_stride, corner[2]);
+
+        Vector3 d1 = sub3(positions[1], positions[0]);
+        Vector3 d2 = sub3(positions[2], positions[0]);
+        float st1_x = uv1.x - uv0.x;
+        float st1_y = uv1.y - uv0.y;
+        float st2_x = uv2.x - uv0.x;
+        float st2_y = uv2.y - uv0.y;
+        float signed_area = st1_x * st2_y - st2_x * st1_y;
+        Vector3 tangent = sub3(scale3(d1, st2_y), scale3(d2, st1_y));
+        float tangent_length = sqrtf(dot3(tangent, tangent));
+
+        // already flipped for mirrored triangles like MikkTSpace's vOs
+        u32 flags = signed_area < 0 ? TANGENT_FRAME_MIRRORED : 0;
+        if (not_zero(signed_area) && not_zero(tangent_length)) {
+            tangent = scale3(tangent, (signed_area < 0 ? -1.0f : 1.0f) / tangent_length);
+        }
+        else {
+            tangent = {};
+            flags |= TANGENT_FRAME_DEGENERATE;
+        }
+
+        for (int k = 0; k < 3; k++) {
+            int slot = block.count++;
+            Vector3 normal = read_float3(mesh->normals, mesh->vertex_stride, corner[k]);
+            Vector3 prev = sub3(positions[(k + 2) % 3], positions[k]);
+            Vector3 next = sub3(positions[(k + 1) % 3], positions[k]);
+            block.normal[0][slot]  = normal.x;   block.normal[1][slot]  = normal.y;   block.normal[2][slot]  = normal.z;
+            block.prev[0][slot]    = prev.x;     block.prev[1][slot]    = prev.y;     block.prev[2][slot]    = prev.z;
+            block.next[0][slot]    = next.x;     block.next[1][slot]    = next.y;     block.next[2][slot]    = next.z;
+            block.tangent[0][slot] = tangent.x;  block.tangent[1][slot] = tangent.y;  block.tangent[2][slot] = tangent.z;
+            block.flags[slot] = (float)flags;
+            block.out[slot] = &mesh->out_tangents[corner + k - mesh->indices];
+        }
+        if (block.count == CORNER_BLOCK_SIZE) {
+            weight_corner_tangents(&block);
+        }
+    }
+    weight_corner_tangents(&block);
+}
+
+// counting sort of each mesh's corners by vertex. a mesh only writes its own vertices' entries so
+// the meshes can go in parallel.
+static void build_vertex_corners(void *userdata, int start, int end) {
+    Tangent_Job *job = (Tangent_Job *)userdata;
+    for (int mesh_index = start; mesh_index < end; mesh_index++) {
+        Tangent_Mesh *mesh = &job->meshes[mesh_index];
+        int *offsets = &job->corner_offsets[job->vertex_bases[mesh_index]];
+        int *cursors = &job->corner_cursors[job->vertex_bases[mesh_index]];
+        memset(cursors, 0, sizeof(int) * mesh->num_vertices);
+        for (int i = 0; i < mesh->num_indices; i++) {
+            assert(mesh->indices[i] < (u32)mesh->num_vertices);
+            cursors[mesh->indices[i]] += 1;
+        }
+        int offset = job->triangle_bases[mesh_index] * 3;
+        for (int v = 0; v < mesh->num_vertices; v++) {
+            offsets[v] = offset;
+            offset += cursors[v];
+            cursors[v] = offsets[v];
+        }
+        for (int i = 0; i < mesh->num_indices; i += 3) {
+            u32 *triangle = &mesh->indices[i];
+            for (int k = 0; k < 3; k++) {
+                Vertex_Corner *vertex_corner = &job->vertex_corners[cursors[triangle[k]]++];
+                vertex_corner->corner = (u32)(i + k);
+                vertex_corner->prev = triangle[(k + 2) % 3];
+                vertex_corner->next = triangle[(k + 1) % 3];
+            }
+        }
+    }
+}
+
+// union-find over a vertex's corners, the lowest one in a group is its root
+static int find_group(Corner_Group *groups, int c) {
+    while (groups[c].group != c) {
+        groups[c].group = groups[groups[c].group].group;
+        c = groups[c].group;
+    }
+    return c;
+}
+
+// each vertex writes the corners that use it, so no two threads ever touch the same output.
+//
+// note(josh): the corners of a vertex are grouped like MikkTSpace does: two corners are in the same
+// group if they're on the same side of a UV mirror and their triangles share an edge at the vertex.
+// every group gets its own frame.
+static void compute_vertex_tangents(void *userdata, int start, int end) {
+    Tangent_Job *job = (Tangent_Job *)userdata;
+    Vertex_Corner *corners = job->vertex_corners;
+    Corner_Group *groups = job->corner_groups;
+    int mesh_index = find_mesh(job->vertex_bases, job->num_meshes, start);
+    for (int i = start; i < end; i++) {
+        while (i >= job->vertex_bases[mesh_index+1]) {
+            mesh_index += 1;
+        }
+        Tangent_Mesh *mesh = &job->meshes[mesh_index];
+        int first_corner = job->corner_offsets[i];
+        int end_corner = job->corner_cursors[i]; // build_vertex_corners() leaves them at the end of each vertex's range
+        if (first_corner == end_corner) {
+            continue;
+        }
+
+        // compute_triangle_tangents() left the weighted tangent in xyz and the triangle's flags in w
+        for (int c = first_corner; c < end_corner; c++) {
+            Vector4 weighted = mesh->out_tangents[corners[c].corner];
+            groups[c].sum.x = weighted.x;
+            groups[c].sum.y = weighted.y;
+            groups[c].sum.z = weighted.z;
+            groups[c].flags = (u32)weighted.w;
+            groups[c].group = c;
+        }
+
+        // the edge from a corner to its next vertex is the same edge as the one from another corner's
+        // previous vertex, when the triangles are wound the same way. looking at every ordered pair
+        // finds each shared edge from one side or the other.
+        for (int a = first_corner; a < end_corner; a++) {
+            if (groups[a].flags & TANGENT_FRAME_DEGENERATE) {
+                continue;
+            }
+            u32 next = corners[a].next;
+            for (int b = first_corner; b < end_corner; b++) {
+                if (corners[b].prev == next && groups[b].flags == groups[a].flags) {
+                    int root_a = find_group(groups, a);
+                    int root_b = find_group(groups, b);
+                    if (root_a < root_b) groups[root_b].group = root_a;
+                    else                 groups[root_a].group = root_b;
+                }
+            }
+        }
+        for (int c = first_corner; c < end_corner; c++) {
+            int root = find_group(groups, c);
+            groups[c].group = root;
+            if (root != c) {
+                groups[root].sum.x += groups[c].sum.x;
+                groups[root].sum.y += groups[c].sum.y;
+                groups[root].sum.z += groups[c].sum.z;
+            }
+        }
+
+        // degenerate triangles take the frame of the first unmirrored group, or the first mirrored one if there aren't any
+        Vector3 normal = read_float3(mesh->normals, mesh->vertex_stride, (u32)(i - job->vertex_bases[mesh_index]));
+        int fallback = -1;
+        for (int c = first_corner; c < end_corner; c++) {
+            if (groups[c].group != c || (groups[c].flags & TANGENT_FRAME_DEGENERATE)) {
+                continue;
+            }
+            float sum_length_sq = dot3(groups[c].sum, groups[c].sum);
+            groups[c].sum = not_zero(sum_length_sq) ? scale3(groups[c].sum, 1.0f / sqrtf(sum_length_sq)) : perpendicular_tangent(normal);
+            if (fallback == -1 || ((groups[fallback].flags & TANGENT_FRAME_MIRRORED) && !(groups[c].flags & TANGENT_FRAME_MIRRORED))) {
+                fallback = c;
+            }
+        }
+        for (int c = first_corner; c < end_corner; c++) {
+            int frame = (groups[c].flags & TANGENT_FRAME_DEGENERATE) ? fallback : groups[c].group; // the summing loop pointed every corner at its root
+            Vector3 tangent = frame != -1 ? groups[frame].sum : perpendicular_tangent(normal);
+            Vector4 *result = &mesh->out_tangents[corners[c].corner];
+            result->x = tangent.x;
+            result->y = tangent.y;
+            result->z = tangent.z;
+            result->w = frame != -1 && (groups[frame].flags & TANGENT_FRAME_MIRRORED) ? -1.0f : 1.0f;
+        }
+    }
+}
+
+void generate_tangents(Tangent_Mesh *meshes, int num_meshes) {
+    Tangent_Job job = {};
+    job.meshes = meshes;
+    job.num_meshes = num_meshes;
+    job.triangle_bases = (int *)alloc(default_allocator(), sizeof(int) * (num_meshes + 1));
+    defer(free(default_allocator(), job.triangle_bases));
+    job.vertex_bases = (int *)alloc(default_allocator(), sizeof(int) * (num_meshes + 1));
+    defer(free(default_allocator(), job.vertex_bases));
+
+    job.triangle_bases[0] = 0;
+    job.vertex_bases[0] = 0;
+    for (int i = 0; i < num_meshes; i++) {
+        assert(meshes[i].num_indices % 3 == 0);
+        job.triangle_bases[i+1] = job.triangle_bases[i] + meshes[i].num_indices / 3;
+        job.vertex_bases[i+1] = job.vertex_bases[i] + meshes[i].num_vertices;
+    }
+    int num_triangles = job.triangle_bases[num_meshes];
+    int num_vertices = job.vertex_bases[num_meshes];
+    if (num_triangles == 0) {
+        return;
+    }
+
+    job.corner_offsets = (int *)alloc(default_allocator(), sizeof(int) * (num_vertices > 0 ? num_vertices : 1));
+    defer(free(default_allocator(), job.corner_offsets));
+    job.corner_cursors = (int *)alloc(default_allocator(), sizeof(int) * (num_vertices > 0 ? num_vertices : 1));
+    defer(free(default_allocator(), job.corner_cursors));
+    job.vertex_corners = (Vertex_Corner *)alloc(default_allocator(), sizeof(Vertex_Corner) * num_triangles * 3);
+    defer(free(default_allocator(), job.vertex_corners));
+    job.corner_groups = (Corner_Group *)alloc(default_allocator(), sizeof(Corner_Group) * num_triangles * 3);
+    defer(free(default_allocator(), job.corner_groups));
+
+    parallel_for(num_triangles, 16 * 1024, compute_triangle_tangents, &job);
+    parallel_for(num_meshes, 1, build_vertex_corners, &job);
+    parallel_for(num_vertices, 8 * 1024, compute_vertex_tangents, &job);
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "basic.h"
+#include "math.h"
+
+//
+// Tangent frames for normal mapping, generated the way MikkTSpace (Mikkelsen 2008) does so they
+// match what the tools that bake our normal maps used:
+//
+//   - every triangle gets the direction u increases along it, normalized, and whether its UVs are
+//     mirrored (negative UV area)
+//   - at each vertex the triangles are grouped: two are in the same group if they have the same
+//     orientation and share an edge there. each one's tangent is projected onto the plane of the
+//     vertex normal, weighted by the angle of its corner and each group's sum normalized
+//   - the bitangent is sign * cross(normal, tangent), sign is -1 for the mirrored side
+//
+// Like MikkTSpace the result is per corner of each triangle rather than per vertex, since a vertex
+// where mirrored and unmirrored triangles meet, or where two fans only touch at a point, needs more
+// than one frame. The caller splits those vertices.
+//
+// One place this is looser than the reference: triangles with no UV area take the frame of the
+// vertex's first group instead of being chained through their neighbours. benchmark --check compares
+// the output with frames worked out by hand for a few test meshes.
+//
+// Every mesh given to one generate_tangents() call is done together, each pass is a single
+// parallel_for over the triangles or vertices of all of them, so lots of small meshes spread across
+// threads as well as one big one.
+//
+
+struct Tangent_Mesh {
+    u32 *indices;          // triangle list, must be indexed
+    int num_indices;
+    void *positions;       // float3s vertex_stride bytes apart
+    void *normals;         // float3s, don't have to be unit length
+    void *tex_coords;      // float2s
+    int num_vertices;
+    int vertex_stride;
+
+    Vector4 *out_tangents; // num_indices of them, one per corner. xyz is the unit tangent, w the bitangent sign
+};
+
+void generate_tangents(Tangent_Mesh *meshes, int num_meshes);
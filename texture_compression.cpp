@@ -0,0 +1,1226 @@
+#include "texture_compression.h"
+#include "simd.h"
+#include "threading.h"
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+static_assert(16 % SIMD_WIDTH == 0, "the block kernels assume 16 pixels split evenly into f32xN lanes");
+
+const char *image_format_name(Image_Format format) {
+    switch (format) {
+        case IMAGE_FORMAT_RGBA8: return "RGBA8";
+        case IMAGE_FORMAT_BC1:   return "BC1";
+        case IMAGE_FORMAT_BC3:   return "BC3";
+        case IMAGE_FORMAT_BC4:   return "BC4";
+        case IMAGE_FORMAT_BC5:   return "BC5";
+        case IMAGE_FORMAT_BC7:   return "BC7";
+        default:                 return "invalid";
+    }
+}
+
+int image_format_block_dimension(Image_Format format) {
+    return format == IMAGE_FORMAT_RGBA8 ? 1 : 4;
+}
+
+int image_format_block_size(Image_Format format) {
+    switch (format) {
+        case IMAGE_FORMAT_RGBA8: return 4;
+        case IMAGE_FORMAT_BC1:   return 8;
+        case IMAGE_FORMAT_BC4:   return 8;
+        case IMAGE_FORMAT_BC3:   return 16;
+        case IMAGE_FORMAT_BC5:   return 16;
+        case IMAGE_FORMAT_BC7:   return 16;
+        default: {
+            assert(false);
+            return 0;
+        }
+    }
+}
+
+i64 image_row_pitch(Image_Format format, int width) {
+    int dimension = image_format_block_dimension(format);
+    return (i64)((width + dimension - 1) / dimension) * image_format_block_size(format);
+}
+
+i64 image_level_size(Image_Format format, int width, int height) {
+    int dimension = image_format_block_dimension(format);
+    return image_row_pitch(format, width) * ((height + dimension - 1) / dimension);
+}
+
+
+
+//
+// Block fitting, shared by all the encoders.
+//
+// Pixels are floats in [0, 255]. A Block_Channels picks which of a block's channels an encoder is
+// fitting, in order, so BC4 fits one of them, BC1 the first three, and BC7 mode 5 the rotated ones
+// without copying anything.
+//
+
+struct Block_Pixels {
+    float channels[4][16]; // SoA, pixel i of the block is row i/4, column i%4
+};
+
+struct Block_Channels {
+    float *channels[4];
+    int count;
+    int num_pixels; // 16 unless it's one subset of a partitioned block, the rest of the lanes are ignored
+};
+
+struct Block_Palette {
+    float colors[16][4];
+    int count;
+};
+
+static Block_Channels block_channels(Block_Pixels *block, int first, int count) {
+    Block_Channels result = {};
+    for (int i = 0; i < count; i++) {
+        result.channels[i] = block->channels[first + i];
+    }
+    result.count = count;
+    result.num_pixels = 16;
+    return result;
+}
+
+static void load_block(byte *pixels, int width, int height, int row_pitch, int block_x, int block_y, Block_Pixels *out_block) {
+    for (int y = 0; y < 4; y++) {
+        int py = block_y * 4 + y;
+        if (py >= height) py = height - 1;
+        byte *row = pixels + (i64)py * row_pitch;
+        for (int x = 0; x < 4; x++) {
+            int px = block_x * 4 + x;
+            if (px >= width) px = width - 1;
+            for (int c = 0; c < 4; c++) {
+                out_block->channels[c][y * 4 + x] = (float)row[px * 4 + c];
+            }
+        }
+    }
+}
+
+static inline int quantize(float value, int max) {
+    int q = (int)(value + 0.5f);
+    if (q < 0) q = 0;
+    if (q > max) q = max;
+    return q;
+}
+
+// Endpoints at either end of the block's principal axis, found by power iteration on the
+// covariance. For a flat block both are the mean.
+static void principal_endpoints(Block_Channels block, float out_e0[4], float out_e1[4]) {
+    int n = block.count;
+    float mean[4] = {};
+    for (int c = 0; c < n; c++) {
+        for (int i = 0; i < block.num_pixels; i++) mean[c] += block.channels[c][i];
+        mean[c] /= block.num_pixels;
+    }
+
+    float covariance[4][4] = {};
+    for (int i = 0; i < block.num_pixels; i++) {
+        float d[4];
+        for (int c = 0; c < n; c++) d[c] = block.channels[c][i] - mean[c];
+        for (int a = 0; a < n; a++) {
+            for (int b = a; b < n; b++) {
+                covariance[a][b] += d[a] * d[b];
+            }
+        }
+    }
+    for (int a = 0; a < n; a++) {
+        for (int b = 0; b < a; b++) {
+            covariance[a][b] = covariance[b][a];
+        }
+    }
+
+    // note(josh): starting from the row with the largest variance can't be orthogonal to the axis
+    int start = 0;
+    for (int c = 1; c < n; c++) {
+        if (covariance[c][c] > covariance[start][start]) start = c;
+    }
+    float axis[4] = {};
+    for (int c = 0; c < n; c++) axis[c] = covariance[start][c];
+    for (int iteration = 0; iteration < 8; iteration++) {
+        float next[4] = {};
+        float largest = 0;
+        for (int a = 0; a < n; a++) {
+            for (int b = 0; b < n; b++) next[a] += covariance[a][b] * axis[b];
+            if (fabsf(next[a]) > largest) largest = fabsf(next[a]);
+        }
+        if (largest < 1e-12f) break;
+        for (int c = 0; c < n; c++) axis[c] = next[c] / largest;
+    }
+    float length_squared = 0;
+    for (int c = 0; c < n; c++) length_squared += axis[c] * axis[c];
+
+    float t_min = 0;
+    float t_max = 0;
+    if (length_squared > 1e-12f) {
+        float inverse_length = 1.0f / sqrtf(length_squared);
+        for (int c = 0; c < n; c++) axis[c] *= inverse_length;
+        t_min = FLT_MAX;
+        t_max = -FLT_MAX;
+        for (int i = 0; i < block.num_pixels; i++) {
+            float t = 0;
+            for (int c = 0; c < n; c++) t += (block.channels[c][i] - mean[c]) * axis[c];
+            if (t < t_min) t_min = t;
+            if (t > t_max) t_max = t;
+        }
+    }
+    for (int c = 0; c < n; c++) {
+        out_e0[c] = fminf(fmaxf(mean[c] + axis[c] * t_min, 0), 255);
+        out_e1[c] = fminf(fmaxf(mean[c] + axis[c] * t_max, 0), 255);
+    }
+}
+
+// Closest palette entry for every pixel, returns the summed squared error.
+static float select_indices(Block_Channels block, Block_Palette *palette, u8 *out_indices) {
+    float total_error = 0;
+    for (int lane = 0; lane < 16; lane += SIMD_WIDTH) {
+        f32xN pixel[4];
+        for (int c = 0; c < block.count; c++) {
+            pixel[c] = f32xN_load(block.channels[c] + lane);
+        }
+        f32xN best_error = f32xN_set1(FLT_MAX);
+        f32xN best_index = f32xN_zero();
+        for (int entry = 0; entry < palette->count; entry++) {
+            f32xN error = f32xN_zero();
+            for (int c = 0; c < block.count; c++) {
+                f32xN d = f32xN_sub(pixel[c], f32xN_set1(palette->colors[entry][c]));
+                error = f32xN_madd(d, d, error);
+            }
+            f32xN closer = f32xN_cmp_lt(error, best_error);
+            best_error = f32xN_select(closer, best_error, error);
+            best_index = f32xN_select(closer, best_index, f32xN_set1((float)entry));
+        }
+        float errors[SIMD_WIDTH];
+        float indices[SIMD_WIDTH];
+        f32xN_store(errors, best_error);
+        f32xN_store(indices, best_index);
+        for (int i = 0; i < SIMD_WIDTH; i++) {
+            if (lane + i < block.num_pixels) total_error += errors[i];
+            out_indices[lane + i] = (u8)indices[i];
+        }
+    }
+    return total_error;
+}
+
+// select_indices() for a palette whose entries are spaced round(i * 64 / (count - 1)) / 64 along the
+// line between its first and last entry, which is every BC7 palette. Each pixel is projected onto the
+// line and rounded to the nearest step, instead of being tested against every entry. Where rounding
+// the endpoints moved the palette slightly off the line, this sometimes picks the second best entry.
+// The error also assumes an exact lerp instead of BC7's integer interpolation, so it's off by a little.
+static float select_indices_projected(Block_Channels block, Block_Palette *palette, u8 *out_indices) {
+    int last = palette->count - 1;
+    float *e0 = palette->colors[0];
+    float *e1 = palette->colors[last];
+    float length_squared = 0;
+    for (int c = 0; c < block.count; c++) length_squared += (e1[c] - e0[c]) * (e1[c] - e0[c]);
+    // note(josh): a flat palette projects everything onto index 0
+    float t_scale = length_squared > 0 ? last / length_squared : 0;
+
+    f32xN zero = f32xN_zero();
+    f32xN max_step = f32xN_set1((float)last);
+    f32xN step_to_weight = f32xN_set1(64.0f / last);
+    f32xN half = f32xN_set1(0.5f);
+    f32xN inverse_64 = f32xN_set1(1.0f / 64);
+    float total_error = 0;
+    for (int lane = 0; lane < 16; lane += SIMD_WIDTH) {
+        f32xN pixel[4];
+        f32xN t = zero;
+        for (int c = 0; c < block.count; c++) {
+            pixel[c] = f32xN_sub(f32xN_load(block.channels[c] + lane), f32xN_set1(e0[c]));
+            t = f32xN_madd(pixel[c], f32xN_set1(e1[c] - e0[c]), t);
+        }
+        f32xN step = f32xN_clamp(f32xN_round(f32xN_mul(t, f32xN_set1(t_scale))), zero, max_step);
+        f32xN weight = f32xN_mul(f32xN_floor(f32xN_madd(step, step_to_weight, half)), inverse_64);
+        f32xN error = zero;
+        for (int c = 0; c < block.count; c++) {
+            f32xN d = f32xN_sub(pixel[c], f32xN_mul(weight, f32xN_set1(e1[c] - e0[c])));
+            error = f32xN_madd(d, d, error);
+        }
+        float errors[SIMD_WIDTH];
+        float indices[SIMD_WIDTH];
+        f32xN_store(errors, error);
+        f32xN_store(indices, step);
+        for (int i = 0; i < SIMD_WIDTH; i++) {
+            if (lane + i < block.num_pixels) total_error += errors[i];
+            out_indices[lane + i] = (u8)indices[i];
+        }
+    }
+    return total_error;
+}
+
+// Least squares endpoints for fixed indices, where index k stands for lerp(e0, e1, weights[k]).
+// Returns false if the indices don't pin down a line, e.g. when they're all the same.
+static bool refine_endpoints(Block_Channels block, u8 *indices, float *weights, float out_e0[4], float out_e1[4]) {
+    float aa = 0, ab = 0, bb = 0;
+    float ax[4] = {};
+    float bx[4] = {};
+    for (int i = 0; i < block.num_pixels; i++) {
+        float b = weights[indices[i]];
+        float a = 1 - b;
+        aa += a * a;
+        ab += a * b;
+        bb += b * b;
+        for (int c = 0; c < block.count; c++) {
+            ax[c] += a * block.channels[c][i];
+            bx[c] += b * block.channels[c][i];
+        }
+    }
+    float determinant = aa * bb - ab * ab;
+    if (fabsf(determinant) < 1e-6f) {
+        return false;
+    }
+    float inverse = 1.0f / determinant;
+    for (int c = 0; c < block.count; c++) {
+        out_e0[c] = fminf(fmaxf((ax[c] * bb - bx[c] * ab) * inverse, 0), 255);
+        out_e1[c] = fminf(fmaxf((bx[c] * aa - ax[c] * ab) * inverse, 0), 255);
+    }
+    return true;
+}
+
+static int num_refinements(Compression_Quality quality) {
+    switch (quality) {
+        case COMPRESSION_QUALITY_FAST:   return 0;
+        case COMPRESSION_QUALITY_NORMAL: return 1;
+        default:                         return 3;
+    }
+}
+
+// note(josh): bits are written from the bottom of the block up, like the BC7 spec numbers them
+struct Block_Bits {
+    u64 words[2];
+    int position;
+};
+
+// count is at most 32. a field can straddle the two words, then its top bits go in the second one.
+static void write_bits(Block_Bits *bits, u32 value, int count) {
+    u64 field = value & ((1ull << count) - 1);
+    int word = bits->position / 64;
+    int shift = bits->position % 64;
+    bits->words[word] |= field << shift;
+    if (shift + count > 64) {
+        bits->words[word + 1] |= field >> (64 - shift);
+    }
+    bits->position += count;
+}
+
+static u32 read_bits(Block_Bits *bits, int count) {
+    int word = bits->position / 64;
+    int shift = bits->position % 64;
+    u64 field = bits->words[word] >> shift;
+    if (shift + count > 64) {
+        field |= bits->words[word + 1] << (64 - shift);
+    }
+    bits->position += count;
+    return (u32)(field & ((1ull << count) - 1));
+}
+
+static void store_u64(byte *out, u64 value) {
+    for (int i = 0; i < 8; i++) out[i] = (byte)(value >> (i * 8));
+}
+
+static u64 load_u64(byte *in) {
+    u64 value = 0;
+    for (int i = 0; i < 8; i++) value |= (u64)in[i] << (i * 8);
+    return value;
+}
+
+
+
+//
+// BC1
+//
+
+static void unpack_565(u16 color, int out[3]) {
+    int r = (color >> 11) & 31;
+    int g = (color >> 5) & 63;
+    int b = color & 31;
+    out[0] = (r << 3) | (r >> 2);
+    out[1] = (g << 2) | (g >> 4);
+    out[2] = (b << 3) | (b >> 2);
+}
+
+static u16 pack_565(float color[4]) {
+    return (u16)((quantize(color[0] * (31.0f / 255.0f), 31) << 11) | (quantize(color[1] * (63.0f / 255.0f), 63) << 5) | quantize(color[2] * (31.0f / 255.0f), 31));
+}
+
+// four_color is what BC3's color block always is and what BC1 is when c0 > c1
+static void bc1_palette(u16 c0, u16 c1, bool four_color, int out_palette[4][4]) {
+    unpack_565(c0, out_palette[0]);
+    unpack_565(c1, out_palette[1]);
+    for (int c = 0; c < 3; c++) {
+        int a = out_palette[0][c];
+        int b = out_palette[1][c];
+        if (four_color) {
+            out_palette[2][c] = (2 * a + b) / 3;
+            out_palette[3][c] = (a + 2 * b) / 3;
+        }
+        else {
+            out_palette[2][c] = (a + b) / 2;
+            out_palette[3][c] = 0;
+        }
+    }
+    out_palette[0][3] = out_palette[1][3] = out_palette[2][3] = 255;
+    out_palette[3][3] = four_color ? 255 : 0;
+}
+
+static void encode_bc1_block(Block_Pixels *pixels, Compression_Quality quality, byte *out) {
+    Block_Channels block = block_channels(pixels, 0, 3);
+    static float weights[4] = {0, 1, 1.0f / 3, 2.0f / 3};
+
+    float e0[4], e1[4];
+    principal_endpoints(block, e0, e1);
+    float best_error = FLT_MAX;
+    u16 best_c0 = 0;
+    u16 best_c1 = 0;
+    u8 best_indices[16] = {};
+    int refinements = num_refinements(quality);
+    for (int iteration = 0; iteration <= refinements; iteration++) {
+        u16 c0 = pack_565(e0);
+        u16 c1 = pack_565(e1);
+        int palette_colors[4][4];
+        bc1_palette(c0, c1, true, palette_colors);
+        Block_Palette palette = {};
+        palette.count = 4;
+        for (int entry = 0; entry < 4; entry++) {
+            for (int c = 0; c < 3; c++) palette.colors[entry][c] = (float)palette_colors[entry][c];
+        }
+        u8 indices[16];
+        float error = select_indices(block, &palette, indices);
+        if (error < best_error) {
+            best_error = error;
+            best_c0 = c0;
+            best_c1 = c1;
+            memcpy(best_indices, indices, sizeof(indices));
+        }
+        if (iteration == refinements || best_error == 0 || !refine_endpoints(block, indices, weights, e0, e1)) {
+            break;
+        }
+    }
+
+    // note(josh): c0 > c1 selects four color mode, swapping the endpoints swaps index 0 with 1 and 2 with 3.
+    // equal endpoints would decode as three color mode where index 3 is black, so everything goes on 0.
+    if (best_c0 < best_c1) {
+        u16 swap = best_c0;
+        best_c0 = best_c1;
+        best_c1 = swap;
+        for (int i = 0; i < 16; i++) best_indices[i] ^= 1;
+    }
+    else if (best_c0 == best_c1) {
+        memset(best_indices, 0, sizeof(best_indices));
+    }
+
+    u32 index_bits = 0;
+    for (int i = 0; i < 16; i++) index_bits |= (u32)best_indices[i] << (i * 2);
+    out[0] = (byte)best_c0;
+    out[1] = (byte)(best_c0 >> 8);
+    out[2] = (byte)best_c1;
+    out[3] = (byte)(best_c1 >> 8);
+    memcpy(out + 4, &index_bits, sizeof(index_bits));
+}
+
+static void decode_bc1_block(byte *in, bool force_four_color, byte out_pixels[16][4]) {
+    u16 c0 = (u16)(in[0] | (in[1] << 8));
+    u16 c1 = (u16)(in[2] | (in[3] << 8));
+    u32 index_bits;
+    memcpy(&index_bits, in + 4, sizeof(index_bits));
+    int palette[4][4];
+    bc1_palette(c0, c1, force_four_color || c0 > c1, palette);
+    for (int i = 0; i < 16; i++) {
+        int index = (index_bits >> (i * 2)) & 3;
+        for (int c = 0; c < 4; c++) out_pixels[i][c] = (byte)palette[index][c];
+    }
+}
+
+
+
+//
+// BC4
+//
+
+// r0 > r1 is eight interpolated values, otherwise six plus 0 and 255
+static void bc4_palette(int r0, int r1, int out_palette[8]) {
+    out_palette[0] = r0;
+    out_palette[1] = r1;
+    if (r0 > r1) {
+        for (int i = 1; i < 7; i++) out_palette[i + 1] = ((7 - i) * r0 + i * r1 + 3) / 7;
+    }
+    else {
+        for (int i = 1; i < 5; i++) out_palette[i + 1] = ((5 - i) * r0 + i * r1 + 2) / 5;
+        out_palette[6] = 0;
+        out_palette[7] = 255;
+    }
+}
+
+static float bc4_try_endpoints(Block_Channels block, int r0, int r1, u8 *out_indices) {
+    int values[8];
+    bc4_palette(r0, r1, values);
+    Block_Palette palette = {};
+    palette.count = 8;
+    for (int i = 0; i < 8; i++) palette.colors[i][0] = (float)values[i];
+    return select_indices(block, &palette, out_indices);
+}
+
+static void encode_bc4_block(Block_Pixels *pixels, int channel, Compression_Quality quality, byte *out) {
+    Block_Channels block = block_channels(pixels, channel, 1);
+    static float weights[8] = {0, 1, 1.0f / 7, 2.0f / 7, 3.0f / 7, 4.0f / 7, 5.0f / 7, 6.0f / 7};
+
+    float *values = block.channels[0];
+    float low = 255;
+    float high = 0;
+    for (int i = 0; i < 16; i++) {
+        low = fminf(low, values[i]);
+        high = fmaxf(high, values[i]);
+    }
+
+    int best_r0 = (int)high;
+    int best_r1 = (int)low;
+    u8 best_indices[16] = {};
+    float best_error = 0;
+    if (high > low) {
+        best_error = bc4_try_endpoints(block, best_r0, best_r1, best_indices);
+        int refinements = num_refinements(quality);
+        u8 indices[16];
+        memcpy(indices, best_indices, sizeof(indices));
+        for (int iteration = 0; iteration < refinements && best_error > 0; iteration++) {
+            float e0[4], e1[4];
+            if (!refine_endpoints(block, indices, weights, e0, e1)) {
+                break;
+            }
+            int r0 = quantize(e0[0], 255);
+            int r1 = quantize(e1[0], 255);
+            if (r0 <= r1) {
+                break;
+            }
+            float error = bc4_try_endpoints(block, r0, r1, indices);
+            if (error >= best_error) {
+                break;
+            }
+            best_error = error;
+            best_r0 = r0;
+            best_r1 = r1;
+            memcpy(best_indices, indices, sizeof(indices));
+        }
+
+        if (quality == COMPRESSION_QUALITY_BEST) {
+            // note(josh): a small search around the fit, and six value mode which is exact on 0 and 255 and
+            // spends its interpolated values on what's between, which is what masks and AO tend to look like
+            int center_r0 = best_r0;
+            int center_r1 = best_r1;
+            for (int d0 = -2; d0 <= 2; d0++) {
+                for (int d1 = -2; d1 <= 2; d1++) {
+                    int r0 = center_r0 + d0;
+                    int r1 = center_r1 + d1;
+                    if ((d0 == 0 && d1 == 0) || r0 > 255 || r1 < 0 || r0 <= r1) continue;
+                    float error = bc4_try_endpoints(block, r0, r1, indices);
+                    if (error < best_error) {
+                        best_error = error;
+                        best_r0 = r0;
+                        best_r1 = r1;
+                        memcpy(best_indices, indices, sizeof(indices));
+                    }
+                }
+            }
+
+            float inner_low = 255;
+            float inner_high = 0;
+            for (int i = 0; i < 16; i++) {
+                if (values[i] > 0 && values[i] < 255) {
+                    inner_low = fminf(inner_low, values[i]);
+                    inner_high = fmaxf(inner_high, values[i]);
+                }
+            }
+            if (inner_low <= inner_high) {
+                float error = bc4_try_endpoints(block, (int)inner_low, (int)inner_high, indices);
+                if (error < best_error) {
+                    best_error = error;
+                    best_r0 = (int)inner_low;
+                    best_r1 = (int)inner_high;
+                    memcpy(best_indices, indices, sizeof(indices));
+                }
+            }
+        }
+    }
+
+    u64 index_bits = 0;
+    for (int i = 0; i < 16; i++) index_bits |= (u64)best_indices[i] << (i * 3);
+    out[0] = (byte)best_r0;
+    out[1] = (byte)best_r1;
+    for (int i = 0; i < 6; i++) out[2 + i] = (byte)(index_bits >> (i * 8));
+}
+
+static void decode_bc4_block(byte *in, int channel, byte out_pixels[16][4]) {
+    int palette[8];
+    bc4_palette(in[0], in[1], palette);
+    u64 index_bits = 0;
+    for (int i = 0; i < 6; i++) index_bits |= (u64)in[2 + i] << (i * 8);
+    for (int i = 0; i < 16; i++) {
+        out_pixels[i][channel] = (byte)palette[(index_bits >> (i * 3)) & 7];
+    }
+}
+
+
+
+//
+// BC7, modes 1, 5 and 6. See the BC7 format description in the D3D11 functional spec.
+//
+
+static int bc7_weights_2[4]  = {0, 21, 43, 64};
+static int bc7_weights_4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+static inline int bc7_interpolate(int a, int b, int weight) {
+    return ((64 - weight) * a + weight * b + 32) >> 6;
+}
+
+static void bc7_palette(int e0[4], int e1[4], int num_channels, int *weights, int num_weights, Block_Palette *out_palette) {
+    out_palette->count = num_weights;
+    for (int i = 0; i < num_weights; i++) {
+        for (int c = 0; c < num_channels; c++) {
+            out_palette->colors[i][c] = (float)bc7_interpolate(e0[c], e1[c], weights[i]);
+        }
+    }
+}
+
+// note(josh): the first pixel's index has its top bit implied zero, flipping the line around fixes that
+static void bc7_fix_anchor(int e0[4], int e1[4], int num_channels, u8 *indices, int num_weights) {
+    if (indices[0] < num_weights / 2) {
+        return;
+    }
+    for (int c = 0; c < num_channels; c++) {
+        int swap = e0[c];
+        e0[c] = e1[c];
+        e1[c] = swap;
+    }
+    for (int i = 0; i < 16; i++) indices[i] = (u8)(num_weights - 1 - indices[i]);
+}
+
+struct Bc7_Mode_6 {
+    int endpoints[2][4]; // 7 bits each
+    int p_bits[2];
+    u8 indices[16];
+    float error;
+};
+
+// endpoint with a shared lowest bit p, returns the squared error it adds
+static float bc7_quantize_with_p_bit(float e[4], int p, int out_endpoint[4]) {
+    float error = 0;
+    for (int c = 0; c < 4; c++) {
+        out_endpoint[c] = quantize((e[c] - p) * 0.5f, 127);
+        float d = (float)((out_endpoint[c] << 1) | p) - e[c];
+        error += d * d;
+    }
+    return error;
+}
+
+static void bc7_try_mode_6(Block_Channels block, float e0[4], float e1[4], int p0, int p1, Compression_Quality quality, Bc7_Mode_6 *best) {
+    Bc7_Mode_6 candidate = {};
+    candidate.p_bits[0] = p0;
+    candidate.p_bits[1] = p1;
+    bc7_quantize_with_p_bit(e0, p0, candidate.endpoints[0]);
+    bc7_quantize_with_p_bit(e1, p1, candidate.endpoints[1]);
+    int full[2][4];
+    for (int c = 0; c < 4; c++) {
+        full[0][c] = (candidate.endpoints[0][c] << 1) | p0;
+        full[1][c] = (candidate.endpoints[1][c] << 1) | p1;
+    }
+    Block_Palette palette = {};
+    bc7_palette(full[0], full[1], 4, bc7_weights_4, 16, &palette);
+    if (quality == COMPRESSION_QUALITY_FAST) {
+        candidate.error = select_indices_projected(block, &palette, candidate.indices);
+    }
+    else {
+        candidate.error = select_indices(block, &palette, candidate.indices);
+    }
+    if (candidate.error < best->error) {
+        *best = candidate;
+    }
+}
+
+static Bc7_Mode_6 bc7_fit_mode_6(Block_Pixels *pixels, Compression_Quality quality) {
+    Block_Channels block = block_channels(pixels, 0, 4);
+    float weights[16];
+    for (int i = 0; i < 16; i++) weights[i] = bc7_weights_4[i] / 64.0f;
+
+    float e0[4], e1[4];
+    principal_endpoints(block, e0, e1);
+    Bc7_Mode_6 best = {};
+    best.error = FLT_MAX;
+    int refinements = num_refinements(quality);
+    for (int iteration = 0; iteration <= refinements; iteration++) {
+        float previous_error = best.error;
+        if (quality == COMPRESSION_QUALITY_BEST) {
+            for (int p = 0; p < 4; p++) {
+                bc7_try_mode_6(block, e0, e1, p & 1, p >> 1, quality, &best);
+            }
+        }
+        else {
+            int ignored[4];
+            int p0 = bc7_quantize_with_p_bit(e0, 1, ignored) < bc7_quantize_with_p_bit(e0, 0, ignored) ? 1 : 0;
+            int p1 = bc7_quantize_with_p_bit(e1, 1, ignored) < bc7_quantize_with_p_bit(e1, 0, ignored) ? 1 : 0;
+            bc7_try_mode_6(block, e0, e1, p0, p1, quality, &best);
+        }
+        if (iteration == refinements || best.error == 0 || best.error >= previous_error || !refine_endpoints(block, best.indices, weights, e0, e1)) {
+            break;
+        }
+    }
+    return best;
+}
+
+static void bc7_write_mode_6(Bc7_Mode_6 *mode, byte *out) {
+    int full[2][4];
+    for (int c = 0; c < 4; c++) {
+        full[0][c] = mode->endpoints[0][c];
+        full[1][c] = mode->endpoints[1][c];
+    }
+    int p_bits[2] = {mode->p_bits[0], mode->p_bits[1]};
+    if (mode->indices[0] >= 8) {
+        int swap = p_bits[0];
+        p_bits[0] = p_bits[1];
+        p_bits[1] = swap;
+    }
+    bc7_fix_anchor(full[0], full[1], 4, mode->indices, 16);
+
+    Block_Bits bits = {};
+    write_bits(&bits, 1 << 6, 7);
+    for (int c = 0; c < 4; c++) {
+        write_bits(&bits, full[0][c], 7);
+        write_bits(&bits, full[1][c], 7);
+    }
+    write_bits(&bits, p_bits[0], 1);
+    write_bits(&bits, p_bits[1], 1);
+    for (int i = 0; i < 16; i++) {
+        write_bits(&bits, mode->indices[i], i == 0 ? 3 : 4);
+    }
+    assert(bits.position == 128);
+    store_u64(out, bits.words[0]);
+    store_u64(out + 8, bits.words[1]);
+}
+
+struct Bc7_Mode_5 {
+    int rotation;
+    int color_endpoints[2][3]; // 7 bits each
+    int alpha_endpoints[2];    // 8 bits each
+    u8 color_indices[16];
+    u8 alpha_indices[16];
+    float error;
+};
+
+static inline int bc7_expand_7(int value) {
+    return (value << 1) | (value >> 6);
+}
+
+// rotation 1, 2 and 3 swap alpha with R, G and B before encoding, the decoder swaps them back
+static Bc7_Mode_5 bc7_fit_mode_5(Block_Pixels *pixels, int rotation, Compression_Quality quality) {
+    Block_Channels rotated = block_channels(pixels, 0, 4);
+    if (rotation != 0) {
+        float *swap = rotated.channels[rotation - 1];
+        rotated.channels[rotation - 1] = rotated.channels[3];
+        rotated.channels[3] = swap;
+    }
+    Block_Channels color = rotated;
+    color.count = 3;
+    Block_Channels alpha = {};
+    alpha.channels[0] = rotated.channels[3];
+    alpha.count = 1;
+    alpha.num_pixels = 16;
+
+    float weights[4];
+    for (int i = 0; i < 4; i++) weights[i] = bc7_weights_2[i] / 64.0f;
+    int refinements = num_refinements(quality);
+
+    Bc7_Mode_5 result = {};
+    result.rotation = rotation;
+
+    float color_error = FLT_MAX;
+    float e0[4], e1[4];
+    principal_endpoints(color, e0, e1);
+    for (int iteration = 0; iteration <= refinements; iteration++) {
+        int q[2][4] = {};
+        int full[2][4] = {};
+        for (int c = 0; c < 3; c++) {
+            q[0][c] = quantize(e0[c] * (127.0f / 255.0f), 127);
+            q[1][c] = quantize(e1[c] * (127.0f / 255.0f), 127);
+            full[0][c] = bc7_expand_7(q[0][c]);
+            full[1][c] = bc7_expand_7(q[1][c]);
+        }
+        Block_Palette palette = {};
+        bc7_palette(full[0], full[1], 3, bc7_weights_2, 4, &palette);
+        u8 indices[16];
+        float error = select_indices(color, &palette, indices);
+        if (error >= color_error) {
+            break;
+        }
+        color_error = error;
+        memcpy(result.color_endpoints[0], q[0], sizeof(result.color_endpoints[0]));
+        memcpy(result.color_endpoints[1], q[1], sizeof(result.color_endpoints[1]));
+        memcpy(result.color_indices, indices, sizeof(indices));
+        if (iteration == refinements || error == 0 || !refine_endpoints(color, indices, weights, e0, e1)) {
+            break;
+        }
+    }
+
+    float alpha_error = FLT_MAX;
+    principal_endpoints(alpha, e0, e1);
+    for (int iteration = 0; iteration <= refinements; iteration++) {
+        int a0 = quantize(e0[0], 255);
+        int a1 = quantize(e1[0], 255);
+        int full0[4] = {a0};
+        int full1[4] = {a1};
+        Block_Palette palette = {};
+        bc7_palette(full0, full1, 1, bc7_weights_2, 4, &palette);
+        u8 indices[16];
+        float error = select_indices(alpha, &palette, indices);
+        if (error >= alpha_error) {
+            break;
+        }
+        alpha_error = error;
+        result.alpha_endpoints[0] = a0;
+        result.alpha_endpoints[1] = a1;
+        memcpy(result.alpha_indices, indices, sizeof(indices));
+        if (iteration == refinements || error == 0 || !refine_endpoints(alpha, indices, weights, e0, e1)) {
+            break;
+        }
+    }
+
+    result.error = color_error + alpha_error;
+    return result;
+}
+
+static void bc7_write_mode_5(Bc7_Mode_5 *mode, byte *out) {
+    int color[2][4] = {};
+    for (int c = 0; c < 3; c++) {
+        color[0][c] = mode->color_endpoints[0][c];
+        color[1][c] = mode->color_endpoints[1][c];
+    }
+    int alpha[2][4] = {{mode->alpha_endpoints[0]}, {mode->alpha_endpoints[1]}};
+    bc7_fix_anchor(color[0], color[1], 3, mode->color_indices, 4);
+    bc7_fix_anchor(alpha[0], alpha[1], 1, mode->alpha_indices, 4);
+
+    Block_Bits bits = {};
+    write_bits(&bits, 1 << 5, 6);
+    write_bits(&bits, mode->rotation, 2);
+    for (int c = 0; c < 3; c++) {
+        write_bits(&bits, color[0][c], 7);
+        write_bits(&bits, color[1][c], 7);
+    }
+    write_bits(&bits, alpha[0][0], 8);
+    write_bits(&bits, alpha[1][0], 8);
+    for (int i = 0; i < 16; i++) {
+        write_bits(&bits, mode->color_indices[i], i == 0 ? 1 : 2);
+    }
+    for (int i = 0; i < 16; i++) {
+        write_bits(&bits, mode->alpha_indices[i], i == 0 ? 1 : 2);
+    }
+    assert(bits.position == 128);
+    store_u64(out, bits.words[0]);
+    store_u64(out + 8, bits.words[1]);
+}
+
+// Which subset each pixel of a two subset block is in, bit i for pixel i, and the pixel of subset 1
+// whose index has its top bit implied zero. Subset 0's is always pixel 0.
+static u16 bc7_partitions_2[64] = {
+    0xcccc, 0x8888, 0xeeee, 0xecc8, 0xc880, 0xfeec, 0xfec8, 0xec80, 0xc800, 0xffec, 0xfe80, 0xe800, 0xffe8, 0xff00, 0xfff0, 0xf000,
+    0xf710, 0x008e, 0x7100, 0x08ce, 0x008c, 0x7310, 0x3100, 0x8cce, 0x088c, 0x3110, 0x6666, 0x366c, 0x17e8, 0x0ff0, 0x718e, 0x399c,
+    0xaaaa, 0xf0f0, 0x5a5a, 0x33cc, 0x3c3c, 0x55aa, 0x9696, 0xa55a, 0x73ce, 0x13c8, 0x324c, 0x3bdc, 0x6996, 0xc33c, 0x9966, 0x0660,
+    0x0272, 0x04e4, 0x4e40, 0x2720, 0xc936, 0x936c, 0x39c6, 0x639c, 0x9336, 0x9cc6, 0x817e, 0xe718, 0xccf0, 0x0fcc, 0x7744, 0xee22,
+};
+static u8 bc7_anchors_2[64] = {
+    15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+    15,  2,  8,  2,  2,  8,  8, 15,  2,  8,  2,  2,  8,  8,  2,  2,
+    15, 15,  6,  8,  2,  8, 15, 15,  2,  8,  2,  2,  2, 15, 15,  6,
+     6,  2,  6,  8, 15, 15,  2,  2, 15, 15, 15, 15, 15,  2,  2, 15,
+};
+static int bc7_weights_3[8] = {0, 9, 18, 27, 37, 46, 55, 64};
+
+struct Bc7_Mode_1 {
+    int partition;
+    int endpoints[2][2][3]; // [subset][endpoint][channel], 6 bits each
+    int p_bits[2];          // one per subset, shared by both its endpoints
+    u8 indices[16];
+    float error;
+};
+
+static inline int bc7_expand_6_with_p_bit(int value, int p) {
+    int seven = (value << 1) | p;
+    return (seven << 1) | (seven >> 6);
+}
+
+// note(josh): the subset's pixels are gathered to the front of a block so the usual kernels can fit them
+static float bc7_fit_mode_1_subset(Block_Pixels *pixels, int partition, int subset, int refinements, Bc7_Mode_1 *out_mode) {
+    Block_Pixels gathered = {};
+    int pixel_of[16];
+    int count = 0;
+    for (int i = 0; i < 16; i++) {
+        if (((bc7_partitions_2[partition] >> i) & 1) == subset) {
+            for (int c = 0; c < 3; c++) gathered.channels[c][count] = pixels->channels[c][i];
+            pixel_of[count++] = i;
+        }
+    }
+    Block_Channels block = block_channels(&gathered, 0, 3);
+    block.num_pixels = count;
+    float weights[8];
+    for (int i = 0; i < 8; i++) weights[i] = bc7_weights_3[i] / 64.0f;
+
+    float e0[4], e1[4];
+    principal_endpoints(block, e0, e1);
+    float best_error = FLT_MAX;
+    for (int iteration = 0; iteration <= refinements; iteration++) {
+        float previous_error = best_error;
+        u8 best_iteration_indices[16];
+        for (int p = 0; p < 2; p++) {
+            int q[2][3];
+            int full[2][4] = {};
+            for (int c = 0; c < 3; c++) {
+                q[0][c] = quantize((e0[c] * (127.0f / 255.0f) - p) * 0.5f, 63);
+                q[1][c] = quantize((e1[c] * (127.0f / 255.0f) - p) * 0.5f, 63);
+                full[0][c] = bc7_expand_6_with_p_bit(q[0][c], p);
+                full[1][c] = bc7_expand_6_with_p_bit(q[1][c], p);
+            }
+            Block_Palette palette = {};
+            bc7_palette(full[0], full[1], 3, bc7_weights_3, 8, &palette);
+            u8 indices[16];
+            float error = select_indices(block, &palette, indices);
+            if (error < best_error) {
+                best_error = error;
+                out_mode->p_bits[subset] = p;
+                memcpy(out_mode->endpoints[subset], q, sizeof(q));
+                memcpy(best_iteration_indices, indices, sizeof(indices));
+                for (int i = 0; i < count; i++) out_mode->indices[pixel_of[i]] = indices[i];
+            }
+        }
+        if (iteration == refinements || best_error == 0 || best_error >= previous_error || !refine_endpoints(block, best_iteration_indices, weights, e0, e1)) {
+            break;
+        }
+    }
+    return best_error;
+}
+
+static Bc7_Mode_1 bc7_fit_mode_1(Block_Pixels *pixels, Compression_Quality quality) {
+    // note(josh): every partition gets a quick fit and only the best one is refined
+    Bc7_Mode_1 best = {};
+    best.error = FLT_MAX;
+    for (int partition = 0; partition < 64; partition++) {
+        Bc7_Mode_1 candidate = {};
+        candidate.partition = partition;
+        candidate.error = bc7_fit_mode_1_subset(pixels, partition, 0, 0, &candidate) + bc7_fit_mode_1_subset(pixels, partition, 1, 0, &candidate);
+        if (candidate.error < best.error) best = candidate;
+    }
+    int refinements = num_refinements(quality);
+    Bc7_Mode_1 refined = {};
+    refined.partition = best.partition;
+    refined.error = bc7_fit_mode_1_subset(pixels, best.partition, 0, refinements, &refined) + bc7_fit_mode_1_subset(pixels, best.partition, 1, refinements, &refined);
+    return refined.error < best.error ? refined : best;
+}
+
+static void bc7_write_mode_1(Bc7_Mode_1 *mode, byte *out) {
+    u16 mask = bc7_partitions_2[mode->partition];
+    int anchors[2] = {0, bc7_anchors_2[mode->partition]};
+    for (int subset = 0; subset < 2; subset++) {
+        if (mode->indices[anchors[subset]] < 4) continue;
+        for (int c = 0; c < 3; c++) {
+            int swap = mode->endpoints[subset][0][c];
+            mode->endpoints[subset][0][c] = mode->endpoints[subset][1][c];
+            mode->endpoints[subset][1][c] = swap;
+        }
+        for (int i = 0; i < 16; i++) {
+            if (((mask >> i) & 1) == subset) mode->indices[i] = (u8)(7 - mode->indices[i]);
+        }
+    }
+
+    Block_Bits bits = {};
+    write_bits(&bits, 1 << 1, 2);
+    write_bits(&bits, mode->partition, 6);
+    for (int c = 0; c < 3; c++) {
+        for (int subset = 0; subset < 2; subset++) {
+            write_bits(&bits, mode->endpoints[subset][0][c], 6);
+            write_bits(&bits, mode->endpoints[subset][1][c], 6);
+        }
+    }
+    write_bits(&bits, mode->p_bits[0], 1);
+    write_bits(&bits, mode->p_bits[1], 1);
+    for (int i = 0; i < 16; i++) {
+        write_bits(&bits, mode->indices[i], (i == anchors[0] || i == anchors[1]) ? 2 : 3);
+    }
+    assert(bits.position == 128);
+    store_u64(out, bits.words[0]);
+    store_u64(out + 8, bits.words[1]);
+}
+
+static void encode_bc7_block(Block_Pixels *pixels, Compression_Quality quality, byte *out) {
+    Bc7_Mode_6 mode_6 = bc7_fit_mode_6(pixels, quality);
+
+    // note(josh): mode 5 fits alpha on its own line, which only matters when there is some alpha. the
+    // rotations let it do the same for whichever color channel is least like the others.
+    Bc7_Mode_5 mode_5 = {};
+    mode_5.error = FLT_MAX;
+    if (quality == COMPRESSION_QUALITY_BEST) {
+        for (int rotation = 0; rotation < 4; rotation++) {
+            Bc7_Mode_5 candidate = bc7_fit_mode_5(pixels, rotation, quality);
+            if (candidate.error < mode_5.error) mode_5 = candidate;
+        }
+    }
+    else if (quality == COMPRESSION_QUALITY_NORMAL && mode_6.error > 0) {
+        bool has_alpha = false;
+        for (int i = 0; i < 16; i++) {
+            if (pixels->channels[3][i] != 255) has_alpha = true;
+        }
+        if (has_alpha) {
+            mode_5 = bc7_fit_mode_5(pixels, 0, quality);
+        }
+    }
+
+    // note(josh): two subsets is for blocks with an edge or two unrelated colors in them, which nothing on
+    // a single line can do well. only opaque blocks since mode 1 has no alpha, and only at the best
+    // quality since trying every partition costs more than everything else put together.
+    Bc7_Mode_1 mode_1 = {};
+    mode_1.error = FLT_MAX;
+    if (quality == COMPRESSION_QUALITY_BEST && mode_6.error > 0) {
+        bool opaque = true;
+        for (int i = 0; i < 16; i++) {
+            if (pixels->channels[3][i] != 255) opaque = false;
+        }
+        if (opaque) {
+            mode_1 = bc7_fit_mode_1(pixels, quality);
+        }
+    }
+
+    if (mode_1.error < mode_5.error && mode_1.error < mode_6.error) {
+        bc7_write_mode_1(&mode_1, out);
+    }
+    else if (mode_5.error < mode_6.error) {
+        bc7_write_mode_5(&mode_5, out);
+    }
+    else {
+        bc7_write_mode_6(&mode_6, out);
+    }
+}
+
+static void decode_bc7_block(byte *in, byte out_pixels[16][4]) {
+    Block_Bits bits = {};
+    bits.words[0] = load_u64(in);
+    bits.words[1] = load_u64(in + 8);
+    int mode = 0;
+    while (mode < 8 && read_bits(&bits, 1) == 0) mode++;
+
+    if (mode == 1) {
+        int partition = read_bits(&bits, 6);
+        int e[2][2][3];
+        for (int c = 0; c < 3; c++) {
+            for (int subset = 0; subset < 2; subset++) {
+                e[subset][0][c] = read_bits(&bits, 6);
+                e[subset][1][c] = read_bits(&bits, 6);
+            }
+        }
+        int p_bits[2];
+        p_bits[0] = read_bits(&bits, 1);
+        p_bits[1] = read_bits(&bits, 1);
+        int anchor = bc7_anchors_2[partition];
+        for (int i = 0; i < 16; i++) {
+            int subset = (bc7_partitions_2[partition] >> i) & 1;
+            int weight = bc7_weights_3[read_bits(&bits, (i == 0 || i == anchor) ? 2 : 3)];
+            for (int c = 0; c < 3; c++) {
+                int a = bc7_expand_6_with_p_bit(e[subset][0][c], p_bits[subset]);
+                int b = bc7_expand_6_with_p_bit(e[subset][1][c], p_bits[subset]);
+                out_pixels[i][c] = (byte)bc7_interpolate(a, b, weight);
+            }
+            out_pixels[i][3] = 255;
+        }
+    }
+    else if (mode == 6) {
+        int e[2][4];
+        for (int c = 0; c < 4; c++) {
+            e[0][c] = read_bits(&bits, 7) << 1;
+            e[1][c] = read_bits(&bits, 7) << 1;
+        }
+        int p0 = read_bits(&bits, 1);
+        int p1 = read_bits(&bits, 1);
+        for (int c = 0; c < 4; c++) {
+            e[0][c] |= p0;
+            e[1][c] |= p1;
+        }
+        for (int i = 0; i < 16; i++) {
+            int weight = bc7_weights_4[read_bits(&bits, i == 0 ? 3 : 4)];
+            for (int c = 0; c < 4; c++) out_pixels[i][c] = (byte)bc7_interpolate(e[0][c], e[1][c], weight);
+        }
+    }
+    else if (mode == 5) {
+        int rotation = read_bits(&bits, 2);
+        int color[2][3];
+        for (int c = 0; c < 3; c++) {
+            color[0][c] = bc7_expand_7(read_bits(&bits, 7));
+            color[1][c] = bc7_expand_7(read_bits(&bits, 7));
+        }
+        int alpha0 = read_bits(&bits, 8);
+        int alpha1 = read_bits(&bits, 8);
+        for (int i = 0; i < 16; i++) {
+            int weight = bc7_weights_2[read_bits(&bits, i == 0 ? 1 : 2)];
+            for (int c = 0; c < 3; c++) out_pixels[i][c] = (byte)bc7_interpolate(color[0][c], color[1][c], weight);
+        }
+        for (int i = 0; i < 16; i++) {
+            int weight = bc7_weights_2[read_bits(&bits, i == 0 ? 1 : 2)];
+            out_pixels[i][3] = (byte)bc7_interpolate(alpha0, alpha1, weight);
+            if (rotation != 0) {
+                byte swap = out_pixels[i][rotation - 1];
+                out_pixels[i][rotation - 1] = out_pixels[i][3];
+                out_pixels[i][3] = swap;
+            }
+        }
+    }
+    else {
+        for (int i = 0; i < 16; i++) {
+            out_pixels[i][0] = 255;
+            out_pixels[i][1] = 0;
+            out_pixels[i][2] = 255;
+            out_pixels[i][3] = 255;
+        }
+    }
+}
+
+
+
+//
+// Whole images
+//
+
+struct Compress_Job {
+    Image_Format format;
+    Compression_Quality quality;
+    byte *pixels;
+    int width;
+    int height;
+    int row_pitch;
+    int blocks_x;
+    byte *out_blocks;
+};
+
+static void compress_block_rows(void *userdata, int start, int end) {
+    Compress_Job *job = (Compress_Job *)userdata;
+    int block_size = image_format_block_size(job->format);
+    for (int block_y = start; block_y < end; block_y++) {
+        for (int block_x = 0; block_x < job->blocks_x; block_x++) {
+            Block_Pixels block;
+            load_block(job->pixels, job->width, job->height, job->row_pitch, block_x, block_y, &block);
+            byte *out = job->out_blocks + ((i64)block_y * job->blocks_x + block_x) * block_size;
+            switch (job->format) {
+                case IMAGE_FORMAT_BC1: {
+                    encode_bc1_block(&block, job->quality, out);
+                    break;
+                }
+                case IMAGE_FORMAT_BC3: {
+                    encode_bc4_block(&block, 3, job->quality, out);
+                    encode_bc1_block(&block, job->quality, out + 8);
+                    break;
+                }
+                case IMAGE_FORMAT_BC4: {
+                    encode_bc4_block(&block, 0, job->quality, out);
+                    break;
+                }
+                case IMAGE_FORMAT_BC5: {
+                    encode_bc4_block(&block, 0, job->quality, out);
+                    encode_bc4_block(&block, 1, job->quality, out + 8);
+                    break;
+                }
+                case IMAGE_FORMAT_BC7: {
+                    encode_bc7_block(&block, job->quality, out);
+                    break;
+                }
+                default: {
+                    assert(false);
+                }
+            }
+        }
+    }
+}
+
+void compress_image(Image_Format format, Compression_Quality quality, byte *pixels, int width, int height, int row_pitch, byte *out_blocks) {
+    assert(width > 0 && height > 0);
+    if (format == IMAGE_FORMAT_RGBA8) {
+        for (int y = 0; y < height; y++) {
+            memcpy(out_blocks + (i64)y * width * 4, pixels + (i64)y * row_pitch, (i64)width * 4);
+        }
+        return;
+    }
+
+    Compress_Job job = {};
+    job.format = format;
+    job.quality = quality;
+    job.pixels = pixels;
+    job.width = width;
+    job.height = height;
+    job.row_pitch = row_pitch;
+    job.blocks_x = (width + 3) / 4;
+    job.out_blocks = out_blocks;
+    parallel_for((height + 3) / 4, 4, compress_block_rows, &job);
+}
+
+void decompress_image(Image_Format format, byte *blocks, int width, int height, byte *out_pixels) {
+    if (format == IMAGE_FORMAT_RGBA8) {
+        memcpy(out_pixels, blocks, (size_t)width * height * 4);
+        return;
+    }
+
+    int block_size = image_format_block_size(format);
+    int blocks_x = (width + 3) / 4;
+    int blocks_y = (height + 3) / 4;
+    for (int block_y = 0; block_y < blocks_y; block_y++) {
+        for (int block_x = 0; block_x < blocks_x; block_x++) {
+            byte *in = blocks + ((i64)block_y * blocks_x + block_x) * block_size;
+            byte decoded[16][4] = {};
+            switch (format) {
+                case IMAGE_FORMAT_BC1: {
+                    decode_bc1_block(in, false, decoded);
+                    break;
+                }
+                case IMAGE_FORMAT_BC3: {
+                    decode_bc1_block(in + 8, true, decoded);
+                    decode_bc4_block(in, 3, decoded);
+                    break;
+                }
+                case IMAGE_FORMAT_BC4: {
+                    decode_bc4_block(in, 0, decoded);
+                    for (int i = 0; i < 16; i++) decoded[i][3] = 255;
+                    break;
+                }
+                case IMAGE_FORMAT_BC5: {
+                    decode_bc4_block(in, 0, decoded);
+                    decode_bc4_block(in + 8, 1, decoded);
+                    for (int i = 0; i < 16; i++) decoded[i][3] = 255;
+                    break;
+                }
+                case IMAGE_FORMAT_BC7: {
+                    decode_bc7_block(in, decoded);
+                    break;
+                }
+                default: {
+                    assert(false);
+                }
+            }
+            for (int y = 0; y < 4 && block_y * 4 + y < height; y++) {
+                for (int x = 0; x < 4 && block_x * 4 + x < width; x++) {
+                    memcpy(out_pixels + ((i64)(block_y * 4 + y) * width + block_x * 4 + x) * 4, decoded[y * 4 + x], 4);
+                }
+            }
+        }
+    }
+}
+
+float image_psnr(byte *a, byte *b, int width, int height, u32 channel_mask) {
+    double squared_error = 0;
+    i64 count = 0;
+    i64 num_pixels = (i64)width * height;
+    for (i64 i = 0; i < num_pixels; i++) {
+        for (int c = 0; c < 4; c++) {
+            if (channel_mask & (1 << c)) {
+                double d = (double)a[i * 4 + c] - (double)b[i * 4 + c];
+                squared_error += d * d;
+                count += 1;
+            }
+        }
+    }
+    if (count == 0 || squared_error == 0) {
+        return 999;
+    }
+    double mse = squared_error / count;
+    return (float)(10.0 * log10(255.0 * 255.0 / mse));
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "basic.h"
+
+//
+// CPU block compression for textures.
+//
+// Every BCn format stores 4x4 pixel blocks in 8 or 16 bytes, as endpoint colors and per-pixel
+// indices into a palette interpolated between them:
+//
+//   BC1  8 bytes   RGB, 565 endpoints and 2-bit indices. 4 bits per pixel.
+//   BC3  16 bytes  BC1 color plus a BC4 block for alpha.
+//   BC4  8 bytes   one channel (R), 8-bit endpoints and 3-bit indices.
+//   BC5  16 bytes  two BC4 blocks, R and G. For normal maps, the shader rebuilds z.
+//   BC7  16 bytes  RGBA, eight modes with different endpoint precision and partitions.
+//
+// The encoders fit the endpoints along the principal axis of the block's colors, pick indices and
+// then refine the endpoints by least squares on those indices. Index selection and the error sums
+// run over the block's 16 pixels in SoA f32xN registers.
+//
+// BC7 always tries mode 6 (RGBA on one line, 4-bit indices). Blocks with alpha also try mode 5 (RGB
+// and alpha on separate lines), and at the best quality every block tries mode 5 with each channel
+// rotation and opaque ones try mode 1 (two subsets of RGB, all 64 partitions). Modes 0, 2, 3, 4 and
+// 7 aren't implemented, so blocks with three distinct colors, or two plus varying alpha, come out
+// worse than a full encoder would make them.
+//
+// Everything is encoded in the space the pixels are stored in, so sRGB images stay sRGB and the GPU
+// does the conversion after decoding, the same as for an uncompressed _SRGB texture.
+//
+
+enum Image_Format {
+    IMAGE_FORMAT_RGBA8, // uncompressed, for images that can't be block compressed
+    IMAGE_FORMAT_BC1,
+    IMAGE_FORMAT_BC3,
+    IMAGE_FORMAT_BC4,
+    IMAGE_FORMAT_BC5,
+    IMAGE_FORMAT_BC7,
+
+    IMAGE_FORMAT_COUNT,
+};
+
+enum Compression_Quality {
+    COMPRESSION_QUALITY_FAST,   // one index pass on the principal axis endpoints, BC7 mode 6 only
+    COMPRESSION_QUALITY_NORMAL, // plus a least squares refinement, BC7 tries mode 5 for blocks with alpha
+    COMPRESSION_QUALITY_BEST,   // more refinement, BC4 endpoint search, BC7 p-bits, rotations and mode 1
+
+    COMPRESSION_QUALITY_COUNT,
+};
+
+const char *image_format_name(Image_Format format);
+
+// Size math. Block formats are 4x4 blocks, RGBA8 counts as 1x1 blocks of 4 bytes. A level's size
+// rounds up to whole blocks, so a 2x2 BC1 level is still one 8 byte block.
+int image_format_block_dimension(Image_Format format);
+int image_format_block_size(Image_Format format);
+i64 image_row_pitch(Image_Format format, int width);
+i64 image_level_size(Image_Format format, int width, int height);
+
+// pixels are RGBA8, row_pitch bytes between rows. Blocks that hang off the right or bottom edge
+// repeat the last column/row. BC4 encodes R, BC5 R and G, BC1 ignores alpha. The work is split
+// across threads by rows of blocks.
+void compress_image(Image_Format format, Compression_Quality quality, byte *pixels, int width, int height, int row_pitch, byte *out_blocks);
+
+// The other way, into tightly packed RGBA8. BC4 decodes to (r, 0, 0, 255) and BC5 to (r, g, 0, 255)
+// like the GPU does. For BC7 only the modes compress_image() writes are supported (1, 5 and 6),
+// other blocks come out magenta.
+void decompress_image(Image_Format format, byte *blocks, int width, int height, byte *out_pixels);
+
+// PSNR in dB over the channels in channel_mask (bit 0 R ... bit 3 A) of two tightly packed RGBA8
+// images, for checking what an encoder does to an image. Identical images return 999.
+float image_psnr(byte *a, byte *b, int width, int height, u32 channel_mask);
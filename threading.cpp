@@ -0,0 +1,88 @@
+#include "threading.h"
+
+#include <thread>
+#include <atomic>
+
+int num_hardware_threads() {
+    int n = (int)std::thread::hardware_concurrency();
+    return n > 0 ? n : 1;
+}
+
+Thread create_thread(void (*proc)(void *userdata), void *userdata) {
+    Thread thread = {};
+    thread.handle = new std::thread(proc, userdata);
+    return thread;
+}
+
+void join_thread(Thread thread) {
+    std::thread *t = (std::thread *)thread.handle;
+    assert(t != nullptr);
+    t->join();
+    delete t;
+}
+
+
+
+struct Parallel_For_State {
+    std::atomic<int> next;
+    int count;
+    int batch_size;
+    Parallel_For_Proc proc;
+    void *userdata;
+};
+
+static void parallel_for_worker(void *userdata) {
+    Parallel_For_State *state = (Parallel_For_State *)userdata;
+    while (true) {
+        int start = state->next.fetch_add(state->batch_size);
+        if (start >= state->count) {
+            break;
+        }
+        int end = start + state->batch_size;
+        if (end > state->count) {
+            end = state->count;
+        }
+        state->proc(state->userdata, start, end);
+    }
+}
+
+void parallel_for(int count, int batch_size, Parallel_For_Proc proc, void *userdata) {
+    if (count <= 0) {
+        return;
+    }
+    if (batch_size < 1) {
+        batch_size = 1;
+    }
+
+    int num_batches = (count + batch_size - 1) / batch_size;
+    int num_threads = num_hardware_threads();
+    if (num_threads > num_batches) {
+        num_threads = num_batches;
+    }
+    if (num_threads <= 1) {
+        proc(userdata, 0, count);
+        return;
+    }
+
+    Parallel_For_State state;
+    state.next = 0;
+    state.count = count;
+    state.batch_size = batch_size;
+    state.proc = proc;
+    state.userdata = userdata;
+
+    // note(josh): the calling thread works too, so we only need num_threads-1 extra
+    const int MAX_THREADS = 64;
+    Thread threads[MAX_THREADS];
+    int num_extra = num_threads - 1;
+    if (num_extra > MAX_THREADS) {
+        num_extra = MAX_THREADS;
+    }
+    for (int i = 0; i < num_extra; i++) {
+        threads[i] = create_thread(parallel_for_worker, &state);
+    }
+    parallel_for_worker(&state);
+    for (int i = 0; i < num_extra; i++) {
+        join_thread(threads[i]);
+    }
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "basic.h"
+
+//
+// Bare minimum threading. Everything here is a thin layer over std::thread so it builds the same on
+// every platform we care about.
+//
+
+int num_hardware_threads();
+
+struct Thread {
+    void *handle;
+};
+
+Thread create_thread(void (*proc)(void *userdata), void *userdata);
+void join_thread(Thread thread);
+
+// Calls proc on [start, end) ranges of at most batch_size items until all of [0, count) is done,
+// spread across up to num_hardware_threads() threads including the calling one. Returns once
+// everything is finished. Ranges are handed out in no particular order.
+typedef void (*Parallel_For_Proc)(void *userdata, int start, int end);
+void parallel_for(int count, int batch_size, Parallel_For_Proc proc, void *userdata);
@@ -9,6 +9,25 @@ struct VS_INPUT {
     float3 bitangent : BITANGENT;
 };
 
+// Compact_Vertex in renderer.h
+struct COMPACT_VS_INPUT {
+    float3 position : SV_POSITION;
+    float2 texcoord : TEXCOORD;
+    float2 normal   : NORMAL;  // octahedral
+    float4 tangent  : TANGENT; // octahedral in xy remapped to [0, 1], bitangent sign in w
+};
+
+// depth_vertex.hlsl, just Loaded_Mesh::position_buffer
+struct DEPTH_VS_INPUT {
+    float3 position : SV_POSITION;
+};
+
+// depth_pixel.hlsl only needs the position, so this is a prefix of PS_INPUT and the shader works
+// behind vertex.hlsl too
+struct DEPTH_PS_INPUT {
+    float4 position : SV_POSITION;
+};
+
 struct PS_INPUT {
     float4 position         : SV_POSITION;
     float3 texcoord         : TEXCOORD;
@@ -77,6 +96,7 @@ cbuffer CBUFFER_LIGHTING : register(b3) {
     float ambient_modifier;
     int has_skybox_map;
     float4 skybox_color;
+    float4 skybox_sh[9]; // diffuse ambient from the skybox as L2 spherical harmonics, see sh_diffuse_ambient()
 };
 
 cbuffer CBUFFER_BLUR : register(b4) {